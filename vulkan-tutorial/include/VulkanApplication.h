@@ -4,6 +4,17 @@
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 
+#include "vulkan_utils.h"
+#include "device_features.h"
+#include "depth_pyramid.h"
+#include "meshlet_scene.h"
+#include "gpu_scene.h"
+#include "uniform_ring.h"
+#include "cpu_culling.h"
+#include "pipeline_permutations.h"
+#include "shader_hot_reload.h"
+
+#include <string>
 #include <vector>
 
 namespace VulkanApp {
@@ -16,19 +27,57 @@ struct VulkanState
     VkSurfaceKHR VkSurface{nullptr};
     VkPhysicalDevice VkPhysicalDevice{nullptr};
     VkDevice VkDevice{nullptr};
+    DeviceFeatureChain EnabledFeatures{};
+    QueueFamilyIndices QueueFamilies;
     VkQueue VkGraphicsQueue{nullptr};
     VkQueue VkPresentQueue{nullptr};
+    VkQueue VkComputeQueue{nullptr};
+    VkQueue VkTransferQueue{nullptr};
     VkSwapchainKHR VkSwapchain{nullptr};
     std::vector<VkImage> SwapchainImages;
     VkFormat Format{};
     VkExtent2D Extent{};
     std::vector<VkImageView> SwapchainImageViews;
+    VkFormat DepthFormat{};
+    VkImage DepthImage{nullptr};
+    VkDeviceMemory DepthImageMemory{nullptr};
+    VkImageView DepthImageView{nullptr};
+    DepthPyramid DepthPyramid;
+    // RenderPass clears and draws the early cull pass; LateRenderPass loads its results and
+    // draws what the late pass found. They are compatible, so pipelines work with both.
     VkRenderPass RenderPass{nullptr};
+    VkRenderPass LateRenderPass{nullptr};
+    VkDescriptorSetLayout SceneDescriptorSetLayout{nullptr};
     VkPipelineLayout PipelineLayout{nullptr};
+    PipelinePermutationCache PipelinePermutations;
+    PipelineKey DefaultPipelineKey;
+    // Materials share a pipeline id when they map to the same PipelineKey; ScenePipelines holds
+    // the resolved pipeline per id and is refreshed after shader hot reloads
+    std::vector<MaterialDesc> Materials;
+    std::vector<uint32_t> MaterialPipelines;
+    std::vector<PipelineKey> PipelineKeys;
+    std::vector<VkPipeline> ScenePipelines;
+    ShaderHotReloader ShaderHotReload;
     VkPipeline GraphicsPipeline{nullptr};
     std::vector<VkFramebuffer> SwapchainFramebuffers;
     VkCommandPool CommandPool{nullptr};
+    VkCommandPool ComputeCommandPool{nullptr};
+    VkCommandPool TransferCommandPool{nullptr};
     VkCommandBuffer CommandBuffer{nullptr};
+    UniformRing UniformRing;
+    GpuScene Scene;
+    MeshletScene Meshlets;
+    std::vector<GpuObjectData> SceneObjects;
+    std::vector<MeshRange> SceneMeshes;
+    std::vector<DrawItem> SceneObjectDraws; // One per object, copied for visible objects
+    CullingBounds SceneBounds;
+    std::vector<uint32_t> VisibleObjects;
+    // CPU culling path: threads and per-chunk lists reused every frame
+    WorkerPool CullingWorkers;
+    std::vector<std::vector<uint32_t>> CullingChunkVisible;
+    DrawQueue DrawQueue;
+    std::vector<DrawBatch> DrawBatches;
+    std::vector<uint32_t> InstanceObjects;
     VkSemaphore ImageAvailableSemaphore{nullptr};
     VkSemaphore RenderFinishedSemaphore{nullptr};
     VkFence InFlightFence{nullptr};
@@ -43,18 +92,27 @@ void createInstance(VulkanState& state);
 void setupDebugMessenger(VulkanState& state);
 void createSurface(VulkanState& state);
 void pickPhysicalDevice(VulkanState& state);
+std::vector<DeviceFeatureRequest> getDeviceFeatureRequests();
 void createLogicalDevice(VulkanState& state);
 void createSwapchain(VulkanState& state);
 void createImageViews(VulkanState& state);
+void createDepthResources(VulkanState& state);
 void createRenderPass(VulkanState& state);
+void createDescriptorSetLayout(VulkanState& state);
+void createPipelineLayout(VulkanState& state);
+void loadShaders(VulkanState& state);
 void createGraphicsPipeline(VulkanState& state);
+void resolveScenePipelines(VulkanState& state);
 void createFramebuffers(VulkanState& state);
 void createCommandPool(VulkanState& state);
 void createCommandBuffer(VulkanState& state);
+void createScene(VulkanState& state);
 void createSyncObjects(VulkanState& state);
 
 void recordCommandBuffer(VulkanState& state, VkCommandBuffer commandBuffer, uint32_t imageIndex);
 
+void runSortBenchmark(VulkanState& state, const std::string& keyCountText);
+
 void mainLoop(VulkanState& state);
 void drawFrame(VulkanState& state);
 
@@ -0,0 +1,72 @@
+#ifndef COMPUTE_H
+#define COMPUTE_H
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+#include <vector>
+
+// A compute pipeline with its layout. Push constants are visible to the compute stage only;
+// kernels that take their buffers as device addresses need no descriptor sets at all.
+struct ComputeKernel
+{
+    uint32_t pushConstantSize{0};
+
+    VkShaderModule shaderModule{nullptr};
+    VkPipelineLayout pipelineLayout{nullptr};
+    VkPipeline pipeline{nullptr};
+};
+
+// Records dispatches into one command buffer and inserts the barriers between them. Each
+// dispatch names the buffers it reads and writes; a barrier is recorded only before a dispatch
+// that reads or writes a buffer written since the last barrier, or writes one read since then,
+// so independent dispatches can overlap.
+struct ComputeRecorder
+{
+    VkCommandBuffer commandBuffer{nullptr};
+    VkPipeline boundPipeline{nullptr};
+    std::vector<VkBuffer> pendingReads;
+    std::vector<VkBuffer> pendingWrites;
+    uint32_t dispatchCount{0};
+    uint32_t barrierCount{0};
+};
+
+// Takes ownership of shaderModule. specializationConstants are uint32_t values for
+// constant_id 0, 1, ... in order.
+void createComputeKernel(
+    ComputeKernel& kernel,
+    const VkDevice& device,
+    VkShaderModule shaderModule,
+    const std::vector<VkDescriptorSetLayout>& setLayouts,
+    uint32_t pushConstantSize,
+    const std::vector<uint32_t>& specializationConstants = {});
+void destroyComputeKernel(ComputeKernel& kernel, const VkDevice& device);
+
+// Anything the first dispatch reads must already be visible to compute shaders
+void beginComputeRecording(ComputeRecorder& recorder, VkCommandBuffer commandBuffer);
+// pushConstants must hold kernel.pushConstantSize bytes. Descriptor sets, if the kernel has
+// any, are bound by the caller on recorder.commandBuffer with kernel.pipelineLayout.
+void recordComputeDispatch(
+    ComputeRecorder& recorder,
+    const ComputeKernel& kernel,
+    const void* pushConstants,
+    uint32_t groupCountX,
+    uint32_t groupCountY,
+    uint32_t groupCountZ,
+    const std::vector<VkBuffer>& reads,
+    const std::vector<VkBuffer>& writes);
+// Same, with the group counts read from a VkDispatchIndirectCommand at argumentOffset, e.g. one
+// a previous dispatch sized from a count it produced
+void recordComputeDispatchIndirect(
+    ComputeRecorder& recorder,
+    const ComputeKernel& kernel,
+    const void* pushConstants,
+    VkBuffer argumentBuffer,
+    VkDeviceSize argumentOffset,
+    const std::vector<VkBuffer>& reads,
+    const std::vector<VkBuffer>& writes);
+// Makes the writes still pending visible to the given consumer stage and access
+void endComputeRecording(ComputeRecorder& recorder, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess);
+
+#endif
@@ -10,6 +10,28 @@ const static uint32_t DEFAULT_WINDOW_HEIGHT = 600;
 const static std::string DEFAULT_WINDOW_NAME = "Vulkan Window";
 const static std::string APPLICATION_NAME = "Vulkan Application";
 const static std::string ENGINE_NAME = "No Engine";
+const static std::string SHADER_DIRECTORY = "shaders";
+const static uint32_t STARTUP_WORKER_COUNT_MAX = 4;
+const static uint32_t VULKAN_API_VERSION = VK_API_VERSION_1_3;
+// The demo scene is a SCENE_GRID_SIZE x SCENE_GRID_SIZE grid of objects, partly off screen
+const static uint32_t SCENE_GRID_SIZE = 320;
+// false skips the GPU cull passes: the CPU frustum-culls the scene, sorts the visible draws
+// by key into batches and records one instanced draw per batch
+const static bool GPU_DRIVEN_RENDERING = true;
+// true replaces per-object culling with per-meshlet frustum and normal cone culling: task and
+// mesh shaders where VK_EXT_mesh_shader is supported, a compute pass plus indirect draws elsewhere
+const static bool MESHLET_RENDERING = false;
+const static uint32_t CPU_CULLING_WORKER_COUNT_MAX = 4;
+
+// Forces a specific GPU instead of the highest scoring one. Either "vendorID:deviceID" in hex
+// (e.g. "10de:2684") or a device UUID. The environment variable takes precedence over the constant.
+const static char* const PHYSICAL_DEVICE_OVERRIDE_ENV = "VULKAN_PHYSICAL_DEVICE";
+const static std::string PHYSICAL_DEVICE_OVERRIDE = "";
+
+// Set to a key count (e.g. "16777216") to time the GPU radix sort on the selected device and
+// print keys per second instead of entering the render loop
+const static char* const SORT_BENCHMARK_ENV = "VULKAN_SORT_BENCHMARK";
+const static uint32_t SORT_BENCHMARK_ITERATIONS = 20;
 
 static std::vector<const char*> VALIDATION_LAYERS = {
     "VK_LAYER_KHRONOS_validation"
@@ -19,6 +41,13 @@ const static std::vector<const char*> REQUIRED_DEVICE_EXTENSIONS = {
     VK_KHR_SWAPCHAIN_EXTENSION_NAME
 };
 
+// Not required, but devices exposing them score higher in pickPhysicalDevice()
+const static std::vector<const char*> PREFERRED_DEVICE_EXTENSIONS = {
+    VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME,
+    VK_EXT_MESH_SHADER_EXTENSION_NAME,
+    VK_EXT_MEMORY_BUDGET_EXTENSION_NAME
+};
+
 #ifdef NDEBUG
 const static bool VALIDATION_LAYERS_ENABLE = false;
 #else
@@ -0,0 +1,50 @@
+#ifndef CPU_CULLING_H
+#define CPU_CULLING_H
+
+#include "frustum.h"
+#include "task_graph.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// Bounds in structure-of-arrays layout so one SIMD register holds the same component of
+// 4 (SSE) or 8 (AVX) objects. Every entry is a box swept by a sphere: spheres have zero
+// extents, boxes zero radius, and both go through the same plane test.
+struct CullingBounds
+{
+    std::vector<float> centerX;
+    std::vector<float> centerY;
+    std::vector<float> centerZ;
+    std::vector<float> extentX; // Half extents of an axis-aligned box
+    std::vector<float> extentY;
+    std::vector<float> extentZ;
+    std::vector<float> radius;
+};
+
+// Both return the index of the new entry
+uint32_t addBoundingSphere(CullingBounds& bounds, const glm::vec3& center, float radius);
+uint32_t addBoundingBox(CullingBounds& bounds, const glm::vec3& boxMin, const glm::vec3& boxMax);
+uint32_t getBoundsCount(const CullingBounds& bounds);
+
+// Appends the indices in [first, last) that intersect the frustum to `visible`, in ascending order
+void cullBounds(
+    const CullingBounds& bounds,
+    const Frustum& frustum,
+    uint32_t first,
+    uint32_t last,
+    std::vector<uint32_t>& visible);
+
+// Culls every entry in chunks of chunkSize spread over the pool, and replaces `visible` with
+// the compacted visible indices in ascending order. chunkVisible holds one list per chunk;
+// keep it between calls so the lists keep their storage.
+void cullBoundsParallel(
+    const CullingBounds& bounds,
+    const Frustum& frustum,
+    std::vector<uint32_t>& visible,
+    WorkerPool& workers,
+    std::vector<std::vector<uint32_t>>& chunkVisible,
+    uint32_t chunkSize = 16384);
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef DEPTH_PYRAMID_H
+#define DEPTH_PYRAMID_H
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include "downsampler.h"
+
+#include <cstdint>
+
+// A 2048x2048 pyramid has 12 levels, all built in one downsample dispatch
+const static uint32_t DEPTH_PYRAMID_MAX_MIPS = DOWNSAMPLE_MAX_MIPS;
+
+// Hierarchical-Z buffer: every texel holds the farthest depth of the screen region it covers,
+// so an object whose nearest depth lies behind it is fully occluded. Level 0 is the depth
+// buffer rounded down to a power of two (conservatively reduced), each further level halves.
+//
+// Built by one max-reduction dispatch of the single-pass downsampler (downsample_r32f.comp),
+// so no per-level barriers or dispatches are needed.
+struct DepthPyramid
+{
+    uint32_t width{0};
+    uint32_t height{0};
+    uint32_t mipCount{0};
+
+    VkImage image{nullptr};
+    VkDeviceMemory imageMemory{nullptr};
+    VkImageView view{nullptr}; // All levels, for sampling
+    VkSampler sampler{nullptr}; // Nearest, clamp to edge; used with texelFetch
+
+    Downsampler downsampler;
+    DownsampleChain chain; // Every level, reduced from the depth buffer
+};
+
+// The pyramid takes ownership of shaderModule, which must be downsample_r32f.comp or
+// downsample_subgroup_r32f.comp. depthView must be sampled in
+// VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL when the pyramid is built.
+void createDepthPyramid(
+    DepthPyramid& pyramid,
+    const VkDevice& device,
+    const VkPhysicalDevice& physicalDevice,
+    const VkCommandPool& commandPool,
+    const VkQueue& queue,
+    VkExtent2D depthExtent,
+    const VkImageView& depthView,
+    VkShaderModule shaderModule);
+
+// Records the build and a barrier making the pyramid readable by later compute work
+void recordDepthPyramidBuild(VkCommandBuffer commandBuffer, const DepthPyramid& pyramid, VkExtent2D depthExtent);
+
+void destroyDepthPyramid(DepthPyramid& pyramid, const VkDevice& device);
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef DEVICE_FEATURES_H
+#define DEVICE_FEATURES_H
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// VkPhysicalDeviceFeatures2 with the core 1.1/1.2/1.3 feature structs chained behind it,
+// followed by the structs of optional device extensions.
+// The pNext links point into the struct itself, so relink after copying one.
+struct DeviceFeatureChain
+{
+    VkPhysicalDeviceFeatures2 features2;
+    VkPhysicalDeviceVulkan11Features vulkan11;
+    VkPhysicalDeviceVulkan12Features vulkan12;
+    VkPhysicalDeviceVulkan13Features vulkan13;
+    VkPhysicalDeviceMeshShaderFeaturesEXT meshShader; // VK_EXT_mesh_shader
+};
+
+// Zeroes every feature and links only the structs the device's API version and extensions
+// know about
+void initDeviceFeatureChain(DeviceFeatureChain& chain, uint32_t deviceApiVersion, bool meshShaderExtension = false);
+
+// Device extensions whose feature structs are linked into the chain; they must be enabled
+// on the device the chain is passed to
+std::vector<const char*> getFeatureDeviceExtensions(const DeviceFeatureChain& enabled);
+
+using DeviceFeatureSelector = VkBool32& (*)(DeviceFeatureChain& chain);
+
+// Expands to the name/selector argument pair of requestDeviceFeature(),
+// e.g. DEVICE_FEATURE(vulkan12.timelineSemaphore)
+#define DEVICE_FEATURE(member) #member, [](DeviceFeatureChain& chain) -> VkBool32& { return chain.member; }
+
+struct DeviceFeatureRequest
+{
+    const char* name;
+    DeviceFeatureSelector select;
+    bool required;
+};
+
+void requestDeviceFeature(
+    std::vector<DeviceFeatureRequest>& requests,
+    const char* name,
+    DeviceFeatureSelector select,
+    bool required);
+
+// Queries support through vkGetPhysicalDeviceFeatures2 and fills `enabled` with the
+// intersection of requested and supported features. Throws if a required one is missing.
+void negotiateDeviceFeatures(
+    const VkPhysicalDevice& physicalDevice,
+    const std::vector<DeviceFeatureRequest>& requests,
+    DeviceFeatureChain& enabled);
+
+std::vector<std::string> getMissingRequiredDeviceFeatures(
+    const VkPhysicalDevice& physicalDevice,
+    const std::vector<DeviceFeatureRequest>& requests);
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef DEVICE_POINTER_H
+#define DEVICE_POINTER_H
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+
+// Typed VkDeviceAddress: a GPU pointer to T, laid out as a single uint64 so it can sit in push
+// constants or storage buffers where the shader declares the matching buffer_reference type
+// (GL_EXT_buffer_reference). Arithmetic is in elements, as with a C++ pointer. The buffer
+// must be created with VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT; see getDevicePointer().
+template <typename T>
+struct DevicePointer
+{
+    VkDeviceAddress address{0};
+
+    DevicePointer<T> operator+(uint64_t count) const { return DevicePointer<T>{address + count * sizeof(T)}; }
+    explicit operator bool() const { return address != 0; }
+};
+static_assert(sizeof(DevicePointer<uint32_t>) == 8, "DevicePointer must match a GLSL buffer_reference");
+
+#endif
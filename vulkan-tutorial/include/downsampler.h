@@ -0,0 +1,107 @@
+#ifndef DOWNSAMPLER_H
+#define DOWNSAMPLER_H
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Matches MAX_MIPS in downsample.glsl; a 2048x2048 destination has 12 levels
+const static uint32_t DOWNSAMPLE_MAX_MIPS = 12;
+
+// Fed to downsample.glsl as the specialization constant REDUCTION
+enum DownsampleReduction : uint32_t
+{
+    DOWNSAMPLE_REDUCTION_AVERAGE = 0, // Mip chains, bloom
+    DOWNSAMPLE_REDUCTION_MAX = 1,     // Hi-Z with standard depth (farthest = 1)
+    DOWNSAMPLE_REDUCTION_MIN = 2,     // Hi-Z with reversed depth
+};
+
+struct DownsamplePushConstants
+{
+    int32_t sourceSize[2];
+    int32_t destinationSize[2];
+    uint32_t mipCount;
+    uint32_t workgroupCount;
+};
+
+// The compute pipeline for one destination format and reduction, shared by every chain
+// built with it. Formats with downsample_*.comp and downsample_subgroup_*.comp variants:
+// R32_SFLOAT, R8G8B8A8_UNORM and R16G16B16A16_SFLOAT.
+struct Downsampler
+{
+    VkFormat format{VK_FORMAT_UNDEFINED};
+    DownsampleReduction reduction{DOWNSAMPLE_REDUCTION_AVERAGE};
+
+    VkSampler sampler{nullptr}; // Nearest, clamp to edge; the source is read with texelFetch
+    VkDescriptorSetLayout setLayout{nullptr};
+    VkShaderModule shaderModule{nullptr};
+    VkPipelineLayout pipelineLayout{nullptr};
+    VkPipeline pipeline{nullptr};
+};
+
+// Up to DOWNSAMPLE_MAX_MIPS consecutive levels of one image, generated from a source view
+// by a single dispatch of downsample.glsl
+struct DownsampleChain
+{
+    uint32_t width{0}; // Of the first destination level
+    uint32_t height{0};
+    uint32_t mipCount{0};
+
+    std::vector<VkImageView> mipViews; // One per destination level, for storage writes
+
+    VkBuffer counterBuffer{nullptr};
+    VkDeviceMemory counterBufferMemory{nullptr};
+
+    VkDescriptorPool descriptorPool{nullptr};
+    VkDescriptorSet descriptorSet{nullptr};
+};
+
+// The downsample_subgroup_*.comp variants reduce level 2 with subgroup quad operations rather
+// than shared memory. They are built for Vulkan 1.2 and need quad operations in compute shaders.
+bool hasDownsampleSubgroupSupport(const VkPhysicalDevice& physicalDevice);
+
+// Name of the downsample_*.comp variant for `format`, for loadShaderModule(). subgroupReduction
+// picks the downsample_subgroup_*.comp variant, see hasDownsampleSubgroupSupport().
+std::string getDownsampleShaderName(VkFormat format, bool subgroupReduction = false);
+
+// The downsampler takes ownership of shaderModule, which must be the variant for `format`
+void createDownsampler(
+    Downsampler& downsampler,
+    const VkDevice& device,
+    VkFormat format,
+    DownsampleReduction reduction,
+    VkShaderModule shaderModule);
+void destroyDownsampler(Downsampler& downsampler, const VkDevice& device);
+
+// Levels [baseLevel, baseLevel + mipCount) of `image`, which are width x height and smaller.
+// sourceView is not owned and must be in sourceLayout whenever the chain is recorded; the
+// destination levels must be in VK_IMAGE_LAYOUT_GENERAL.
+void createDownsampleChain(
+    DownsampleChain& chain,
+    const VkDevice& device,
+    const VkPhysicalDevice& physicalDevice,
+    const VkCommandPool& commandPool,
+    const VkQueue& queue,
+    const Downsampler& downsampler,
+    const VkImage& image,
+    uint32_t baseLevel,
+    uint32_t width,
+    uint32_t height,
+    uint32_t mipCount,
+    const VkImageView& sourceView,
+    VkImageLayout sourceLayout);
+void destroyDownsampleChain(DownsampleChain& chain, const VkDevice& device);
+
+// Records the dispatch only; the caller adds whatever barrier its readers need. Each texel of
+// the first level reduces every source texel it covers, so sourceExtent may be any size at
+// least the chain's; up to twice it keeps that to a 3x3 footprint.
+void recordDownsample(
+    VkCommandBuffer commandBuffer,
+    const Downsampler& downsampler,
+    const DownsampleChain& chain,
+    VkExtent2D sourceExtent);
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef DRAW_BATCHING_H
+#define DRAW_BATCHING_H
+
+#include <cstdint>
+#include <vector>
+
+// One visible object waiting to be drawn
+struct DrawItem
+{
+    uint32_t pass{0}; // Submission bucket, lower passes are recorded first
+    uint32_t pipeline;
+    uint32_t mesh;
+    uint32_t material;
+    uint32_t objectIndex;
+    float depth{0.0f}; // Clip-space z; within a state group items are ordered front to back
+};
+
+// A run of objects sharing pass, pipeline, material and mesh, drawn as one instanced draw.
+// Instances [firstInstance, firstInstance + instanceCount) of the instance stream hold
+// the object indices.
+struct DrawBatch
+{
+    uint32_t pass;
+    uint32_t pipeline;
+    uint32_t mesh;
+    uint32_t material;
+    uint32_t firstInstance;
+    uint32_t instanceCount;
+};
+
+// Sort key layout, most significant first. Sorting by key groups draws by the state that is
+// most expensive to change, so recording only rebinds when a field actually changes.
+const static uint32_t DRAW_KEY_PASS_BITS = 4;
+const static uint32_t DRAW_KEY_PIPELINE_BITS = 12;
+const static uint32_t DRAW_KEY_MATERIAL_BITS = 12;
+const static uint32_t DRAW_KEY_MESH_BITS = 12;
+const static uint32_t DRAW_KEY_DEPTH_BITS = 24;
+static_assert(
+    DRAW_KEY_PASS_BITS + DRAW_KEY_PIPELINE_BITS + DRAW_KEY_MATERIAL_BITS + DRAW_KEY_MESH_BITS + DRAW_KEY_DEPTH_BITS
+        == 64,
+    "Draw sort key fields must fill 64 bits");
+
+struct DrawSortEntry
+{
+    uint64_t key;
+    uint32_t item; // Index into DrawQueue::items
+};
+
+// Per-frame draw submission queue. The vectors keep their capacity across frames.
+struct DrawQueue
+{
+    std::vector<DrawItem> items;
+    std::vector<DrawSortEntry> entries;
+    std::vector<DrawSortEntry> scratch;
+};
+
+// Throws if an id does not fit its key field
+uint64_t packDrawSortKey(const DrawItem& item);
+
+void resetDrawQueue(DrawQueue& queue);
+void submitDraw(DrawQueue& queue, const DrawItem& item);
+
+// LSD radix sort on the 64-bit key, 8 bits per pass; passes where every key has the same
+// digit are skipped. Stable, so equal keys keep submission order. scratch is resized as needed.
+void radixSortDrawKeys(std::vector<DrawSortEntry>& entries, std::vector<DrawSortEntry>& scratch);
+
+// Sorts the queue by key, merges runs with equal (pass, pipeline, material, mesh) into batches
+// and writes the per-instance object indices in batch order
+void buildDrawBatches(DrawQueue& queue, std::vector<DrawBatch>& batches, std::vector<uint32_t>& instanceObjects);
+
+#endif
@@ -0,0 +1,19 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <glm/glm.hpp>
+
+// Six inward-facing planes (xyz = normal, w = distance) in the space the matrix maps from.
+// Order: left, right, top, bottom, near, far.
+struct Frustum
+{
+    glm::vec4 planes[6];
+};
+
+// Gribb/Hartmann plane extraction for Vulkan clip space (0 <= z <= w). Planes are normalized,
+// so dot(plane.xyz, p) + plane.w is a signed distance.
+Frustum extractFrustum(const glm::mat4& viewProjection);
+
+bool isSphereInFrustum(const Frustum& frustum, const glm::vec3& center, float radius);
+
+#endif
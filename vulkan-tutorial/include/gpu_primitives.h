@@ -0,0 +1,199 @@
+#ifndef GPU_PRIMITIVES_H
+#define GPU_PRIMITIVES_H
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include "compute.h"
+#include "device_features.h"
+#include "device_pointer.h"
+
+#include <cstdint>
+
+// Match WORKGROUP_SIZE and ITEMS_PER_THREAD in primitives.glsl. Every kernel handles one
+// block of GPU_PRIMITIVE_BLOCK_SIZE elements per workgroup.
+const static uint32_t GPU_PRIMITIVE_WORKGROUP_SIZE = 256;
+const static uint32_t GPU_PRIMITIVE_ITEMS_PER_THREAD = 4;
+const static uint32_t GPU_PRIMITIVE_BLOCK_SIZE = GPU_PRIMITIVE_WORKGROUP_SIZE * GPU_PRIMITIVE_ITEMS_PER_THREAD;
+
+// Match primitive_sort.glsl: least significant digit first, 8 bits per pass, one thread per digit
+const static uint32_t GPU_RADIX_BITS = 8;
+const static uint32_t GPU_RADIX_SIZE = 1 << GPU_RADIX_BITS;
+const static uint32_t GPU_RADIX_PASS_COUNT = 32 / GPU_RADIX_BITS;
+// Look-back status words keep 30 bits for the count
+const static uint32_t GPU_RADIX_SORT_MAX_COUNT = (1u << 30) - 1;
+
+// Fed to primitive_reduce.comp as the specialization constant REDUCE_OP
+enum GpuReduceOp : uint32_t
+{
+    GPU_REDUCE_ADD = 0,
+    GPU_REDUCE_MIN = 1,
+    GPU_REDUCE_MAX = 2,
+    GPU_REDUCE_OP_COUNT = 3,
+};
+
+// A range of uint32_t elements in a buffer created with VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT.
+// The kernels address it through data; buffer is what the ComputeRecorder tracks for barriers.
+struct GpuArray
+{
+    VkBuffer buffer{nullptr};
+    VkDeviceSize offset{0}; // Of data in bytes, for commands that take the buffer
+    DevicePointer<uint32_t> data;
+};
+
+// The whole of `buffer`
+GpuArray getGpuArray(const VkDevice& device, VkBuffer buffer);
+// The elements of `array` from `first` on
+GpuArray getGpuSubArray(const GpuArray& array, uint64_t first);
+
+// Mirror the push constant blocks of the primitive_*.comp kernels
+struct GpuReducePushConstants
+{
+    DevicePointer<uint32_t> source;
+    DevicePointer<uint32_t> destination;
+    uint32_t count;
+};
+
+struct GpuScanPushConstants
+{
+    DevicePointer<uint32_t> source;
+    DevicePointer<uint32_t> destination;
+    DevicePointer<uint32_t> blockSums;
+    uint32_t count;
+    uint32_t writeBlockSums;
+};
+
+struct GpuScanAddPushConstants
+{
+    DevicePointer<uint32_t> data;
+    DevicePointer<uint32_t> blockOffsets;
+    uint32_t count;
+};
+
+struct GpuCompactPushConstants
+{
+    DevicePointer<uint32_t> source;
+    DevicePointer<uint32_t> flags;
+    DevicePointer<uint32_t> offsets;
+    DevicePointer<uint32_t> destination;
+    DevicePointer<uint32_t> destinationCount;
+    uint32_t count;
+};
+
+struct GpuSortSetupPushConstants
+{
+    DevicePointer<uint32_t> state;
+    DevicePointer<uint32_t> histogram;
+    DevicePointer<uint32_t> countSource;
+    uint32_t count;
+    uint32_t useCountSource;
+    uint32_t maxCount;
+};
+
+struct GpuSortHistogramPushConstants
+{
+    DevicePointer<uint32_t> keys;
+    DevicePointer<uint32_t> state;
+    DevicePointer<uint32_t> histogram;
+    DevicePointer<uint32_t> status;
+    uint32_t maxPartitions;
+};
+
+struct GpuSortOnesweepPushConstants
+{
+    DevicePointer<uint32_t> keys;
+    DevicePointer<uint32_t> values;
+    DevicePointer<uint32_t> keysOut;
+    DevicePointer<uint32_t> valuesOut;
+    DevicePointer<uint32_t> state;
+    DevicePointer<uint32_t> histogram;
+    DevicePointer<uint32_t> status;
+    uint32_t pass;
+    uint32_t maxPartitions;
+    uint32_t hasValues;
+};
+
+// Reduce, exclusive scan, stream compaction and radix sort over uint32_t arrays. Each record*()
+// function appends its dispatches to a ComputeRecorder, which places the barriers between them,
+// so several primitives can share one command buffer. Temporary data goes to a caller-provided
+// scratch array sized with the matching get*ScratchCount().
+struct GpuPrimitives
+{
+    uint32_t maxWorkgroupCount{0};
+
+    ComputeKernel reduce[GPU_REDUCE_OP_COUNT];
+    ComputeKernel scan;
+    ComputeKernel scanAdd;
+    ComputeKernel compact;
+    ComputeKernel sortSetup;
+    ComputeKernel sortHistogram;
+    ComputeKernel sortOnesweep;
+};
+
+// The kernels are built for Vulkan 1.2 and need basic, arithmetic and ballot subgroup operations
+// in compute shaders, 256-invocation workgroups and the bufferDeviceAddress feature
+bool hasGpuPrimitivesSupport(const VkPhysicalDevice& physicalDevice, const DeviceFeatureChain& enabledFeatures);
+
+void createGpuPrimitives(GpuPrimitives& primitives, const VkDevice& device, const VkPhysicalDevice& physicalDevice);
+void destroyGpuPrimitives(GpuPrimitives& primitives, const VkDevice& device);
+
+// Scratch elements needed by the matching record*() call for `count` elements
+uint64_t getReduceScratchCount(uint32_t count);
+uint64_t getExclusiveScanScratchCount(uint32_t count);
+uint64_t getCompactScratchCount(uint32_t count);
+uint64_t getRadixSortScratchCount(uint32_t maxCount, bool hasValues);
+
+// Writes the reduction of source[0, count) to result[0]. count must not be 0.
+void recordReduce(
+    ComputeRecorder& recorder,
+    const GpuPrimitives& primitives,
+    GpuReduceOp op,
+    const GpuArray& source,
+    const GpuArray& result,
+    uint32_t count,
+    const GpuArray& scratch);
+
+// destination[i] = source[0] + ... + source[i - 1]; source and destination may be the same array
+void recordExclusiveScan(
+    ComputeRecorder& recorder,
+    const GpuPrimitives& primitives,
+    const GpuArray& source,
+    const GpuArray& destination,
+    uint32_t count,
+    const GpuArray& scratch);
+
+// Copies the elements of source whose flag is 1 to the front of destination, in order, and
+// writes how many there were to destinationCount[0]. Flags must be 0 or 1; count must not be 0.
+void recordCompact(
+    ComputeRecorder& recorder,
+    const GpuPrimitives& primitives,
+    const GpuArray& source,
+    const GpuArray& flags,
+    const GpuArray& destination,
+    const GpuArray& destinationCount,
+    uint32_t count,
+    const GpuArray& scratch);
+
+// Stable ascending sort of keys in place. values, unless its buffer is null, is permuted along
+// with the keys. Onesweep: one dispatch counts the digits of all four passes, then each pass
+// moves the keys once, finding its offsets through decoupled look-back. The passes are indirect
+// dispatches sized on the GPU, so the scratch buffer also needs VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT.
+void recordRadixSort(
+    ComputeRecorder& recorder,
+    const GpuPrimitives& primitives,
+    const GpuArray& keys,
+    const GpuArray& values,
+    uint32_t count,
+    const GpuArray& scratch);
+// Same, for a count only known on the GPU, e.g. the output count of a culling or compaction
+// pass: sorts the first min(countSource[0], maxCount) elements. Size scratch for maxCount.
+void recordRadixSortIndirect(
+    ComputeRecorder& recorder,
+    const GpuPrimitives& primitives,
+    const GpuArray& keys,
+    const GpuArray& values,
+    const GpuArray& countSource,
+    uint32_t maxCount,
+    const GpuArray& scratch);
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef GPU_PRIMITIVES_BENCHMARK_H
+#define GPU_PRIMITIVES_BENCHMARK_H
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include "gpu_primitives.h"
+
+#include <cstdint>
+
+struct RadixSortBenchmarkResult
+{
+    uint32_t keyCount{0};
+    uint32_t iterationCount{0};
+    double bestMilliseconds{0.0};
+    double medianMilliseconds{0.0};
+    double keysPerSecond{0.0}; // From the median
+    bool sorted{false};        // The last iteration's keys and values were checked on the CPU
+};
+
+// Sorts keyCount random 32-bit keys with an index payload iterationCount times on `queue`,
+// timing each recordRadixSort() with timestamp queries. Blocks until done; commandPool must
+// belong to queueFamily, whose queues need timestamp support.
+RadixSortBenchmarkResult benchmarkRadixSort(
+    const VkDevice& device,
+    const VkPhysicalDevice& physicalDevice,
+    const VkCommandPool& commandPool,
+    const VkQueue& queue,
+    uint32_t queueFamily,
+    const GpuPrimitives& primitives,
+    uint32_t keyCount,
+    uint32_t iterationCount);
+
+#endif
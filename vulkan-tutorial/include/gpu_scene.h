@@ -0,0 +1,235 @@
+#ifndef GPU_SCENE_H
+#define GPU_SCENE_H
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include "depth_pyramid.h"
+#include "device_features.h"
+#include "draw_batching.h"
+#include "frustum.h"
+#include "mesh_asset.h"
+#include "uniform_ring.h"
+#include "vertex_formats.h"
+#include "vulkan_utils.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// std430 mirror of ObjectData in cull.comp, default.vert and packed.vert
+struct GpuObjectData
+{
+    glm::vec4 boundingSphere; // World-space center, radius
+    glm::vec4 transform;      // xy offset, z uniform scale, w depth
+    uint32_t indexCount;
+    uint32_t firstIndex;
+    int32_t vertexOffset;
+    uint32_t padding;
+};
+static_assert(sizeof(GpuObjectData) == 48, "GpuObjectData must match the std430 layout in the shaders");
+
+// Index range of one mesh inside the scene's shared index buffer
+struct MeshRange
+{
+    uint32_t indexCount;
+    uint32_t firstIndex;
+    int32_t vertexOffset;
+};
+
+// std140 mirror of CullData in cull.comp, pushed to the uniform ring every frame
+struct CullUniforms
+{
+    glm::mat4 viewProjection;
+    glm::vec4 frustumPlanes[6];
+    // xyz world-space eye position, w = 1; for an orthographic view w = 0 and xyz is the
+    // view direction
+    glm::vec4 cameraPosition;
+    uint32_t objectCount;
+    uint32_t pyramidWidth;
+    uint32_t pyramidHeight;
+    uint32_t pyramidMipCount;
+};
+static_assert(sizeof(CullUniforms) == 192, "CullUniforms must match the std140 layout in cull.comp");
+
+// Two-phase occlusion culling. The early pass draws what was visible last frame, the depth
+// pyramid is built from that depth, and the late pass tests every object against it: newly
+// visible (disoccluded) objects are drawn, and the per-object visibility is updated for the
+// next frame's early pass.
+enum CullPass : uint32_t
+{
+    CULL_PASS_EARLY = 0,
+    CULL_PASS_LATE = 1,
+};
+const static uint32_t CULL_PASS_COUNT = 2;
+
+struct CullPushConstants
+{
+    uint32_t pass;
+};
+
+// objectIndex value that makes the vertex shader read the object from the instance stream
+const static uint32_t DRAW_OBJECT_FROM_INSTANCE = UINT32_MAX;
+
+// Per-draw data of the scene graphics pipelines, mirrors DrawConstants in default.vert and
+// packed.vert; only the vertex stage sees it. The vertex shaders read the objects through the
+// device address rather than the scene set, so moving from one draw to the next updates no descriptors.
+struct DrawPushConstants
+{
+    DevicePointer<GpuObjectData> objects;
+    uint32_t objectIndex;   // Object of a single-instance draw, or DRAW_OBJECT_FROM_INSTANCE
+    uint32_t materialIndex; // Into the application's material list
+};
+static_assert(sizeof(DrawPushConstants) == 16, "DrawPushConstants must match DrawConstants in the shaders");
+
+// Scene descriptor set (set = 0), shared by the cull pass and the graphics pipelines
+enum SceneBinding : uint32_t
+{
+    SCENE_BINDING_OBJECTS = 0,       // GpuObjectData[], compute (+ task + mesh)
+    SCENE_BINDING_DRAW_COMMANDS = 1, // VkDrawIndexedIndirectCommand[objectCount * CULL_PASS_COUNT]
+    SCENE_BINDING_DRAW_COUNT = 2,    // uint[CULL_PASS_COUNT], number of commands each pass emitted
+    SCENE_BINDING_CULL_DATA = 3,     // CullUniforms, dynamic uniform buffer, compute (+ task)
+    SCENE_BINDING_VISIBILITY = 4,    // uint[], 1 if the object passed last frame's late test
+    SCENE_BINDING_DEPTH_PYRAMID = 5, // DepthPyramid, sampled with texelFetch
+};
+
+// Per-object data and indirect draw buffers for GPU-driven rendering. The cull compute pass
+// tests each object against the frustum (and, in the late pass, the depth pyramid) and writes
+// one indexed indirect command per visible object, with firstInstance carrying the object
+// index; the CPU records one vkCmdDrawIndexedIndirectCount per pass regardless of object count.
+struct GpuScene
+{
+    uint32_t objectCount{0};
+    // Upper bound passed to the indirect draw, clamped to maxDrawIndirectCount
+    uint32_t maxDrawCount{0};
+    // With drawIndirectCount the cull pass compacts visible commands and the GPU reads the count;
+    // without it every object keeps its slot and culled ones get instanceCount = 0
+    bool compactDraws{false};
+    bool multiDrawIndirect{false};
+
+    VkBuffer indexBuffer{nullptr};
+    VkDeviceMemory indexBufferMemory{nullptr};
+    VkBuffer objectBuffer{nullptr};
+    VkDeviceMemory objectBufferMemory{nullptr};
+    DevicePointer<GpuObjectData> objects; // objectBuffer, for the graphics pipelines
+    VkBuffer drawCommandBuffer{nullptr};
+    VkDeviceMemory drawCommandBufferMemory{nullptr};
+    VkBuffer drawCountBuffer{nullptr};
+    VkDeviceMemory drawCountBufferMemory{nullptr};
+    VkBuffer visibilityBuffer{nullptr};
+    VkDeviceMemory visibilityBufferMemory{nullptr};
+    // Per-instance vertex stream (binding 0, VK_VERTEX_INPUT_RATE_INSTANCE) of object indices.
+    // The indirect path binds the identity stream so firstInstance = object index resolves to
+    // that object; CPU-recorded batches write their instances to the host-visible stream.
+    VkBuffer identityInstanceBuffer{nullptr};
+    VkDeviceMemory identityInstanceBufferMemory{nullptr};
+    VkBuffer instanceBuffer{nullptr};
+    VkDeviceMemory instanceBufferMemory{nullptr};
+    void* instanceObjectsMapped{nullptr};
+    // Dynamic offset of this frame's CullUniforms in the uniform ring; every bind of the scene
+    // set passes it
+    uint32_t cullUniformsOffset{0};
+    uint32_t pyramidWidth{0};
+    uint32_t pyramidHeight{0};
+    uint32_t pyramidMipCount{0};
+
+    VkDescriptorPool descriptorPool{nullptr};
+    VkDescriptorSet descriptorSet{nullptr};
+
+    VkShaderModule cullShaderModule{nullptr};
+    VkPipelineLayout cullPipelineLayout{nullptr};
+    VkPipeline cullPipeline{nullptr};
+};
+
+// An imported mesh in VERTEX_FORMAT_PACKED, bound at VERTEX_BINDING_VERTICES. Objects drawing
+// it fold quantization into their transform with foldVertexQuantization().
+struct GpuMesh
+{
+    uint32_t vertexCount{0};
+    uint32_t indexCount{0};
+    VertexQuantization quantization{};
+
+    VkBuffer vertexBuffer{nullptr};
+    VkDeviceMemory vertexBufferMemory{nullptr};
+    VkBuffer indexBuffer{nullptr};
+    VkDeviceMemory indexBufferMemory{nullptr};
+};
+
+// meshShaders also exposes the objects and cull data to the task and mesh stages
+VkDescriptorSetLayout createSceneDescriptorSetLayout(const VkDevice& device, bool meshShaders);
+
+// Uploads objects and indices through the transfer queue and builds the cull pipeline.
+// The scene takes ownership of cullShaderModule.
+void createGpuScene(
+    GpuScene& scene,
+    const VkDevice& device,
+    const VkPhysicalDevice& physicalDevice,
+    const DeviceFeatureChain& enabledFeatures,
+    const QueueFamilyIndices& queueFamilies,
+    const VkCommandPool& transferCommandPool,
+    const VkQueue& transferQueue,
+    const VkDescriptorSetLayout& sceneSetLayout,
+    const UniformRing& uniformRing,
+    const DepthPyramid& depthPyramid,
+    VkShaderModule cullShaderModule,
+    const std::vector<GpuObjectData>& objects,
+    const std::vector<uint32_t>& indices);
+
+// Call once per frame before recording anything that binds the scene set
+void updateGpuSceneCamera(
+    GpuScene& scene,
+    UniformRing& uniformRing,
+    const glm::mat4& viewProjection,
+    const glm::vec4& cameraPosition);
+// Call once per frame before recording, while the GPU is not reading the previous values; at
+// most objectCount instances
+void updateGpuSceneInstances(GpuScene& scene, const std::vector<uint32_t>& instanceObjects);
+
+// Must be recorded outside a render pass; leaves the pass's draw buffers ready for indirect
+// reads. The late pass must follow the depth pyramid build.
+void recordGpuCulling(VkCommandBuffer commandBuffer, const GpuScene& scene, CullPass pass);
+// Records the pass's indirect draws; a graphics pipeline using pipelineLayout must already be bound
+void recordGpuSceneDraws(
+    VkCommandBuffer commandBuffer,
+    const GpuScene& scene,
+    const VkPipelineLayout& pipelineLayout,
+    CullPass pass);
+
+// Graphics pipelines using pipelineLayout read DrawPushConstants; every draw through it must
+// have them set. Indirect draws take the object from firstInstance, so they push
+// DRAW_OBJECT_FROM_INSTANCE once per pass.
+void recordDrawPushConstants(
+    VkCommandBuffer commandBuffer,
+    const GpuScene& scene,
+    const VkPipelineLayout& pipelineLayout,
+    uint32_t objectIndex,
+    uint32_t materialIndex);
+
+// CPU-culled alternative to the cull passes: one instanced vkCmdDrawIndexed per batch from
+// buildDrawBatches(), whose instanceObjects must already be in the instance stream.
+// pipelines maps DrawBatch::pipeline to the pipeline to bind. Each batch pushes its material,
+// and single-object batches their object index.
+void recordInstancedSceneDraws(
+    VkCommandBuffer commandBuffer,
+    const GpuScene& scene,
+    const VkPipelineLayout& pipelineLayout,
+    const std::vector<VkPipeline>& pipelines,
+    const std::vector<MeshRange>& meshes,
+    const std::vector<DrawBatch>& batches,
+    const std::vector<uint32_t>& instanceObjects);
+
+void destroyGpuScene(GpuScene& scene, const VkDevice& device);
+
+// Packs the asset's vertices straight into the staging memory of the upload
+void createGpuMesh(
+    GpuMesh& mesh,
+    const VkDevice& device,
+    const VkPhysicalDevice& physicalDevice,
+    const QueueFamilyIndices& queueFamilies,
+    const VkCommandPool& transferCommandPool,
+    const VkQueue& transferQueue,
+    const MeshAsset& asset);
+void destroyGpuMesh(GpuMesh& mesh, const VkDevice& device);
+
+#endif
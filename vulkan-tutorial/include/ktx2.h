@@ -0,0 +1,38 @@
+#ifndef KTX2_H
+#define KTX2_H
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include "mapped_file.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct Ktx2Level
+{
+    uint64_t byteOffset; // From the start of the file
+    uint64_t byteLength;
+};
+
+// A memory-mapped KTX2 texture. Only what can be copied to an image as is is accepted: 2D,
+// one layer and face, no supercompression and a block-compressed BC1-7 or RGBA8 format.
+// KTX2 stores the smallest level first, so streaming from the tail reads the file forward.
+struct Ktx2File
+{
+    MappedFile file;
+    VkFormat format{VK_FORMAT_UNDEFINED};
+    uint32_t width{0};
+    uint32_t height{0};
+    std::vector<Ktx2Level> levels; // levels[0] is the full-resolution image
+};
+
+// Bytes per 4x4 block for BCn formats, per texel for uncompressed ones; 0 if unsupported
+uint32_t getTextureFormatBlockBytes(VkFormat format, uint32_t& blockSize);
+bool isBlockCompressedFormat(VkFormat format);
+
+void openKtx2File(Ktx2File& ktx, const std::string& filename);
+void closeKtx2File(Ktx2File& ktx);
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// A read-only view of a whole file. Pages are loaded on first touch, so parsers running on
+// several threads read the file in parallel without copying it into memory first.
+struct MappedFile
+{
+    const uint8_t* data{nullptr};
+    size_t size{0};
+#ifdef _WIN32
+    void* fileHandle{nullptr};
+    void* mappingHandle{nullptr};
+#else
+    int fileDescriptor{-1};
+#endif
+};
+
+void mapFile(MappedFile& file, const std::string& filename);
+void unmapFile(MappedFile& file);
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef MESH_ASSET_H
+#define MESH_ASSET_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Bumped whenever the file layout or the optimization pipeline changes, so stale caches
+// are rebuilt instead of loaded
+const static uint32_t MESH_ASSET_VERSION = 1;
+
+enum MeshAssetFlagBits : uint32_t
+{
+    MESH_ASSET_OPTIMIZED_BIT = 0x00000001,
+};
+
+// An indexed triangle list with interleaved vertices. Until the importer defines richer
+// layouts, every vertex starts with its position as three floats.
+struct MeshAsset
+{
+    uint32_t flags{0};
+    uint32_t vertexStride{0};
+    uint32_t vertexCount{0};
+    std::vector<uint8_t> vertices;
+    std::vector<uint32_t> indices;
+};
+
+// Identifies the source an asset was imported from; stored in the cache so a changed source
+// invalidates it
+uint64_t hashMeshSource(const void* data, size_t size);
+
+// Welds duplicate vertices, reorders triangles for the vertex cache and then for overdraw,
+// and finally reorders vertices for fetch locality. Sets MESH_ASSET_OPTIMIZED_BIT.
+void optimizeMeshAsset(MeshAsset& asset);
+
+// Returns false if the file is missing, was written from a different source or by another
+// MESH_ASSET_VERSION, is truncated, has a stride other than vertexStride or an index past the
+// last vertex; the caller then imports and writes it again.
+bool readMeshAssetCache(const std::string& filename, uint64_t sourceHash, uint32_t vertexStride, MeshAsset& asset);
+void writeMeshAssetCache(const std::string& filename, uint64_t sourceHash, const MeshAsset& asset);
+
+#endif
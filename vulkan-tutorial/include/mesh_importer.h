@@ -0,0 +1,44 @@
+#ifndef MESH_IMPORTER_H
+#define MESH_IMPORTER_H
+
+#include "mesh_asset.h"
+#include "vertex_formats.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Work is split into independent jobs of about this many vertices, indices or (for OBJ)
+// bytes of text, so a single large primitive still spreads over every worker
+const static uint32_t MESH_IMPORT_CHUNK_ELEMENTS = 64 * 1024;
+const static size_t MESH_IMPORT_CHUNK_BYTES = 1024 * 1024;
+
+// Parses a binary glTF 2.0 (.glb) or Wavefront OBJ (.obj) file into `asset` as an
+// unoptimized triangle list of Vertex. The file is memory-mapped and parsed in parallel on
+// workerCount threads, each job writing straight into its slice of the asset.
+//
+// glTF: every triangle primitive reachable from the default scene is flattened into one mesh
+// with its node transforms applied. Positions must be float; normals, tangents and
+// TEXCOORD_0 may use any normalized integer type. Sparse accessors are not supported.
+// OBJ: v, vt, vn and f statements; polygons are fanned. Everything else is ignored.
+//
+// Both formats are counter-clockwise; winding is reversed to match VK_FRONT_FACE_CLOCKWISE.
+// Missing normals are left zero for fillMissingNormals(), missing tangents are +x.
+void importMesh(MeshAsset& asset, const std::string& filename, uint32_t workerCount);
+
+// Replaces zero normals with the area-weighted normal of the triangles around the vertex.
+// Run after welding so the triangles of a smooth surface share vertices.
+void fillMissingNormals(MeshAsset& asset);
+
+// importMesh(), optimizeMeshAsset() and fillMissingNormals(), or just a read of
+// cacheFilename when it was written from the same version of the same file. An empty
+// cacheFilename skips the cache.
+void loadMesh(MeshAsset& asset, const std::string& filename, const std::string& cacheFilename, uint32_t workerCount);
+
+VertexQuantization computeVertexQuantization(const MeshAsset& asset);
+
+// Writes the asset's vertices as PackedVertex, e.g. into a mapped staging buffer that holds
+// asset.vertexCount * sizeof(PackedVertex) bytes
+void writePackedVertices(void* destination, const MeshAsset& asset, const VertexQuantization& quantization);
+
+#endif
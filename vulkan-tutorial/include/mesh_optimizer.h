@@ -0,0 +1,70 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Post-transform cache size Tipsify targets. Modern GPUs don't have a true FIFO cache, but
+// batching vertices into small warps behaves close enough to one of this size.
+const static uint32_t VERTEX_CACHE_SIZE = 16;
+// Clusters may grow this much worse in ACMR than the cache-optimal order before overdraw
+// sorting is allowed to split them; 1.05 costs ~5% vertex shading for much better sorting
+const static float OVERDRAW_THRESHOLD = 1.05f;
+
+// remap entry of a vertex no index references
+const static uint32_t VERTEX_REMAP_UNUSED = UINT32_MAX;
+
+struct VertexCacheStats
+{
+    uint32_t vertexShaderInvocations;
+    float acmr; // Average cache miss ratio: transformed vertices per triangle, 0.5 is optimal
+    float atvr; // Average transform to vertex ratio: 1.0 is optimal
+};
+
+// Simulates a FIFO post-transform cache of cacheSize entries over a triangle list
+VertexCacheStats analyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize);
+
+// Finds byte-identical vertices with a hash table. On return remap[i] is the new index of
+// vertex i, with new indices assigned in order of first occurrence. Returns the unique
+// vertex count. Positions that differ only in the sign of zero are not merged.
+uint32_t weldVertices(std::vector<uint32_t>& remap, const void* vertices, size_t vertexCount, size_t vertexStride);
+
+void remapIndices(std::vector<uint32_t>& indices, const std::vector<uint32_t>& remap);
+// Writes each source vertex to destination[remap[i]]; destination must hold the remapped
+// vertex count. Vertices that map to the same slot must be identical, and ones remapped to
+// VERTEX_REMAP_UNUSED are dropped.
+void remapVertices(
+    void* destination,
+    const void* vertices,
+    size_t vertexCount,
+    size_t vertexStride,
+    const std::vector<uint32_t>& remap);
+
+// Reorders triangles for post-transform cache locality with Tipsify (Sander et al. 2007),
+// linear in the triangle count. clusters receives the first triangle of every run that
+// started after a cache flush; optimizeOverdraw() reorders those runs. May be null.
+void optimizeVertexCache(
+    std::vector<uint32_t>& indices,
+    size_t vertexCount,
+    uint32_t cacheSize,
+    std::vector<uint32_t>* clusters);
+
+// Splits the cache-optimized runs further where that costs at most `threshold` times their
+// ACMR, then sorts the clusters so that ones facing away from the mesh center are drawn
+// first and occlude the rest. Normals follow VK_FRONT_FACE_CLOCKWISE.
+void optimizeOverdraw(
+    std::vector<uint32_t>& indices,
+    const std::vector<glm::vec3>& positions,
+    const std::vector<uint32_t>& clusters,
+    uint32_t cacheSize,
+    float threshold);
+
+// Renumbers vertices in the order the index buffer first references them, so vertex fetch
+// walks memory forward. Fills remap like weldVertices() and rewrites indices in place;
+// returns the count of referenced vertices. Unreferenced ones map to VERTEX_REMAP_UNUSED.
+uint32_t optimizeVertexFetch(std::vector<uint32_t>& remap, std::vector<uint32_t>& indices, size_t vertexCount);
+
+#endif
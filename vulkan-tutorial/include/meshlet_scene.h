@@ -0,0 +1,141 @@
+#ifndef MESHLET_SCENE_H
+#define MESHLET_SCENE_H
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include "device_features.h"
+#include "gpu_scene.h"
+#include "meshlets.h"
+#include "pipeline_permutations.h"
+#include "vulkan_utils.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// std430 mirror of Meshlet in meshlet_cull.comp, meshlet.task and meshlet.mesh
+struct GpuMeshlet
+{
+    glm::vec4 boundingSphere; // Mesh-space center, radius
+    glm::vec4 coneApex;       // xyz apex, w unused
+    glm::vec4 coneAxis;       // xyz axis, w cutoff
+    uint32_t vertexOffset;
+    uint32_t triangleOffset;
+    uint32_t vertexCount;
+    uint32_t triangleCount;
+};
+static_assert(sizeof(GpuMeshlet) == 64, "GpuMeshlet must match the std430 layout in the shaders");
+
+// std430 mirror of MeshletVertex in meshlet.mesh
+struct GpuMeshletVertex
+{
+    glm::vec4 position;
+    glm::vec4 color;
+};
+static_assert(sizeof(GpuMeshletVertex) == 32, "GpuMeshletVertex must match the std430 layout in meshlet.mesh");
+
+// One meshlet of one object; the unit the task shader and the fallback cull pass test
+struct MeshletInstance
+{
+    uint32_t objectIndex;
+    uint32_t meshlet;
+};
+
+struct MeshletPushConstants
+{
+    uint32_t instanceCount;
+};
+
+// Meshlet descriptor set (set = 1, after the scene set)
+enum MeshletBinding : uint32_t
+{
+    MESHLET_BINDING_MESHLETS = 0,      // GpuMeshlet[]
+    MESHLET_BINDING_INSTANCES = 1,     // MeshletInstance[]
+    MESHLET_BINDING_VERTICES = 2,      // uint[], source vertex index of each meshlet vertex
+    MESHLET_BINDING_TRIANGLES = 3,     // uint[], one triangle's local indices packed 8:8:8
+    MESHLET_BINDING_VERTEX_DATA = 4,   // GpuMeshletVertex[]
+    MESHLET_BINDING_DRAW_COMMANDS = 5, // Fallback: VkDrawIndexedIndirectCommand[instanceCount]
+    MESHLET_BINDING_DRAW_COUNT = 6,    // Fallback: uint, commands the cull pass emitted
+};
+
+// Per-meshlet frustum and normal cone culling. With VK_EXT_mesh_shader a task shader culls
+// the meshlet instances and launches one mesh workgroup per survivor; otherwise a compute pass
+// writes one indexed indirect draw per visible meshlet, drawn with the regular vertex pipeline
+// from an index buffer holding every meshlet's triangles in meshlet order.
+struct MeshletScene
+{
+    uint32_t instanceCount{0};
+    uint32_t maxDrawCount{0};
+    bool meshShaders{false};
+    bool compactDraws{false};
+    bool multiDrawIndirect{false};
+    uint32_t maxTaskWorkGroupCountX{0};
+
+    VkBuffer meshletBuffer{nullptr};
+    VkDeviceMemory meshletBufferMemory{nullptr};
+    VkBuffer instanceBuffer{nullptr};
+    VkDeviceMemory instanceBufferMemory{nullptr};
+    VkBuffer vertexIndexBuffer{nullptr};
+    VkDeviceMemory vertexIndexBufferMemory{nullptr};
+    VkBuffer triangleBuffer{nullptr};
+    VkDeviceMemory triangleBufferMemory{nullptr};
+    VkBuffer vertexDataBuffer{nullptr};
+    VkDeviceMemory vertexDataBufferMemory{nullptr};
+    VkBuffer indexBuffer{nullptr};
+    VkDeviceMemory indexBufferMemory{nullptr};
+    VkBuffer drawCommandBuffer{nullptr};
+    VkDeviceMemory drawCommandBufferMemory{nullptr};
+    VkBuffer drawCountBuffer{nullptr};
+    VkDeviceMemory drawCountBufferMemory{nullptr};
+
+    VkDescriptorSetLayout setLayout{nullptr};
+    VkDescriptorPool descriptorPool{nullptr};
+    VkDescriptorSet descriptorSet{nullptr};
+    // Scene set + meshlet set, shared by the cull pass and the mesh shader pipeline
+    VkPipelineLayout pipelineLayout{nullptr};
+
+    VkShaderModule cullShaderModule{nullptr};
+    VkPipeline cullPipeline{nullptr};
+
+    ShaderProgram meshProgram;
+    VkPipeline meshPipeline{nullptr};
+    PFN_vkCmdDrawMeshTasksEXT drawMeshTasks{nullptr};
+};
+
+bool hasMeshShaderSupport(const DeviceFeatureChain& enabledFeatures);
+
+// Uploads the meshlets and instances, then builds the mesh shader pipeline for `material` when
+// mesh shaders are enabled and the fallback cull pipeline otherwise. `vertices` must hold the
+// same positions the meshlets were built from, and `renderPass` must be compatible with the
+// render passes the draws are recorded in.
+void createMeshletScene(
+    MeshletScene& meshletScene,
+    const VkDevice& device,
+    const VkPhysicalDevice& physicalDevice,
+    const DeviceFeatureChain& enabledFeatures,
+    const QueueFamilyIndices& queueFamilies,
+    const VkCommandPool& transferCommandPool,
+    const VkQueue& transferQueue,
+    const VkDescriptorSetLayout& sceneSetLayout,
+    const VkRenderPass& renderPass,
+    const MaterialDesc& material,
+    const MeshletMesh& mesh,
+    const std::vector<GpuMeshletVertex>& vertices,
+    const std::vector<MeshletInstance>& instances);
+
+// Fallback path only, a no-op with mesh shaders. Must be recorded outside a render pass after
+// updateGpuSceneCamera(); leaves the draw buffers ready for indirect reads.
+void recordMeshletCulling(VkCommandBuffer commandBuffer, const MeshletScene& meshletScene, const GpuScene& scene);
+// Inside a render pass. The fallback draws with whatever graphics pipeline using
+// pipelineLayout is bound; the mesh shader path binds its own.
+void recordMeshletDraws(
+    VkCommandBuffer commandBuffer,
+    const MeshletScene& meshletScene,
+    const GpuScene& scene,
+    const VkPipelineLayout& pipelineLayout);
+
+void destroyMeshletScene(MeshletScene& meshletScene, const VkDevice& device);
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef MESHLETS_H
+#define MESHLETS_H
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// Limits that fit NVIDIA's and AMD's preferred mesh shader output sizes; 124 triangles leaves
+// room for the 4-byte primitive count in a 128-triangle block
+const static uint32_t MESHLET_MAX_VERTICES = 64;
+const static uint32_t MESHLET_MAX_TRIANGLES = 124;
+
+// A small cluster of triangles. Its vertices are MeshletMesh::vertices[vertexOffset..] (indices
+// into the source vertex array) and its triangles are triangleCount triples of local vertex
+// indices starting at MeshletMesh::triangles[triangleOffset * 3].
+struct Meshlet
+{
+    uint32_t vertexOffset;
+    uint32_t triangleOffset;
+    uint32_t vertexCount;
+    uint32_t triangleCount;
+};
+
+// Bounding sphere plus a normal cone. The meshlet is entirely back-facing, and can be skipped,
+// when dot(normalize(coneApex - cameraPosition), coneAxis) >= coneCutoff. Normals follow
+// VK_FRONT_FACE_CLOCKWISE, the PipelineStateDesc default. A cutoff of 1 disables the cone test.
+struct MeshletBounds
+{
+    glm::vec3 center;
+    float radius;
+    glm::vec3 coneApex;
+    glm::vec3 coneAxis;
+    float coneCutoff;
+};
+
+struct MeshletMesh
+{
+    std::vector<Meshlet> meshlets;
+    std::vector<MeshletBounds> bounds; // One per meshlet
+    std::vector<uint32_t> vertices;
+    std::vector<uint8_t> triangles;
+};
+
+// Splits indices [firstIndex, firstIndex + indexCount) of a triangle list into meshlets and
+// appends them, with their bounds, to `mesh`. Index values address `positions` directly.
+// Triangles are taken in index order, so cache-friendly input gives tighter meshlets.
+// Returns the index of the first appended meshlet.
+uint32_t buildMeshlets(
+    MeshletMesh& mesh,
+    const std::vector<uint32_t>& indices,
+    uint32_t firstIndex,
+    uint32_t indexCount,
+    const std::vector<glm::vec3>& positions,
+    uint32_t maxVertices = MESHLET_MAX_VERTICES,
+    uint32_t maxTriangles = MESHLET_MAX_TRIANGLES);
+
+MeshletBounds computeMeshletBounds(
+    const MeshletMesh& mesh,
+    const Meshlet& meshlet,
+    const std::vector<glm::vec3>& positions);
+
+#endif
@@ -0,0 +1,107 @@
+#ifndef PIPELINE_PERMUTATIONS_H
+#define PIPELINE_PERMUTATIONS_H
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include "vertex_formats.h"
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+// Feature bits a material can declare. Bit N is fed to every shader stage as the
+// VkBool32 specialization constant with constant_id = N, so the driver compiles a
+// branch-free variant from the same SPIR-V module.
+enum MaterialFeatureBits : uint32_t
+{
+    MATERIAL_FEATURE_VERTEX_COLOR_BIT = 0x00000001,
+    MATERIAL_FEATURE_GRAYSCALE_BIT = 0x00000002,
+};
+const static uint32_t MATERIAL_FEATURE_COUNT = 2;
+
+// Fixed-function state that varies between pipelines sharing a shader program.
+struct PipelineStateDesc
+{
+    VkPrimitiveTopology topology{VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST};
+    VkPolygonMode polygonMode{VK_POLYGON_MODE_FILL};
+    VkCullModeFlags cullMode{VK_CULL_MODE_BACK_BIT};
+    VkFrontFace frontFace{VK_FRONT_FACE_CLOCKWISE};
+    VkBool32 blendEnable{VK_FALSE};
+    VkBool32 depthTestEnable{VK_TRUE};
+    VkBool32 depthWriteEnable{VK_TRUE};
+    VkCompareOp depthCompareOp{VK_COMPARE_OP_LESS};
+
+    bool operator<(const PipelineStateDesc& other) const;
+};
+
+struct MaterialDesc
+{
+    uint32_t shaderProgram{0};
+    uint32_t featureBits{0};
+    PipelineStateDesc state;
+};
+
+// A pipeline is uniquely identified by (shader program, specialization constants, state)
+struct PipelineKey
+{
+    uint32_t shaderProgram{0};
+    uint32_t featureBits{0};
+    PipelineStateDesc state;
+
+    bool operator<(const PipelineKey& other) const;
+};
+PipelineKey makePipelineKey(const MaterialDesc& material);
+
+struct ShaderProgram
+{
+    VkShaderModule vertexModule{nullptr};
+    VkShaderModule fragmentModule{nullptr};
+    // When meshModule is set the program is a VK_EXT_mesh_shader one: the vertex module is
+    // unused and the task module is optional
+    VkShaderModule taskModule{nullptr};
+    VkShaderModule meshModule{nullptr};
+    // GLSL file names the modules were compiled from, used to match hot reloads
+    std::string vertexSourceName;
+    std::string fragmentSourceName;
+    VertexFormat vertexFormat{VERTEX_FORMAT_PROCEDURAL};
+};
+
+// Owns the shader modules of every registered program and lazily builds one
+// VkPipeline per distinct PipelineKey the first time it is requested.
+struct PipelinePermutationCache
+{
+    VkDevice device{nullptr};
+    VkRenderPass renderPass{nullptr};
+    VkPipelineLayout pipelineLayout{nullptr};
+    VkPipelineCache pipelineCache{nullptr};
+    std::vector<ShaderProgram> programs;
+    std::map<PipelineKey, VkPipeline> pipelines;
+};
+
+void initPipelinePermutationCache(
+    PipelinePermutationCache& cache,
+    const VkDevice& device,
+    const VkRenderPass& renderPass,
+    const VkPipelineLayout& pipelineLayout);
+uint32_t registerShaderProgram(
+    PipelinePermutationCache& cache,
+    VkShaderModule vertexModule,
+    VkShaderModule fragmentModule,
+    const std::string& vertexSourceName = "",
+    const std::string& fragmentSourceName = "",
+    VertexFormat vertexFormat = VERTEX_FORMAT_PROCEDURAL);
+VkPipeline getPipelinePermutation(PipelinePermutationCache& cache, const PipelineKey& key);
+void destroyPipelinePermutationCache(PipelinePermutationCache& cache);
+
+VkPipeline createPipelinePermutation(
+    const VkDevice& device,
+    const VkPipelineCache& pipelineCache,
+    const VkRenderPass& renderPass,
+    const VkPipelineLayout& pipelineLayout,
+    const ShaderProgram& program,
+    uint32_t featureBits,
+    const PipelineStateDesc& state);
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef SHADER_HOT_RELOAD_H
+#define SHADER_HOT_RELOAD_H
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include "pipeline_permutations.h"
+
+#include <atomic>
+#include <cstdint>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Development-only: watches the GLSL sources with inotify and recompiles them through
+// shaderc (link against shaderc_shared). Everywhere else the functions below are no-ops.
+#if defined(__linux__) && !defined(NDEBUG)
+    #define SHADER_HOT_RELOAD_ENABLE 1
+#else
+    #define SHADER_HOT_RELOAD_ENABLE 0
+#endif
+
+struct CompiledShader
+{
+    std::string sourceName; // File name inside the watched directory, e.g. "default.vert"
+    std::vector<uint32_t> spirv;
+};
+
+// New modules for one program plus every permutation of it rebuilt from those modules
+struct ProgramRebuild
+{
+    uint32_t shaderProgram{0};
+    ShaderProgram program;
+    std::vector<std::pair<PipelineKey, VkPipeline>> pipelines;
+};
+
+struct ShaderHotReloader
+{
+    std::string shaderDirectory;
+    int inotifyFd{-1};
+    int watchDescriptor{-1};
+    std::thread watcherThread;
+    std::atomic<bool> running{false};
+
+    // Filled by the watcher thread, drained at frame boundaries
+    std::mutex compiledMutex;
+    std::vector<CompiledShader> compiledShaders;
+
+    std::future<std::vector<ProgramRebuild>> pendingRebuild;
+};
+
+void startShaderHotReload(ShaderHotReloader& reloader, const std::string& shaderDirectory);
+void stopShaderHotReload(ShaderHotReloader& reloader, PipelinePermutationCache& cache);
+
+// Call once per frame before recording. Kicks off asynchronous pipeline rebuilds for
+// freshly compiled shaders and swaps finished rebuilds into the cache. Returns true
+// when pipelines were swapped, in which case cached VkPipeline handles must be re-fetched.
+bool applyShaderHotReload(ShaderHotReloader& reloader, PipelinePermutationCache& cache);
+
+std::vector<uint32_t> compileGlslToSpirv(const std::string& path);
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef TASK_GRAPH_H
+#define TASK_GRAPH_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct TaskGraphNode
+{
+    std::string name;
+    std::vector<std::string> dependencies;
+    std::function<void()> work;
+    // Some APIs (most of GLFW) may only be called from the thread that initialized them
+    bool mainThreadOnly{false};
+};
+
+struct TaskTiming
+{
+    std::string name;
+    double startMs{0.0}; // Relative to the start of runTaskGraph()
+    double durationMs{0.0};
+    bool ranOnMainThread{false};
+};
+
+// Runs every node once all of its dependencies have finished. Worker-eligible nodes run on
+// a pool of workerCount threads; main-thread nodes run on the calling thread. If a node
+// throws, no further nodes are started and the first exception is rethrown once in-flight
+// nodes have finished. Returns per-node timings in completion order.
+std::vector<TaskTiming> runTaskGraph(const std::vector<TaskGraphNode>& nodes, uint32_t workerCount);
+
+void printTaskTimings(const std::string& label, const std::vector<TaskTiming>& timings);
+
+// Threads kept alive between runParallelFor() calls, for work repeated every frame where
+// starting threads would cost more than the work itself. One job runs at a time.
+struct WorkerPool
+{
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable workCondition; // A job was posted, or the pool is stopping
+    std::condition_variable doneCondition; // The job's last item finished
+    const std::function<void(uint32_t)>* work{nullptr};
+    uint32_t itemCount{0};
+    uint32_t nextItem{0};
+    uint32_t unfinishedCount{0};
+    bool stopping{false};
+    std::exception_ptr firstError;
+};
+
+void startWorkerPool(WorkerPool& pool, uint32_t threadCount);
+// Joins the threads; safe on a pool that was never started
+void stopWorkerPool(WorkerPool& pool);
+
+// Calls work(i) for every i in [0, count) on the pool's threads and the calling thread, and
+// returns once all have finished. The first exception thrown by work is rethrown.
+void runParallelFor(WorkerPool& pool, uint32_t count, const std::function<void(uint32_t)>& work);
+
+#endif
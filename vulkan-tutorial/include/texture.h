@@ -0,0 +1,77 @@
+#ifndef TEXTURE_H
+#define TEXTURE_H
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include "device_features.h"
+#include "downsampler.h"
+#include "ktx2.h"
+
+#include <cstdint>
+#include <string>
+
+const static float TEXTURE_MAX_ANISOTROPY = 16.0f;
+// Mip levels no larger than this in either dimension are uploaded when the texture is created,
+// so it can be sampled straight away; larger levels are left to streamTextureLevel()
+const static uint32_t TEXTURE_RESIDENT_TAIL_SIZE = 128;
+
+// A sampled image filled from a KTX2 file. Every mip level is allocated up front but only the
+// tail is uploaded; the view covers residentLevel and below, so sampling never touches a level
+// that hasn't been copied yet.
+struct Texture
+{
+    Ktx2File source; // Stays mapped until every level is resident
+    VkFormat format{VK_FORMAT_UNDEFINED};
+    uint32_t width{0};
+    uint32_t height{0};
+    uint32_t levelCount{0};
+    uint32_t residentLevel{0}; // Finest level uploaded so far
+
+    VkImage image{nullptr};
+    VkDeviceMemory imageMemory{nullptr};
+    VkImageView view{nullptr};
+};
+
+// BCn formats additionally need the textureCompressionBC feature. Compressed data is never
+// decoded on the CPU, so an unsupported format is an error.
+bool isTextureFormatSupported(
+    const VkPhysicalDevice& physicalDevice,
+    const DeviceFeatureChain& enabledFeatures,
+    VkFormat format);
+
+// Uploads go through `queue`, which must be a graphics queue as the levels are transitioned
+// for fragment shader reads. A file with a single level gets its full mip chain generated on
+// the GPU when mipGenerator is given and has the texture's format; otherwise the texture has
+// exactly the levels stored in the file.
+void createTexture(
+    Texture& texture,
+    const VkDevice& device,
+    const VkPhysicalDevice& physicalDevice,
+    const DeviceFeatureChain& enabledFeatures,
+    const VkCommandPool& commandPool,
+    const VkQueue& queue,
+    const std::string& filename,
+    const Downsampler* mipGenerator = nullptr);
+
+// Uploads the next finer mip level, if any, and replaces the view to include it. Returns true
+// when it did, in which case descriptors that reference the view must be rewritten before
+// the next draw that samples it. The upload waits for `queue` to go idle, which also makes
+// destroying the previous view safe.
+bool streamTextureLevel(
+    Texture& texture,
+    const VkDevice& device,
+    const VkPhysicalDevice& physicalDevice,
+    const VkCommandPool& commandPool,
+    const VkQueue& queue);
+
+bool isTextureFullyResident(const Texture& texture);
+void destroyTexture(Texture& texture, const VkDevice& device);
+
+// Trilinear, repeating, anisotropic when samplerAnisotropy is enabled
+VkSampler createTextureSampler(
+    const VkDevice& device,
+    const VkPhysicalDevice& physicalDevice,
+    const DeviceFeatureChain& enabledFeatures);
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef UNIFORM_RING_H
+#define UNIFORM_RING_H
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+
+// Bytes of uniform data one frame may allocate
+const static VkDeviceSize UNIFORM_RING_FRAME_SIZE = 256 * 1024;
+// One region per frame in flight. drawFrame() waits for the previous frame's fence before
+// recording, so a single region is never written while the GPU reads it.
+const static uint32_t UNIFORM_RING_FRAME_COUNT = 1;
+
+// Per-frame linear allocator for uniform data. One host-visible buffer, mapped for its whole
+// lifetime, is split into frameCount regions; each frame bump-allocates out of the next region,
+// aligned to minUniformBufferOffsetAlignment, so per-draw data costs a memcpy and a dynamic
+// offset instead of a buffer, a map or a descriptor update.
+//
+// Bind the buffer once through a VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC descriptor whose
+// range is the struct size (see getUniformRingDescriptor()), then pass the allocation's offset
+// to vkCmdBindDescriptorSets.
+struct UniformRing
+{
+    VkDeviceSize alignment{0};
+    VkDeviceSize frameSize{0};
+    uint32_t frameCount{0};
+    uint32_t frame{0};
+    VkDeviceSize head{0}; // Next free byte of the current frame's region
+
+    VkBuffer buffer{nullptr};
+    VkDeviceMemory bufferMemory{nullptr};
+    uint8_t* mapped{nullptr};
+};
+
+struct UniformAllocation
+{
+    uint32_t offset; // Dynamic offset into the ring buffer
+    void* data;      // Where to write the uniforms, valid until the region is reused
+};
+
+void createUniformRing(
+    UniformRing& ring,
+    const VkDevice& device,
+    const VkPhysicalDevice& physicalDevice,
+    VkDeviceSize frameSize,
+    uint32_t frameCount);
+
+// Call once per frame, after waiting for the fence of the frame that last used the next region
+void beginUniformRingFrame(UniformRing& ring);
+
+// Throws when the frame's region is exhausted
+UniformAllocation allocateUniforms(UniformRing& ring, VkDeviceSize size);
+// allocateUniforms() plus the copy; returns the dynamic offset
+uint32_t pushUniforms(UniformRing& ring, const void* data, VkDeviceSize size);
+
+// For the dynamic descriptor: range is the size of the struct the shader declares
+VkDescriptorBufferInfo getUniformRingDescriptor(const UniformRing& ring, VkDeviceSize range);
+
+void destroyUniformRing(UniformRing& ring, const VkDevice& device);
+
+#endif
@@ -1,9 +1,11 @@
 #ifndef UTILS_H
 #define UTILS_H
 
+#include <cstdint>
 #include <vector>
 #include <string>
 
 std::vector<char> readFile(const std::string& filename);
+std::vector<uint32_t> readSpirvFile(const std::string& filename);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,70 @@
+#ifndef VERTEX_FORMATS_H
+#define VERTEX_FORMATS_H
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// How a shader program's vertex shader receives its vertices. The per-instance object index
+// stream always occupies binding 0, location 0.
+enum VertexFormat : uint32_t
+{
+    VERTEX_FORMAT_PROCEDURAL = 0, // Generated from gl_VertexIndex, no vertex buffer
+    VERTEX_FORMAT_PACKED = 1,     // PackedVertex at VERTEX_BINDING_VERTICES
+};
+
+const static uint32_t VERTEX_BINDING_VERTICES = 1;
+
+// Full precision vertex, as imported and optimized. Position first, as MeshAsset expects.
+struct Vertex
+{
+    glm::vec3 position;
+    glm::vec3 normal;
+    glm::vec4 tangent; // xyz tangent, w bitangent sign
+    glm::vec2 uv;
+};
+
+// GPU vertex, 20 bytes against Vertex's 48. Decoded by the fixed-function formats in
+// appendVertexInputDescriptions() plus the octahedral decode in packed.vert.
+struct PackedVertex
+{
+    uint16_t position[4]; // R16G16B16A16_SNORM: xyz in the mesh's quantization bounds, w bitangent sign
+    uint32_t normal;      // R16G16_SNORM octahedral
+    uint32_t tangent;     // R16G16_SNORM octahedral
+    uint32_t uv;          // R16G16_SFLOAT
+};
+static_assert(sizeof(PackedVertex) == 20, "PackedVertex must match the attribute offsets");
+
+// Positions are stored as center + snorm * extent. The scale is uniform so normals need no
+// correction and the decode folds into an object's transform, see foldVertexQuantization().
+struct VertexQuantization
+{
+    glm::vec3 center;
+    float extent;
+};
+
+VertexQuantization computeVertexQuantization(const Vertex* vertices, size_t vertexCount);
+
+glm::vec2 encodeOctahedral(const glm::vec3& direction);
+glm::vec3 decodeOctahedral(const glm::vec2& encoded);
+
+PackedVertex packVertex(const Vertex& vertex, const VertexQuantization& quantization);
+Vertex unpackVertex(const PackedVertex& vertex, const VertexQuantization& quantization);
+std::vector<PackedVertex> packVertices(const std::vector<Vertex>& vertices, const VertexQuantization& quantization);
+
+// Returns the GpuObjectData transform that places dequantized positions where `transform`
+// would place the original ones
+glm::vec4 foldVertexQuantization(const glm::vec4& transform, const VertexQuantization& quantization);
+
+// Appends the vertex buffer binding and attributes `format` needs, if any
+void appendVertexInputDescriptions(
+    VertexFormat format,
+    std::vector<VkVertexInputBindingDescription>& bindings,
+    std::vector<VkVertexInputAttributeDescription>& attributes);
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef VIRTUAL_PAGE_CACHE_H
+#define VIRTUAL_PAGE_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+const static uint32_t VIRTUAL_PAGE_NONE = UINT32_MAX;
+
+// Residency bookkeeping of a virtual texture, independent of the GPU resources behind it.
+//
+// The virtual texture is square with pagesPerSide pages at level 0; every further level halves
+// that, and the last level is a single page that is loaded first and never evicted. Pages are
+// identified by one index over all levels (level 0 first, row-major within a level), which is
+// also the bit index in the feedback buffer and the texel order of the page table.
+//
+// Resident pages live in slots of a square atlas. Every page table entry maps to the finest
+// resident page at or above it, so a missing page falls back to a blurrier ancestor.
+struct VirtualPageCache
+{
+    uint32_t pagesPerSide{0};
+    uint32_t levelCount{0};
+    std::vector<uint32_t> levelOffsets; // First page index of each level
+    uint32_t pageCount{0};
+
+    uint32_t atlasPagesPerSide{0};
+    std::vector<uint32_t> pageSlots; // Per page, its atlas slot or VIRTUAL_PAGE_NONE
+    std::vector<uint32_t> slotPages; // Per slot, the page in it or VIRTUAL_PAGE_NONE
+    std::vector<uint64_t> slotLastUsed; // Frame the slot's page was last requested in
+    uint64_t frame{0};
+
+    // Entries for every page, see packVirtualPageEntry(); rebuilt by buildVirtualPageTable()
+    std::vector<uint32_t> pageTable;
+    bool pageTableDirty{true};
+};
+
+void initVirtualPageCache(VirtualPageCache& cache, uint32_t pagesPerSide, uint32_t atlasPagesPerSide);
+
+uint32_t getVirtualPagesPerSide(const VirtualPageCache& cache, uint32_t level);
+uint32_t getVirtualPageIndex(const VirtualPageCache& cache, uint32_t level, uint32_t x, uint32_t y);
+void getVirtualPageCoords(const VirtualPageCache& cache, uint32_t page, uint32_t& level, uint32_t& x, uint32_t& y);
+uint32_t getVirtualPageParent(const VirtualPageCache& cache, uint32_t page);
+
+// R8G8B8A8_UINT page table texel: atlas slot x and y, level of the page mapped there, 1
+uint32_t packVirtualPageEntry(const VirtualPageCache& cache, uint32_t slot, uint32_t level);
+
+// Starts a new frame and marks the pages set in requestBits (one bit per page) as used. Returns
+// the pages that must be loaded to satisfy them, which includes missing ancestors, coarsest
+// first and at most maxRequests of them. Pages flagged in `loading` are left out.
+std::vector<uint32_t> processVirtualPageRequests(
+    VirtualPageCache& cache,
+    const uint32_t* requestBits,
+    const std::vector<uint8_t>& loading,
+    size_t maxRequests);
+
+// Puts page into the least recently used slot not requested this frame. Returns the slot, or
+// VIRTUAL_PAGE_NONE when every slot is in use this frame.
+uint32_t allocateVirtualPageSlot(VirtualPageCache& cache, uint32_t page);
+// Maps page to a slot that is never evicted
+void pinVirtualPage(VirtualPageCache& cache, uint32_t page, uint32_t slot);
+
+void buildVirtualPageTable(VirtualPageCache& cache);
+
+#endif
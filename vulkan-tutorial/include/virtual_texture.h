@@ -0,0 +1,115 @@
+#ifndef VIRTUAL_TEXTURE_H
+#define VIRTUAL_TEXTURE_H
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include "device_features.h"
+#include "ktx2.h"
+#include "virtual_page_cache.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Must match the defines in virtual_texture.glsl. The border (one BCn block) lets bilinear and
+// anisotropic filtering reach past a page's edge without sampling its atlas neighbour.
+const static uint32_t VIRTUAL_TEXTURE_PAGE_SIZE = 128;
+const static uint32_t VIRTUAL_TEXTURE_PAGE_BORDER = 4;
+const static uint32_t VIRTUAL_TEXTURE_PADDED_PAGE_SIZE = VIRTUAL_TEXTURE_PAGE_SIZE + 2 * VIRTUAL_TEXTURE_PAGE_BORDER;
+// Resident pages per atlas side; the atlas is the whole VRAM footprint of the page data
+const static uint32_t VIRTUAL_TEXTURE_ATLAS_PAGES = 16;
+// Caps both the loads queued and the pages copied into the atlas per frame
+const static uint32_t VIRTUAL_TEXTURE_MAX_UPLOADS_PER_FRAME = 16;
+
+enum VirtualTextureBinding : uint32_t
+{
+    VIRTUAL_TEXTURE_BINDING_ATLAS = 0,      // sampler2D, the source format
+    VIRTUAL_TEXTURE_BINDING_PAGE_TABLE = 1, // usampler2D, one level per page level
+    VIRTUAL_TEXTURE_BINDING_FEEDBACK = 2,   // uint[], one request bit per page
+};
+
+struct VirtualTexturePageData
+{
+    uint32_t page;
+    std::vector<uint8_t> texels; // Padded page, in the source's block layout
+};
+
+// Software virtual texturing: no sparse residency. A square, power-of-two KTX2 texture with
+// a full mip chain stays memory-mapped; only the pages recently sampled are resident, in a
+// fixed-size atlas, and a page table maps every virtual page to the finest resident page
+// covering it.
+//
+// Each frame the fragment shaders (through virtual_texture.glsl) set a bit for every page
+// they wanted. updateVirtualTexture() reads those bits back, queues the missing pages for
+// the loader thread, copies pages it has finished into the atlas and refreshes the page table.
+// The loop runs a couple of frames behind, during which the blurrier fallback is shown.
+struct VirtualTexture
+{
+    Ktx2File source;
+    uint32_t blockSize{0};
+    uint32_t blockBytes{0};
+    VirtualPageCache cache;
+    std::vector<uint8_t> pageLoading; // Render thread only: queued or loaded but not uploaded
+
+    // Loader thread: reads pages out of the mapping so the render thread never waits on I/O
+    std::thread loaderThread;
+    std::mutex loaderMutex;
+    std::condition_variable loaderWake;
+    bool loaderRunning{false};
+    std::deque<uint32_t> loadQueue;
+    std::vector<VirtualTexturePageData> loadedPages;
+
+    VkImage atlasImage{nullptr};
+    VkDeviceMemory atlasImageMemory{nullptr};
+    VkImageView atlasView{nullptr};
+    VkSampler atlasSampler{nullptr};
+
+    VkImage pageTableImage{nullptr};
+    VkDeviceMemory pageTableImageMemory{nullptr};
+    VkImageView pageTableView{nullptr};
+    VkSampler pageTableSampler{nullptr};
+
+    // Written by the shaders, copied to the host-visible readback buffer at the start of the next frame
+    VkBuffer feedbackBuffer{nullptr};
+    VkDeviceMemory feedbackBufferMemory{nullptr};
+    VkBuffer readbackBuffer{nullptr};
+    VkDeviceMemory readbackBufferMemory{nullptr};
+    const uint32_t* readbackMapped{nullptr};
+
+    // Persistently mapped; page uploads followed by the page table
+    VkBuffer stagingBuffer{nullptr};
+    VkDeviceMemory stagingBufferMemory{nullptr};
+    uint8_t* stagingMapped{nullptr};
+
+    VkDescriptorSetLayout setLayout{nullptr};
+    VkDescriptorPool descriptorPool{nullptr};
+    VkDescriptorSet descriptorSet{nullptr};
+};
+
+// Needs fragmentStoresAndAtomics for the feedback writes
+bool hasVirtualTextureSupport(const DeviceFeatureChain& enabledFeatures);
+
+// Uploads the root page, which is never evicted, and starts the loader thread. `queue` must be
+// a graphics queue: the atlas and page table are sampled from fragment shaders.
+void createVirtualTexture(
+    VirtualTexture& virtualTexture,
+    const VkDevice& device,
+    const VkPhysicalDevice& physicalDevice,
+    const DeviceFeatureChain& enabledFeatures,
+    const VkCommandPool& commandPool,
+    const VkQueue& queue,
+    const std::string& filename);
+
+// Call once per frame, after the previous frame's fence and before anything that samples the
+// texture is recorded, outside of a render pass. Relies on there being a single frame in
+// flight: the staging and readback buffers are reused every frame.
+void updateVirtualTexture(VkCommandBuffer commandBuffer, VirtualTexture& virtualTexture);
+
+void destroyVirtualTexture(VirtualTexture& virtualTexture, const VkDevice& device);
+
+#endif
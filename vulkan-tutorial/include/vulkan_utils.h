@@ -4,8 +4,14 @@
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 
+#include "device_pointer.h"
+
+#include <array>
+#include <cstdint>
+#include <functional>
 #include <vector>
 #include <optional>
+#include <string>
 
 std::vector<VkExtensionProperties> getVkInstanceExtensionProperties();
 std::vector<const char*> getRequiredInstanceExtensions();
@@ -14,11 +20,21 @@ std::vector<VkPhysicalDevice> getPhysicalDevices(const VkInstance& instance);
 struct QueueFamilyIndices {
     std::optional<uint32_t> graphicsFamily;
     std::optional<uint32_t> presentFamily;
+    // Compute-only / transfer-only families when the device has them, otherwise
+    // the closest general-purpose family so callers can always submit to them
+    std::optional<uint32_t> computeFamily;
+    std::optional<uint32_t> transferFamily;
 
     bool isComplete() {
         return graphicsFamily.has_value()
             && presentFamily.has_value();
     }
+    bool hasDedicatedCompute() const {
+        return computeFamily.has_value() && computeFamily != graphicsFamily;
+    }
+    bool hasDedicatedTransfer() const {
+        return transferFamily.has_value() && transferFamily != graphicsFamily && transferFamily != computeFamily;
+    }
 };
 QueueFamilyIndices findQueueFamilies(const VkPhysicalDevice& physicalDevice, const VkSurfaceKHR& surface);
 
@@ -37,8 +53,140 @@ bool checkValidationLayerSupport();
 bool checkRequiredInstanceExtensionsSupport(std::vector<const char*> requiredExtensions);
 bool isPhysicalDeviceSuitable(const VkPhysicalDevice& physicalDevice, const VkSurfaceKHR& surface);
 bool checkDeviceExtensionSupport(const VkPhysicalDevice& physicalDevice);
+bool isDeviceExtensionAvailable(const std::vector<VkExtensionProperties>& availableExtensions, const char* extensionName);
+
+// Higher is better; negative means the device can't run the application at all
+int64_t scorePhysicalDevice(const VkPhysicalDevice& physicalDevice, const VkSurfaceKHR& surface);
+
+struct PhysicalDeviceOverride {
+    std::optional<uint32_t> vendorID;
+    std::optional<uint32_t> deviceID;
+    std::optional<std::array<uint8_t, VK_UUID_SIZE>> deviceUUID;
+};
+std::optional<PhysicalDeviceOverride> parsePhysicalDeviceOverride(const std::string& text);
+bool matchesPhysicalDeviceOverride(const VkPhysicalDevice& physicalDevice, const PhysicalDeviceOverride& deviceOverride);
+
+VkShaderModule createShaderModule(const VkDevice& device, const uint32_t* code, size_t codeSize);
+VkShaderModule createShaderModule(const VkDevice& device, const std::vector<uint32_t>& code);
+VkShaderModule loadShaderModule(const VkDevice& device, const std::string& sourceName);
+
+uint32_t findMemoryType(const VkPhysicalDevice& physicalDevice, uint32_t typeFilter, VkMemoryPropertyFlags properties);
+
+// Buffers used by more than one of queueFamilies are created VK_SHARING_MODE_CONCURRENT.
+// VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT in usage also allocates the memory with
+// VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT, so the buffer can be passed to getDevicePointer().
+void createBuffer(
+    const VkDevice& device,
+    const VkPhysicalDevice& physicalDevice,
+    VkDeviceSize size,
+    VkBufferUsageFlags usage,
+    VkMemoryPropertyFlags properties,
+    const std::vector<uint32_t>& queueFamilies,
+    VkBuffer& buffer,
+    VkDeviceMemory& bufferMemory);
+
+// Needs the bufferDeviceAddress feature and a buffer created as described at createBuffer()
+VkDeviceAddress getBufferDeviceAddress(const VkDevice& device, const VkBuffer& buffer);
+template <typename T>
+DevicePointer<T> getDevicePointer(const VkDevice& device, const VkBuffer& buffer)
+{
+    return DevicePointer<T>{getBufferDeviceAddress(device, buffer)};
+}
+
+// One-shot command buffer helpers for setup work; endSingleTimeCommands() blocks until the queue is idle
+VkCommandBuffer beginSingleTimeCommands(const VkDevice& device, const VkCommandPool& commandPool);
+void endSingleTimeCommands(const VkDevice& device, const VkCommandPool& commandPool, const VkQueue& queue, VkCommandBuffer commandBuffer);
+
+// Copies data into a new device-local buffer through a staging buffer on the given queue
+void createDeviceLocalBuffer(
+    const VkDevice& device,
+    const VkPhysicalDevice& physicalDevice,
+    const VkCommandPool& commandPool,
+    const VkQueue& queue,
+    const void* data,
+    VkDeviceSize size,
+    VkBufferUsageFlags usage,
+    const std::vector<uint32_t>& queueFamilies,
+    VkBuffer& buffer,
+    VkDeviceMemory& bufferMemory);
+// Same, but the caller writes the contents straight into the mapped staging memory, so data
+// that has to be converted on the way (e.g. vertex packing) needs no intermediate copy
+void createDeviceLocalBuffer(
+    const VkDevice& device,
+    const VkPhysicalDevice& physicalDevice,
+    const VkCommandPool& commandPool,
+    const VkQueue& queue,
+    const std::function<void(void*)>& writeContents,
+    VkDeviceSize size,
+    VkBufferUsageFlags usage,
+    const std::vector<uint32_t>& queueFamilies,
+    VkBuffer& buffer,
+    VkDeviceMemory& bufferMemory);
+
+void createImage(
+    const VkDevice& device,
+    const VkPhysicalDevice& physicalDevice,
+    uint32_t width,
+    uint32_t height,
+    uint32_t mipLevels,
+    VkFormat format,
+    VkImageUsageFlags usage,
+    VkImage& image,
+    VkDeviceMemory& imageMemory);
+VkImageView createImageView(
+    const VkDevice& device,
+    const VkImage& image,
+    VkFormat format,
+    VkImageAspectFlags aspectMask,
+    uint32_t baseMipLevel,
+    uint32_t levelCount);
+
+// First candidate whose optimal-tiling features include `features`
+VkFormat findSupportedFormat(
+    const VkPhysicalDevice& physicalDevice,
+    const std::vector<VkFormat>& candidates,
+    VkFormatFeatureFlags features);
+// A depth format that can be rendered to and then sampled (e.g. to build a depth pyramid)
+VkFormat findDepthFormat(const VkPhysicalDevice& physicalDevice);
 
-VkShaderModule createShaderModule(const VkDevice& device, const std::vector<char>& code);
+// Queue family ownership transfer. The release half is recorded on a queue of srcFamily and the
+// acquire half on a queue of dstFamily; the caller orders the two submissions with a semaphore.
+// Image layouts must match between both halves. With equal families release is a no-op and
+// acquire degrades to an ordinary barrier.
+void releaseBufferOwnership(
+    VkCommandBuffer commandBuffer,
+    VkBuffer buffer,
+    uint32_t srcFamily,
+    uint32_t dstFamily,
+    VkPipelineStageFlags srcStage,
+    VkAccessFlags srcAccess);
+void acquireBufferOwnership(
+    VkCommandBuffer commandBuffer,
+    VkBuffer buffer,
+    uint32_t srcFamily,
+    uint32_t dstFamily,
+    VkPipelineStageFlags dstStage,
+    VkAccessFlags dstAccess);
+void releaseImageOwnership(
+    VkCommandBuffer commandBuffer,
+    VkImage image,
+    const VkImageSubresourceRange& subresourceRange,
+    VkImageLayout oldLayout,
+    VkImageLayout newLayout,
+    uint32_t srcFamily,
+    uint32_t dstFamily,
+    VkPipelineStageFlags srcStage,
+    VkAccessFlags srcAccess);
+void acquireImageOwnership(
+    VkCommandBuffer commandBuffer,
+    VkImage image,
+    const VkImageSubresourceRange& subresourceRange,
+    VkImageLayout oldLayout,
+    VkImageLayout newLayout,
+    uint32_t srcFamily,
+    uint32_t dstFamily,
+    VkPipelineStageFlags dstStage,
+    VkAccessFlags dstAccess);
 
 void populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT& createInfo);
 
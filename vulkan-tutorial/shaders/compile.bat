@@ -1,3 +1,21 @@
-..\..\tools\glslc.exe default.vert -o vert.spv
-..\..\tools\glslc.exe default.frag -o frag.spv
+..\..\tools\glslc.exe -O --target-env=vulkan1.2 default.vert -o default.vert.spv
+..\..\tools\glslc.exe -O default.frag -o default.frag.spv
+..\..\tools\glslc.exe -O --target-env=vulkan1.2 packed.vert -o packed.vert.spv
+..\..\tools\glslc.exe -O cull.comp -o cull.comp.spv
+..\..\tools\glslc.exe -O downsample_r32f.comp -o downsample_r32f.comp.spv
+..\..\tools\glslc.exe -O downsample_rgba8.comp -o downsample_rgba8.comp.spv
+..\..\tools\glslc.exe -O downsample_rgba16f.comp -o downsample_rgba16f.comp.spv
+..\..\tools\glslc.exe -O --target-env=vulkan1.2 downsample_subgroup_r32f.comp -o downsample_subgroup_r32f.comp.spv
+..\..\tools\glslc.exe -O --target-env=vulkan1.2 downsample_subgroup_rgba8.comp -o downsample_subgroup_rgba8.comp.spv
+..\..\tools\glslc.exe -O --target-env=vulkan1.2 downsample_subgroup_rgba16f.comp -o downsample_subgroup_rgba16f.comp.spv
+..\..\tools\glslc.exe -O meshlet_cull.comp -o meshlet_cull.comp.spv
+..\..\tools\glslc.exe -O --target-env=vulkan1.2 primitive_reduce.comp -o primitive_reduce.comp.spv
+..\..\tools\glslc.exe -O --target-env=vulkan1.2 primitive_scan.comp -o primitive_scan.comp.spv
+..\..\tools\glslc.exe -O --target-env=vulkan1.2 primitive_scan_add.comp -o primitive_scan_add.comp.spv
+..\..\tools\glslc.exe -O --target-env=vulkan1.2 primitive_compact.comp -o primitive_compact.comp.spv
+..\..\tools\glslc.exe -O --target-env=vulkan1.2 primitive_sort_setup.comp -o primitive_sort_setup.comp.spv
+..\..\tools\glslc.exe -O --target-env=vulkan1.2 primitive_sort_histogram.comp -o primitive_sort_histogram.comp.spv
+..\..\tools\glslc.exe -O --target-env=vulkan1.2 primitive_sort_onesweep.comp -o primitive_sort_onesweep.comp.spv
+..\..\tools\glslc.exe -O --target-env=vulkan1.3 meshlet.task -o meshlet.task.spv
+..\..\tools\glslc.exe -O --target-env=vulkan1.3 meshlet.mesh -o meshlet.mesh.spv
 pause
\ No newline at end of file
@@ -4,6 +4,13 @@ layout(location = 0) in vec3 fragColor;
 
 layout(location = 0) out vec4 outColor;
 
+// constant_id matches the MaterialFeatureBits bit index
+layout(constant_id = 1) const bool GRAYSCALE = false;
+
 void main() {
-    outColor = vec4(fragColor, 1.0);
+    vec3 color = fragColor;
+    if (GRAYSCALE) {
+        color = vec3(dot(color, vec3(0.299, 0.587, 0.114)));
+    }
+    outColor = vec4(color, 1.0);
 }
\ No newline at end of file
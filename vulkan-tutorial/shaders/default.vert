@@ -1,4 +1,5 @@
 #version 450
+#extension GL_EXT_buffer_reference : require
 
 vec2 positions[3] = vec2[](
     vec2(0.0, -0.5),
@@ -12,9 +13,41 @@ vec3 colors[3] = vec3[](
     vec3(0.0, 0.0, 1.0)
 );
 
+// constant_id matches the MaterialFeatureBits bit index
+layout(constant_id = 0) const bool USE_VERTEX_COLOR = true;
+
+struct ObjectData {
+    vec4 boundingSphere;
+    vec4 transform;
+    uint indexCount;
+    uint firstIndex;
+    int vertexOffset;
+    uint padding;
+};
+
+layout(buffer_reference, std430, buffer_reference_align = 16) readonly buffer ObjectBuffer {
+    ObjectData objects[];
+};
+
+// Per-instance stream: the identity stream for indirect draws, whose firstInstance is the
+// object index, or the batch's object indices for instanced draws
+layout(location = 0) in uint inObjectIndex;
+
+// Mirrors DrawPushConstants
+const uint DRAW_OBJECT_FROM_INSTANCE = 0xFFFFFFFFu;
+layout(push_constant) uniform DrawConstants {
+    ObjectBuffer scene; // GpuScene::objects
+    uint objectIndex;   // Single-instance draws skip the instance stream
+    uint materialIndex;
+} draw;
+
 layout(location = 0) out vec3 fragColor;
 
 void main() {
-    gl_Position = vec4(positions[gl_VertexIndex], 0.0, 1.0);
-    fragColor = colors[gl_VertexIndex];
+    uint objectIndex = draw.objectIndex != DRAW_OBJECT_FROM_INSTANCE ? draw.objectIndex : inObjectIndex;
+    ObjectData object = draw.scene.objects[objectIndex];
+    vec2 position = positions[gl_VertexIndex] * object.transform.z + object.transform.xy;
+
+    gl_Position = vec4(position, object.transform.w, 1.0);
+    fragColor = USE_VERTEX_COLOR ? colors[gl_VertexIndex] : vec3(1.0);
 }
\ No newline at end of file
@@ -0,0 +1,269 @@
+// Single-pass downsampler, included by the downsample_*.comp variants after they define
+// FORMAT, the format qualifier of the destination storage images.
+//
+// Level 0 of the destination chain is reduced from the source texture, which may be larger
+// than it by any factor up to 2 (e.g. a depth buffer into a power-of-two pyramid, or mip 0 of
+// a texture into its mip 1). Each workgroup then reduces a 32x32 tile of level 0 down to one
+// texel of level 5: level 1 in registers, the rest in shared memory. The last workgroup to
+// finish (found with an atomic counter) reduces the remaining levels, so the whole chain is
+// one dispatch with no barriers between levels.
+//
+// Edge texels are clamped rather than zeroed, so a level with an odd or unit size reduces the
+// same way whatever the operation.
+//
+// With SUBGROUP_REDUCTION defined (the downsample_subgroup_*.comp variants, which enable
+// GL_KHR_shader_subgroup_quad) level 2 is reduced from level 1 with quad swaps instead, and
+// only levels 3-5 go through shared memory.
+
+#define MAX_MIPS 12
+#define TILE_SIZE 32
+#define SHARED_LEVELS 6
+
+#define REDUCTION_AVERAGE 0
+#define REDUCTION_MAX 1
+#define REDUCTION_MIN 2
+
+layout(local_size_x = 256) in;
+
+// DownsampleReduction
+layout(constant_id = 0) const uint REDUCTION = REDUCTION_AVERAGE;
+
+layout(set = 0, binding = 0) uniform sampler2D sourceTexture;
+layout(set = 0, binding = 1, FORMAT) uniform coherent image2D mips[MAX_MIPS];
+layout(std430, set = 0, binding = 2) coherent buffer WorkgroupCounter {
+    uint finishedWorkgroups;
+};
+
+layout(push_constant) uniform DownsampleConstants {
+    ivec2 sourceSize;
+    ivec2 destinationSize;
+    uint mipCount;
+    uint workgroupCount;
+};
+
+// Level 1 of the tile, or level 2 with SUBGROUP_REDUCTION; later levels are reduced into its
+// top-left corner
+shared vec4 tile[TILE_SIZE / 2][TILE_SIZE / 2];
+shared bool isLastWorkgroup;
+
+// Storage image arrays are only indexed with constants, so the shader doesn't need
+// shaderStorageImageArrayDynamicIndexing
+vec4 loadMip(uint level, ivec2 p) {
+    switch (level) {
+        case 0: return imageLoad(mips[0], p);
+        case 1: return imageLoad(mips[1], p);
+        case 2: return imageLoad(mips[2], p);
+        case 3: return imageLoad(mips[3], p);
+        case 4: return imageLoad(mips[4], p);
+        case 5: return imageLoad(mips[5], p);
+        case 6: return imageLoad(mips[6], p);
+        case 7: return imageLoad(mips[7], p);
+        case 8: return imageLoad(mips[8], p);
+        case 9: return imageLoad(mips[9], p);
+        case 10: return imageLoad(mips[10], p);
+        default: return imageLoad(mips[11], p);
+    }
+}
+
+void storeMip(uint level, ivec2 p, vec4 value) {
+    switch (level) {
+        case 0: imageStore(mips[0], p, value); break;
+        case 1: imageStore(mips[1], p, value); break;
+        case 2: imageStore(mips[2], p, value); break;
+        case 3: imageStore(mips[3], p, value); break;
+        case 4: imageStore(mips[4], p, value); break;
+        case 5: imageStore(mips[5], p, value); break;
+        case 6: imageStore(mips[6], p, value); break;
+        case 7: imageStore(mips[7], p, value); break;
+        case 8: imageStore(mips[8], p, value); break;
+        case 9: imageStore(mips[9], p, value); break;
+        case 10: imageStore(mips[10], p, value); break;
+        default: imageStore(mips[11], p, value); break;
+    }
+}
+
+ivec2 levelSize(uint level) {
+    return max(destinationSize >> int(level), ivec2(1));
+}
+
+vec4 reduce(vec4 a, vec4 b, vec4 c, vec4 d) {
+    if (REDUCTION == REDUCTION_MAX) {
+        return max(max(a, b), max(c, d));
+    }
+    if (REDUCTION == REDUCTION_MIN) {
+        return min(min(a, b), min(c, d));
+    }
+    return (a + b + c + d) * 0.25;
+}
+
+// Reduces every source texel the level 0 texel touches (at most 3x3, as level 0 is at least
+// half the source size); max and min stay conservative for non-power-of-two sources
+vec4 reduceSource(ivec2 p) {
+    ivec2 begin = (p * sourceSize) / destinationSize;
+    ivec2 end = min(((p + 1) * sourceSize + destinationSize - 1) / destinationSize, sourceSize);
+
+    vec4 result = texelFetch(sourceTexture, begin, 0);
+    vec4 sum = vec4(0.0);
+    for (int y = begin.y; y < end.y; y++) {
+        for (int x = begin.x; x < end.x; x++) {
+            vec4 value = texelFetch(sourceTexture, ivec2(x, y), 0);
+            sum += value;
+            if (REDUCTION == REDUCTION_MAX) {
+                result = max(result, value);
+            } else if (REDUCTION == REDUCTION_MIN) {
+                result = min(result, value);
+            }
+        }
+    }
+    if (REDUCTION == REDUCTION_AVERAGE) {
+        ivec2 extent = end - begin;
+        result = sum / float(extent.x * extent.y);
+    }
+    return result;
+}
+
+#ifdef SUBGROUP_REDUCTION
+// Z-order position of `index` in a 16x16 grid: every 4 consecutive indices form a 2x2 block
+ivec2 decodeMorton(uint index) {
+    uvec2 bits = uvec2(index, index >> 1) & 0x55u;
+    bits = (bits | (bits >> 1)) & 0x33u;
+    bits = (bits | (bits >> 2)) & 0x0fu;
+    return ivec2(bits);
+}
+
+// Level 2 texel of the quad's 2x2 block of level 1 texels, p being this invocation's. A texel past
+// the edge of level 1 takes its clamped neighbour, which always lies in the same quad.
+vec4 reduceQuad(vec4 value, ivec2 p) {
+    ivec2 last = levelSize(1) - 1;
+    vec4 horizontal = subgroupQuadSwapHorizontal(value);
+    if (p.x > last.x) {
+        value = horizontal;
+    }
+    vec4 vertical = subgroupQuadSwapVertical(value);
+    if (p.y > last.y) {
+        value = vertical;
+    }
+    return reduce(
+        value, subgroupQuadSwapHorizontal(value), subgroupQuadSwapVertical(value), subgroupQuadSwapDiagonal(value));
+}
+
+#define FIRST_SHARED_LEVEL 3
+#else
+#define FIRST_SHARED_LEVEL 2
+#endif
+
+// Child (2 * p + offset) of a level `level` texel, clamped to level - 1 and to the tile
+vec4 loadTileChild(uint level, ivec2 local, ivec2 offset) {
+    ivec2 origin = ivec2(gl_WorkGroupID.xy) * (TILE_SIZE >> (level - 1));
+    ivec2 child = min(origin + local * 2 + offset, levelSize(level - 1) - 1) - origin;
+    child = clamp(child, ivec2(0), ivec2((TILE_SIZE >> (level - 1)) - 1));
+    return tile[child.y][child.x];
+}
+
+void main() {
+    uint localIndex = gl_LocalInvocationIndex;
+
+    // Levels 0 and 1: each invocation reduces a 2x2 quad of level 0 straight to its level 1
+    // texel, without going through shared memory
+#ifdef SUBGROUP_REDUCTION
+    // Laid out so each subgroup quad holds a 2x2 block of level 1. 256 invocations split into
+    // full subgroups on every implementation, so the subgroup indices cover the tile once.
+    ivec2 quad = decodeMorton(gl_SubgroupID * gl_SubgroupSize + gl_SubgroupInvocationID);
+#else
+    ivec2 quad = ivec2(localIndex % (TILE_SIZE / 2), localIndex / (TILE_SIZE / 2));
+#endif
+    ivec2 quadOrigin = ivec2(gl_WorkGroupID.xy) * TILE_SIZE + quad * 2;
+    vec4 texels[4];
+    for (uint i = 0; i < 4; i++) {
+        ivec2 p = quadOrigin + ivec2(i & 1, i >> 1);
+        texels[i] = reduceSource(min(p, destinationSize - 1));
+        if (all(lessThan(p, destinationSize))) {
+            storeMip(0, p, texels[i]);
+        }
+    }
+
+    vec4 value = reduce(texels[0], texels[1], texels[2], texels[3]);
+    ivec2 p = ivec2(gl_WorkGroupID.xy) * (TILE_SIZE / 2) + quad;
+    if (mipCount > 1 && all(lessThan(p, levelSize(1)))) {
+        storeMip(1, p, value);
+    }
+#ifdef SUBGROUP_REDUCTION
+    // Level 2 from the quad, then the tile holds level 2
+    value = reduceQuad(value, p);
+    if ((gl_SubgroupInvocationID & 3) == 0) {
+        ivec2 local = quad / 2;
+        tile[local.y][local.x] = value;
+        p = ivec2(gl_WorkGroupID.xy) * (TILE_SIZE / 4) + local;
+        if (mipCount > 2 && all(lessThan(p, levelSize(2)))) {
+            storeMip(2, p, value);
+        }
+    }
+#else
+    tile[quad.y][quad.x] = value;
+#endif
+
+    // Levels FIRST_SHARED_LEVEL-5: reduce the tile in place
+    for (uint level = FIRST_SHARED_LEVEL; level < SHARED_LEVELS; level++) {
+        uint size = TILE_SIZE >> level;
+        bool active = localIndex < size * size;
+        ivec2 local = ivec2(localIndex % size, localIndex / size);
+
+        barrier();
+        if (active) {
+            value = reduce(
+                loadTileChild(level, local, ivec2(0, 0)),
+                loadTileChild(level, local, ivec2(1, 0)),
+                loadTileChild(level, local, ivec2(0, 1)),
+                loadTileChild(level, local, ivec2(1, 1)));
+        }
+        barrier();
+
+        if (active) {
+            tile[local.y][local.x] = value;
+            p = ivec2(gl_WorkGroupID.xy) * int(size) + local;
+            if (level < mipCount && all(lessThan(p, levelSize(level)))) {
+                storeMip(level, p, value);
+            }
+        }
+    }
+
+    if (mipCount <= SHARED_LEVELS) {
+        return;
+    }
+
+    // Publish this workgroup's level 5 texel, then let only the last workgroup continue
+    memoryBarrierImage();
+    barrier();
+    if (localIndex == 0) {
+        isLastWorkgroup = atomicAdd(finishedWorkgroups, 1u) == workgroupCount - 1;
+    }
+    barrier();
+    if (!isLastWorkgroup) {
+        return;
+    }
+
+    for (uint level = SHARED_LEVELS; level < mipCount; level++) {
+        ivec2 size = levelSize(level);
+        ivec2 previousSize = levelSize(level - 1);
+
+        for (uint index = localIndex; index < uint(size.x * size.y); index += 256) {
+            ivec2 texel = ivec2(index % uint(size.x), index / uint(size.x));
+            ivec2 p0 = min(texel * 2, previousSize - 1);
+            ivec2 p1 = min(texel * 2 + 1, previousSize - 1);
+
+            storeMip(level, texel, reduce(
+                loadMip(level - 1, p0),
+                loadMip(level - 1, ivec2(p1.x, p0.y)),
+                loadMip(level - 1, ivec2(p0.x, p1.y)),
+                loadMip(level - 1, p1)));
+        }
+
+        memoryBarrierImage();
+        barrier();
+    }
+
+    // Ready for the next dispatch
+    if (localIndex == 0) {
+        finishedWorkgroups = 0;
+    }
+}
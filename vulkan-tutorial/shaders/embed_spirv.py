@@ -0,0 +1,93 @@
+#!/usr/bin/env python3
+"""Bakes compiled SPIR-V into a C++ header as constexpr uint32_t arrays.
+
+Usage: embed_spirv.py -o <header> <file.spv>...
+
+Each "name.stage.spv" becomes EmbeddedShaders::NAME_STAGE, and EMBEDDED_SHADERS
+lists every module by its source file name ("name.stage") for runtime lookup.
+"""
+
+import argparse
+import hashlib
+import os
+import re
+import struct
+import sys
+
+SPIRV_MAGIC = 0x07230203
+
+
+def symbol_name(source_name):
+    return re.sub(r"[^0-9A-Za-z]", "_", source_name).upper()
+
+
+def read_words(path):
+    with open(path, "rb") as f:
+        data = f.read()
+    if len(data) % 4 != 0:
+        sys.exit(f"embed_spirv.py: {path} is not a whole number of 32-bit words")
+    words = struct.unpack(f"<{len(data) // 4}I", data)
+    if not words or words[0] != SPIRV_MAGIC:
+        sys.exit(f"embed_spirv.py: {path} is not little-endian SPIR-V")
+    return data, words
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("-o", "--output", required=True)
+    parser.add_argument("inputs", nargs="+")
+    args = parser.parse_args()
+
+    lines = [
+        "// Generated by shaders/embed_spirv.py. Do not edit.",
+        "#ifndef EMBEDDED_SHADERS_H",
+        "#define EMBEDDED_SHADERS_H",
+        "",
+        "#include <cstddef>",
+        "#include <cstdint>",
+        "",
+        "namespace EmbeddedShaders {",
+        "",
+    ]
+
+    entries = []
+    for path in args.inputs:
+        data, words = read_words(path)
+        source_name = os.path.basename(path)[: -len(".spv")]
+        symbol = symbol_name(source_name)
+        entries.append((source_name, symbol))
+
+        lines.append(f"// {source_name}: {len(data)} bytes, sha256 {hashlib.sha256(data).hexdigest()}")
+        lines.append(f"inline constexpr uint32_t {symbol}[] = {{")
+        for i in range(0, len(words), 8):
+            lines.append("    " + ", ".join(f"0x{w:08x}" for w in words[i : i + 8]) + ",")
+        lines.append("};")
+        lines.append("")
+
+    lines += [
+        "struct EmbeddedShader",
+        "{",
+        "    const char* sourceName;",
+        "    const uint32_t* code;",
+        "    size_t codeSize; // In bytes, as VkShaderModuleCreateInfo expects",
+        "};",
+        "",
+        "inline constexpr EmbeddedShader EMBEDDED_SHADERS[] = {",
+    ]
+    for source_name, symbol in entries:
+        lines.append(f'    {{"{source_name}", {symbol}, sizeof({symbol})}},')
+    lines += [
+        "};",
+        "",
+        "} // namespace EmbeddedShaders",
+        "",
+        "#endif",
+        "",
+    ]
+
+    with open(args.output, "w", newline="\n") as f:
+        f.write("\n".join(lines))
+
+
+if __name__ == "__main__":
+    main()
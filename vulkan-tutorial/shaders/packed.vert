@@ -0,0 +1,57 @@
+#version 450
+#extension GL_EXT_buffer_reference : require
+
+// constant_id matches the MaterialFeatureBits bit index
+layout(constant_id = 0) const bool USE_VERTEX_COLOR = true;
+
+struct ObjectData {
+    vec4 boundingSphere;
+    vec4 transform;
+    uint indexCount;
+    uint firstIndex;
+    int vertexOffset;
+    uint padding;
+};
+
+layout(buffer_reference, std430, buffer_reference_align = 16) readonly buffer ObjectBuffer {
+    ObjectData objects[];
+};
+
+layout(location = 0) in uint inObjectIndex;
+
+// Mirrors DrawPushConstants
+const uint DRAW_OBJECT_FROM_INSTANCE = 0xFFFFFFFFu;
+layout(push_constant) uniform DrawConstants {
+    ObjectBuffer scene; // GpuScene::objects
+    uint objectIndex;   // Single-instance draws skip the instance stream
+    uint materialIndex;
+} draw;
+
+// PackedVertex; the SNORM and SFLOAT attribute formats are unpacked by the input assembler.
+// Positions are in the mesh's quantization bounds, which foldVertexQuantization() folds into
+// the object transform.
+layout(location = 1) in vec4 inPosition; // xyz position, w bitangent sign
+layout(location = 2) in vec2 inNormal;   // Octahedral
+layout(location = 3) in vec2 inTangent;  // Octahedral, unused until materials sample normal maps
+layout(location = 4) in vec2 inUv;
+
+layout(location = 0) out vec3 fragColor;
+
+vec3 octahedralDecode(vec2 encoded) {
+    vec3 n = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    float fold = max(-n.z, 0.0);
+    n.xy += mix(vec2(fold), vec2(-fold), greaterThanEqual(n.xy, vec2(0.0)));
+    return normalize(n);
+}
+
+void main() {
+    uint objectIndex = draw.objectIndex != DRAW_OBJECT_FROM_INSTANCE ? draw.objectIndex : inObjectIndex;
+    ObjectData object = draw.scene.objects[objectIndex];
+    vec2 position = inPosition.xy * object.transform.z + object.transform.xy;
+
+    vec3 normal = octahedralDecode(inNormal);
+
+    gl_Position = vec4(position, object.transform.w, 1.0);
+    // No lighting yet: show the decoded normals, or the UVs when vertex color is off
+    fragColor = USE_VERTEX_COLOR ? normal * 0.5 + 0.5 : vec3(inUv, 0.0);
+}
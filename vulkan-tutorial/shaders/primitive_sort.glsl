@@ -0,0 +1,33 @@
+// Shared by the primitive_sort_*.comp kernels, see recordRadixSort(). Included after
+// primitives.glsl.
+//
+// Scratch layout, mirrored by getRadixSortScratchLayout():
+//   state       VkDispatchIndirectCommand, clamped key count, one partition counter per pass
+//   histogram   RADIX_SIZE digit counts per pass, zeroed by the setup kernel
+//   status      RADIX_SIZE look-back words per partition per pass, zeroed by the histogram kernel
+
+#define RADIX_BITS 8
+#define RADIX_SIZE 256
+#define RADIX_PASS_COUNT 4
+#if RADIX_SIZE != WORKGROUP_SIZE
+#error One thread per digit
+#endif
+
+#define SORT_STATE_DISPATCH 0
+#define SORT_STATE_COUNT 3
+#define SORT_STATE_PARTITION_COUNTERS 4
+
+// Look-back status word: flag in the top 2 bits, digit count in the rest
+#define STATUS_NOT_READY 0u
+#define STATUS_AGGREGATE 1u // Count of this partition alone
+#define STATUS_INCLUSIVE 2u // Count of this and every earlier partition
+#define STATUS_FLAG_SHIFT 30
+#define STATUS_VALUE_MASK 0x3FFFFFFFu
+
+uint getDigit(uint key, uint pass) {
+    return (key >> (pass * RADIX_BITS)) & (RADIX_SIZE - 1);
+}
+
+uint getStatusIndex(uint pass, uint partition, uint digit, uint maxPartitions) {
+    return (pass * maxPartitions + partition) * RADIX_SIZE + digit;
+}
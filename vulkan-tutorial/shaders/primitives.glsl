@@ -0,0 +1,64 @@
+// Shared by the primitive_*.comp kernels, see gpu_primitives.h. Buffers are passed as device
+// addresses in push constants, so none of the kernels has a descriptor set.
+//
+// Element order within a workgroup follows subgroups rather than gl_LocalInvocationIndex,
+// which Vulkan does not tie to gl_SubgroupInvocationID. The workgroup size is a multiple of
+// every subgroup size, so subgroups are assumed to be full.
+
+#extension GL_EXT_buffer_reference : require
+#extension GL_KHR_shader_subgroup_basic : require
+#extension GL_KHR_shader_subgroup_arithmetic : require
+#extension GL_KHR_shader_subgroup_ballot : require
+
+// Match GPU_PRIMITIVE_WORKGROUP_SIZE and GPU_PRIMITIVE_ITEMS_PER_THREAD
+#define WORKGROUP_SIZE 256
+#define ITEMS_PER_THREAD 4
+#define BLOCK_SIZE (WORKGROUP_SIZE * ITEMS_PER_THREAD)
+
+layout(local_size_x = WORKGROUP_SIZE) in;
+
+layout(buffer_reference, std430, buffer_reference_align = 4) buffer UintBuffer {
+    uint values[];
+};
+
+// One entry per subgroup; sized for the smallest possible subgroup
+shared uint subgroupPartials[WORKGROUP_SIZE];
+shared uint workgroupTotal;
+
+uint getThreadIndex() {
+    return gl_SubgroupID * gl_SubgroupSize + gl_SubgroupInvocationID;
+}
+
+// Exclusive prefix sum of value over the workgroup, in getThreadIndex() order. total receives
+// the sum of every value. Has barriers: every invocation must call it.
+uint workgroupExclusiveAdd(uint value, out uint total) {
+    uint inclusive = subgroupInclusiveAdd(value);
+    if (gl_SubgroupInvocationID == gl_SubgroupSize - 1) {
+        subgroupPartials[gl_SubgroupID] = inclusive;
+    }
+    barrier();
+
+    // The first subgroup scans the subgroup totals, a subgroup's worth at a time
+    if (gl_SubgroupID == 0) {
+        uint carry = 0;
+        for (uint first = 0; first < gl_NumSubgroups; first += gl_SubgroupSize) {
+            uint index = first + gl_SubgroupInvocationID;
+            uint partial = index < gl_NumSubgroups ? subgroupPartials[index] : 0;
+            uint scanned = subgroupExclusiveAdd(partial);
+            if (index < gl_NumSubgroups) {
+                subgroupPartials[index] = carry + scanned;
+            }
+            carry += subgroupAdd(partial);
+        }
+        if (subgroupElect()) {
+            workgroupTotal = carry;
+        }
+    }
+    barrier();
+
+    total = workgroupTotal;
+    uint result = subgroupPartials[gl_SubgroupID] + inclusive - value;
+    // The shared arrays may be reused right after
+    barrier();
+    return result;
+}
@@ -0,0 +1,73 @@
+// Virtual texture sampling for fragment shaders; see VirtualTexture in virtual_texture.h.
+// Define VIRTUAL_TEXTURE_SET before including to place the bindings in a set other than 1.
+//
+//   vec4 color = sampleVirtualTexture(uv);
+//
+// Picks the page level from the uv derivatives, records the page as wanted in the feedback
+// buffer, then samples whatever the page table maps it to: the page itself once resident, a
+// coarser ancestor until then. Filtering stays within one page level, so level transitions
+// are not blended.
+
+#ifndef VIRTUAL_TEXTURE_SET
+#define VIRTUAL_TEXTURE_SET 1
+#endif
+
+// Match VIRTUAL_TEXTURE_PAGE_SIZE / VIRTUAL_TEXTURE_PAGE_BORDER
+#define VIRTUAL_TEXTURE_PAGE_SIZE 128
+#define VIRTUAL_TEXTURE_PAGE_BORDER 4
+#define VIRTUAL_TEXTURE_PADDED_PAGE_SIZE (VIRTUAL_TEXTURE_PAGE_SIZE + 2 * VIRTUAL_TEXTURE_PAGE_BORDER)
+
+layout(set = VIRTUAL_TEXTURE_SET, binding = 0) uniform sampler2D virtualTextureAtlas;
+layout(set = VIRTUAL_TEXTURE_SET, binding = 1) uniform usampler2D virtualTexturePageTable;
+layout(std430, set = VIRTUAL_TEXTURE_SET, binding = 2) buffer VirtualTextureFeedback {
+    uint virtualTextureRequests[];
+};
+
+// Pages are numbered level by level, row-major, matching VirtualPageCache
+uint getVirtualPageIndex(int level, ivec2 page, int pagesPerSide) {
+    uint offset = 0;
+    for (int l = 0; l < level; l++) {
+        int side = pagesPerSide >> l;
+        offset += uint(side * side);
+    }
+    return offset + uint(page.y * (pagesPerSide >> level) + page.x);
+}
+
+void requestVirtualPage(int level, ivec2 page, int pagesPerSide) {
+    uint index = getVirtualPageIndex(level, page, pagesPerSide);
+    uint bit = 1u << (index & 31u);
+    // Most fragments find the bit already set; reading first keeps atomics rare
+    if ((virtualTextureRequests[index >> 5] & bit) == 0) {
+        atomicOr(virtualTextureRequests[index >> 5], bit);
+    }
+}
+
+vec4 sampleVirtualTexture(vec2 uv) {
+    int pagesPerSide = textureSize(virtualTexturePageTable, 0).x;
+    int levelCount = textureQueryLevels(virtualTexturePageTable);
+
+    // Derivatives before wrapping, so they stay continuous across the seam
+    vec2 texelDx = dFdx(uv) * float(pagesPerSide * VIRTUAL_TEXTURE_PAGE_SIZE);
+    vec2 texelDy = dFdy(uv) * float(pagesPerSide * VIRTUAL_TEXTURE_PAGE_SIZE);
+    float lod = log2(max(max(length(texelDx), length(texelDy)), 1.0));
+    int level = min(int(lod), levelCount - 1);
+    uv = fract(uv);
+
+    int side = pagesPerSide >> level;
+    ivec2 page = min(ivec2(uv * float(side)), ivec2(side - 1));
+    requestVirtualPage(level, page, pagesPerSide);
+
+    uvec4 entry = texelFetch(virtualTexturePageTable, page, level);
+    int mappedSide = pagesPerSide >> int(entry.z);
+
+    // Position inside the mapped page, then inside its atlas slot
+    vec2 inPage = fract(uv * float(mappedSide));
+    vec2 atlasTexel = vec2(entry.xy) * float(VIRTUAL_TEXTURE_PADDED_PAGE_SIZE)
+        + float(VIRTUAL_TEXTURE_PAGE_BORDER) + inPage * float(VIRTUAL_TEXTURE_PAGE_SIZE);
+    vec2 atlasSize = vec2(textureSize(virtualTextureAtlas, 0));
+
+    // The mapped level's texels are the atlas's texels, so scale the gradients to match
+    vec2 gradientScale = float(mappedSide * VIRTUAL_TEXTURE_PAGE_SIZE) / atlasSize;
+    vec2 atlasUv = atlasTexel / atlasSize;
+    return textureGrad(virtualTextureAtlas, atlasUv, dFdx(uv) * gradientScale, dFdy(uv) * gradientScale);
+}
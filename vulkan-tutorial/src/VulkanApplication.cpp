@@ -3,11 +3,30 @@
 #include "constants.h"
 #include "vulkan_utils.h"
 #include "utils.h"
+#include "pipeline_permutations.h"
+#include "task_graph.h"
+#include "device_features.h"
+#include "gpu_scene.h"
+#include "uniform_ring.h"
+#include "frustum.h"
+#include "depth_pyramid.h"
+#include "cpu_culling.h"
+#include "draw_batching.h"
+#include "meshlets.h"
+#include "meshlet_scene.h"
+#include "gpu_primitives.h"
+#include "gpu_primitives_benchmark.h"
 
 #include <stdexcept>
 #include <vector>
 #include <iostream>
 #include <set>
+#include <algorithm>
+#include <thread>
+#include <cstdlib>
+#include <optional>
+#include <map>
+#include <string>
 
 namespace VulkanApp {
     void run()
@@ -15,7 +34,12 @@ namespace VulkanApp {
         VulkanState state;
         initWindow(state);
         initVulkan(state);
-        mainLoop(state);
+        if (const char* benchmarkEnv = std::getenv(SORT_BENCHMARK_ENV)) {
+            runSortBenchmark(state, benchmarkEnv);
+        }
+        else {
+            mainLoop(state);
+        }
         cleanup(state);
     }
 
@@ -37,19 +61,52 @@ namespace VulkanApp {
     }
 
     void initVulkan(VulkanState& state){
-        createInstance(state);
-        setupDebugMessenger(state);
-        createSurface(state);
-        pickPhysicalDevice(state);
-        createLogicalDevice(state);
-        createSwapchain(state);
-        createImageViews(state);
-        createRenderPass(state);
-        createGraphicsPipeline(state);
-        createFramebuffers(state);
-        createCommandPool(state);
-        createCommandBuffer(state);
-        createSyncObjects(state);
+        // Each step only waits on the steps whose handles it consumes, so shader I/O, pipeline
+        // compilation and the command/sync setup overlap swapchain creation.
+        std::vector<TaskGraphNode> startupGraph = {
+            {"createInstance", {}, [&state]() { createInstance(state); }},
+            {"setupDebugMessenger", {"createInstance"}, [&state]() { setupDebugMessenger(state); }},
+            {"createSurface", {"createInstance"}, [&state]() { createSurface(state); }},
+            {"pickPhysicalDevice", {"createSurface"}, [&state]() { pickPhysicalDevice(state); }},
+            {"createLogicalDevice", {"pickPhysicalDevice"}, [&state]() { createLogicalDevice(state); }},
+            // chooseSwapExtent() queries GLFW, which must happen on the main thread
+            {"createSwapchain", {"createLogicalDevice"}, [&state]() { createSwapchain(state); }, true},
+            {"createImageViews", {"createSwapchain"}, [&state]() { createImageViews(state); }},
+            // Uses the graphics command pool, so it waits for createCommandBuffer to be done with it
+            {"createDepthResources",
+             {"createSwapchain", "createCommandBuffer"},
+             [&state]() { createDepthResources(state); }},
+            {"createRenderPass", {"createDepthResources"}, [&state]() { createRenderPass(state); }},
+            {"createDescriptorSetLayout", {"createLogicalDevice"}, [&state]() { createDescriptorSetLayout(state); }},
+            {"createPipelineLayout", {"createDescriptorSetLayout"}, [&state]() { createPipelineLayout(state); }},
+            {"loadShaders", {"createLogicalDevice"}, [&state]() { loadShaders(state); }},
+            {"createGraphicsPipeline",
+             {"createRenderPass", "createPipelineLayout", "loadShaders"},
+             [&state]() { createGraphicsPipeline(state); }},
+            {"createFramebuffers", {"createImageViews", "createRenderPass"}, [&state]() { createFramebuffers(state); }},
+            {"createCommandPool", {"createLogicalDevice"}, [&state]() { createCommandPool(state); }},
+            {"createCommandBuffer", {"createCommandPool"}, [&state]() { createCommandBuffer(state); }},
+            // After createDepthResources, which may submit to the same VkQueue when there is no
+            // dedicated transfer family, and loadShaders, which assigns material pipeline ids.
+            // The meshlet path builds its mesh shader pipeline against the render pass.
+            {"createScene",
+             {"createCommandPool", "createDescriptorSetLayout", "createDepthResources", "loadShaders", "createRenderPass"},
+             [&state]() { createScene(state); }},
+            {"createSyncObjects", {"createLogicalDevice"}, [&state]() { createSyncObjects(state); }},
+        };
+
+        uint32_t workerCount = std::clamp(std::thread::hardware_concurrency(), 1u, STARTUP_WORKER_COUNT_MAX);
+        std::vector<TaskTiming> timings = runTaskGraph(startupGraph, workerCount);
+        printTaskTimings("initVulkan()", timings);
+
+        startShaderHotReload(state.ShaderHotReload, SHADER_DIRECTORY);
+
+        if (!GPU_DRIVEN_RENDERING && !MESHLET_RENDERING) {
+            // The recording thread culls a chunk too, so it counts as one of the workers
+            uint32_t cullingWorkerCount =
+                std::clamp(std::thread::hardware_concurrency(), 1u, CPU_CULLING_WORKER_COUNT_MAX);
+            startWorkerPool(state.CullingWorkers, cullingWorkerCount - 1);
+        }
     }
 
     void createInstance(VulkanState& state){
@@ -65,7 +122,7 @@ namespace VulkanApp {
         appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
         appInfo.pEngineName = ENGINE_NAME.c_str();
         appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-        appInfo.apiVersion = VK_API_VERSION_1_0;
+        appInfo.apiVersion = VULKAN_API_VERSION;
 
         std::vector<const char*> requiredExtensions = getRequiredInstanceExtensions();
         if (!checkRequiredInstanceExtensionsSupport(requiredExtensions)) {
@@ -121,25 +178,111 @@ namespace VulkanApp {
             throw std::runtime_error("ERROR VulkanApplication::pickPhysicalDevice() No physical devices present!");
         }
 
+        std::string overrideText = PHYSICAL_DEVICE_OVERRIDE;
+        if (const char* overrideEnv = std::getenv(PHYSICAL_DEVICE_OVERRIDE_ENV)) {
+            overrideText = overrideEnv;
+        }
+        std::optional<PhysicalDeviceOverride> deviceOverride;
+        if (!overrideText.empty()) {
+            deviceOverride = parsePhysicalDeviceOverride(overrideText);
+            if (!deviceOverride.has_value()) {
+                std::cerr << "pickPhysicalDevice() Ignoring malformed device override \"" << overrideText << "\"" << std::endl;
+            }
+        }
+
+        std::vector<DeviceFeatureRequest> featureRequests = getDeviceFeatureRequests();
+
+        int64_t bestScore = -1;
+        VkPhysicalDevice overrideDevice = VK_NULL_HANDLE;
         for (const VkPhysicalDevice& physicalDevice : physicalDevices) {
-            if (isPhysicalDeviceSuitable(physicalDevice, state.VkSurface)) {
+            VkPhysicalDeviceProperties deviceProperties;
+            vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+
+            int64_t score = scorePhysicalDevice(physicalDevice, state.VkSurface);
+            if (score >= 0 && !getMissingRequiredDeviceFeatures(physicalDevice, featureRequests).empty()) {
+                score = -1;
+            }
+            std::cout << "Physical device " << deviceProperties.deviceName << " score " << score << std::endl;
+            if (score < 0) {
+                continue;
+            }
+
+            if (deviceOverride.has_value() && overrideDevice == VK_NULL_HANDLE
+                && matchesPhysicalDeviceOverride(physicalDevice, deviceOverride.value())) {
+                overrideDevice = physicalDevice;
+            }
+            if (score > bestScore) {
+                bestScore = score;
                 state.VkPhysicalDevice = physicalDevice;
-                break;
             }
         }
 
+        if (overrideDevice != VK_NULL_HANDLE) {
+            state.VkPhysicalDevice = overrideDevice;
+        }
+        else if (deviceOverride.has_value()) {
+            std::cerr << "pickPhysicalDevice() No suitable device matches override \"" << overrideText
+                      << "\", using the highest scoring device" << std::endl;
+        }
+
         if (state.VkPhysicalDevice == VK_NULL_HANDLE) {
             throw std::runtime_error(
                 "ERROR VulkanApplication::pickPhysicalDevice() No suitable physical device is present!");
         }
+
+        VkPhysicalDeviceProperties selectedProperties;
+        vkGetPhysicalDeviceProperties(state.VkPhysicalDevice, &selectedProperties);
+        std::cout << "Selected physical device " << selectedProperties.deviceName << std::endl;
+    }
+    std::vector<DeviceFeatureRequest> getDeviceFeatureRequests(){
+        // Subsystems list what they need here. Optional features are enabled when supported;
+        // check VulkanState::EnabledFeatures before taking the matching fast path.
+        std::vector<DeviceFeatureRequest> requests;
+
+        // Submission and synchronization
+        requestDeviceFeature(requests, DEVICE_FEATURE(vulkan12.timelineSemaphore), false);
+        requestDeviceFeature(requests, DEVICE_FEATURE(vulkan13.synchronization2), false);
+
+        // Rendering
+        requestDeviceFeature(requests, DEVICE_FEATURE(vulkan13.dynamicRendering), false);
+        requestDeviceFeature(requests, DEVICE_FEATURE(features2.features.multiDrawIndirect), false);
+        // The GPU-driven path passes the object index through firstInstance of each indirect draw
+        requestDeviceFeature(requests, DEVICE_FEATURE(features2.features.drawIndirectFirstInstance), true);
+        requestDeviceFeature(requests, DEVICE_FEATURE(vulkan11.shaderDrawParameters), false);
+        requestDeviceFeature(requests, DEVICE_FEATURE(vulkan12.drawIndirectCount), false);
+        requestDeviceFeature(requests, DEVICE_FEATURE(meshShader.taskShader), false);
+        requestDeviceFeature(requests, DEVICE_FEATURE(meshShader.meshShader), false);
+
+        // Scene data access
+        // The vertex shaders read the scene's objects through DrawPushConstants::objects
+        requestDeviceFeature(requests, DEVICE_FEATURE(vulkan12.bufferDeviceAddress), true);
+        requestDeviceFeature(requests, DEVICE_FEATURE(vulkan12.descriptorIndexing), false);
+        requestDeviceFeature(requests, DEVICE_FEATURE(vulkan12.runtimeDescriptorArray), false);
+        requestDeviceFeature(requests, DEVICE_FEATURE(vulkan12.descriptorBindingPartiallyBound), false);
+        requestDeviceFeature(requests, DEVICE_FEATURE(vulkan12.shaderSampledImageArrayNonUniformIndexing), false);
+
+        // Textures: BCn data is uploaded as is, so without the feature those files fail to load
+        // (isTextureFormatSupported()); samplers fall back to no anisotropy
+        requestDeviceFeature(requests, DEVICE_FEATURE(features2.features.textureCompressionBC), false);
+        requestDeviceFeature(requests, DEVICE_FEATURE(features2.features.samplerAnisotropy), false);
+        // Virtual textures: the fragment shaders write page requests to the feedback buffer.
+        // Checked by hasVirtualTextureSupport() where virtual textures are created.
+        requestDeviceFeature(requests, DEVICE_FEATURE(features2.features.fragmentStoresAndAtomics), false);
+
+        return requests;
     }
     void createLogicalDevice(VulkanState& state){
-        QueueFamilyIndices indices = findQueueFamilies(state.VkPhysicalDevice, state.VkSurface);
+        state.QueueFamilies = findQueueFamilies(state.VkPhysicalDevice, state.VkSurface);
+        const QueueFamilyIndices& indices = state.QueueFamilies;
 
         float queuePriority = 1.0f;
 
         std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-        std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily.value(), indices.presentFamily.value()};
+        std::set<uint32_t> uniqueQueueFamilies = {
+            indices.graphicsFamily.value(),
+            indices.presentFamily.value(),
+            indices.computeFamily.value(),
+            indices.transferFamily.value()};
         for (uint32_t queueFamily : uniqueQueueFamilies) {
             VkDeviceQueueCreateInfo queueCreateInfo;
             queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
@@ -152,75 +295,30 @@ namespace VulkanApp {
             queueCreateInfos.push_back(queueCreateInfo);
         }
 
-        // All VK_FALSE for now
-        VkPhysicalDeviceFeatures deviceFeatures;
-        deviceFeatures.robustBufferAccess = VK_FALSE;
-        deviceFeatures.fullDrawIndexUint32 = VK_FALSE;
-        deviceFeatures.imageCubeArray = VK_FALSE;
-        deviceFeatures.independentBlend = VK_FALSE;
-        deviceFeatures.geometryShader = VK_FALSE;
-        deviceFeatures.tessellationShader = VK_FALSE;
-        deviceFeatures.sampleRateShading = VK_FALSE;
-        deviceFeatures.dualSrcBlend = VK_FALSE;
-        deviceFeatures.logicOp = VK_FALSE;
-        deviceFeatures.multiDrawIndirect = VK_FALSE;
-        deviceFeatures.drawIndirectFirstInstance = VK_FALSE;
-        deviceFeatures.depthClamp = VK_FALSE;
-        deviceFeatures.depthBiasClamp = VK_FALSE;
-        deviceFeatures.fillModeNonSolid = VK_FALSE;
-        deviceFeatures.depthBounds = VK_FALSE;
-        deviceFeatures.wideLines = VK_FALSE;
-        deviceFeatures.largePoints = VK_FALSE;
-        deviceFeatures.alphaToOne = VK_FALSE;
-        deviceFeatures.multiViewport = VK_FALSE;
-        deviceFeatures.samplerAnisotropy = VK_FALSE;
-        deviceFeatures.textureCompressionETC2 = VK_FALSE;
-        deviceFeatures.textureCompressionASTC_LDR = VK_FALSE;
-        deviceFeatures.textureCompressionBC = VK_FALSE;
-        deviceFeatures.occlusionQueryPrecise = VK_FALSE;
-        deviceFeatures.pipelineStatisticsQuery = VK_FALSE;
-        deviceFeatures.vertexPipelineStoresAndAtomics = VK_FALSE;
-        deviceFeatures.fragmentStoresAndAtomics = VK_FALSE;
-        deviceFeatures.shaderTessellationAndGeometryPointSize = VK_FALSE;
-        deviceFeatures.shaderImageGatherExtended = VK_FALSE;
-        deviceFeatures.shaderStorageImageExtendedFormats = VK_FALSE;
-        deviceFeatures.shaderStorageImageMultisample = VK_FALSE;
-        deviceFeatures.shaderStorageImageReadWithoutFormat = VK_FALSE;
-        deviceFeatures.shaderStorageImageWriteWithoutFormat = VK_FALSE;
-        deviceFeatures.shaderUniformBufferArrayDynamicIndexing = VK_FALSE;
-        deviceFeatures.shaderSampledImageArrayDynamicIndexing = VK_FALSE;
-        deviceFeatures.shaderStorageBufferArrayDynamicIndexing = VK_FALSE;
-        deviceFeatures.shaderStorageImageArrayDynamicIndexing = VK_FALSE;
-        deviceFeatures.shaderClipDistance = VK_FALSE;
-        deviceFeatures.shaderCullDistance = VK_FALSE;
-        deviceFeatures.shaderFloat64 = VK_FALSE;
-        deviceFeatures.shaderInt64 = VK_FALSE;
-        deviceFeatures.shaderInt16 = VK_FALSE;
-        deviceFeatures.shaderResourceResidency = VK_FALSE;
-        deviceFeatures.shaderResourceMinLod = VK_FALSE;
-        deviceFeatures.sparseBinding = VK_FALSE;
-        deviceFeatures.sparseResidencyBuffer = VK_FALSE;
-        deviceFeatures.sparseResidencyImage2D = VK_FALSE;
-        deviceFeatures.sparseResidencyImage3D = VK_FALSE;
-        deviceFeatures.sparseResidency2Samples = VK_FALSE;
-        deviceFeatures.sparseResidency4Samples = VK_FALSE;
-        deviceFeatures.sparseResidency8Samples = VK_FALSE;
-        deviceFeatures.sparseResidency16Samples = VK_FALSE;
-        deviceFeatures.sparseResidencyAliased = VK_FALSE;
-        deviceFeatures.variableMultisampleRate = VK_FALSE;
-        deviceFeatures.inheritedQueries = VK_FALSE;
+        negotiateDeviceFeatures(state.VkPhysicalDevice, getDeviceFeatureRequests(), state.EnabledFeatures);
+
+        // A 1.0 device can't take VkPhysicalDeviceFeatures2 in pNext; only its core features apply there
+        VkPhysicalDeviceProperties deviceProperties;
+        vkGetPhysicalDeviceProperties(state.VkPhysicalDevice, &deviceProperties);
+        bool featureChainSupported = deviceProperties.apiVersion >= VK_API_VERSION_1_1;
+
+        std::vector<const char*> deviceExtensions = REQUIRED_DEVICE_EXTENSIONS;
+        if (featureChainSupported) {
+            std::vector<const char*> featureExtensions = getFeatureDeviceExtensions(state.EnabledFeatures);
+            deviceExtensions.insert(deviceExtensions.end(), featureExtensions.begin(), featureExtensions.end());
+        }
 
         VkDeviceCreateInfo createInfo;
         createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-        createInfo.pNext = nullptr;
+        createInfo.pNext = featureChainSupported ? &state.EnabledFeatures.features2 : nullptr;
         createInfo.flags = 0;
         createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
         createInfo.pQueueCreateInfos = queueCreateInfos.data();
         createInfo.enabledLayerCount = 0;         // enabledLayerCount is deprecated and should not be used
         createInfo.ppEnabledLayerNames = nullptr; // ppEnabledLayerNames is deprecated and should not be used
-        createInfo.enabledExtensionCount = static_cast<uint32_t>(REQUIRED_DEVICE_EXTENSIONS.size());
-        createInfo.ppEnabledExtensionNames = REQUIRED_DEVICE_EXTENSIONS.data();
-        createInfo.pEnabledFeatures = &deviceFeatures;
+        createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
+        createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+        createInfo.pEnabledFeatures = featureChainSupported ? nullptr : &state.EnabledFeatures.features2.features;
 
         if (vkCreateDevice(state.VkPhysicalDevice, &createInfo, nullptr, &state.VkDevice) != VK_SUCCESS) {
             throw std::runtime_error("ERROR VulkanApplication::createLogicalDevice() Failed to create logical device!");
@@ -228,6 +326,9 @@ namespace VulkanApp {
 
         vkGetDeviceQueue(state.VkDevice, indices.graphicsFamily.value(), 0, &state.VkGraphicsQueue);
         vkGetDeviceQueue(state.VkDevice, indices.presentFamily.value(), 0, &state.VkPresentQueue);
+        // Without dedicated families these alias the graphics queue, and submissions just serialize
+        vkGetDeviceQueue(state.VkDevice, indices.computeFamily.value(), 0, &state.VkComputeQueue);
+        vkGetDeviceQueue(state.VkDevice, indices.transferFamily.value(), 0, &state.VkTransferQueue);
     }
     void createSwapchain(VulkanState& state){
         SwapchainSupportDetails swapchainSupportDetails = querySwapchainSupport(state.VkPhysicalDevice, state.VkSurface);
@@ -297,8 +398,37 @@ namespace VulkanApp {
             }
         }
     }
+    void createDepthResources(VulkanState& state){
+        state.DepthFormat = findDepthFormat(state.VkPhysicalDevice);
+
+        createImage(
+            state.VkDevice,
+            state.VkPhysicalDevice,
+            state.Extent.width,
+            state.Extent.height,
+            1,
+            state.DepthFormat,
+            VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+            state.DepthImage,
+            state.DepthImageMemory);
+        state.DepthImageView
+            = createImageView(state.VkDevice, state.DepthImage, state.DepthFormat, VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1);
+
+        createDepthPyramid(
+            state.DepthPyramid,
+            state.VkDevice,
+            state.VkPhysicalDevice,
+            state.CommandPool,
+            state.VkGraphicsQueue,
+            state.Extent,
+            state.DepthImageView,
+            loadShaderModule(
+                state.VkDevice,
+                getDownsampleShaderName(VK_FORMAT_R32_SFLOAT, hasDownsampleSubgroupSupport(state.VkPhysicalDevice))));
+    }
     void createRenderPass(VulkanState& state){
-        VkAttachmentDescription colorAttachement;
+        VkAttachmentDescription attachments[2];
+        VkAttachmentDescription& colorAttachement = attachments[0];
         colorAttachement.flags = 0;
         colorAttachement.format = state.Format;
         colorAttachement.samples = VK_SAMPLE_COUNT_1_BIT;
@@ -307,12 +437,28 @@ namespace VulkanApp {
         colorAttachement.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
         colorAttachement.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
         colorAttachement.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        colorAttachement.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        colorAttachement.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+        // Left readable by the depth pyramid build between the two passes
+        VkAttachmentDescription& depthAttachment = attachments[1];
+        depthAttachment.flags = 0;
+        depthAttachment.format = state.DepthFormat;
+        depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+        depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        depthAttachment.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 
         VkAttachmentReference colorAttachmentReference;
         colorAttachmentReference.attachment = 0;
         colorAttachmentReference.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
+        VkAttachmentReference depthAttachmentReference;
+        depthAttachmentReference.attachment = 1;
+        depthAttachmentReference.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
         VkSubpassDescription subpass;
         subpass.flags = 0;
         subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
@@ -321,215 +467,157 @@ namespace VulkanApp {
         subpass.colorAttachmentCount = 1;
         subpass.pColorAttachments = &colorAttachmentReference;
         subpass.pResolveAttachments = nullptr;
-        subpass.pDepthStencilAttachment = nullptr;
+        subpass.pDepthStencilAttachment = &depthAttachmentReference;
         subpass.preserveAttachmentCount = 0;
         subpass.pPreserveAttachments = nullptr;
 
-        VkSubpassDependency subpassDependency;
-        subpassDependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-        subpassDependency.dstSubpass = 0;
-        subpassDependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-        subpassDependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-        subpassDependency.srcAccessMask = 0;
-        subpassDependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-        subpassDependency.dependencyFlags = 0;
+        VkSubpassDependency subpassDependencies[2];
+        subpassDependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+        subpassDependencies[0].dstSubpass = 0;
+        subpassDependencies[0].srcStageMask
+            = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+        subpassDependencies[0].dstStageMask
+            = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+        subpassDependencies[0].srcAccessMask = 0;
+        subpassDependencies[0].dstAccessMask
+            = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        subpassDependencies[0].dependencyFlags = 0;
+
+        // Depth feeds the pyramid build, color carries on into LateRenderPass
+        subpassDependencies[1].srcSubpass = 0;
+        subpassDependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+        subpassDependencies[1].srcStageMask
+            = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        subpassDependencies[1].dstStageMask
+            = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+        subpassDependencies[1].srcAccessMask
+            = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        subpassDependencies[1].dstAccessMask
+            = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_SHADER_READ_BIT;
+        subpassDependencies[1].dependencyFlags = 0;
 
         VkRenderPassCreateInfo renderPassInfo;
         renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
         renderPassInfo.pNext = nullptr;
         renderPassInfo.flags = 0;
-        renderPassInfo.attachmentCount = 1;
-        renderPassInfo.pAttachments = &colorAttachement;
+        renderPassInfo.attachmentCount = 2;
+        renderPassInfo.pAttachments = attachments;
         renderPassInfo.subpassCount = 1;
         renderPassInfo.pSubpasses = &subpass;
-        renderPassInfo.dependencyCount = 1;
-        renderPassInfo.pDependencies = &subpassDependency;
+        renderPassInfo.dependencyCount = 2;
+        renderPassInfo.pDependencies = subpassDependencies;
 
         if (vkCreateRenderPass(state.VkDevice, &renderPassInfo, nullptr, &state.RenderPass) != VK_SUCCESS) {
             throw std::runtime_error("ERROR VulkanApplication::createRenderPass() Failed to create render pass!");
         }
-    }
-    void createGraphicsPipeline(VulkanState& state){
-        std::vector<char> vertShaderCode = readFile("shaders/vert.spv");
-        std::vector<char> fragShaderCode = readFile("shaders/frag.spv");
-
-        VkShaderModule vertShaderModule = createShaderModule(state.VkDevice, vertShaderCode);
-        VkShaderModule fragShaderModule = createShaderModule(state.VkDevice, fragShaderCode);
-
-        VkPipelineShaderStageCreateInfo vertShaderStageInfo;
-        vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-        vertShaderStageInfo.pNext = nullptr;
-        vertShaderStageInfo.flags = 0;
-        vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
-        vertShaderStageInfo.module = vertShaderModule;
-        vertShaderStageInfo.pName = "main";
-        vertShaderStageInfo.pSpecializationInfo = nullptr;
-
-        VkPipelineShaderStageCreateInfo fragShaderStageInfo;
-        fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-        fragShaderStageInfo.pNext = nullptr;
-        fragShaderStageInfo.flags = 0;
-        fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-        fragShaderStageInfo.module = fragShaderModule;
-        fragShaderStageInfo.pName = "main";
-        fragShaderStageInfo.pSpecializationInfo = nullptr;
-
-        VkPipelineShaderStageCreateInfo shaderStages[] = {vertShaderStageInfo, fragShaderStageInfo};
-
-        std::vector<VkDynamicState> dynamicStates = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
-        VkPipelineDynamicStateCreateInfo dynamicState;
-        dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-        dynamicState.pNext = nullptr;
-        dynamicState.flags = 0;
-        dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
-        dynamicState.pDynamicStates = dynamicStates.data();
-
-        VkPipelineVertexInputStateCreateInfo vertexInputInfo;
-        vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-        vertexInputInfo.pNext = nullptr;
-        vertexInputInfo.flags = 0;
-        vertexInputInfo.vertexBindingDescriptionCount = 0;
-        vertexInputInfo.pVertexBindingDescriptions = nullptr;
-        vertexInputInfo.vertexAttributeDescriptionCount = 0;
-        vertexInputInfo.pVertexAttributeDescriptions = nullptr;
-
-        VkPipelineInputAssemblyStateCreateInfo inputAssemblyInfo;
-        inputAssemblyInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-        inputAssemblyInfo.pNext = nullptr;
-        inputAssemblyInfo.flags = 0;
-        inputAssemblyInfo.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-        inputAssemblyInfo.primitiveRestartEnable = VK_FALSE;
-
-        VkViewport viewport;
-        viewport.x = 0.0f;
-        viewport.y = 0.0f;
-        viewport.width = static_cast<float>(state.Extent.width);
-        viewport.height = static_cast<float>(state.Extent.height);
-        viewport.minDepth = 0.0f;
-        viewport.maxDepth = 1.0f;
 
-        VkRect2D scissor;
-        scissor.offset = {0, 0};
-        scissor.extent = state.Extent;
+        // Late pass: keep what the early pass drew and present at the end
+        colorAttachement.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+        colorAttachement.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        colorAttachement.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+        depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        depthAttachment.initialLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+        // Waits for the pyramid build to finish reading depth before it is written again
+        VkSubpassDependency lateDependency;
+        lateDependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+        lateDependency.dstSubpass = 0;
+        lateDependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+        lateDependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT
+                                    | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT
+                                    | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        lateDependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        lateDependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT
+                                     | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT
+                                     | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        lateDependency.dependencyFlags = 0;
 
-        VkPipelineViewportStateCreateInfo viewportStateInfo;
-        viewportStateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-        viewportStateInfo.pNext = nullptr;
-        viewportStateInfo.flags = 0;
-        viewportStateInfo.viewportCount = 1;
-        viewportStateInfo.pViewports = &viewport;
-        viewportStateInfo.scissorCount = 1;
-        viewportStateInfo.pScissors = &scissor;
-
-        VkPipelineRasterizationStateCreateInfo rasterizerInfo;
-        rasterizerInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-        rasterizerInfo.pNext = nullptr;
-        rasterizerInfo.flags = 0;
-        rasterizerInfo.depthClampEnable = VK_FALSE;
-        rasterizerInfo.rasterizerDiscardEnable = VK_FALSE;
-        rasterizerInfo.polygonMode = VK_POLYGON_MODE_FILL;
-        rasterizerInfo.cullMode = VK_CULL_MODE_BACK_BIT;
-        rasterizerInfo.frontFace = VK_FRONT_FACE_CLOCKWISE;
-        rasterizerInfo.depthBiasEnable = VK_FALSE;
-        rasterizerInfo.depthBiasConstantFactor = 0.0f;
-        rasterizerInfo.depthBiasClamp = 0.0f;
-        rasterizerInfo.depthBiasSlopeFactor = 0.0f;
-        rasterizerInfo.lineWidth = 1.0f;
-
-        VkPipelineMultisampleStateCreateInfo multisamplingInfo;
-        multisamplingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-        multisamplingInfo.pNext = nullptr;
-        multisamplingInfo.flags = 0;
-        multisamplingInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
-        multisamplingInfo.sampleShadingEnable = VK_FALSE;
-        multisamplingInfo.minSampleShading = 1.0f;
-        multisamplingInfo.pSampleMask = nullptr;
-        multisamplingInfo.alphaToCoverageEnable = VK_FALSE;
-        multisamplingInfo.alphaToOneEnable = VK_FALSE;
-
-        // Create later
-        // VkPipelineDepthStencilStateCreateInfo depthStencilInfo;
-
-        VkPipelineColorBlendAttachmentState colorBlendAttachementState;
-        colorBlendAttachementState.blendEnable = VK_FALSE;
-        colorBlendAttachementState.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
-        colorBlendAttachementState.dstColorBlendFactor = VK_BLEND_FACTOR_ZERO;
-        colorBlendAttachementState.colorBlendOp = VK_BLEND_OP_ADD;
-        colorBlendAttachementState.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
-        colorBlendAttachementState.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
-        colorBlendAttachementState.alphaBlendOp = VK_BLEND_OP_ADD;
-        colorBlendAttachementState.colorWriteMask
-            = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-
-        VkPipelineColorBlendStateCreateInfo colorBlending{};
-        colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-        colorBlending.pNext = nullptr;
-        colorBlending.flags = 0;
-        colorBlending.logicOpEnable = VK_FALSE;
-        colorBlending.logicOp = VK_LOGIC_OP_COPY;
-        colorBlending.attachmentCount = 1;
-        colorBlending.pAttachments = &colorBlendAttachementState;
-        colorBlending.blendConstants[0] = 0.0f;
-        colorBlending.blendConstants[1] = 0.0f;
-        colorBlending.blendConstants[2] = 0.0f;
-        colorBlending.blendConstants[3] = 0.0f;
+        renderPassInfo.dependencyCount = 1;
+        renderPassInfo.pDependencies = &lateDependency;
 
+        if (vkCreateRenderPass(state.VkDevice, &renderPassInfo, nullptr, &state.LateRenderPass) != VK_SUCCESS) {
+            throw std::runtime_error("ERROR VulkanApplication::createRenderPass() Failed to create late render pass!");
+        }
+    }
+    void createDescriptorSetLayout(VulkanState& state){
+        state.SceneDescriptorSetLayout
+            = createSceneDescriptorSetLayout(state.VkDevice, hasMeshShaderSupport(state.EnabledFeatures));
+    }
+    void createPipelineLayout(VulkanState& state){
         VkPipelineLayoutCreateInfo pipelineLayoutInfo;
         pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
         pipelineLayoutInfo.pNext = nullptr;
         pipelineLayoutInfo.flags = 0;
-        pipelineLayoutInfo.setLayoutCount = 0;
-        pipelineLayoutInfo.pSetLayouts = nullptr;
-        pipelineLayoutInfo.pushConstantRangeCount = 0;
-        pipelineLayoutInfo.pPushConstantRanges = nullptr;
+        VkPushConstantRange pushConstantRange;
+        // Only the vertex shaders read DrawPushConstants; add the fragment stage once a fragment
+        // shader reads materialIndex
+        pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+        pushConstantRange.offset = 0;
+        pushConstantRange.size = sizeof(DrawPushConstants);
+
+        pipelineLayoutInfo.setLayoutCount = 1;
+        pipelineLayoutInfo.pSetLayouts = &state.SceneDescriptorSetLayout;
+        pipelineLayoutInfo.pushConstantRangeCount = 1;
+        pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
 
         if (vkCreatePipelineLayout(state.VkDevice, &pipelineLayoutInfo, nullptr, &state.PipelineLayout) != VK_SUCCESS) {
             throw std::runtime_error(
-                "ERROR VulkanApplication::createGraphicsPipeline() Failed to create pipeline layout!");
-        }
-
-        VkGraphicsPipelineCreateInfo pipelineInfo;
-        pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-        pipelineInfo.pNext = nullptr;
-        pipelineInfo.flags = 0;
-        pipelineInfo.stageCount = 2;
-        pipelineInfo.pStages = shaderStages;
-        pipelineInfo.pVertexInputState = &vertexInputInfo;
-        pipelineInfo.pInputAssemblyState = &inputAssemblyInfo;
-        pipelineInfo.pTessellationState = nullptr;
-        pipelineInfo.pViewportState = &viewportStateInfo;
-        pipelineInfo.pRasterizationState = &rasterizerInfo;
-        pipelineInfo.pMultisampleState = &multisamplingInfo;
-        pipelineInfo.pDepthStencilState = nullptr;
-        pipelineInfo.pColorBlendState = &colorBlending;
-        pipelineInfo.pDynamicState = &dynamicState;
-        pipelineInfo.layout = state.PipelineLayout;
-        pipelineInfo.renderPass = state.RenderPass;
-        pipelineInfo.subpass = 0;
-        pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
-        pipelineInfo.basePipelineIndex = -1;
-
-        if (vkCreateGraphicsPipelines(state.VkDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &state.GraphicsPipeline)
-            != VK_SUCCESS) {
-            throw std::runtime_error(
-                "ERROR VulkanApplication::createGraphicsPipeline() Failed to create graphics pipeline!");
+                "ERROR VulkanApplication::createPipelineLayout() Failed to create pipeline layout!");
+        }
+    }
+    void loadShaders(VulkanState& state){
+        VkShaderModule vertShaderModule = loadShaderModule(state.VkDevice, "default.vert");
+        VkShaderModule fragShaderModule = loadShaderModule(state.VkDevice, "default.frag");
+
+        // The cache owns the shader modules from here on; permutations are built lazily from them
+        uint32_t defaultProgram = registerShaderProgram(
+            state.PipelinePermutations, vertShaderModule, fragShaderModule, "default.vert", "default.frag");
+
+        MaterialDesc defaultMaterial;
+        defaultMaterial.shaderProgram = defaultProgram;
+        defaultMaterial.featureBits = MATERIAL_FEATURE_VERTEX_COLOR_BIT;
+
+        state.DefaultPipelineKey = makePipelineKey(defaultMaterial);
+        state.Materials = {defaultMaterial};
+
+        std::map<PipelineKey, uint32_t> pipelineIds;
+        state.MaterialPipelines.clear();
+        state.PipelineKeys.clear();
+        for (const MaterialDesc& material : state.Materials) {
+            PipelineKey key = makePipelineKey(material);
+            auto [it, inserted] = pipelineIds.emplace(key, static_cast<uint32_t>(state.PipelineKeys.size()));
+            if (inserted) {
+                state.PipelineKeys.push_back(key);
+            }
+            state.MaterialPipelines.push_back(it->second);
         }
+    }
+    void createGraphicsPipeline(VulkanState& state){
+        initPipelinePermutationCache(state.PipelinePermutations, state.VkDevice, state.RenderPass, state.PipelineLayout);
 
-        vkDestroyShaderModule(state.VkDevice, vertShaderModule, nullptr);
-        vkDestroyShaderModule(state.VkDevice, fragShaderModule, nullptr);
+        state.GraphicsPipeline = getPipelinePermutation(state.PipelinePermutations, state.DefaultPipelineKey);
+        resolveScenePipelines(state);
+    }
+    void resolveScenePipelines(VulkanState& state){
+        state.ScenePipelines.clear();
+        for (const PipelineKey& key : state.PipelineKeys) {
+            state.ScenePipelines.push_back(getPipelinePermutation(state.PipelinePermutations, key));
+        }
     }
     void createFramebuffers(VulkanState& state){
         state.SwapchainFramebuffers.resize(state.SwapchainImages.size());
 
         for (size_t i = 0; i < state.SwapchainImageViews.size(); i++) {
-            VkImageView attachments[] = {state.SwapchainImageViews[i]};
+            VkImageView attachments[] = {state.SwapchainImageViews[i], state.DepthImageView};
 
             VkFramebufferCreateInfo framebufferInfo;
             framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
             framebufferInfo.pNext = nullptr;
             framebufferInfo.flags = 0;
             framebufferInfo.renderPass = state.RenderPass;
-            framebufferInfo.attachmentCount = 1;
+            framebufferInfo.attachmentCount = 2;
             framebufferInfo.pAttachments = attachments;
             framebufferInfo.width = state.Extent.width;
             framebufferInfo.height = state.Extent.height;
@@ -541,17 +629,27 @@ namespace VulkanApp {
         }
     }
     void createCommandPool(VulkanState& state){
-        QueueFamilyIndices queueFamilyIndices = findQueueFamilies(state.VkPhysicalDevice, state.VkSurface);
-
         VkCommandPoolCreateInfo commandPoolInfo;
         commandPoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
         commandPoolInfo.pNext = nullptr;
         commandPoolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
-        commandPoolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value();
+        commandPoolInfo.queueFamilyIndex = state.QueueFamilies.graphicsFamily.value();
 
         if (vkCreateCommandPool(state.VkDevice, &commandPoolInfo, nullptr, &state.CommandPool) != VK_SUCCESS) {
             throw std::runtime_error("ERROR VulkanApplication::createCommandPool() Failed to create command pool!");
         }
+
+        commandPoolInfo.queueFamilyIndex = state.QueueFamilies.computeFamily.value();
+        if (vkCreateCommandPool(state.VkDevice, &commandPoolInfo, nullptr, &state.ComputeCommandPool) != VK_SUCCESS) {
+            throw std::runtime_error("ERROR VulkanApplication::createCommandPool() Failed to create compute command pool!");
+        }
+
+        // Upload command buffers are recorded once and thrown away
+        commandPoolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+        commandPoolInfo.queueFamilyIndex = state.QueueFamilies.transferFamily.value();
+        if (vkCreateCommandPool(state.VkDevice, &commandPoolInfo, nullptr, &state.TransferCommandPool) != VK_SUCCESS) {
+            throw std::runtime_error("ERROR VulkanApplication::createCommandPool() Failed to create transfer command pool!");
+        }
     }
     void createCommandBuffer(VulkanState& state){
         VkCommandBufferAllocateInfo commandBufferAllocateInfo;
@@ -566,6 +664,137 @@ namespace VulkanApp {
                 "ERROR VulkanApplication::createCommandBuffer() Failed to allocate command buffers!");
         }
     }
+    void createScene(VulkanState& state){
+        // One triangle mesh instanced over a grid that overhangs the viewport, so the cull pass
+        // has both visible and off-screen objects to sort out, plus one large triangle in front
+        // of the grid that occludes part of it. Objects are placed directly in clip space until
+        // there is a camera.
+        std::vector<uint32_t> indices = {0, 1, 2};
+
+        const float gridExtent = 2.5f;
+        const float spacing = gridExtent / static_cast<float>(SCENE_GRID_SIZE);
+        const float scale = spacing * 0.8f;
+        const float triangleRadius = 0.71f; // Furthest default.vert vertex from the origin
+
+        const float occluderScale = 1.2f;
+        const float occluderDepth = 0.1f;
+        const float gridDepth = 0.5f;
+
+        // Every object is an instance of the same triangle mesh and default material
+        const uint32_t triangleMesh = 0;
+        const uint32_t defaultMaterial = 0;
+        MeshRange triangle;
+        triangle.indexCount = static_cast<uint32_t>(indices.size());
+        triangle.firstIndex = 0;
+        triangle.vertexOffset = 0;
+        state.SceneMeshes = {triangle};
+
+        std::vector<GpuObjectData>& objects = state.SceneObjects;
+        objects.clear();
+        objects.reserve(SCENE_GRID_SIZE * SCENE_GRID_SIZE + 1);
+
+        GpuObjectData occluder;
+        occluder.boundingSphere = glm::vec4(0.0f, 0.0f, occluderDepth, triangleRadius * occluderScale);
+        occluder.transform = glm::vec4(0.0f, 0.0f, occluderScale, occluderDepth);
+        occluder.indexCount = static_cast<uint32_t>(indices.size());
+        occluder.firstIndex = 0;
+        occluder.vertexOffset = 0;
+        occluder.padding = 0;
+        objects.push_back(occluder);
+
+        for (uint32_t y = 0; y < SCENE_GRID_SIZE; y++) {
+            for (uint32_t x = 0; x < SCENE_GRID_SIZE; x++) {
+                glm::vec2 offset(
+                    -0.5f * gridExtent + (static_cast<float>(x) + 0.5f) * spacing,
+                    -0.5f * gridExtent + (static_cast<float>(y) + 0.5f) * spacing);
+
+                GpuObjectData object;
+                object.boundingSphere = glm::vec4(offset, gridDepth, triangleRadius * scale);
+                object.transform = glm::vec4(offset, scale, gridDepth);
+                object.indexCount = static_cast<uint32_t>(indices.size());
+                object.firstIndex = 0;
+                object.vertexOffset = 0;
+                object.padding = 0;
+                objects.push_back(object);
+            }
+        }
+
+        state.SceneBounds = CullingBounds{};
+        state.SceneObjectDraws.clear();
+        for (uint32_t i = 0; i < objects.size(); i++) {
+            const GpuObjectData& object = objects[i];
+            addBoundingSphere(state.SceneBounds, glm::vec3(object.boundingSphere), object.boundingSphere.w);
+
+            DrawItem draw;
+            draw.pipeline = state.MaterialPipelines[defaultMaterial];
+            draw.mesh = triangleMesh;
+            draw.material = defaultMaterial;
+            draw.objectIndex = i;
+            state.SceneObjectDraws.push_back(draw);
+        }
+
+        // Per-frame uniforms such as the cull data are allocated from this ring
+        createUniformRing(
+            state.UniformRing,
+            state.VkDevice,
+            state.VkPhysicalDevice,
+            UNIFORM_RING_FRAME_SIZE,
+            UNIFORM_RING_FRAME_COUNT);
+
+        createGpuScene(
+            state.Scene,
+            state.VkDevice,
+            state.VkPhysicalDevice,
+            state.EnabledFeatures,
+            state.QueueFamilies,
+            state.TransferCommandPool,
+            state.VkTransferQueue,
+            state.SceneDescriptorSetLayout,
+            state.UniformRing,
+            state.DepthPyramid,
+            loadShaderModule(state.VkDevice, "cull.comp"),
+            objects,
+            indices);
+
+        if (MESHLET_RENDERING) {
+            // Mirrors positions[] and colors[] in default.vert, which the fallback path draws with
+            std::vector<glm::vec3> positions = {{0.0f, -0.5f, 0.0f}, {0.5f, 0.5f, 0.0f}, {-0.5f, 0.5f, 0.0f}};
+            std::vector<glm::vec3> colors = {{1.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f}, {0.0f, 0.0f, 1.0f}};
+            std::vector<GpuMeshletVertex> vertices(positions.size());
+            for (size_t i = 0; i < positions.size(); i++) {
+                vertices[i].position = glm::vec4(positions[i], 1.0f);
+                vertices[i].color = glm::vec4(colors[i], 1.0f);
+            }
+
+            MeshletMesh meshletMesh;
+            uint32_t firstMeshlet
+                = buildMeshlets(meshletMesh, indices, triangle.firstIndex, triangle.indexCount, positions);
+            uint32_t meshletCount = static_cast<uint32_t>(meshletMesh.meshlets.size()) - firstMeshlet;
+
+            std::vector<MeshletInstance> instances;
+            instances.reserve(objects.size() * meshletCount);
+            for (uint32_t objectIndex = 0; objectIndex < objects.size(); objectIndex++) {
+                for (uint32_t meshlet = firstMeshlet; meshlet < firstMeshlet + meshletCount; meshlet++) {
+                    instances.push_back({objectIndex, meshlet});
+                }
+            }
+
+            createMeshletScene(
+                state.Meshlets,
+                state.VkDevice,
+                state.VkPhysicalDevice,
+                state.EnabledFeatures,
+                state.QueueFamilies,
+                state.TransferCommandPool,
+                state.VkTransferQueue,
+                state.SceneDescriptorSetLayout,
+                state.RenderPass,
+                state.Materials[defaultMaterial],
+                meshletMesh,
+                vertices,
+                instances);
+        }
+    }
     void createSyncObjects(VulkanState& state) {
         VkSemaphoreCreateInfo semaphoreCreateInfo;
         semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
@@ -602,23 +831,44 @@ namespace VulkanApp {
                 "ERROR VulkanApplication::recordCommandBuffer() Failed to begin recording command buffer!");
         }
 
-        VkClearValue clearColor = {{{0.0f, 0.0f, 0.0f, 1.0f}}};
-        // VkClearColorValue           color;
-        // VkClearDepthStencilValue    depthStencil;
+        // Identity view-projection: the scene is authored in clip space for now
+        const glm::mat4 viewProjection(1.0f);
+        // Orthographic, looking down +z; w = 0 makes the meshlet cone test use a view direction
+        const glm::vec4 cameraPosition(0.0f, 0.0f, 1.0f, 0.0f);
+        if (GPU_DRIVEN_RENDERING || MESHLET_RENDERING) {
+            updateGpuSceneCamera(state.Scene, state.UniformRing, viewProjection, cameraPosition);
+        }
+        else {
+            cullBoundsParallel(
+                state.SceneBounds,
+                extractFrustum(viewProjection),
+                state.VisibleObjects,
+                state.CullingWorkers,
+                state.CullingChunkVisible);
+
+            resetDrawQueue(state.DrawQueue);
+            for (uint32_t objectIndex : state.VisibleObjects) {
+                glm::vec3 center(state.SceneObjects[objectIndex].boundingSphere);
+                DrawItem draw = state.SceneObjectDraws[objectIndex];
+                draw.depth = (viewProjection * glm::vec4(center, 1.0f)).z;
+                submitDraw(state.DrawQueue, draw);
+            }
+            buildDrawBatches(state.DrawQueue, state.DrawBatches, state.InstanceObjects);
+            updateGpuSceneInstances(state.Scene, state.InstanceObjects);
+        }
+
+        VkClearValue clearValues[2];
+        clearValues[0].color = {{0.0f, 0.0f, 0.0f, 1.0f}};
+        clearValues[1].depthStencil = {1.0f, 0};
 
         VkRenderPassBeginInfo renderPassInfo;
         renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
         renderPassInfo.pNext = nullptr;
-        renderPassInfo.renderPass = state.RenderPass;
         renderPassInfo.framebuffer = state.SwapchainFramebuffers[imageIndex];
         renderPassInfo.renderArea.offset = {0, 0};
         renderPassInfo.renderArea.extent = state.Extent;
-        renderPassInfo.clearValueCount = 1;
-        renderPassInfo.pClearValues = &clearColor;
-
-        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, state.GraphicsPipeline);
+        renderPassInfo.clearValueCount = 2;
+        renderPassInfo.pClearValues = clearValues;
 
         VkViewport viewport;
         viewport.x = 0.0f;
@@ -627,22 +877,100 @@ namespace VulkanApp {
         viewport.height = static_cast<float>(state.Extent.height);
         viewport.minDepth = 0.0f;
         viewport.maxDepth = 1.0f;
-        vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
 
         VkRect2D scissor;
         scissor.offset = {0, 0};
         scissor.extent = state.Extent;
-        vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 
-        vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+        // Early pass: last frame's visible set. Late pass: whatever the depth pyramid built from
+        // the early pass's depth shows to be newly visible. The CPU-culled path draws everything
+        // in the early pass and only uses the late one to reach the present layout.
+        // The meshlet path culls against the frustum only and draws everything in the early pass.
+        for (CullPass pass : {CULL_PASS_EARLY, CULL_PASS_LATE}) {
+            if (MESHLET_RENDERING) {
+                if (pass == CULL_PASS_EARLY) {
+                    recordMeshletCulling(commandBuffer, state.Meshlets, state.Scene);
+                }
+            }
+            else if (GPU_DRIVEN_RENDERING) {
+                if (pass == CULL_PASS_LATE) {
+                    recordDepthPyramidBuild(commandBuffer, state.DepthPyramid, state.Extent);
+                }
+                recordGpuCulling(commandBuffer, state.Scene, pass);
+            }
+
+            renderPassInfo.renderPass = pass == CULL_PASS_EARLY ? state.RenderPass : state.LateRenderPass;
+            vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, state.GraphicsPipeline);
+            vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+            vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+            // The indirect paths draw everything with the default material (state.Materials[0])
+            // and take the object from firstInstance; the CPU path pushes per batch
+            recordDrawPushConstants(commandBuffer, state.Scene, state.PipelineLayout, DRAW_OBJECT_FROM_INSTANCE, 0);
+
+            if (MESHLET_RENDERING) {
+                if (pass == CULL_PASS_EARLY) {
+                    recordMeshletDraws(commandBuffer, state.Meshlets, state.Scene, state.PipelineLayout);
+                }
+            }
+            else if (GPU_DRIVEN_RENDERING) {
+                recordGpuSceneDraws(commandBuffer, state.Scene, state.PipelineLayout, pass);
+            }
+            else if (pass == CULL_PASS_EARLY) {
+                recordInstancedSceneDraws(
+                    commandBuffer,
+                    state.Scene,
+                    state.PipelineLayout,
+                    state.ScenePipelines,
+                    state.SceneMeshes,
+                    state.DrawBatches,
+                    state.InstanceObjects);
+            }
 
-        vkCmdEndRenderPass(commandBuffer);
+            vkCmdEndRenderPass(commandBuffer);
+        }
 
         if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
             throw std::runtime_error("ERROR VulkanApplication::recordCommandBuffer() Failed to record command buffer!");
         }
     }
 
+    void runSortBenchmark(VulkanState& state, const std::string& keyCountText) {
+        uint32_t keyCount = 0;
+        try {
+            keyCount = static_cast<uint32_t>(std::stoul(keyCountText));
+        }
+        catch (const std::exception&) {
+        }
+        if (keyCount == 0) {
+            std::cerr << "runSortBenchmark() Malformed key count \"" << keyCountText << "\"" << std::endl;
+            return;
+        }
+        if (!hasGpuPrimitivesSupport(state.VkPhysicalDevice, state.EnabledFeatures)) {
+            std::cerr << "runSortBenchmark() The device cannot run the GPU primitives" << std::endl;
+            return;
+        }
+
+        GpuPrimitives primitives;
+        createGpuPrimitives(primitives, state.VkDevice, state.VkPhysicalDevice);
+        RadixSortBenchmarkResult result = benchmarkRadixSort(
+            state.VkDevice,
+            state.VkPhysicalDevice,
+            state.ComputeCommandPool,
+            state.VkComputeQueue,
+            state.QueueFamilies.computeFamily.value(),
+            primitives,
+            keyCount,
+            SORT_BENCHMARK_ITERATIONS);
+        destroyGpuPrimitives(primitives, state.VkDevice);
+
+        std::cout << "Radix sort of " << result.keyCount << " keys with values, " << result.iterationCount
+                  << " iterations: best " << result.bestMilliseconds << " ms, median " << result.medianMilliseconds
+                  << " ms, " << result.keysPerSecond * 1e-6 << " Mkeys/s"
+                  << (result.sorted ? "" : " (OUTPUT NOT SORTED)") << std::endl;
+    }
+
     void mainLoop(VulkanState& state) {
         while (!glfwWindowShouldClose(state.GLFWwindow)) {
             glfwPollEvents();
@@ -654,6 +982,12 @@ namespace VulkanApp {
     void drawFrame(VulkanState& state) {
         vkWaitForFences(state.VkDevice, 1, &state.InFlightFence, VK_TRUE, UINT64_MAX);
         vkResetFences(state.VkDevice, 1, &state.InFlightFence);
+        beginUniformRingFrame(state.UniformRing);
+
+        if (applyShaderHotReload(state.ShaderHotReload, state.PipelinePermutations)) {
+            state.GraphicsPipeline = getPipelinePermutation(state.PipelinePermutations, state.DefaultPipelineKey);
+            resolveScenePipelines(state);
+        }
 
         uint32_t imageIndex;
         vkAcquireNextImageKHR(
@@ -697,20 +1031,36 @@ namespace VulkanApp {
     }
 
     void cleanup(VulkanState& state) {
+        stopShaderHotReload(state.ShaderHotReload, state.PipelinePermutations);
+        stopWorkerPool(state.CullingWorkers);
+
         vkDestroySemaphore(state.VkDevice, state.ImageAvailableSemaphore, nullptr);
         vkDestroySemaphore(state.VkDevice, state.RenderFinishedSemaphore, nullptr);
         vkDestroyFence(state.VkDevice, state.InFlightFence, nullptr);
 
+        destroyMeshletScene(state.Meshlets, state.VkDevice);
+        destroyGpuScene(state.Scene, state.VkDevice);
+        destroyUniformRing(state.UniformRing, state.VkDevice);
+
+        vkDestroyCommandPool(state.VkDevice, state.TransferCommandPool, nullptr);
+        vkDestroyCommandPool(state.VkDevice, state.ComputeCommandPool, nullptr);
         vkDestroyCommandPool(state.VkDevice, state.CommandPool, nullptr);
 
         for (VkFramebuffer framebuffer : state.SwapchainFramebuffers) {
             vkDestroyFramebuffer(state.VkDevice, framebuffer, nullptr);
         }
 
-        vkDestroyPipeline(state.VkDevice, state.GraphicsPipeline, nullptr);
+        destroyPipelinePermutationCache(state.PipelinePermutations);
         vkDestroyPipelineLayout(state.VkDevice, state.PipelineLayout, nullptr);
+        vkDestroyDescriptorSetLayout(state.VkDevice, state.SceneDescriptorSetLayout, nullptr);
+        vkDestroyRenderPass(state.VkDevice, state.LateRenderPass, nullptr);
         vkDestroyRenderPass(state.VkDevice, state.RenderPass, nullptr);
 
+        destroyDepthPyramid(state.DepthPyramid, state.VkDevice);
+        vkDestroyImageView(state.VkDevice, state.DepthImageView, nullptr);
+        vkDestroyImage(state.VkDevice, state.DepthImage, nullptr);
+        vkFreeMemory(state.VkDevice, state.DepthImageMemory, nullptr);
+
         for (VkImageView imageView : state.SwapchainImageViews) {
             vkDestroyImageView(state.VkDevice, imageView, nullptr);
         }
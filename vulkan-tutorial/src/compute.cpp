@@ -0,0 +1,219 @@
+#include "compute.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+bool containsBuffer(const std::vector<VkBuffer>& buffers, VkBuffer buffer)
+{
+    return std::find(buffers.begin(), buffers.end(), buffer) != buffers.end();
+}
+
+void recordComputeBarrier(ComputeRecorder& recorder, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess)
+{
+    VkMemoryBarrier barrier;
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.pNext = nullptr;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = dstAccess;
+    vkCmdPipelineBarrier(
+        recorder.commandBuffer,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        dstStage,
+        0,
+        1,
+        &barrier,
+        0,
+        nullptr,
+        0,
+        nullptr);
+
+    recorder.pendingReads.clear();
+    recorder.pendingWrites.clear();
+    recorder.barrierCount++;
+}
+
+// Read after write and write after write need the earlier writes made visible; write after
+// read only needs the reads finished, which the same barrier also guarantees. Barriers also
+// cover indirect command reads, so a buffer written before any earlier barrier can be used
+// as dispatch arguments without one of its own.
+void trackComputeAccesses(
+    ComputeRecorder& recorder,
+    const std::vector<VkBuffer>& reads,
+    const std::vector<VkBuffer>& writes)
+{
+    bool hazard = false;
+    for (VkBuffer buffer : reads) {
+        hazard = hazard || containsBuffer(recorder.pendingWrites, buffer);
+    }
+    for (VkBuffer buffer : writes) {
+        hazard = hazard || containsBuffer(recorder.pendingWrites, buffer)
+            || containsBuffer(recorder.pendingReads, buffer);
+    }
+    if (hazard) {
+        recordComputeBarrier(
+            recorder,
+            VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+    }
+    recorder.pendingReads.insert(recorder.pendingReads.end(), reads.begin(), reads.end());
+    recorder.pendingWrites.insert(recorder.pendingWrites.end(), writes.begin(), writes.end());
+}
+
+void bindComputeKernel(ComputeRecorder& recorder, const ComputeKernel& kernel, const void* pushConstants)
+{
+    if (recorder.boundPipeline != kernel.pipeline) {
+        vkCmdBindPipeline(recorder.commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, kernel.pipeline);
+        recorder.boundPipeline = kernel.pipeline;
+    }
+    if (kernel.pushConstantSize > 0) {
+        vkCmdPushConstants(
+            recorder.commandBuffer,
+            kernel.pipelineLayout,
+            VK_SHADER_STAGE_COMPUTE_BIT,
+            0,
+            kernel.pushConstantSize,
+            pushConstants);
+    }
+}
+} // namespace
+
+//---------------------------------
+// createComputeKernel()
+//---------------------------------
+void createComputeKernel(
+    ComputeKernel& kernel,
+    const VkDevice& device,
+    VkShaderModule shaderModule,
+    const std::vector<VkDescriptorSetLayout>& setLayouts,
+    uint32_t pushConstantSize,
+    const std::vector<uint32_t>& specializationConstants)
+{
+    kernel.pushConstantSize = pushConstantSize;
+    kernel.shaderModule = shaderModule;
+
+    VkPushConstantRange pushConstantRange;
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = pushConstantSize;
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo;
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.pNext = nullptr;
+    pipelineLayoutInfo.flags = 0;
+    pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+    pipelineLayoutInfo.pSetLayouts = setLayouts.data();
+    pipelineLayoutInfo.pushConstantRangeCount = pushConstantSize > 0 ? 1 : 0;
+    pipelineLayoutInfo.pPushConstantRanges = pushConstantSize > 0 ? &pushConstantRange : nullptr;
+
+    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &kernel.pipelineLayout) != VK_SUCCESS) {
+        throw std::runtime_error("createComputeKernel() Failed to create pipeline layout!");
+    }
+
+    std::vector<VkSpecializationMapEntry> specializationEntries(specializationConstants.size());
+    for (uint32_t i = 0; i < specializationEntries.size(); i++) {
+        specializationEntries[i].constantID = i;
+        specializationEntries[i].offset = i * sizeof(uint32_t);
+        specializationEntries[i].size = sizeof(uint32_t);
+    }
+
+    VkSpecializationInfo specializationInfo;
+    specializationInfo.mapEntryCount = static_cast<uint32_t>(specializationEntries.size());
+    specializationInfo.pMapEntries = specializationEntries.data();
+    specializationInfo.dataSize = specializationConstants.size() * sizeof(uint32_t);
+    specializationInfo.pData = specializationConstants.data();
+
+    VkComputePipelineCreateInfo pipelineInfo;
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.pNext = nullptr;
+    pipelineInfo.flags = 0;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.pNext = nullptr;
+    pipelineInfo.stage.flags = 0;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = shaderModule;
+    pipelineInfo.stage.pName = "main";
+    pipelineInfo.stage.pSpecializationInfo = specializationConstants.empty() ? nullptr : &specializationInfo;
+    pipelineInfo.layout = kernel.pipelineLayout;
+    pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+    pipelineInfo.basePipelineIndex = -1;
+
+    if (vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &kernel.pipeline) != VK_SUCCESS) {
+        throw std::runtime_error("createComputeKernel() Failed to create pipeline!");
+    }
+}
+
+//---------------------------------
+// destroyComputeKernel()
+//---------------------------------
+void destroyComputeKernel(ComputeKernel& kernel, const VkDevice& device)
+{
+    vkDestroyPipeline(device, kernel.pipeline, nullptr);
+    vkDestroyPipelineLayout(device, kernel.pipelineLayout, nullptr);
+    vkDestroyShaderModule(device, kernel.shaderModule, nullptr);
+    kernel = ComputeKernel{};
+}
+
+//---------------------------------
+// beginComputeRecording()
+//---------------------------------
+void beginComputeRecording(ComputeRecorder& recorder, VkCommandBuffer commandBuffer)
+{
+    recorder.commandBuffer = commandBuffer;
+    recorder.boundPipeline = nullptr;
+    recorder.pendingReads.clear();
+    recorder.pendingWrites.clear();
+    recorder.dispatchCount = 0;
+    recorder.barrierCount = 0;
+}
+
+//---------------------------------
+// recordComputeDispatch()
+//---------------------------------
+void recordComputeDispatch(
+    ComputeRecorder& recorder,
+    const ComputeKernel& kernel,
+    const void* pushConstants,
+    uint32_t groupCountX,
+    uint32_t groupCountY,
+    uint32_t groupCountZ,
+    const std::vector<VkBuffer>& reads,
+    const std::vector<VkBuffer>& writes)
+{
+    trackComputeAccesses(recorder, reads, writes);
+    bindComputeKernel(recorder, kernel, pushConstants);
+    vkCmdDispatch(recorder.commandBuffer, groupCountX, groupCountY, groupCountZ);
+    recorder.dispatchCount++;
+}
+
+//---------------------------------
+// recordComputeDispatchIndirect()
+//---------------------------------
+void recordComputeDispatchIndirect(
+    ComputeRecorder& recorder,
+    const ComputeKernel& kernel,
+    const void* pushConstants,
+    VkBuffer argumentBuffer,
+    VkDeviceSize argumentOffset,
+    const std::vector<VkBuffer>& reads,
+    const std::vector<VkBuffer>& writes)
+{
+    std::vector<VkBuffer> allReads = reads;
+    allReads.push_back(argumentBuffer);
+    trackComputeAccesses(recorder, allReads, writes);
+    bindComputeKernel(recorder, kernel, pushConstants);
+    vkCmdDispatchIndirect(recorder.commandBuffer, argumentBuffer, argumentOffset);
+    recorder.dispatchCount++;
+}
+
+//---------------------------------
+// endComputeRecording()
+//---------------------------------
+void endComputeRecording(ComputeRecorder& recorder, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess)
+{
+    if (!recorder.pendingWrites.empty()) {
+        recordComputeBarrier(recorder, dstStage, dstAccess);
+    }
+    recorder.commandBuffer = nullptr;
+    recorder.boundPipeline = nullptr;
+}
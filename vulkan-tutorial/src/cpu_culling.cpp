@@ -0,0 +1,208 @@
+#include "cpu_culling.h"
+
+// GLM_ARCH and the matching intrinsics headers; the SIMD paths are enabled by building with
+// GLM_FORCE_INTRINSICS (AVX additionally needs /arch:AVX or -mavx)
+#include <glm/simd/platform.h>
+
+#include <algorithm>
+#include <bit>
+
+namespace {
+// Writes base + i for every set bit i of mask and returns the new end of the output
+uint32_t* writeVisibleIndices(uint32_t mask, uint32_t base, uint32_t* out)
+{
+    while (mask != 0) {
+        *out++ = base + static_cast<uint32_t>(std::countr_zero(mask));
+        mask &= mask - 1;
+    }
+    return out;
+}
+} // namespace
+
+//---------------------------------
+// addBoundingSphere()
+//---------------------------------
+uint32_t addBoundingSphere(CullingBounds& bounds, const glm::vec3& center, float radius)
+{
+    bounds.centerX.push_back(center.x);
+    bounds.centerY.push_back(center.y);
+    bounds.centerZ.push_back(center.z);
+    bounds.extentX.push_back(0.0f);
+    bounds.extentY.push_back(0.0f);
+    bounds.extentZ.push_back(0.0f);
+    bounds.radius.push_back(radius);
+    return getBoundsCount(bounds) - 1;
+}
+
+//---------------------------------
+// addBoundingBox()
+//---------------------------------
+uint32_t addBoundingBox(CullingBounds& bounds, const glm::vec3& boxMin, const glm::vec3& boxMax)
+{
+    glm::vec3 center = 0.5f * (boxMin + boxMax);
+    glm::vec3 extents = 0.5f * (boxMax - boxMin);
+
+    bounds.centerX.push_back(center.x);
+    bounds.centerY.push_back(center.y);
+    bounds.centerZ.push_back(center.z);
+    bounds.extentX.push_back(extents.x);
+    bounds.extentY.push_back(extents.y);
+    bounds.extentZ.push_back(extents.z);
+    bounds.radius.push_back(0.0f);
+    return getBoundsCount(bounds) - 1;
+}
+
+//---------------------------------
+// getBoundsCount()
+//---------------------------------
+uint32_t getBoundsCount(const CullingBounds& bounds)
+{
+    return static_cast<uint32_t>(bounds.centerX.size());
+}
+
+//---------------------------------
+// cullBounds()
+//---------------------------------
+void cullBounds(
+    const CullingBounds& bounds,
+    const Frustum& frustum,
+    uint32_t first,
+    uint32_t last,
+    std::vector<uint32_t>& visible)
+{
+    // An entry is outside if, for some plane, even its farthest point along the plane normal
+    // is behind it: dot(n, c) + w + dot(|n|, e) + r < 0
+    size_t outputStart = visible.size();
+    visible.resize(outputStart + (last - first));
+    uint32_t* out = visible.data() + outputStart;
+
+    uint32_t i = first;
+#if GLM_ARCH & GLM_ARCH_AVX_BIT
+    __m256 planeX[6], planeY[6], planeZ[6], planeW[6], absX[6], absY[6], absZ[6];
+    for (int p = 0; p < 6; p++) {
+        const glm::vec4& plane = frustum.planes[p];
+        planeX[p] = _mm256_set1_ps(plane.x);
+        planeY[p] = _mm256_set1_ps(plane.y);
+        planeZ[p] = _mm256_set1_ps(plane.z);
+        planeW[p] = _mm256_set1_ps(plane.w);
+        absX[p] = _mm256_set1_ps(glm::abs(plane.x));
+        absY[p] = _mm256_set1_ps(glm::abs(plane.y));
+        absZ[p] = _mm256_set1_ps(glm::abs(plane.z));
+    }
+    const __m256 zero = _mm256_setzero_ps();
+
+    for (; i + 8 <= last; i += 8) {
+        __m256 cx = _mm256_loadu_ps(&bounds.centerX[i]);
+        __m256 cy = _mm256_loadu_ps(&bounds.centerY[i]);
+        __m256 cz = _mm256_loadu_ps(&bounds.centerZ[i]);
+        __m256 ex = _mm256_loadu_ps(&bounds.extentX[i]);
+        __m256 ey = _mm256_loadu_ps(&bounds.extentY[i]);
+        __m256 ez = _mm256_loadu_ps(&bounds.extentZ[i]);
+        __m256 r = _mm256_loadu_ps(&bounds.radius[i]);
+
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (int p = 0; p < 6; p++) {
+            __m256 distance = _mm256_add_ps(_mm256_mul_ps(planeX[p], cx), _mm256_mul_ps(planeY[p], cy));
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(planeZ[p], cz));
+            distance = _mm256_add_ps(distance, _mm256_add_ps(planeW[p], r));
+            __m256 reach = _mm256_add_ps(_mm256_mul_ps(absX[p], ex), _mm256_mul_ps(absY[p], ey));
+            reach = _mm256_add_ps(reach, _mm256_mul_ps(absZ[p], ez));
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(distance, reach), zero, _CMP_GE_OQ));
+        }
+        out = writeVisibleIndices(static_cast<uint32_t>(_mm256_movemask_ps(inside)), i, out);
+    }
+#elif GLM_ARCH & GLM_ARCH_SSE2_BIT
+    glm_vec4 planeX[6], planeY[6], planeZ[6], planeW[6], absX[6], absY[6], absZ[6];
+    for (int p = 0; p < 6; p++) {
+        const glm::vec4& plane = frustum.planes[p];
+        planeX[p] = _mm_set1_ps(plane.x);
+        planeY[p] = _mm_set1_ps(plane.y);
+        planeZ[p] = _mm_set1_ps(plane.z);
+        planeW[p] = _mm_set1_ps(plane.w);
+        absX[p] = _mm_set1_ps(glm::abs(plane.x));
+        absY[p] = _mm_set1_ps(glm::abs(plane.y));
+        absZ[p] = _mm_set1_ps(glm::abs(plane.z));
+    }
+    const glm_vec4 zero = _mm_setzero_ps();
+
+    for (; i + 4 <= last; i += 4) {
+        glm_vec4 cx = _mm_loadu_ps(&bounds.centerX[i]);
+        glm_vec4 cy = _mm_loadu_ps(&bounds.centerY[i]);
+        glm_vec4 cz = _mm_loadu_ps(&bounds.centerZ[i]);
+        glm_vec4 ex = _mm_loadu_ps(&bounds.extentX[i]);
+        glm_vec4 ey = _mm_loadu_ps(&bounds.extentY[i]);
+        glm_vec4 ez = _mm_loadu_ps(&bounds.extentZ[i]);
+        glm_vec4 r = _mm_loadu_ps(&bounds.radius[i]);
+
+        glm_vec4 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (int p = 0; p < 6; p++) {
+            glm_vec4 distance = _mm_add_ps(_mm_mul_ps(planeX[p], cx), _mm_mul_ps(planeY[p], cy));
+            distance = _mm_add_ps(distance, _mm_mul_ps(planeZ[p], cz));
+            distance = _mm_add_ps(distance, _mm_add_ps(planeW[p], r));
+            glm_vec4 reach = _mm_add_ps(_mm_mul_ps(absX[p], ex), _mm_mul_ps(absY[p], ey));
+            reach = _mm_add_ps(reach, _mm_mul_ps(absZ[p], ez));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, reach), zero));
+        }
+        out = writeVisibleIndices(static_cast<uint32_t>(_mm_movemask_ps(inside)), i, out);
+    }
+#endif
+
+    // Scalar tail, and the whole range without SIMD
+    for (; i < last; i++) {
+        bool inside = true;
+        for (const glm::vec4& plane : frustum.planes) {
+            float distance = plane.x * bounds.centerX[i] + plane.y * bounds.centerY[i] + plane.z * bounds.centerZ[i]
+                           + plane.w + bounds.radius[i];
+            float reach = glm::abs(plane.x) * bounds.extentX[i] + glm::abs(plane.y) * bounds.extentY[i]
+                        + glm::abs(plane.z) * bounds.extentZ[i];
+            inside = inside && distance + reach >= 0.0f;
+        }
+        if (inside) {
+            *out++ = i;
+        }
+    }
+
+    visible.resize(static_cast<size_t>(out - visible.data()));
+}
+
+//---------------------------------
+// cullBoundsParallel()
+//---------------------------------
+void cullBoundsParallel(
+    const CullingBounds& bounds,
+    const Frustum& frustum,
+    std::vector<uint32_t>& visible,
+    WorkerPool& workers,
+    std::vector<std::vector<uint32_t>>& chunkVisible,
+    uint32_t chunkSize)
+{
+    visible.clear();
+
+    const uint32_t count = getBoundsCount(bounds);
+    const uint32_t chunkCount = (count + chunkSize - 1) / chunkSize;
+    if (chunkCount <= 1 || workers.threads.empty()) {
+        cullBounds(bounds, frustum, 0, count, visible);
+        return;
+    }
+
+    // Chunks are independent; each one writes its own list and the lists are joined in chunk
+    // order to keep the output sorted
+    if (chunkVisible.size() < chunkCount) {
+        chunkVisible.resize(chunkCount);
+    }
+    runParallelFor(workers, chunkCount, [&](uint32_t chunk) {
+        uint32_t first = chunk * chunkSize;
+        uint32_t last = std::min(count, first + chunkSize);
+        chunkVisible[chunk].clear();
+        cullBounds(bounds, frustum, first, last, chunkVisible[chunk]);
+    });
+
+    size_t visibleCount = 0;
+    for (uint32_t chunk = 0; chunk < chunkCount; chunk++) {
+        visibleCount += chunkVisible[chunk].size();
+    }
+    visible.reserve(visibleCount);
+    for (uint32_t chunk = 0; chunk < chunkCount; chunk++) {
+        visible.insert(visible.end(), chunkVisible[chunk].begin(), chunkVisible[chunk].end());
+    }
+}
@@ -0,0 +1,167 @@
+#include "depth_pyramid.h"
+
+#include "vulkan_utils.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+const uint32_t DEPTH_PYRAMID_MAX_SIZE = 1u << (DEPTH_PYRAMID_MAX_MIPS - 1);
+
+uint32_t previousPowerOfTwo(uint32_t value)
+{
+    uint32_t result = 1;
+    while (result * 2 <= value) {
+        result *= 2;
+    }
+    return result;
+}
+} // namespace
+
+//---------------------------------
+// createDepthPyramid()
+//---------------------------------
+void createDepthPyramid(
+    DepthPyramid& pyramid,
+    const VkDevice& device,
+    const VkPhysicalDevice& physicalDevice,
+    const VkCommandPool& commandPool,
+    const VkQueue& queue,
+    VkExtent2D depthExtent,
+    const VkImageView& depthView,
+    VkShaderModule shaderModule)
+{
+    pyramid.width = std::min(previousPowerOfTwo(depthExtent.width), DEPTH_PYRAMID_MAX_SIZE);
+    pyramid.height = std::min(previousPowerOfTwo(depthExtent.height), DEPTH_PYRAMID_MAX_SIZE);
+    pyramid.mipCount = 1;
+    while ((std::max(pyramid.width, pyramid.height) >> pyramid.mipCount) > 0) {
+        pyramid.mipCount++;
+    }
+
+    createImage(
+        device,
+        physicalDevice,
+        pyramid.width,
+        pyramid.height,
+        pyramid.mipCount,
+        VK_FORMAT_R32_SFLOAT,
+        VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+        pyramid.image,
+        pyramid.imageMemory);
+
+    pyramid.view = createImageView(
+        device, pyramid.image, VK_FORMAT_R32_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT, 0, pyramid.mipCount);
+
+    VkSamplerCreateInfo samplerInfo;
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.pNext = nullptr;
+    samplerInfo.flags = 0;
+    samplerInfo.magFilter = VK_FILTER_NEAREST;
+    samplerInfo.minFilter = VK_FILTER_NEAREST;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.mipLodBias = 0.0f;
+    samplerInfo.anisotropyEnable = VK_FALSE;
+    samplerInfo.maxAnisotropy = 1.0f;
+    samplerInfo.compareEnable = VK_FALSE;
+    samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
+    samplerInfo.minLod = 0.0f;
+    samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+    samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_TRANSPARENT_BLACK;
+    samplerInfo.unnormalizedCoordinates = VK_FALSE;
+
+    if (vkCreateSampler(device, &samplerInfo, nullptr, &pyramid.sampler) != VK_SUCCESS) {
+        throw std::runtime_error("createDepthPyramid() Failed to create sampler!");
+    }
+
+    // The pyramid stays in GENERAL for its whole life: written as storage, read with texelFetch
+    VkCommandBuffer commandBuffer = beginSingleTimeCommands(device, commandPool);
+
+    VkImageMemoryBarrier layoutBarrier;
+    layoutBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    layoutBarrier.pNext = nullptr;
+    layoutBarrier.srcAccessMask = 0;
+    layoutBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    layoutBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    layoutBarrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+    layoutBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    layoutBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    layoutBarrier.image = pyramid.image;
+    layoutBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    layoutBarrier.subresourceRange.baseMipLevel = 0;
+    layoutBarrier.subresourceRange.levelCount = pyramid.mipCount;
+    layoutBarrier.subresourceRange.baseArrayLayer = 0;
+    layoutBarrier.subresourceRange.layerCount = 1;
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0,
+        0,
+        nullptr,
+        0,
+        nullptr,
+        1,
+        &layoutBarrier);
+
+    endSingleTimeCommands(device, commandPool, queue, commandBuffer);
+
+    createDownsampler(pyramid.downsampler, device, VK_FORMAT_R32_SFLOAT, DOWNSAMPLE_REDUCTION_MAX, shaderModule);
+    createDownsampleChain(
+        pyramid.chain,
+        device,
+        physicalDevice,
+        commandPool,
+        queue,
+        pyramid.downsampler,
+        pyramid.image,
+        0,
+        pyramid.width,
+        pyramid.height,
+        pyramid.mipCount,
+        depthView,
+        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+}
+
+//---------------------------------
+// recordDepthPyramidBuild()
+//---------------------------------
+void recordDepthPyramidBuild(VkCommandBuffer commandBuffer, const DepthPyramid& pyramid, VkExtent2D depthExtent)
+{
+    recordDownsample(commandBuffer, pyramid.downsampler, pyramid.chain, depthExtent);
+
+    VkMemoryBarrier pyramidBarrier;
+    pyramidBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    pyramidBarrier.pNext = nullptr;
+    pyramidBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    pyramidBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0,
+        1,
+        &pyramidBarrier,
+        0,
+        nullptr,
+        0,
+        nullptr);
+}
+
+//---------------------------------
+// destroyDepthPyramid()
+//---------------------------------
+void destroyDepthPyramid(DepthPyramid& pyramid, const VkDevice& device)
+{
+    destroyDownsampleChain(pyramid.chain, device);
+    destroyDownsampler(pyramid.downsampler, device);
+
+    vkDestroySampler(device, pyramid.sampler, nullptr);
+    vkDestroyImageView(device, pyramid.view, nullptr);
+    vkDestroyImage(device, pyramid.image, nullptr);
+    vkFreeMemory(device, pyramid.imageMemory, nullptr);
+
+    pyramid = DepthPyramid{};
+}
@@ -0,0 +1,166 @@
+#include "device_features.h"
+
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+namespace {
+bool hasDeviceExtension(const VkPhysicalDevice& physicalDevice, const char* extensionName)
+{
+    uint32_t extensionCount = 0;
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+    std::vector<VkExtensionProperties> extensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, extensions.data());
+
+    for (const VkExtensionProperties& extension : extensions) {
+        if (strcmp(extension.extensionName, extensionName) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void initDeviceFeatureChainFor(const VkPhysicalDevice& physicalDevice, DeviceFeatureChain& chain)
+{
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+
+    // VK_EXT_mesh_shader needs SPIR-V 1.4, which is core from 1.2
+    bool meshShaderExtension = deviceProperties.apiVersion >= VK_API_VERSION_1_2
+        && hasDeviceExtension(physicalDevice, VK_EXT_MESH_SHADER_EXTENSION_NAME);
+    initDeviceFeatureChain(chain, deviceProperties.apiVersion, meshShaderExtension);
+}
+
+void queryDeviceFeatures(const VkPhysicalDevice& physicalDevice, DeviceFeatureChain& supported)
+{
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+
+    initDeviceFeatureChainFor(physicalDevice, supported);
+    if (deviceProperties.apiVersion >= VK_API_VERSION_1_1) {
+        vkGetPhysicalDeviceFeatures2(physicalDevice, &supported.features2);
+    }
+    else {
+        vkGetPhysicalDeviceFeatures(physicalDevice, &supported.features2.features);
+    }
+}
+} // namespace
+
+//---------------------------------
+// initDeviceFeatureChain()
+//---------------------------------
+void initDeviceFeatureChain(DeviceFeatureChain& chain, uint32_t deviceApiVersion, bool meshShaderExtension)
+{
+    chain.features2 = {};
+    chain.features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    chain.vulkan11 = {};
+    chain.vulkan11.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_1_FEATURES;
+    chain.vulkan12 = {};
+    chain.vulkan12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    chain.vulkan13 = {};
+    chain.vulkan13.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+    chain.meshShader = {};
+    chain.meshShader.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_EXT;
+
+    // VkPhysicalDeviceVulkan11Features/12Features are 1.2 structs, 13Features is 1.3;
+    // chaining them on an older device is invalid, so those features just stay VK_FALSE
+    if (deviceApiVersion >= VK_API_VERSION_1_2) {
+        chain.features2.pNext = &chain.vulkan11;
+        chain.vulkan11.pNext = &chain.vulkan12;
+    }
+    if (deviceApiVersion >= VK_API_VERSION_1_3) {
+        chain.vulkan12.pNext = &chain.vulkan13;
+    }
+
+    // Extension structs go after the last linked core struct
+    if (meshShaderExtension) {
+        void** tail = &chain.features2.pNext;
+        while (*tail != nullptr) {
+            tail = &static_cast<VkBaseOutStructure*>(*tail)->pNext;
+        }
+        *tail = &chain.meshShader;
+    }
+}
+
+//---------------------------------
+// getFeatureDeviceExtensions()
+//---------------------------------
+std::vector<const char*> getFeatureDeviceExtensions(const DeviceFeatureChain& enabled)
+{
+    std::vector<const char*> extensions;
+    for (const VkBaseInStructure* next = static_cast<const VkBaseInStructure*>(enabled.features2.pNext);
+         next != nullptr;
+         next = next->pNext) {
+        if (next == reinterpret_cast<const VkBaseInStructure*>(&enabled.meshShader)) {
+            extensions.push_back(VK_EXT_MESH_SHADER_EXTENSION_NAME);
+        }
+    }
+    return extensions;
+}
+
+//---------------------------------
+// requestDeviceFeature()
+//---------------------------------
+void requestDeviceFeature(
+    std::vector<DeviceFeatureRequest>& requests,
+    const char* name,
+    DeviceFeatureSelector select,
+    bool required)
+{
+    DeviceFeatureRequest request;
+    request.name = name;
+    request.select = select;
+    request.required = required;
+    requests.push_back(request);
+}
+
+//---------------------------------
+// negotiateDeviceFeatures()
+//---------------------------------
+void negotiateDeviceFeatures(
+    const VkPhysicalDevice& physicalDevice,
+    const std::vector<DeviceFeatureRequest>& requests,
+    DeviceFeatureChain& enabled)
+{
+    std::vector<std::string> missingRequired = getMissingRequiredDeviceFeatures(physicalDevice, requests);
+    if (!missingRequired.empty()) {
+        std::string message = "negotiateDeviceFeatures() Missing required device features:";
+        for (const std::string& name : missingRequired) {
+            message += " " + name;
+        }
+        throw std::runtime_error(message);
+    }
+
+    DeviceFeatureChain supported;
+    queryDeviceFeatures(physicalDevice, supported);
+
+    initDeviceFeatureChainFor(physicalDevice, enabled);
+    for (const DeviceFeatureRequest& request : requests) {
+        if (request.select(supported)) {
+            request.select(enabled) = VK_TRUE;
+        }
+        else {
+            std::cout << "Optional device feature " << request.name << " not supported, using fallback path"
+                      << std::endl;
+        }
+    }
+}
+
+//---------------------------------
+// getMissingRequiredDeviceFeatures()
+//---------------------------------
+std::vector<std::string> getMissingRequiredDeviceFeatures(
+    const VkPhysicalDevice& physicalDevice,
+    const std::vector<DeviceFeatureRequest>& requests)
+{
+    DeviceFeatureChain supported;
+    queryDeviceFeatures(physicalDevice, supported);
+
+    std::vector<std::string> missing;
+    for (const DeviceFeatureRequest& request : requests) {
+        if (request.required && !request.select(supported)) {
+            missing.push_back(request.name);
+        }
+    }
+    return missing;
+}
@@ -0,0 +1,367 @@
+#include "downsampler.h"
+
+#include "vulkan_utils.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+const uint32_t DOWNSAMPLE_TILE_SIZE = 32; // Level-0 texels per workgroup side in downsample.glsl
+
+uint32_t getWorkgroupCount(uint32_t size)
+{
+    return (size + DOWNSAMPLE_TILE_SIZE - 1) / DOWNSAMPLE_TILE_SIZE;
+}
+} // namespace
+
+//---------------------------------
+// hasDownsampleSubgroupSupport()
+//---------------------------------
+bool hasDownsampleSubgroupSupport(const VkPhysicalDevice& physicalDevice)
+{
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+    if (deviceProperties.apiVersion < VK_API_VERSION_1_2) {
+        return false;
+    }
+
+    VkPhysicalDeviceSubgroupProperties subgroupProperties;
+    subgroupProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SUBGROUP_PROPERTIES;
+    subgroupProperties.pNext = nullptr;
+
+    VkPhysicalDeviceProperties2 properties2;
+    properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties2.pNext = &subgroupProperties;
+    vkGetPhysicalDeviceProperties2(physicalDevice, &properties2);
+
+    // A quad needs 4 invocations of one subgroup
+    const VkSubgroupFeatureFlags requiredOperations = VK_SUBGROUP_FEATURE_BASIC_BIT | VK_SUBGROUP_FEATURE_QUAD_BIT;
+    return subgroupProperties.subgroupSize >= 4
+        && (subgroupProperties.supportedStages & VK_SHADER_STAGE_COMPUTE_BIT) != 0
+        && (subgroupProperties.supportedOperations & requiredOperations) == requiredOperations;
+}
+
+//---------------------------------
+// getDownsampleShaderName()
+//---------------------------------
+std::string getDownsampleShaderName(VkFormat format, bool subgroupReduction)
+{
+    const std::string prefix = subgroupReduction ? "downsample_subgroup_" : "downsample_";
+    switch (format) {
+    case VK_FORMAT_R32_SFLOAT:
+        return prefix + "r32f.comp";
+    case VK_FORMAT_R8G8B8A8_UNORM:
+        return prefix + "rgba8.comp";
+    case VK_FORMAT_R16G16B16A16_SFLOAT:
+        return prefix + "rgba16f.comp";
+    default:
+        throw std::runtime_error("getDownsampleShaderName() No downsample shader for this format!");
+    }
+}
+
+//---------------------------------
+// createDownsampler()
+//---------------------------------
+void createDownsampler(
+    Downsampler& downsampler,
+    const VkDevice& device,
+    VkFormat format,
+    DownsampleReduction reduction,
+    VkShaderModule shaderModule)
+{
+    downsampler.format = format;
+    downsampler.reduction = reduction;
+    downsampler.shaderModule = shaderModule;
+
+    VkSamplerCreateInfo samplerInfo;
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.pNext = nullptr;
+    samplerInfo.flags = 0;
+    samplerInfo.magFilter = VK_FILTER_NEAREST;
+    samplerInfo.minFilter = VK_FILTER_NEAREST;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.mipLodBias = 0.0f;
+    samplerInfo.anisotropyEnable = VK_FALSE;
+    samplerInfo.maxAnisotropy = 1.0f;
+    samplerInfo.compareEnable = VK_FALSE;
+    samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
+    samplerInfo.minLod = 0.0f;
+    samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+    samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_TRANSPARENT_BLACK;
+    samplerInfo.unnormalizedCoordinates = VK_FALSE;
+
+    if (vkCreateSampler(device, &samplerInfo, nullptr, &downsampler.sampler) != VK_SUCCESS) {
+        throw std::runtime_error("createDownsampler() Failed to create sampler!");
+    }
+
+    VkDescriptorSetLayoutBinding bindings[3];
+    bindings[0].binding = 0;
+    bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    bindings[0].descriptorCount = 1;
+    bindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    bindings[0].pImmutableSamplers = nullptr;
+
+    bindings[1].binding = 1;
+    bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    bindings[1].descriptorCount = DOWNSAMPLE_MAX_MIPS;
+    bindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    bindings[1].pImmutableSamplers = nullptr;
+
+    bindings[2].binding = 2;
+    bindings[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    bindings[2].descriptorCount = 1;
+    bindings[2].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    bindings[2].pImmutableSamplers = nullptr;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo;
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.pNext = nullptr;
+    layoutInfo.flags = 0;
+    layoutInfo.bindingCount = 3;
+    layoutInfo.pBindings = bindings;
+
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &downsampler.setLayout) != VK_SUCCESS) {
+        throw std::runtime_error("createDownsampler() Failed to create descriptor set layout!");
+    }
+
+    VkPushConstantRange pushConstantRange;
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(DownsamplePushConstants);
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo;
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.pNext = nullptr;
+    pipelineLayoutInfo.flags = 0;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &downsampler.setLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &downsampler.pipelineLayout) != VK_SUCCESS) {
+        throw std::runtime_error("createDownsampler() Failed to create pipeline layout!");
+    }
+
+    // constant_id = 0 is REDUCTION
+    uint32_t reductionValue = reduction;
+
+    VkSpecializationMapEntry specializationEntry;
+    specializationEntry.constantID = 0;
+    specializationEntry.offset = 0;
+    specializationEntry.size = sizeof(uint32_t);
+
+    VkSpecializationInfo specializationInfo;
+    specializationInfo.mapEntryCount = 1;
+    specializationInfo.pMapEntries = &specializationEntry;
+    specializationInfo.dataSize = sizeof(uint32_t);
+    specializationInfo.pData = &reductionValue;
+
+    VkComputePipelineCreateInfo pipelineInfo;
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.pNext = nullptr;
+    pipelineInfo.flags = 0;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.pNext = nullptr;
+    pipelineInfo.stage.flags = 0;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = shaderModule;
+    pipelineInfo.stage.pName = "main";
+    pipelineInfo.stage.pSpecializationInfo = &specializationInfo;
+    pipelineInfo.layout = downsampler.pipelineLayout;
+    pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+    pipelineInfo.basePipelineIndex = -1;
+
+    if (vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &downsampler.pipeline)
+        != VK_SUCCESS) {
+        throw std::runtime_error("createDownsampler() Failed to create pipeline!");
+    }
+}
+
+//---------------------------------
+// destroyDownsampler()
+//---------------------------------
+void destroyDownsampler(Downsampler& downsampler, const VkDevice& device)
+{
+    vkDestroyPipeline(device, downsampler.pipeline, nullptr);
+    vkDestroyPipelineLayout(device, downsampler.pipelineLayout, nullptr);
+    vkDestroyShaderModule(device, downsampler.shaderModule, nullptr);
+    vkDestroyDescriptorSetLayout(device, downsampler.setLayout, nullptr);
+    vkDestroySampler(device, downsampler.sampler, nullptr);
+
+    downsampler = Downsampler{};
+}
+
+//---------------------------------
+// createDownsampleChain()
+//---------------------------------
+void createDownsampleChain(
+    DownsampleChain& chain,
+    const VkDevice& device,
+    const VkPhysicalDevice& physicalDevice,
+    const VkCommandPool& commandPool,
+    const VkQueue& queue,
+    const Downsampler& downsampler,
+    const VkImage& image,
+    uint32_t baseLevel,
+    uint32_t width,
+    uint32_t height,
+    uint32_t mipCount,
+    const VkImageView& sourceView,
+    VkImageLayout sourceLayout)
+{
+    if (mipCount == 0 || mipCount > DOWNSAMPLE_MAX_MIPS) {
+        throw std::runtime_error("createDownsampleChain() Chain must have 1 to DOWNSAMPLE_MAX_MIPS levels!");
+    }
+
+    chain.width = width;
+    chain.height = height;
+    chain.mipCount = mipCount;
+    for (uint32_t level = 0; level < mipCount; level++) {
+        chain.mipViews.push_back(
+            createImageView(device, image, downsampler.format, VK_IMAGE_ASPECT_COLOR_BIT, baseLevel + level, 1));
+    }
+
+    createBuffer(
+        device,
+        physicalDevice,
+        sizeof(uint32_t),
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        {},
+        chain.counterBuffer,
+        chain.counterBufferMemory);
+
+    // The workgroup counter starts at zero and the shader resets it after each dispatch
+    VkCommandBuffer commandBuffer = beginSingleTimeCommands(device, commandPool);
+    vkCmdFillBuffer(commandBuffer, chain.counterBuffer, 0, sizeof(uint32_t), 0);
+    endSingleTimeCommands(device, commandPool, queue, commandBuffer);
+
+    VkDescriptorPoolSize poolSizes[3];
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    poolSizes[0].descriptorCount = 1;
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    poolSizes[1].descriptorCount = DOWNSAMPLE_MAX_MIPS;
+    poolSizes[2].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSizes[2].descriptorCount = 1;
+
+    VkDescriptorPoolCreateInfo poolInfo;
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.pNext = nullptr;
+    poolInfo.flags = 0;
+    poolInfo.maxSets = 1;
+    poolInfo.poolSizeCount = 3;
+    poolInfo.pPoolSizes = poolSizes;
+
+    if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &chain.descriptorPool) != VK_SUCCESS) {
+        throw std::runtime_error("createDownsampleChain() Failed to create descriptor pool!");
+    }
+
+    VkDescriptorSetAllocateInfo allocateInfo;
+    allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocateInfo.pNext = nullptr;
+    allocateInfo.descriptorPool = chain.descriptorPool;
+    allocateInfo.descriptorSetCount = 1;
+    allocateInfo.pSetLayouts = &downsampler.setLayout;
+
+    if (vkAllocateDescriptorSets(device, &allocateInfo, &chain.descriptorSet) != VK_SUCCESS) {
+        throw std::runtime_error("createDownsampleChain() Failed to allocate descriptor set!");
+    }
+
+    VkDescriptorImageInfo sourceInfo;
+    sourceInfo.sampler = downsampler.sampler;
+    sourceInfo.imageView = sourceView;
+    sourceInfo.imageLayout = sourceLayout;
+
+    // Every array element is statically used by the shader, so levels past mipCount alias
+    // the last one; the shader never touches them
+    VkDescriptorImageInfo mipInfos[DOWNSAMPLE_MAX_MIPS];
+    for (uint32_t level = 0; level < DOWNSAMPLE_MAX_MIPS; level++) {
+        mipInfos[level].sampler = VK_NULL_HANDLE;
+        mipInfos[level].imageView = chain.mipViews[std::min(level, chain.mipCount - 1)];
+        mipInfos[level].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+    }
+
+    VkDescriptorBufferInfo counterInfo;
+    counterInfo.buffer = chain.counterBuffer;
+    counterInfo.offset = 0;
+    counterInfo.range = VK_WHOLE_SIZE;
+
+    VkWriteDescriptorSet writes[3];
+    for (uint32_t i = 0; i < 3; i++) {
+        writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[i].pNext = nullptr;
+        writes[i].dstSet = chain.descriptorSet;
+        writes[i].dstBinding = i;
+        writes[i].dstArrayElement = 0;
+        writes[i].descriptorCount = 1;
+        writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writes[i].pImageInfo = nullptr;
+        writes[i].pBufferInfo = nullptr;
+        writes[i].pTexelBufferView = nullptr;
+    }
+    writes[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    writes[0].pImageInfo = &sourceInfo;
+    writes[1].descriptorCount = DOWNSAMPLE_MAX_MIPS;
+    writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    writes[1].pImageInfo = mipInfos;
+    writes[2].pBufferInfo = &counterInfo;
+    vkUpdateDescriptorSets(device, 3, writes, 0, nullptr);
+}
+
+//---------------------------------
+// destroyDownsampleChain()
+//---------------------------------
+void destroyDownsampleChain(DownsampleChain& chain, const VkDevice& device)
+{
+    vkDestroyDescriptorPool(device, chain.descriptorPool, nullptr);
+    vkDestroyBuffer(device, chain.counterBuffer, nullptr);
+    vkFreeMemory(device, chain.counterBufferMemory, nullptr);
+    for (VkImageView mipView : chain.mipViews) {
+        vkDestroyImageView(device, mipView, nullptr);
+    }
+
+    chain = DownsampleChain{};
+}
+
+//---------------------------------
+// recordDownsample()
+//---------------------------------
+void recordDownsample(
+    VkCommandBuffer commandBuffer,
+    const Downsampler& downsampler,
+    const DownsampleChain& chain,
+    VkExtent2D sourceExtent)
+{
+    uint32_t workgroupsX = getWorkgroupCount(chain.width);
+    uint32_t workgroupsY = getWorkgroupCount(chain.height);
+
+    DownsamplePushConstants pushConstants;
+    pushConstants.sourceSize[0] = static_cast<int32_t>(sourceExtent.width);
+    pushConstants.sourceSize[1] = static_cast<int32_t>(sourceExtent.height);
+    pushConstants.destinationSize[0] = static_cast<int32_t>(chain.width);
+    pushConstants.destinationSize[1] = static_cast<int32_t>(chain.height);
+    pushConstants.mipCount = chain.mipCount;
+    pushConstants.workgroupCount = workgroupsX * workgroupsY;
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, downsampler.pipeline);
+    vkCmdBindDescriptorSets(
+        commandBuffer,
+        VK_PIPELINE_BIND_POINT_COMPUTE,
+        downsampler.pipelineLayout,
+        0,
+        1,
+        &chain.descriptorSet,
+        0,
+        nullptr);
+    vkCmdPushConstants(
+        commandBuffer,
+        downsampler.pipelineLayout,
+        VK_SHADER_STAGE_COMPUTE_BIT,
+        0,
+        sizeof(DownsamplePushConstants),
+        &pushConstants);
+    vkCmdDispatch(commandBuffer, workgroupsX, workgroupsY, 1);
+}
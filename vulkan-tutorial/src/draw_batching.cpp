@@ -0,0 +1,141 @@
+#include "draw_batching.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace {
+const uint32_t RADIX_BITS = 8;
+const uint32_t RADIX_BUCKETS = 1 << RADIX_BITS;
+const uint32_t RADIX_PASSES = 64 / RADIX_BITS;
+
+uint64_t packField(uint64_t key, uint32_t value, uint32_t bits, const char* name)
+{
+    if (value >= (1u << bits)) {
+        throw std::runtime_error(std::string("packDrawSortKey() ") + name + " id exceeds the sort key range!");
+    }
+    return (key << bits) | value;
+}
+
+// Non-negative IEEE floats order like their bit patterns; keep the top DRAW_KEY_DEPTH_BITS
+uint32_t quantizeDepth(float depth)
+{
+    float clamped = std::max(depth, 0.0f);
+    uint32_t bits;
+    memcpy(&bits, &clamped, sizeof(float));
+    return bits >> (32 - DRAW_KEY_DEPTH_BITS);
+}
+} // namespace
+
+//---------------------------------
+// packDrawSortKey()
+//---------------------------------
+uint64_t packDrawSortKey(const DrawItem& item)
+{
+    uint64_t key = 0;
+    key = packField(key, item.pass, DRAW_KEY_PASS_BITS, "Pass");
+    key = packField(key, item.pipeline, DRAW_KEY_PIPELINE_BITS, "Pipeline");
+    key = packField(key, item.material, DRAW_KEY_MATERIAL_BITS, "Material");
+    key = packField(key, item.mesh, DRAW_KEY_MESH_BITS, "Mesh");
+    return (key << DRAW_KEY_DEPTH_BITS) | quantizeDepth(item.depth);
+}
+
+//---------------------------------
+// resetDrawQueue()
+//---------------------------------
+void resetDrawQueue(DrawQueue& queue)
+{
+    queue.items.clear();
+    queue.entries.clear();
+}
+
+//---------------------------------
+// submitDraw()
+//---------------------------------
+void submitDraw(DrawQueue& queue, const DrawItem& item)
+{
+    DrawSortEntry entry;
+    entry.key = packDrawSortKey(item);
+    entry.item = static_cast<uint32_t>(queue.items.size());
+    queue.entries.push_back(entry);
+    queue.items.push_back(item);
+}
+
+//---------------------------------
+// radixSortDrawKeys()
+//---------------------------------
+void radixSortDrawKeys(std::vector<DrawSortEntry>& entries, std::vector<DrawSortEntry>& scratch)
+{
+    const size_t count = entries.size();
+    if (count < 2) {
+        return;
+    }
+    scratch.resize(count);
+
+    // All digit histograms in a single read of the keys
+    std::vector<uint32_t> histograms(RADIX_PASSES * RADIX_BUCKETS, 0);
+    for (const DrawSortEntry& entry : entries) {
+        for (uint32_t pass = 0; pass < RADIX_PASSES; pass++) {
+            histograms[pass * RADIX_BUCKETS + ((entry.key >> (pass * RADIX_BITS)) & (RADIX_BUCKETS - 1))]++;
+        }
+    }
+
+    DrawSortEntry* source = entries.data();
+    DrawSortEntry* destination = scratch.data();
+    for (uint32_t pass = 0; pass < RADIX_PASSES; pass++) {
+        uint32_t* histogram = &histograms[pass * RADIX_BUCKETS];
+        const uint32_t shift = pass * RADIX_BITS;
+
+        // Every key has the same digit: this pass would be an identity copy
+        if (histogram[(source[0].key >> shift) & (RADIX_BUCKETS - 1)] == count) {
+            continue;
+        }
+
+        uint32_t offset = 0;
+        for (uint32_t bucket = 0; bucket < RADIX_BUCKETS; bucket++) {
+            uint32_t bucketCount = histogram[bucket];
+            histogram[bucket] = offset;
+            offset += bucketCount;
+        }
+        for (size_t i = 0; i < count; i++) {
+            destination[histogram[(source[i].key >> shift) & (RADIX_BUCKETS - 1)]++] = source[i];
+        }
+        std::swap(source, destination);
+    }
+
+    if (source != entries.data()) {
+        entries.swap(scratch);
+    }
+}
+
+//---------------------------------
+// buildDrawBatches()
+//---------------------------------
+void buildDrawBatches(DrawQueue& queue, std::vector<DrawBatch>& batches, std::vector<uint32_t>& instanceObjects)
+{
+    batches.clear();
+    instanceObjects.clear();
+    instanceObjects.reserve(queue.items.size());
+
+    radixSortDrawKeys(queue.entries, queue.scratch);
+
+    uint64_t batchState = 0;
+    for (const DrawSortEntry& entry : queue.entries) {
+        const uint64_t state = entry.key >> DRAW_KEY_DEPTH_BITS;
+        const DrawItem& item = queue.items[entry.item];
+        if (batches.empty() || state != batchState) {
+            DrawBatch batch;
+            batch.pass = item.pass;
+            batch.pipeline = item.pipeline;
+            batch.mesh = item.mesh;
+            batch.material = item.material;
+            batch.firstInstance = static_cast<uint32_t>(instanceObjects.size());
+            batch.instanceCount = 0;
+            batches.push_back(batch);
+            batchState = state;
+        }
+        batches.back().instanceCount++;
+        instanceObjects.push_back(item.objectIndex);
+    }
+}
@@ -0,0 +1,36 @@
+#include "frustum.h"
+
+//---------------------------------
+// extractFrustum()
+//---------------------------------
+Frustum extractFrustum(const glm::mat4& viewProjection)
+{
+    // glm is column-major, so row i of the matrix is (m[0][i], m[1][i], m[2][i], m[3][i])
+    const glm::mat4 m = glm::transpose(viewProjection);
+
+    Frustum frustum;
+    frustum.planes[0] = m[3] + m[0];
+    frustum.planes[1] = m[3] - m[0];
+    frustum.planes[2] = m[3] + m[1];
+    frustum.planes[3] = m[3] - m[1];
+    frustum.planes[4] = m[2];
+    frustum.planes[5] = m[3] - m[2];
+
+    for (glm::vec4& plane : frustum.planes) {
+        plane /= glm::length(glm::vec3(plane));
+    }
+    return frustum;
+}
+
+//---------------------------------
+// isSphereInFrustum()
+//---------------------------------
+bool isSphereInFrustum(const Frustum& frustum, const glm::vec3& center, float radius)
+{
+    for (const glm::vec4& plane : frustum.planes) {
+        if (glm::dot(glm::vec3(plane), center) + plane.w < -radius) {
+            return false;
+        }
+    }
+    return true;
+}
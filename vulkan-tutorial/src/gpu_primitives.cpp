@@ -0,0 +1,422 @@
+#include "gpu_primitives.h"
+#include "vulkan_utils.h"
+
+#include <stdexcept>
+#include <string>
+
+namespace {
+uint32_t getBlockCount(uint32_t count)
+{
+    return (count + GPU_PRIMITIVE_BLOCK_SIZE - 1) / GPU_PRIMITIVE_BLOCK_SIZE;
+}
+
+uint32_t getWorkgroupCount(const GpuPrimitives& primitives, uint32_t count, const char* caller)
+{
+    const uint32_t blockCount = getBlockCount(count);
+    if (blockCount > primitives.maxWorkgroupCount) {
+        throw std::runtime_error(std::string(caller) + " Too many elements for one dispatch!");
+    }
+    return blockCount;
+}
+
+// Where recordRadixSort() keeps its data inside the scratch array; see primitive_sort.glsl
+struct RadixSortScratch
+{
+    uint32_t maxPartitions;
+    GpuArray state;
+    GpuArray histogram;
+    GpuArray status;
+    GpuArray alternateKeys;
+    GpuArray alternateValues;
+    uint64_t elementCount;
+};
+
+// Dispatch arguments, key count and partition counters; the arguments come first
+const static uint32_t SORT_STATE_SIZE = 8;
+
+RadixSortScratch getRadixSortScratchLayout(const GpuArray& scratch, uint32_t maxCount, bool hasValues)
+{
+    RadixSortScratch layout;
+    layout.maxPartitions = getBlockCount(maxCount);
+
+    const uint64_t histogramFirst = SORT_STATE_SIZE;
+    const uint64_t statusFirst = histogramFirst + GPU_RADIX_PASS_COUNT * GPU_RADIX_SIZE;
+    const uint64_t keysFirst = statusFirst + uint64_t(GPU_RADIX_PASS_COUNT) * GPU_RADIX_SIZE * layout.maxPartitions;
+    const uint64_t valuesFirst = keysFirst + maxCount;
+    layout.elementCount = hasValues ? valuesFirst + maxCount : valuesFirst;
+
+    layout.state = scratch;
+    layout.histogram = getGpuSubArray(scratch, histogramFirst);
+    layout.status = getGpuSubArray(scratch, statusFirst);
+    layout.alternateKeys = getGpuSubArray(scratch, keysFirst);
+    layout.alternateValues = hasValues ? getGpuSubArray(scratch, valuesFirst) : GpuArray{};
+    return layout;
+}
+
+//---------------------------------
+// recordOnesweepSort()
+//---------------------------------
+// countSource is only read when its buffer is set
+void recordOnesweepSort(
+    ComputeRecorder& recorder,
+    const GpuPrimitives& primitives,
+    const GpuArray& keys,
+    const GpuArray& values,
+    uint32_t count,
+    const GpuArray& countSource,
+    uint32_t maxCount,
+    const GpuArray& scratch)
+{
+    if (maxCount == 0) {
+        return;
+    }
+    if (maxCount > GPU_RADIX_SORT_MAX_COUNT) {
+        throw std::runtime_error("recordRadixSort() Too many keys for the look-back status words!");
+    }
+    const bool hasValues = values.buffer != nullptr;
+    const RadixSortScratch layout = getRadixSortScratchLayout(scratch, maxCount, hasValues);
+    // The indirect dispatches are never larger than this
+    getWorkgroupCount(primitives, maxCount, "recordRadixSort()");
+
+    GpuSortSetupPushConstants setupConstants;
+    setupConstants.state = layout.state.data;
+    setupConstants.histogram = layout.histogram.data;
+    setupConstants.countSource = countSource.data;
+    setupConstants.count = count;
+    setupConstants.useCountSource = countSource.buffer != nullptr ? 1 : 0;
+    setupConstants.maxCount = maxCount;
+    std::vector<VkBuffer> setupReads;
+    if (countSource.buffer != nullptr) {
+        setupReads.push_back(countSource.buffer);
+    }
+    recordComputeDispatch(recorder, primitives.sortSetup, &setupConstants, 1, 1, 1, setupReads, {scratch.buffer});
+
+    const VkDeviceSize dispatchOffset = layout.state.offset;
+    GpuSortHistogramPushConstants histogramConstants;
+    histogramConstants.keys = keys.data;
+    histogramConstants.state = layout.state.data;
+    histogramConstants.histogram = layout.histogram.data;
+    histogramConstants.status = layout.status.data;
+    histogramConstants.maxPartitions = layout.maxPartitions;
+    recordComputeDispatchIndirect(
+        recorder, primitives.sortHistogram, &histogramConstants, scratch.buffer, dispatchOffset,
+        {keys.buffer, scratch.buffer}, {scratch.buffer});
+
+    // An even number of passes leaves the result in keys and values
+    static_assert(GPU_RADIX_PASS_COUNT % 2 == 0, "recordRadixSort() must end in the caller's arrays");
+    for (uint32_t pass = 0; pass < GPU_RADIX_PASS_COUNT; pass++) {
+        const GpuArray& keysIn = pass % 2 == 0 ? keys : layout.alternateKeys;
+        const GpuArray& keysOut = pass % 2 == 0 ? layout.alternateKeys : keys;
+        const GpuArray& valuesIn = pass % 2 == 0 ? values : layout.alternateValues;
+        const GpuArray& valuesOut = pass % 2 == 0 ? layout.alternateValues : values;
+
+        GpuSortOnesweepPushConstants onesweepConstants;
+        onesweepConstants.keys = keysIn.data;
+        onesweepConstants.values = valuesIn.data;
+        onesweepConstants.keysOut = keysOut.data;
+        onesweepConstants.valuesOut = valuesOut.data;
+        onesweepConstants.state = layout.state.data;
+        onesweepConstants.histogram = layout.histogram.data;
+        onesweepConstants.status = layout.status.data;
+        onesweepConstants.pass = pass;
+        onesweepConstants.maxPartitions = layout.maxPartitions;
+        onesweepConstants.hasValues = hasValues ? 1 : 0;
+        std::vector<VkBuffer> reads = {keysIn.buffer, scratch.buffer};
+        std::vector<VkBuffer> writes = {keysOut.buffer, scratch.buffer};
+        if (hasValues) {
+            reads.push_back(valuesIn.buffer);
+            writes.push_back(valuesOut.buffer);
+        }
+        recordComputeDispatchIndirect(
+            recorder, primitives.sortOnesweep, &onesweepConstants, scratch.buffer, dispatchOffset, reads, writes);
+    }
+}
+
+template <typename T>
+void createPrimitiveKernel(
+    ComputeKernel& kernel,
+    const VkDevice& device,
+    const char* shaderName,
+    const std::vector<uint32_t>& specializationConstants = {})
+{
+    createComputeKernel(
+        kernel, device, loadShaderModule(device, shaderName), {}, sizeof(T), specializationConstants);
+}
+} // namespace
+
+//---------------------------------
+// getGpuArray()
+//---------------------------------
+GpuArray getGpuArray(const VkDevice& device, VkBuffer buffer)
+{
+    return GpuArray{buffer, 0, getDevicePointer<uint32_t>(device, buffer)};
+}
+
+//---------------------------------
+// getGpuSubArray()
+//---------------------------------
+GpuArray getGpuSubArray(const GpuArray& array, uint64_t first)
+{
+    return GpuArray{array.buffer, array.offset + first * sizeof(uint32_t), array.data + first};
+}
+
+//---------------------------------
+// hasGpuPrimitivesSupport()
+//---------------------------------
+bool hasGpuPrimitivesSupport(const VkPhysicalDevice& physicalDevice, const DeviceFeatureChain& enabledFeatures)
+{
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+    if (deviceProperties.apiVersion < VK_API_VERSION_1_2 || !enabledFeatures.vulkan12.bufferDeviceAddress) {
+        return false;
+    }
+    if (deviceProperties.limits.maxComputeWorkGroupInvocations < GPU_PRIMITIVE_WORKGROUP_SIZE
+        || deviceProperties.limits.maxComputeWorkGroupSize[0] < GPU_PRIMITIVE_WORKGROUP_SIZE) {
+        return false;
+    }
+
+    VkPhysicalDeviceSubgroupProperties subgroupProperties;
+    subgroupProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SUBGROUP_PROPERTIES;
+    subgroupProperties.pNext = nullptr;
+
+    VkPhysicalDeviceProperties2 properties2;
+    properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties2.pNext = &subgroupProperties;
+    vkGetPhysicalDeviceProperties2(physicalDevice, &properties2);
+
+    const VkSubgroupFeatureFlags requiredOperations = VK_SUBGROUP_FEATURE_BASIC_BIT
+        | VK_SUBGROUP_FEATURE_ARITHMETIC_BIT
+        | VK_SUBGROUP_FEATURE_BALLOT_BIT;
+    return (subgroupProperties.supportedStages & VK_SHADER_STAGE_COMPUTE_BIT) != 0
+        && (subgroupProperties.supportedOperations & requiredOperations) == requiredOperations;
+}
+
+//---------------------------------
+// createGpuPrimitives()
+//---------------------------------
+void createGpuPrimitives(GpuPrimitives& primitives, const VkDevice& device, const VkPhysicalDevice& physicalDevice)
+{
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+    primitives.maxWorkgroupCount = deviceProperties.limits.maxComputeWorkGroupCount[0];
+
+    for (uint32_t op = 0; op < GPU_REDUCE_OP_COUNT; op++) {
+        createPrimitiveKernel<GpuReducePushConstants>(primitives.reduce[op], device, "primitive_reduce.comp", {op});
+    }
+    createPrimitiveKernel<GpuScanPushConstants>(primitives.scan, device, "primitive_scan.comp");
+    createPrimitiveKernel<GpuScanAddPushConstants>(primitives.scanAdd, device, "primitive_scan_add.comp");
+    createPrimitiveKernel<GpuCompactPushConstants>(primitives.compact, device, "primitive_compact.comp");
+    createPrimitiveKernel<GpuSortSetupPushConstants>(primitives.sortSetup, device, "primitive_sort_setup.comp");
+    createPrimitiveKernel<GpuSortHistogramPushConstants>(
+        primitives.sortHistogram, device, "primitive_sort_histogram.comp");
+    createPrimitiveKernel<GpuSortOnesweepPushConstants>(
+        primitives.sortOnesweep, device, "primitive_sort_onesweep.comp");
+}
+
+//---------------------------------
+// destroyGpuPrimitives()
+//---------------------------------
+void destroyGpuPrimitives(GpuPrimitives& primitives, const VkDevice& device)
+{
+    for (ComputeKernel& kernel : primitives.reduce) {
+        destroyComputeKernel(kernel, device);
+    }
+    destroyComputeKernel(primitives.scan, device);
+    destroyComputeKernel(primitives.scanAdd, device);
+    destroyComputeKernel(primitives.compact, device);
+    destroyComputeKernel(primitives.sortSetup, device);
+    destroyComputeKernel(primitives.sortHistogram, device);
+    destroyComputeKernel(primitives.sortOnesweep, device);
+    primitives = GpuPrimitives{};
+}
+
+//---------------------------------
+// getReduceScratchCount()
+//---------------------------------
+uint64_t getReduceScratchCount(uint32_t count)
+{
+    // One value per block for every level but the last, which writes the result
+    uint64_t scratchCount = 0;
+    for (uint32_t levelCount = getBlockCount(count); levelCount > 1; levelCount = getBlockCount(levelCount)) {
+        scratchCount += levelCount;
+    }
+    return scratchCount;
+}
+
+//---------------------------------
+// getExclusiveScanScratchCount()
+//---------------------------------
+uint64_t getExclusiveScanScratchCount(uint32_t count)
+{
+    // The block sums of every level that spans more than one block
+    uint64_t scratchCount = 0;
+    for (uint32_t blockCount = getBlockCount(count); blockCount > 1; blockCount = getBlockCount(blockCount)) {
+        scratchCount += blockCount;
+    }
+    return scratchCount;
+}
+
+//---------------------------------
+// getCompactScratchCount()
+//---------------------------------
+uint64_t getCompactScratchCount(uint32_t count)
+{
+    // The scanned flags, then the scan's own scratch
+    return uint64_t(count) + getExclusiveScanScratchCount(count);
+}
+
+//---------------------------------
+// getRadixSortScratchCount()
+//---------------------------------
+uint64_t getRadixSortScratchCount(uint32_t maxCount, bool hasValues)
+{
+    return getRadixSortScratchLayout(GpuArray{}, maxCount, hasValues).elementCount;
+}
+
+//---------------------------------
+// recordReduce()
+//---------------------------------
+void recordReduce(
+    ComputeRecorder& recorder,
+    const GpuPrimitives& primitives,
+    GpuReduceOp op,
+    const GpuArray& source,
+    const GpuArray& result,
+    uint32_t count,
+    const GpuArray& scratch)
+{
+    if (count == 0) {
+        throw std::runtime_error("recordReduce() Nothing to reduce!");
+    }
+
+    GpuArray levelSource = source;
+    GpuArray levelScratch = scratch;
+    uint32_t levelCount = count;
+    while (true) {
+        const uint32_t blockCount = getWorkgroupCount(primitives, levelCount, "recordReduce()");
+        const GpuArray& destination = blockCount == 1 ? result : levelScratch;
+
+        GpuReducePushConstants pushConstants;
+        pushConstants.source = levelSource.data;
+        pushConstants.destination = destination.data;
+        pushConstants.count = levelCount;
+        recordComputeDispatch(
+            recorder, primitives.reduce[op], &pushConstants, blockCount, 1, 1,
+            {levelSource.buffer}, {destination.buffer});
+
+        if (blockCount == 1) {
+            return;
+        }
+        levelSource = levelScratch;
+        levelScratch = getGpuSubArray(levelScratch, blockCount);
+        levelCount = blockCount;
+    }
+}
+
+//---------------------------------
+// recordExclusiveScan()
+//---------------------------------
+// Scans each block and writes its total, scans the totals in place (recursing while they span
+// more than one block), then adds each block's scanned total to its elements
+void recordExclusiveScan(
+    ComputeRecorder& recorder,
+    const GpuPrimitives& primitives,
+    const GpuArray& source,
+    const GpuArray& destination,
+    uint32_t count,
+    const GpuArray& scratch)
+{
+    if (count == 0) {
+        return;
+    }
+
+    const uint32_t blockCount = getWorkgroupCount(primitives, count, "recordExclusiveScan()");
+    const GpuArray& blockSums = scratch;
+
+    GpuScanPushConstants scanConstants;
+    scanConstants.source = source.data;
+    scanConstants.destination = destination.data;
+    scanConstants.blockSums = blockSums.data;
+    scanConstants.count = count;
+    scanConstants.writeBlockSums = blockCount > 1 ? 1 : 0;
+    if (blockCount == 1) {
+        recordComputeDispatch(
+            recorder, primitives.scan, &scanConstants, 1, 1, 1, {source.buffer}, {destination.buffer});
+        return;
+    }
+    recordComputeDispatch(
+        recorder, primitives.scan, &scanConstants, blockCount, 1, 1,
+        {source.buffer}, {destination.buffer, blockSums.buffer});
+
+    recordExclusiveScan(recorder, primitives, blockSums, blockSums, blockCount, getGpuSubArray(scratch, blockCount));
+
+    GpuScanAddPushConstants addConstants;
+    addConstants.data = destination.data;
+    addConstants.blockOffsets = blockSums.data;
+    addConstants.count = count;
+    recordComputeDispatch(
+        recorder, primitives.scanAdd, &addConstants, blockCount, 1, 1,
+        {destination.buffer, blockSums.buffer}, {destination.buffer});
+}
+
+//---------------------------------
+// recordCompact()
+//---------------------------------
+void recordCompact(
+    ComputeRecorder& recorder,
+    const GpuPrimitives& primitives,
+    const GpuArray& source,
+    const GpuArray& flags,
+    const GpuArray& destination,
+    const GpuArray& destinationCount,
+    uint32_t count,
+    const GpuArray& scratch)
+{
+    if (count == 0) {
+        throw std::runtime_error("recordCompact() Nothing to compact!");
+    }
+
+    const GpuArray& offsets = scratch;
+    recordExclusiveScan(recorder, primitives, flags, offsets, count, getGpuSubArray(scratch, count));
+
+    GpuCompactPushConstants pushConstants;
+    pushConstants.source = source.data;
+    pushConstants.flags = flags.data;
+    pushConstants.offsets = offsets.data;
+    pushConstants.destination = destination.data;
+    pushConstants.destinationCount = destinationCount.data;
+    pushConstants.count = count;
+    recordComputeDispatch(
+        recorder, primitives.compact, &pushConstants,
+        getWorkgroupCount(primitives, count, "recordCompact()"), 1, 1,
+        {source.buffer, flags.buffer, offsets.buffer}, {destination.buffer, destinationCount.buffer});
+}
+
+//---------------------------------
+// recordRadixSort()
+//---------------------------------
+void recordRadixSort(
+    ComputeRecorder& recorder,
+    const GpuPrimitives& primitives,
+    const GpuArray& keys,
+    const GpuArray& values,
+    uint32_t count,
+    const GpuArray& scratch)
+{
+    recordOnesweepSort(recorder, primitives, keys, values, count, GpuArray{}, count, scratch);
+}
+
+//---------------------------------
+// recordRadixSortIndirect()
+//---------------------------------
+void recordRadixSortIndirect(
+    ComputeRecorder& recorder,
+    const GpuPrimitives& primitives,
+    const GpuArray& keys,
+    const GpuArray& values,
+    const GpuArray& countSource,
+    uint32_t maxCount,
+    const GpuArray& scratch)
+{
+    recordOnesweepSort(recorder, primitives, keys, values, 0, countSource, maxCount, scratch);
+}
@@ -0,0 +1,237 @@
+#include "gpu_primitives_benchmark.h"
+#include "vulkan_utils.h"
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+struct BenchmarkBuffer
+{
+    VkBuffer buffer{nullptr};
+    VkDeviceMemory memory{nullptr};
+};
+
+void destroyBenchmarkBuffer(BenchmarkBuffer& buffer, const VkDevice& device)
+{
+    vkDestroyBuffer(device, buffer.buffer, nullptr);
+    vkFreeMemory(device, buffer.memory, nullptr);
+    buffer = BenchmarkBuffer{};
+}
+
+void recordCopyBuffer(
+    VkCommandBuffer commandBuffer,
+    VkBuffer source,
+    VkBuffer destination,
+    VkDeviceSize destinationOffset,
+    VkDeviceSize size)
+{
+    VkBufferCopy region;
+    region.srcOffset = 0;
+    region.dstOffset = destinationOffset;
+    region.size = size;
+    vkCmdCopyBuffer(commandBuffer, source, destination, 1, &region);
+}
+
+void recordMemoryBarrier(
+    VkCommandBuffer commandBuffer,
+    VkPipelineStageFlags srcStage,
+    VkAccessFlags srcAccess,
+    VkPipelineStageFlags dstStage,
+    VkAccessFlags dstAccess)
+{
+    VkMemoryBarrier barrier;
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.pNext = nullptr;
+    barrier.srcAccessMask = srcAccess;
+    barrier.dstAccessMask = dstAccess;
+    vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+uint64_t getTimestampMask(const VkPhysicalDevice& physicalDevice, uint32_t queueFamily)
+{
+    uint32_t familyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> families(familyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, families.data());
+
+    const uint32_t validBits = families[queueFamily].timestampValidBits;
+    if (validBits == 0) {
+        throw std::runtime_error("benchmarkRadixSort() The queue family has no timestamp support!");
+    }
+    return validBits >= 64 ? UINT64_MAX : (uint64_t(1) << validBits) - 1;
+}
+} // namespace
+
+//---------------------------------
+// benchmarkRadixSort()
+//---------------------------------
+RadixSortBenchmarkResult benchmarkRadixSort(
+    const VkDevice& device,
+    const VkPhysicalDevice& physicalDevice,
+    const VkCommandPool& commandPool,
+    const VkQueue& queue,
+    uint32_t queueFamily,
+    const GpuPrimitives& primitives,
+    uint32_t keyCount,
+    uint32_t iterationCount)
+{
+    if (keyCount == 0 || iterationCount == 0) {
+        throw std::runtime_error("benchmarkRadixSort() Nothing to benchmark!");
+    }
+
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+    const uint64_t timestampMask = getTimestampMask(physicalDevice, queueFamily);
+
+    // Keys repeat, so stability is exercised as well
+    std::vector<uint32_t> sourceKeys(keyCount);
+    std::mt19937 random(1234);
+    std::uniform_int_distribution<uint32_t> distribution;
+    for (uint32_t& key : sourceKeys) {
+        key = distribution(random) % (keyCount / 2 + 1) * 2654435761u;
+    }
+    std::vector<uint32_t> sourceValues(keyCount);
+    std::iota(sourceValues.begin(), sourceValues.end(), 0);
+
+    // The sort runs in place, so every iteration starts by copying the input over
+    const VkDeviceSize arraySize = VkDeviceSize(keyCount) * sizeof(uint32_t);
+    BenchmarkBuffer keysSource, valuesSource, keys, values, scratch, readback;
+    createDeviceLocalBuffer(
+        device, physicalDevice, commandPool, queue, sourceKeys.data(), arraySize,
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT, {}, keysSource.buffer, keysSource.memory);
+    createDeviceLocalBuffer(
+        device, physicalDevice, commandPool, queue, sourceValues.data(), arraySize,
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT, {}, valuesSource.buffer, valuesSource.memory);
+
+    const VkBufferUsageFlags arrayUsage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT
+        | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT
+        | VK_BUFFER_USAGE_TRANSFER_SRC_BIT
+        | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    createBuffer(
+        device, physicalDevice, arraySize, arrayUsage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, {},
+        keys.buffer, keys.memory);
+    createBuffer(
+        device, physicalDevice, arraySize, arrayUsage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, {},
+        values.buffer, values.memory);
+    createBuffer(
+        device,
+        physicalDevice,
+        getRadixSortScratchCount(keyCount, true) * sizeof(uint32_t),
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT
+            | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        {},
+        scratch.buffer,
+        scratch.memory);
+    createBuffer(
+        device,
+        physicalDevice,
+        arraySize * 2,
+        VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        {},
+        readback.buffer,
+        readback.memory);
+
+    const GpuArray keysArray = getGpuArray(device, keys.buffer);
+    const GpuArray valuesArray = getGpuArray(device, values.buffer);
+    const GpuArray scratchArray = getGpuArray(device, scratch.buffer);
+
+    VkQueryPoolCreateInfo queryPoolInfo;
+    queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolInfo.pNext = nullptr;
+    queryPoolInfo.flags = 0;
+    queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryPoolInfo.queryCount = 2;
+    queryPoolInfo.pipelineStatistics = 0;
+
+    VkQueryPool queryPool;
+    if (vkCreateQueryPool(device, &queryPoolInfo, nullptr, &queryPool) != VK_SUCCESS) {
+        throw std::runtime_error("benchmarkRadixSort() Failed to create query pool!");
+    }
+
+    std::vector<double> milliseconds;
+    for (uint32_t iteration = 0; iteration < iterationCount; iteration++) {
+        const bool lastIteration = iteration + 1 == iterationCount;
+        VkCommandBuffer commandBuffer = beginSingleTimeCommands(device, commandPool);
+        vkCmdResetQueryPool(commandBuffer, queryPool, 0, 2);
+
+        recordCopyBuffer(commandBuffer, keysSource.buffer, keys.buffer, 0, arraySize);
+        recordCopyBuffer(commandBuffer, valuesSource.buffer, values.buffer, 0, arraySize);
+        recordMemoryBarrier(
+            commandBuffer,
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_ACCESS_TRANSFER_WRITE_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+        // Bottom of pipe: written once every earlier command, the copies included, is done
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, 0);
+        ComputeRecorder recorder;
+        beginComputeRecording(recorder, commandBuffer);
+        recordRadixSort(recorder, primitives, keysArray, valuesArray, keyCount, scratchArray);
+        // The readback copies, or the next iteration's uploads
+        endComputeRecording(
+            recorder, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT);
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, 1);
+
+        if (lastIteration) {
+            recordCopyBuffer(commandBuffer, keys.buffer, readback.buffer, 0, arraySize);
+            recordCopyBuffer(commandBuffer, values.buffer, readback.buffer, arraySize, arraySize);
+            recordMemoryBarrier(
+                commandBuffer,
+                VK_PIPELINE_STAGE_TRANSFER_BIT,
+                VK_ACCESS_TRANSFER_WRITE_BIT,
+                VK_PIPELINE_STAGE_HOST_BIT,
+                VK_ACCESS_HOST_READ_BIT);
+        }
+        endSingleTimeCommands(device, commandPool, queue, commandBuffer);
+
+        uint64_t timestamps[2];
+        if (vkGetQueryPoolResults(
+                device, queryPool, 0, 2, sizeof(timestamps), timestamps, sizeof(uint64_t),
+                VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT) != VK_SUCCESS) {
+            throw std::runtime_error("benchmarkRadixSort() Failed to read timestamps!");
+        }
+        const uint64_t ticks = (timestamps[1] - timestamps[0]) & timestampMask;
+        milliseconds.push_back(double(ticks) * deviceProperties.limits.timestampPeriod * 1e-6);
+    }
+
+    RadixSortBenchmarkResult result;
+    result.keyCount = keyCount;
+    result.iterationCount = iterationCount;
+
+    std::sort(milliseconds.begin(), milliseconds.end());
+    result.bestMilliseconds = milliseconds.front();
+    result.medianMilliseconds = milliseconds[milliseconds.size() / 2];
+    result.keysPerSecond = result.medianMilliseconds > 0.0 ? keyCount / (result.medianMilliseconds * 1e-3) : 0.0;
+
+    // Sorted keys, each value pointing at its key, and equal keys in input order
+    void* mapped;
+    vkMapMemory(device, readback.memory, 0, arraySize * 2, 0, &mapped);
+    const uint32_t* sortedKeys = static_cast<const uint32_t*>(mapped);
+    const uint32_t* sortedValues = sortedKeys + keyCount;
+    result.sorted = true;
+    for (uint32_t i = 0; i < keyCount && result.sorted; i++) {
+        const uint32_t value = sortedValues[i];
+        result.sorted = value < keyCount && sourceKeys[value] == sortedKeys[i];
+        if (i > 0) {
+            result.sorted = result.sorted
+                && (sortedKeys[i - 1] < sortedKeys[i]
+                    || (sortedKeys[i - 1] == sortedKeys[i] && sortedValues[i - 1] < value));
+        }
+    }
+    vkUnmapMemory(device, readback.memory);
+
+    vkDestroyQueryPool(device, queryPool, nullptr);
+    destroyBenchmarkBuffer(readback, device);
+    destroyBenchmarkBuffer(scratch, device);
+    destroyBenchmarkBuffer(values, device);
+    destroyBenchmarkBuffer(keys, device);
+    destroyBenchmarkBuffer(valuesSource, device);
+    destroyBenchmarkBuffer(keysSource, device);
+    return result;
+}
@@ -0,0 +1,636 @@
+#include "gpu_scene.h"
+#include "mesh_importer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+const uint32_t CULL_WORKGROUP_SIZE = 64; // local_size_x in cull.comp
+
+VkPipeline createCullPipeline(
+    const VkDevice& device,
+    const VkPipelineLayout& pipelineLayout,
+    const VkShaderModule& shaderModule,
+    bool compactDraws)
+{
+    // constant_id = 0 is COMPACT_DRAWS
+    VkBool32 compactDrawsValue = compactDraws ? VK_TRUE : VK_FALSE;
+
+    VkSpecializationMapEntry specializationEntry;
+    specializationEntry.constantID = 0;
+    specializationEntry.offset = 0;
+    specializationEntry.size = sizeof(VkBool32);
+
+    VkSpecializationInfo specializationInfo;
+    specializationInfo.mapEntryCount = 1;
+    specializationInfo.pMapEntries = &specializationEntry;
+    specializationInfo.dataSize = sizeof(VkBool32);
+    specializationInfo.pData = &compactDrawsValue;
+
+    VkComputePipelineCreateInfo pipelineInfo;
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.pNext = nullptr;
+    pipelineInfo.flags = 0;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.pNext = nullptr;
+    pipelineInfo.stage.flags = 0;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = shaderModule;
+    pipelineInfo.stage.pName = "main";
+    pipelineInfo.stage.pSpecializationInfo = &specializationInfo;
+    pipelineInfo.layout = pipelineLayout;
+    pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+    pipelineInfo.basePipelineIndex = -1;
+
+    VkPipeline pipeline;
+    if (vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
+        throw std::runtime_error("createGpuScene() Failed to create cull pipeline!");
+    }
+    return pipeline;
+}
+
+VkDescriptorBufferInfo wholeBuffer(VkBuffer buffer)
+{
+    VkDescriptorBufferInfo bufferInfo;
+    bufferInfo.buffer = buffer;
+    bufferInfo.offset = 0;
+    bufferInfo.range = VK_WHOLE_SIZE;
+    return bufferInfo;
+}
+} // namespace
+
+//---------------------------------
+// createSceneDescriptorSetLayout()
+//---------------------------------
+VkDescriptorSetLayout createSceneDescriptorSetLayout(const VkDevice& device, bool meshShaders)
+{
+    const VkShaderStageFlags meshletStages
+        = meshShaders ? VK_SHADER_STAGE_TASK_BIT_EXT | VK_SHADER_STAGE_MESH_BIT_EXT : 0;
+
+    VkDescriptorSetLayoutBinding bindings[6];
+    bindings[0].binding = SCENE_BINDING_OBJECTS;
+    bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    bindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT | meshletStages;
+
+    bindings[1].binding = SCENE_BINDING_DRAW_COMMANDS;
+    bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    bindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+    bindings[2].binding = SCENE_BINDING_DRAW_COUNT;
+    bindings[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    bindings[2].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+    bindings[3].binding = SCENE_BINDING_CULL_DATA;
+    bindings[3].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    bindings[3].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT | (meshShaders ? VK_SHADER_STAGE_TASK_BIT_EXT : 0);
+
+    bindings[4].binding = SCENE_BINDING_VISIBILITY;
+    bindings[4].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    bindings[4].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+    bindings[5].binding = SCENE_BINDING_DEPTH_PYRAMID;
+    bindings[5].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    bindings[5].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+    for (VkDescriptorSetLayoutBinding& binding : bindings) {
+        binding.descriptorCount = 1;
+        binding.pImmutableSamplers = nullptr;
+    }
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo;
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.pNext = nullptr;
+    layoutInfo.flags = 0;
+    layoutInfo.bindingCount = 6;
+    layoutInfo.pBindings = bindings;
+
+    VkDescriptorSetLayout setLayout;
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &setLayout) != VK_SUCCESS) {
+        throw std::runtime_error("createSceneDescriptorSetLayout() Failed to create descriptor set layout!");
+    }
+    return setLayout;
+}
+
+//---------------------------------
+// createGpuScene()
+//---------------------------------
+void createGpuScene(
+    GpuScene& scene,
+    const VkDevice& device,
+    const VkPhysicalDevice& physicalDevice,
+    const DeviceFeatureChain& enabledFeatures,
+    const QueueFamilyIndices& queueFamilies,
+    const VkCommandPool& transferCommandPool,
+    const VkQueue& transferQueue,
+    const VkDescriptorSetLayout& sceneSetLayout,
+    const UniformRing& uniformRing,
+    const DepthPyramid& depthPyramid,
+    VkShaderModule cullShaderModule,
+    const std::vector<GpuObjectData>& objects,
+    const std::vector<uint32_t>& indices)
+{
+    if (objects.empty() || indices.empty()) {
+        throw std::runtime_error("createGpuScene() Scene has no objects!");
+    }
+
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+
+    scene.objectCount = static_cast<uint32_t>(objects.size());
+    scene.maxDrawCount = std::min(scene.objectCount, deviceProperties.limits.maxDrawIndirectCount);
+    scene.compactDraws = enabledFeatures.vulkan12.drawIndirectCount == VK_TRUE;
+    scene.multiDrawIndirect = enabledFeatures.features2.features.multiDrawIndirect == VK_TRUE;
+    scene.cullShaderModule = cullShaderModule;
+    scene.pyramidWidth = depthPyramid.width;
+    scene.pyramidHeight = depthPyramid.height;
+    scene.pyramidMipCount = depthPyramid.mipCount;
+
+    // Static data is uploaded on the transfer queue and read on the graphics queue;
+    // createBuffer() makes it concurrent when those are different families
+    std::vector<uint32_t> uploadFamilies = {queueFamilies.graphicsFamily.value(), queueFamilies.transferFamily.value()};
+
+    createDeviceLocalBuffer(
+        device,
+        physicalDevice,
+        transferCommandPool,
+        transferQueue,
+        indices.data(),
+        sizeof(uint32_t) * indices.size(),
+        VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+        uploadFamilies,
+        scene.indexBuffer,
+        scene.indexBufferMemory);
+
+    createDeviceLocalBuffer(
+        device,
+        physicalDevice,
+        transferCommandPool,
+        transferQueue,
+        objects.data(),
+        sizeof(GpuObjectData) * objects.size(),
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+        uploadFamilies,
+        scene.objectBuffer,
+        scene.objectBufferMemory);
+    scene.objects = getDevicePointer<GpuObjectData>(device, scene.objectBuffer);
+
+    // Nothing was visible "last frame", so the first early pass draws nothing and the first
+    // late pass, testing against an empty pyramid, draws everything in the frustum
+    std::vector<uint32_t> initialVisibility(objects.size(), 0);
+    createDeviceLocalBuffer(
+        device,
+        physicalDevice,
+        transferCommandPool,
+        transferQueue,
+        initialVisibility.data(),
+        sizeof(uint32_t) * initialVisibility.size(),
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        uploadFamilies,
+        scene.visibilityBuffer,
+        scene.visibilityBufferMemory);
+
+    std::vector<uint32_t> identityInstances(objects.size());
+    for (uint32_t i = 0; i < scene.objectCount; i++) {
+        identityInstances[i] = i;
+    }
+    createDeviceLocalBuffer(
+        device,
+        physicalDevice,
+        transferCommandPool,
+        transferQueue,
+        identityInstances.data(),
+        sizeof(uint32_t) * identityInstances.size(),
+        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+        uploadFamilies,
+        scene.identityInstanceBuffer,
+        scene.identityInstanceBufferMemory);
+
+    // Every object is drawn at most once, so objectCount instances always fit
+    createBuffer(
+        device,
+        physicalDevice,
+        sizeof(uint32_t) * objects.size(),
+        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        {},
+        scene.instanceBuffer,
+        scene.instanceBufferMemory);
+    vkMapMemory(
+        device, scene.instanceBufferMemory, 0, sizeof(uint32_t) * objects.size(), 0, &scene.instanceObjectsMapped);
+
+    createBuffer(
+        device,
+        physicalDevice,
+        sizeof(VkDrawIndexedIndirectCommand) * objects.size() * CULL_PASS_COUNT,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        {},
+        scene.drawCommandBuffer,
+        scene.drawCommandBufferMemory);
+
+    createBuffer(
+        device,
+        physicalDevice,
+        sizeof(uint32_t) * CULL_PASS_COUNT,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        {},
+        scene.drawCountBuffer,
+        scene.drawCountBufferMemory);
+
+    VkDescriptorPoolSize poolSizes[3];
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSizes[0].descriptorCount = 4;
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    poolSizes[1].descriptorCount = 1;
+    poolSizes[2].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    poolSizes[2].descriptorCount = 1;
+
+    VkDescriptorPoolCreateInfo poolInfo;
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.pNext = nullptr;
+    poolInfo.flags = 0;
+    poolInfo.maxSets = 1;
+    poolInfo.poolSizeCount = 3;
+    poolInfo.pPoolSizes = poolSizes;
+
+    if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &scene.descriptorPool) != VK_SUCCESS) {
+        throw std::runtime_error("createGpuScene() Failed to create descriptor pool!");
+    }
+
+    VkDescriptorSetAllocateInfo allocateInfo;
+    allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocateInfo.pNext = nullptr;
+    allocateInfo.descriptorPool = scene.descriptorPool;
+    allocateInfo.descriptorSetCount = 1;
+    allocateInfo.pSetLayouts = &sceneSetLayout;
+
+    if (vkAllocateDescriptorSets(device, &allocateInfo, &scene.descriptorSet) != VK_SUCCESS) {
+        throw std::runtime_error("createGpuScene() Failed to allocate descriptor set!");
+    }
+
+    VkDescriptorBufferInfo bufferInfos[5] = {
+        wholeBuffer(scene.objectBuffer),
+        wholeBuffer(scene.drawCommandBuffer),
+        wholeBuffer(scene.drawCountBuffer),
+        getUniformRingDescriptor(uniformRing, sizeof(CullUniforms)),
+        wholeBuffer(scene.visibilityBuffer)};
+    uint32_t bufferBindings[5] = {
+        SCENE_BINDING_OBJECTS,
+        SCENE_BINDING_DRAW_COMMANDS,
+        SCENE_BINDING_DRAW_COUNT,
+        SCENE_BINDING_CULL_DATA,
+        SCENE_BINDING_VISIBILITY};
+
+    VkDescriptorImageInfo pyramidInfo;
+    pyramidInfo.sampler = depthPyramid.sampler;
+    pyramidInfo.imageView = depthPyramid.view;
+    pyramidInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+    VkWriteDescriptorSet writes[6];
+    for (uint32_t i = 0; i < 6; i++) {
+        writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[i].pNext = nullptr;
+        writes[i].dstSet = scene.descriptorSet;
+        writes[i].dstArrayElement = 0;
+        writes[i].descriptorCount = 1;
+        writes[i].pImageInfo = nullptr;
+        writes[i].pBufferInfo = nullptr;
+        writes[i].pTexelBufferView = nullptr;
+    }
+    for (uint32_t i = 0; i < 5; i++) {
+        writes[i].dstBinding = bufferBindings[i];
+        writes[i].descriptorType = bufferBindings[i] == SCENE_BINDING_CULL_DATA
+            ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC
+            : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writes[i].pBufferInfo = &bufferInfos[i];
+    }
+    writes[5].dstBinding = SCENE_BINDING_DEPTH_PYRAMID;
+    writes[5].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    writes[5].pImageInfo = &pyramidInfo;
+    vkUpdateDescriptorSets(device, 6, writes, 0, nullptr);
+
+    VkPushConstantRange pushConstantRange;
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(CullPushConstants);
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo;
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.pNext = nullptr;
+    pipelineLayoutInfo.flags = 0;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &sceneSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &scene.cullPipelineLayout) != VK_SUCCESS) {
+        throw std::runtime_error("createGpuScene() Failed to create cull pipeline layout!");
+    }
+
+    scene.cullPipeline = createCullPipeline(device, scene.cullPipelineLayout, cullShaderModule, scene.compactDraws);
+}
+
+//---------------------------------
+// updateGpuSceneCamera()
+//---------------------------------
+void updateGpuSceneCamera(
+    GpuScene& scene,
+    UniformRing& uniformRing,
+    const glm::mat4& viewProjection,
+    const glm::vec4& cameraPosition)
+{
+    Frustum frustum = extractFrustum(viewProjection);
+
+    CullUniforms uniforms;
+    uniforms.viewProjection = viewProjection;
+    for (uint32_t i = 0; i < 6; i++) {
+        uniforms.frustumPlanes[i] = frustum.planes[i];
+    }
+    uniforms.cameraPosition = cameraPosition;
+    uniforms.objectCount = scene.objectCount;
+    uniforms.pyramidWidth = scene.pyramidWidth;
+    uniforms.pyramidHeight = scene.pyramidHeight;
+    uniforms.pyramidMipCount = scene.pyramidMipCount;
+
+    scene.cullUniformsOffset = pushUniforms(uniformRing, &uniforms, sizeof(CullUniforms));
+}
+
+//---------------------------------
+// updateGpuSceneInstances()
+//---------------------------------
+void updateGpuSceneInstances(GpuScene& scene, const std::vector<uint32_t>& instanceObjects)
+{
+    if (instanceObjects.size() > scene.objectCount) {
+        throw std::runtime_error("updateGpuSceneInstances() More instances than scene objects!");
+    }
+    memcpy(scene.instanceObjectsMapped, instanceObjects.data(), sizeof(uint32_t) * instanceObjects.size());
+}
+
+//---------------------------------
+// recordGpuCulling()
+//---------------------------------
+void recordGpuCulling(VkCommandBuffer commandBuffer, const GpuScene& scene, CullPass pass)
+{
+    vkCmdFillBuffer(commandBuffer, scene.drawCountBuffer, sizeof(uint32_t) * pass, sizeof(uint32_t), 0);
+
+    VkMemoryBarrier clearBarrier;
+    clearBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    clearBarrier.pNext = nullptr;
+    clearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    clearBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0,
+        1,
+        &clearBarrier,
+        0,
+        nullptr,
+        0,
+        nullptr);
+
+    CullPushConstants pushConstants;
+    pushConstants.pass = pass;
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, scene.cullPipeline);
+    vkCmdBindDescriptorSets(
+        commandBuffer,
+        VK_PIPELINE_BIND_POINT_COMPUTE,
+        scene.cullPipelineLayout,
+        0,
+        1,
+        &scene.descriptorSet,
+        1,
+        &scene.cullUniformsOffset);
+    vkCmdPushConstants(
+        commandBuffer, scene.cullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullPushConstants), &pushConstants);
+    vkCmdDispatch(commandBuffer, (scene.objectCount + CULL_WORKGROUP_SIZE - 1) / CULL_WORKGROUP_SIZE, 1, 1);
+
+    // The early pass's visibility reads must also finish before the late pass rewrites them;
+    // the compute -> compute part of this barrier covers that
+    VkMemoryBarrier cullBarrier;
+    cullBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    cullBarrier.pNext = nullptr;
+    cullBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    cullBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0,
+        1,
+        &cullBarrier,
+        0,
+        nullptr,
+        0,
+        nullptr);
+}
+
+//---------------------------------
+// recordGpuSceneDraws()
+//---------------------------------
+void recordGpuSceneDraws(
+    VkCommandBuffer commandBuffer,
+    const GpuScene& scene,
+    const VkPipelineLayout& pipelineLayout,
+    CullPass pass)
+{
+    const uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+    const VkDeviceSize commandOffset = static_cast<VkDeviceSize>(stride) * scene.objectCount * pass;
+
+    vkCmdBindDescriptorSets(
+        commandBuffer,
+        VK_PIPELINE_BIND_POINT_GRAPHICS,
+        pipelineLayout,
+        0,
+        1,
+        &scene.descriptorSet,
+        1,
+        &scene.cullUniformsOffset);
+    vkCmdBindIndexBuffer(commandBuffer, scene.indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+    VkDeviceSize instanceOffset = 0;
+    vkCmdBindVertexBuffers(commandBuffer, 0, 1, &scene.identityInstanceBuffer, &instanceOffset);
+
+    if (scene.compactDraws) {
+        vkCmdDrawIndexedIndirectCount(
+            commandBuffer,
+            scene.drawCommandBuffer,
+            commandOffset,
+            scene.drawCountBuffer,
+            sizeof(uint32_t) * pass,
+            scene.maxDrawCount,
+            stride);
+        return;
+    }
+
+    // Fallback: one slot per object, culled ones are zero-instance draws. Without
+    // multiDrawIndirect each indirect call may only read a single command.
+    uint32_t batchSize = scene.multiDrawIndirect ? scene.maxDrawCount : 1;
+    for (uint32_t first = 0; first < scene.objectCount; first += batchSize) {
+        uint32_t drawCount = std::min(batchSize, scene.objectCount - first);
+        vkCmdDrawIndexedIndirect(
+            commandBuffer, scene.drawCommandBuffer, commandOffset + first * stride, drawCount, stride);
+    }
+}
+
+//---------------------------------
+// recordDrawPushConstants()
+//---------------------------------
+void recordDrawPushConstants(
+    VkCommandBuffer commandBuffer,
+    const GpuScene& scene,
+    const VkPipelineLayout& pipelineLayout,
+    uint32_t objectIndex,
+    uint32_t materialIndex)
+{
+    DrawPushConstants pushConstants;
+    pushConstants.objects = scene.objects;
+    pushConstants.objectIndex = objectIndex;
+    pushConstants.materialIndex = materialIndex;
+
+    vkCmdPushConstants(
+        commandBuffer,
+        pipelineLayout,
+        VK_SHADER_STAGE_VERTEX_BIT,
+        0,
+        sizeof(DrawPushConstants),
+        &pushConstants);
+}
+
+//---------------------------------
+// recordInstancedSceneDraws()
+//---------------------------------
+void recordInstancedSceneDraws(
+    VkCommandBuffer commandBuffer,
+    const GpuScene& scene,
+    const VkPipelineLayout& pipelineLayout,
+    const std::vector<VkPipeline>& pipelines,
+    const std::vector<MeshRange>& meshes,
+    const std::vector<DrawBatch>& batches,
+    const std::vector<uint32_t>& instanceObjects)
+{
+    vkCmdBindDescriptorSets(
+        commandBuffer,
+        VK_PIPELINE_BIND_POINT_GRAPHICS,
+        pipelineLayout,
+        0,
+        1,
+        &scene.descriptorSet,
+        1,
+        &scene.cullUniformsOffset);
+    vkCmdBindIndexBuffer(commandBuffer, scene.indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+    VkDeviceSize instanceOffset = 0;
+    vkCmdBindVertexBuffers(commandBuffer, 0, 1, &scene.instanceBuffer, &instanceOffset);
+
+    // The scene set, index buffer and instance stream are shared by every batch and bound once
+    // above. Batches come out of the sort grouped by pipeline, so this only rebinds when the
+    // pipeline actually changes.
+    VkPipeline boundPipeline = VK_NULL_HANDLE;
+    for (const DrawBatch& batch : batches) {
+        if (pipelines[batch.pipeline] != boundPipeline) {
+            boundPipeline = pipelines[batch.pipeline];
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, boundPipeline);
+        }
+        // A lone object goes straight through the push constants instead of the instance stream
+        uint32_t objectIndex
+            = batch.instanceCount == 1 ? instanceObjects[batch.firstInstance] : DRAW_OBJECT_FROM_INSTANCE;
+        recordDrawPushConstants(commandBuffer, scene, pipelineLayout, objectIndex, batch.material);
+
+        const MeshRange& mesh = meshes[batch.mesh];
+        vkCmdDrawIndexed(
+            commandBuffer, mesh.indexCount, batch.instanceCount, mesh.firstIndex, mesh.vertexOffset, batch.firstInstance);
+    }
+}
+
+//---------------------------------
+// destroyGpuScene()
+//---------------------------------
+void destroyGpuScene(GpuScene& scene, const VkDevice& device)
+{
+    vkDestroyPipeline(device, scene.cullPipeline, nullptr);
+    vkDestroyPipelineLayout(device, scene.cullPipelineLayout, nullptr);
+    vkDestroyShaderModule(device, scene.cullShaderModule, nullptr);
+
+    vkDestroyDescriptorPool(device, scene.descriptorPool, nullptr);
+
+    vkUnmapMemory(device, scene.instanceBufferMemory);
+    vkDestroyBuffer(device, scene.instanceBuffer, nullptr);
+    vkFreeMemory(device, scene.instanceBufferMemory, nullptr);
+    vkDestroyBuffer(device, scene.identityInstanceBuffer, nullptr);
+    vkFreeMemory(device, scene.identityInstanceBufferMemory, nullptr);
+    vkDestroyBuffer(device, scene.visibilityBuffer, nullptr);
+    vkFreeMemory(device, scene.visibilityBufferMemory, nullptr);
+    vkDestroyBuffer(device, scene.drawCountBuffer, nullptr);
+    vkFreeMemory(device, scene.drawCountBufferMemory, nullptr);
+    vkDestroyBuffer(device, scene.drawCommandBuffer, nullptr);
+    vkFreeMemory(device, scene.drawCommandBufferMemory, nullptr);
+    vkDestroyBuffer(device, scene.objectBuffer, nullptr);
+    vkFreeMemory(device, scene.objectBufferMemory, nullptr);
+    vkDestroyBuffer(device, scene.indexBuffer, nullptr);
+    vkFreeMemory(device, scene.indexBufferMemory, nullptr);
+
+    scene = GpuScene{};
+}
+
+//---------------------------------
+// createGpuMesh()
+//---------------------------------
+void createGpuMesh(
+    GpuMesh& mesh,
+    const VkDevice& device,
+    const VkPhysicalDevice& physicalDevice,
+    const QueueFamilyIndices& queueFamilies,
+    const VkCommandPool& transferCommandPool,
+    const VkQueue& transferQueue,
+    const MeshAsset& asset)
+{
+    if (asset.vertexCount == 0 || asset.indices.empty()) {
+        throw std::runtime_error("createGpuMesh() Mesh asset is empty!");
+    }
+
+    mesh.vertexCount = asset.vertexCount;
+    mesh.indexCount = static_cast<uint32_t>(asset.indices.size());
+    mesh.quantization = computeVertexQuantization(asset);
+
+    std::vector<uint32_t> uploadFamilies = {queueFamilies.graphicsFamily.value(), queueFamilies.transferFamily.value()};
+
+    createDeviceLocalBuffer(
+        device,
+        physicalDevice,
+        transferCommandPool,
+        transferQueue,
+        [&asset, &mesh](void* staging) { writePackedVertices(staging, asset, mesh.quantization); },
+        sizeof(PackedVertex) * mesh.vertexCount,
+        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+        uploadFamilies,
+        mesh.vertexBuffer,
+        mesh.vertexBufferMemory);
+
+    createDeviceLocalBuffer(
+        device,
+        physicalDevice,
+        transferCommandPool,
+        transferQueue,
+        asset.indices.data(),
+        sizeof(uint32_t) * asset.indices.size(),
+        VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+        uploadFamilies,
+        mesh.indexBuffer,
+        mesh.indexBufferMemory);
+}
+
+//---------------------------------
+// destroyGpuMesh()
+//---------------------------------
+void destroyGpuMesh(GpuMesh& mesh, const VkDevice& device)
+{
+    vkDestroyBuffer(device, mesh.indexBuffer, nullptr);
+    vkFreeMemory(device, mesh.indexBufferMemory, nullptr);
+    vkDestroyBuffer(device, mesh.vertexBuffer, nullptr);
+    vkFreeMemory(device, mesh.vertexBufferMemory, nullptr);
+
+    mesh = GpuMesh{};
+}
@@ -0,0 +1,150 @@
+#include "ktx2.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+const uint8_t KTX2_IDENTIFIER[12] = {0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A};
+const size_t KTX2_HEADER_SIZE = 80; // Identifier, header and index
+const size_t KTX2_LEVEL_ENTRY_SIZE = 24;
+
+uint32_t readUint32(const uint8_t* data)
+{
+    uint32_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+uint64_t readUint64(const uint8_t* data)
+{
+    uint64_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+void validateKtx2(const Ktx2File& ktx)
+{
+    uint32_t blockSize = 0;
+    const uint64_t blockBytes = getTextureFormatBlockBytes(ktx.format, blockSize);
+    for (size_t level = 0; level < ktx.levels.size(); level++) {
+        uint64_t levelWidth = std::max(ktx.width >> level, 1u);
+        uint64_t levelHeight = std::max(ktx.height >> level, 1u);
+        uint64_t blocksWide = (levelWidth + blockSize - 1) / blockSize;
+        uint64_t blocksHigh = (levelHeight + blockSize - 1) / blockSize;
+        uint64_t expectedLength = blocksWide * blocksHigh * blockBytes;
+
+        const Ktx2Level& entry = ktx.levels[level];
+        if (entry.byteLength < expectedLength || entry.byteOffset > ktx.file.size
+            || entry.byteLength > ktx.file.size - entry.byteOffset) {
+            throw std::runtime_error("openKtx2File() Mip level data out of range!");
+        }
+    }
+}
+} // namespace
+
+//---------------------------------
+// getTextureFormatBlockBytes()
+//---------------------------------
+uint32_t getTextureFormatBlockBytes(VkFormat format, uint32_t& blockSize)
+{
+    blockSize = 4;
+    switch (format) {
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+    case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+    case VK_FORMAT_BC4_UNORM_BLOCK:
+    case VK_FORMAT_BC4_SNORM_BLOCK:
+        return 8;
+    case VK_FORMAT_BC2_UNORM_BLOCK:
+    case VK_FORMAT_BC2_SRGB_BLOCK:
+    case VK_FORMAT_BC3_UNORM_BLOCK:
+    case VK_FORMAT_BC3_SRGB_BLOCK:
+    case VK_FORMAT_BC5_UNORM_BLOCK:
+    case VK_FORMAT_BC5_SNORM_BLOCK:
+    case VK_FORMAT_BC6H_UFLOAT_BLOCK:
+    case VK_FORMAT_BC6H_SFLOAT_BLOCK:
+    case VK_FORMAT_BC7_UNORM_BLOCK:
+    case VK_FORMAT_BC7_SRGB_BLOCK:
+        return 16;
+    case VK_FORMAT_R8G8B8A8_UNORM:
+    case VK_FORMAT_R8G8B8A8_SRGB:
+        blockSize = 1;
+        return 4;
+    default:
+        blockSize = 0;
+        return 0;
+    }
+}
+
+//---------------------------------
+// isBlockCompressedFormat()
+//---------------------------------
+bool isBlockCompressedFormat(VkFormat format)
+{
+    uint32_t blockSize = 0;
+    return getTextureFormatBlockBytes(format, blockSize) != 0 && blockSize == 4;
+}
+
+//---------------------------------
+// openKtx2File()
+//---------------------------------
+void openKtx2File(Ktx2File& ktx, const std::string& filename)
+{
+    mapFile(ktx.file, filename);
+    try {
+        const uint8_t* data = ktx.file.data;
+        if (ktx.file.size < KTX2_HEADER_SIZE || std::memcmp(data, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0) {
+            throw std::runtime_error("openKtx2File() Not a KTX2 file: " + filename);
+        }
+
+        ktx.format = static_cast<VkFormat>(readUint32(data + 12));
+        ktx.width = readUint32(data + 20);
+        ktx.height = readUint32(data + 24);
+        const uint32_t depth = readUint32(data + 28);
+        const uint32_t layerCount = readUint32(data + 32);
+        const uint32_t faceCount = readUint32(data + 36);
+        const uint32_t levelCount = std::max(readUint32(data + 40), 1u);
+        const uint32_t supercompressionScheme = readUint32(data + 44);
+
+        uint32_t blockSize = 0;
+        if (getTextureFormatBlockBytes(ktx.format, blockSize) == 0) {
+            // Includes VK_FORMAT_UNDEFINED, which KTX2 uses for Basis Universal payloads
+            throw std::runtime_error("openKtx2File() Unsupported texture format in " + filename);
+        }
+        if (ktx.width == 0 || ktx.height == 0 || depth != 0 || layerCount > 1 || faceCount != 1) {
+            throw std::runtime_error("openKtx2File() Only single 2D textures are supported: " + filename);
+        }
+        if (supercompressionScheme != 0) {
+            throw std::runtime_error("openKtx2File() Supercompressed KTX2 is not supported: " + filename);
+        }
+        if (levelCount > 32 || (std::max(ktx.width, ktx.height) >> (levelCount - 1)) == 0) {
+            throw std::runtime_error("openKtx2File() Too many mip levels in " + filename);
+        }
+        if (KTX2_HEADER_SIZE + levelCount * KTX2_LEVEL_ENTRY_SIZE > ktx.file.size) {
+            throw std::runtime_error("openKtx2File() Truncated level index in " + filename);
+        }
+
+        ktx.levels.resize(levelCount);
+        for (uint32_t level = 0; level < levelCount; level++) {
+            const uint8_t* entry = data + KTX2_HEADER_SIZE + level * KTX2_LEVEL_ENTRY_SIZE;
+            ktx.levels[level].byteOffset = readUint64(entry);
+            ktx.levels[level].byteLength = readUint64(entry + 8);
+        }
+        validateKtx2(ktx);
+    }
+    catch (...) {
+        closeKtx2File(ktx);
+        throw;
+    }
+}
+
+//---------------------------------
+// closeKtx2File()
+//---------------------------------
+void closeKtx2File(Ktx2File& ktx)
+{
+    unmapFile(ktx.file);
+    ktx = Ktx2File();
+}
@@ -0,0 +1,106 @@
+#include "mapped_file.h"
+
+#ifdef _WIN32
+    #define WIN32_LEAN_AND_MEAN
+    #define NOMINMAX
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+#include <stdexcept>
+
+//---------------------------------
+// mapFile()
+//---------------------------------
+void mapFile(MappedFile& file, const std::string& filename)
+{
+#ifdef _WIN32
+    HANDLE fileHandle = CreateFileA(
+        filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (fileHandle == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("mapFile() Failed to open file!");
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(fileHandle, &fileSize)) {
+        CloseHandle(fileHandle);
+        throw std::runtime_error("mapFile() Failed to query file size!");
+    }
+
+    file.fileHandle = fileHandle;
+    file.size = static_cast<size_t>(fileSize.QuadPart);
+    if (file.size == 0) {
+        return; // Empty files can't be mapped
+    }
+
+    HANDLE mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    const void* view = mappingHandle != nullptr ? MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (view == nullptr) {
+        if (mappingHandle != nullptr) {
+            CloseHandle(mappingHandle);
+        }
+        CloseHandle(fileHandle);
+        file = MappedFile();
+        throw std::runtime_error("mapFile() Failed to map file!");
+    }
+    file.mappingHandle = mappingHandle;
+    file.data = static_cast<const uint8_t*>(view);
+#else
+    int fileDescriptor = open(filename.c_str(), O_RDONLY);
+    if (fileDescriptor < 0) {
+        throw std::runtime_error("mapFile() Failed to open file!");
+    }
+
+    struct stat fileStatus;
+    if (fstat(fileDescriptor, &fileStatus) != 0) {
+        close(fileDescriptor);
+        throw std::runtime_error("mapFile() Failed to query file size!");
+    }
+
+    file.fileDescriptor = fileDescriptor;
+    file.size = static_cast<size_t>(fileStatus.st_size);
+    if (file.size == 0) {
+        return; // Empty files can't be mapped
+    }
+
+    void* view = mmap(nullptr, file.size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+    if (view == MAP_FAILED) {
+        close(fileDescriptor);
+        file = MappedFile();
+        throw std::runtime_error("mapFile() Failed to map file!");
+    }
+    // Parsers stream through their chunks front to back
+    madvise(view, file.size, MADV_SEQUENTIAL);
+    file.data = static_cast<const uint8_t*>(view);
+#endif
+}
+
+//---------------------------------
+// unmapFile()
+//---------------------------------
+void unmapFile(MappedFile& file)
+{
+#ifdef _WIN32
+    if (file.data != nullptr) {
+        UnmapViewOfFile(file.data);
+    }
+    if (file.mappingHandle != nullptr) {
+        CloseHandle(file.mappingHandle);
+    }
+    if (file.fileHandle != nullptr) {
+        CloseHandle(file.fileHandle);
+    }
+#else
+    if (file.data != nullptr) {
+        munmap(const_cast<uint8_t*>(file.data), file.size);
+    }
+    if (file.fileDescriptor >= 0) {
+        close(file.fileDescriptor);
+    }
+#endif
+    file = MappedFile();
+}
@@ -0,0 +1,156 @@
+#include "mesh_asset.h"
+#include "mesh_optimizer.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+const uint32_t MESH_ASSET_MAGIC = 0x414D4B56; // "VKMA"
+
+// Little-endian on every platform we ship; the file is a cache, not an interchange format
+struct MeshAssetHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t sourceHash;
+    uint32_t flags;
+    uint32_t vertexStride;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+};
+static_assert(sizeof(MeshAssetHeader) == 32, "MeshAssetHeader must have no padding");
+
+void validateMeshAsset(const MeshAsset& asset, const char* error)
+{
+    if (asset.vertexStride < sizeof(glm::vec3)
+        || asset.vertices.size() != static_cast<size_t>(asset.vertexCount) * asset.vertexStride
+        || asset.indices.size() % 3 != 0) {
+        throw std::runtime_error(error);
+    }
+}
+} // namespace
+
+//---------------------------------
+// hashMeshSource()
+//---------------------------------
+uint64_t hashMeshSource(const void* data, size_t size)
+{
+    // FNV-1a, 64-bit
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+//---------------------------------
+// optimizeMeshAsset()
+//---------------------------------
+void optimizeMeshAsset(MeshAsset& asset)
+{
+    validateMeshAsset(asset, "optimizeMeshAsset() Mesh asset layout is inconsistent!");
+
+    // Weld first so the cache optimizer sees the real sharing between triangles
+    std::vector<uint32_t> remap;
+    uint32_t uniqueCount = weldVertices(remap, asset.vertices.data(), asset.vertexCount, asset.vertexStride);
+    std::vector<uint8_t> welded(static_cast<size_t>(uniqueCount) * asset.vertexStride);
+    remapVertices(welded.data(), asset.vertices.data(), asset.vertexCount, asset.vertexStride, remap);
+    remapIndices(asset.indices, remap);
+
+    std::vector<glm::vec3> positions(uniqueCount);
+    for (uint32_t v = 0; v < uniqueCount; v++) {
+        std::memcpy(&positions[v], welded.data() + static_cast<size_t>(v) * asset.vertexStride, sizeof(glm::vec3));
+    }
+
+    std::vector<uint32_t> clusters;
+    optimizeVertexCache(asset.indices, uniqueCount, VERTEX_CACHE_SIZE, &clusters);
+    optimizeOverdraw(asset.indices, positions, clusters, VERTEX_CACHE_SIZE, OVERDRAW_THRESHOLD);
+
+    // Last, since it renumbers vertices to follow the final triangle order
+    uint32_t referencedCount = optimizeVertexFetch(remap, asset.indices, uniqueCount);
+    asset.vertices.assign(static_cast<size_t>(referencedCount) * asset.vertexStride, 0);
+    remapVertices(asset.vertices.data(), welded.data(), uniqueCount, asset.vertexStride, remap);
+
+    asset.vertexCount = referencedCount;
+    asset.flags |= MESH_ASSET_OPTIMIZED_BIT;
+}
+
+//---------------------------------
+// readMeshAssetCache()
+//---------------------------------
+bool readMeshAssetCache(const std::string& filename, uint64_t sourceHash, uint32_t vertexStride, MeshAsset& asset)
+{
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        return false;
+    }
+    const uint64_t fileSize = static_cast<uint64_t>(file.tellg());
+    file.seekg(0);
+
+    MeshAssetHeader header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.magic != MESH_ASSET_MAGIC
+        || header.version != MESH_ASSET_VERSION || header.sourceHash != sourceHash) {
+        return false;
+    }
+
+    // Checked against the file size before allocating, so a corrupt header can't ask for more
+    // memory than the file holds
+    const uint64_t vertexBytes = static_cast<uint64_t>(header.vertexCount) * header.vertexStride;
+    const uint64_t indexBytes = static_cast<uint64_t>(header.indexCount) * sizeof(uint32_t);
+    if (header.vertexStride != vertexStride || header.indexCount % 3 != 0
+        || fileSize != sizeof(header) + vertexBytes + indexBytes) {
+        return false;
+    }
+
+    asset.flags = header.flags;
+    asset.vertexStride = header.vertexStride;
+    asset.vertexCount = header.vertexCount;
+    asset.vertices.resize(vertexBytes);
+    asset.indices.resize(header.indexCount);
+
+    file.read(reinterpret_cast<char*>(asset.vertices.data()), asset.vertices.size());
+    file.read(reinterpret_cast<char*>(asset.indices.data()), asset.indices.size() * sizeof(uint32_t));
+    if (!file) {
+        return false;
+    }
+
+    // The indices go straight into GPU buffers
+    return std::all_of(asset.indices.begin(), asset.indices.end(), [&asset](uint32_t index) {
+        return index < asset.vertexCount;
+    });
+}
+
+//---------------------------------
+// writeMeshAssetCache()
+//---------------------------------
+void writeMeshAssetCache(const std::string& filename, uint64_t sourceHash, const MeshAsset& asset)
+{
+    validateMeshAsset(asset, "writeMeshAssetCache() Mesh asset layout is inconsistent!");
+
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        throw std::runtime_error("writeMeshAssetCache() Failed to open file!");
+    }
+
+    MeshAssetHeader header;
+    header.magic = MESH_ASSET_MAGIC;
+    header.version = MESH_ASSET_VERSION;
+    header.sourceHash = sourceHash;
+    header.flags = asset.flags;
+    header.vertexStride = asset.vertexStride;
+    header.vertexCount = asset.vertexCount;
+    header.indexCount = static_cast<uint32_t>(asset.indices.size());
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(asset.vertices.data()), asset.vertices.size());
+    file.write(reinterpret_cast<const char*>(asset.indices.data()), asset.indices.size() * sizeof(uint32_t));
+
+    if (!file) {
+        throw std::runtime_error("writeMeshAssetCache() Failed to write file!");
+    }
+}
@@ -0,0 +1,1140 @@
+#include "mesh_importer.h"
+#include "mapped_file.h"
+#include "mesh_optimizer.h"
+#include "task_graph.h"
+
+#include <glm/gtc/quaternion.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <string_view>
+
+namespace {
+//---------------------------------
+// Parallel jobs
+//---------------------------------
+void runImportJobs(const std::vector<TaskGraphNode>& jobs, uint32_t workerCount)
+{
+    if (jobs.empty()) {
+        return;
+    }
+    // Jobs write disjoint slices of the asset, so the graph has no edges
+    uint32_t jobCount = static_cast<uint32_t>(std::min<size_t>(jobs.size(), UINT32_MAX));
+    runTaskGraph(jobs, std::max(1u, std::min(workerCount, jobCount)));
+}
+
+void resizeMeshAsset(MeshAsset& asset, size_t vertexCount, size_t indexCount)
+{
+    if (vertexCount >= UINT32_MAX || indexCount >= UINT32_MAX) {
+        throw std::runtime_error("importMesh() Mesh exceeds 32-bit vertex or index counts!");
+    }
+    asset.flags = 0;
+    asset.vertexStride = sizeof(Vertex);
+    asset.vertexCount = static_cast<uint32_t>(vertexCount);
+    asset.vertices.resize(vertexCount * sizeof(Vertex));
+    asset.indices.resize(indexCount);
+}
+
+Vertex* getAssetVertices(MeshAsset& asset, const char* error)
+{
+    if (asset.vertexStride != sizeof(Vertex) || asset.vertices.size() != asset.vertexCount * sizeof(Vertex)) {
+        throw std::runtime_error(error);
+    }
+    return reinterpret_cast<Vertex*>(asset.vertices.data());
+}
+
+const Vertex* getAssetVertices(const MeshAsset& asset, const char* error)
+{
+    return getAssetVertices(const_cast<MeshAsset&>(asset), error);
+}
+
+const glm::vec4 DEFAULT_TANGENT(1.0f, 0.0f, 0.0f, 1.0f);
+
+//---------------------------------
+// JSON, just enough for glTF. Strings are views into the mapped file with escapes left in,
+// which is fine for the keys and enum strings glTF uses.
+//---------------------------------
+struct JsonValue
+{
+    enum Type
+    {
+        JSON_NULL,
+        JSON_BOOL,
+        JSON_NUMBER,
+        JSON_STRING,
+        JSON_ARRAY,
+        JSON_OBJECT,
+    };
+
+    Type type{JSON_NULL};
+    bool boolean{false};
+    double number{0.0};
+    std::string_view string;
+    std::vector<std::string_view> keys; // Objects only, parallel to values
+    std::vector<JsonValue> values;      // Array elements or object members
+
+    const JsonValue* find(std::string_view key) const
+    {
+        for (size_t i = 0; i < keys.size(); i++) {
+            if (keys[i] == key) {
+                return &values[i];
+            }
+        }
+        return nullptr;
+    }
+};
+
+struct JsonParser
+{
+    const char* cursor;
+    const char* end;
+};
+
+const uint32_t JSON_MAX_DEPTH = 64;
+
+[[noreturn]] void throwJsonError()
+{
+    throw std::runtime_error("importMesh() Malformed glTF JSON!");
+}
+
+void skipJsonWhitespace(JsonParser& parser)
+{
+    while (parser.cursor < parser.end
+           && (*parser.cursor == ' ' || *parser.cursor == '\t' || *parser.cursor == '\n' || *parser.cursor == '\r')) {
+        parser.cursor++;
+    }
+}
+
+bool consumeJson(JsonParser& parser, char expected)
+{
+    skipJsonWhitespace(parser);
+    if (parser.cursor < parser.end && *parser.cursor == expected) {
+        parser.cursor++;
+        return true;
+    }
+    return false;
+}
+
+std::string_view parseJsonString(JsonParser& parser)
+{
+    if (!consumeJson(parser, '"')) {
+        throwJsonError();
+    }
+    const char* begin = parser.cursor;
+    while (parser.cursor < parser.end && *parser.cursor != '"') {
+        parser.cursor += *parser.cursor == '\\' ? 2 : 1;
+    }
+    if (parser.cursor >= parser.end) {
+        throwJsonError();
+    }
+    std::string_view string(begin, static_cast<size_t>(parser.cursor - begin));
+    parser.cursor++;
+    return string;
+}
+
+void parseJsonValue(JsonParser& parser, JsonValue& value, uint32_t depth)
+{
+    if (depth > JSON_MAX_DEPTH) {
+        throwJsonError();
+    }
+
+    skipJsonWhitespace(parser);
+    if (parser.cursor >= parser.end) {
+        throwJsonError();
+    }
+
+    auto consumeLiteral = [&parser](std::string_view literal) {
+        if (static_cast<size_t>(parser.end - parser.cursor) < literal.size()
+            || std::memcmp(parser.cursor, literal.data(), literal.size()) != 0) {
+            throwJsonError();
+        }
+        parser.cursor += literal.size();
+    };
+
+    switch (*parser.cursor) {
+    case '{':
+        parser.cursor++;
+        value.type = JsonValue::JSON_OBJECT;
+        if (consumeJson(parser, '}')) {
+            return;
+        }
+        do {
+            value.keys.push_back(parseJsonString(parser));
+            if (!consumeJson(parser, ':')) {
+                throwJsonError();
+            }
+            value.values.emplace_back();
+            parseJsonValue(parser, value.values.back(), depth + 1);
+        } while (consumeJson(parser, ','));
+        if (!consumeJson(parser, '}')) {
+            throwJsonError();
+        }
+        return;
+    case '[':
+        parser.cursor++;
+        value.type = JsonValue::JSON_ARRAY;
+        if (consumeJson(parser, ']')) {
+            return;
+        }
+        do {
+            value.values.emplace_back();
+            parseJsonValue(parser, value.values.back(), depth + 1);
+        } while (consumeJson(parser, ','));
+        if (!consumeJson(parser, ']')) {
+            throwJsonError();
+        }
+        return;
+    case '"':
+        value.type = JsonValue::JSON_STRING;
+        value.string = parseJsonString(parser);
+        return;
+    case 't':
+        consumeLiteral("true");
+        value.type = JsonValue::JSON_BOOL;
+        value.boolean = true;
+        return;
+    case 'f':
+        consumeLiteral("false");
+        value.type = JsonValue::JSON_BOOL;
+        return;
+    case 'n':
+        consumeLiteral("null");
+        return;
+    default: {
+        // from_chars rejects a leading '+', which JSON doesn't allow either
+        std::from_chars_result result = std::from_chars(parser.cursor, parser.end, value.number);
+        if (result.ec != std::errc()) {
+            throwJsonError();
+        }
+        value.type = JsonValue::JSON_NUMBER;
+        parser.cursor = result.ptr;
+        return;
+    }
+    }
+}
+
+const JsonValue& getJsonMember(const JsonValue& object, std::string_view key)
+{
+    const JsonValue* member = object.find(key);
+    if (member == nullptr) {
+        throw std::runtime_error("importMesh() glTF is missing a required property: " + std::string(key));
+    }
+    return *member;
+}
+
+const JsonValue& getJsonElement(const JsonValue& array, int64_t index)
+{
+    if (array.type != JsonValue::JSON_ARRAY || index < 0 || static_cast<size_t>(index) >= array.values.size()) {
+        throw std::runtime_error("importMesh() glTF index out of range!");
+    }
+    return array.values[static_cast<size_t>(index)];
+}
+
+int64_t getJsonInteger(const JsonValue& object, std::string_view key, int64_t fallback)
+{
+    const JsonValue* member = object.find(key);
+    if (member == nullptr) {
+        return fallback;
+    }
+    if (member->type != JsonValue::JSON_NUMBER) {
+        throwJsonError();
+    }
+    return static_cast<int64_t>(member->number);
+}
+
+//---------------------------------
+// glTF
+//---------------------------------
+const uint32_t GLB_MAGIC = 0x46546C67;      // "glTF"
+const uint32_t GLB_CHUNK_JSON = 0x4E4F534A; // "JSON"
+const uint32_t GLB_CHUNK_BIN = 0x004E4942;  // "BIN\0"
+
+const uint32_t GLTF_BYTE = 5120;
+const uint32_t GLTF_UNSIGNED_BYTE = 5121;
+const uint32_t GLTF_SHORT = 5122;
+const uint32_t GLTF_UNSIGNED_SHORT = 5123;
+const uint32_t GLTF_UNSIGNED_INT = 5125;
+const uint32_t GLTF_FLOAT = 5126;
+const int64_t GLTF_MODE_TRIANGLES = 4;
+
+struct GltfAccessor
+{
+    const uint8_t* data{nullptr}; // Null when the primitive lacks the attribute
+    size_t stride{0};
+    uint32_t count{0};
+    uint32_t componentType{0};
+    uint32_t componentCount{0};
+    bool normalized{false};
+};
+
+uint32_t getGltfComponentSize(uint32_t componentType)
+{
+    switch (componentType) {
+    case GLTF_BYTE:
+    case GLTF_UNSIGNED_BYTE:
+        return 1;
+    case GLTF_SHORT:
+    case GLTF_UNSIGNED_SHORT:
+        return 2;
+    case GLTF_UNSIGNED_INT:
+    case GLTF_FLOAT:
+        return 4;
+    default:
+        throw std::runtime_error("importMesh() Unknown glTF component type!");
+    }
+}
+
+uint32_t getGltfComponentCount(std::string_view type)
+{
+    if (type == "SCALAR") {
+        return 1;
+    }
+    if (type.size() == 4 && type.substr(0, 3) == "VEC" && type[3] >= '2' && type[3] <= '4') {
+        return static_cast<uint32_t>(type[3] - '0');
+    }
+    throw std::runtime_error("importMesh() Unsupported glTF accessor type!");
+}
+
+GltfAccessor resolveGltfAccessor(const JsonValue& root, const uint8_t* bin, size_t binSize, int64_t index)
+{
+    const JsonValue& accessor = getJsonElement(getJsonMember(root, "accessors"), index);
+    if (accessor.find("sparse") != nullptr || accessor.find("bufferView") == nullptr) {
+        throw std::runtime_error("importMesh() Sparse and buffer-less glTF accessors are not supported!");
+    }
+
+    const JsonValue& bufferView
+        = getJsonElement(getJsonMember(root, "bufferViews"), getJsonInteger(accessor, "bufferView", -1));
+    if (getJsonInteger(bufferView, "buffer", -1) != 0) {
+        throw std::runtime_error("importMesh() glTF data outside the GLB binary chunk is not supported!");
+    }
+
+    GltfAccessor resolved;
+    resolved.componentType = static_cast<uint32_t>(getJsonInteger(accessor, "componentType", 0));
+    resolved.componentCount = getGltfComponentCount(getJsonMember(accessor, "type").string);
+    resolved.count = static_cast<uint32_t>(getJsonInteger(accessor, "count", 0));
+    const JsonValue* normalized = accessor.find("normalized");
+    resolved.normalized = normalized != nullptr && normalized->boolean;
+
+    const size_t elementSize
+        = static_cast<size_t>(getGltfComponentSize(resolved.componentType)) * resolved.componentCount;
+    const int64_t viewOffset = getJsonInteger(bufferView, "byteOffset", 0);
+    const int64_t viewLength = getJsonInteger(bufferView, "byteLength", -1);
+    const int64_t accessorOffset = getJsonInteger(accessor, "byteOffset", 0);
+    resolved.stride = static_cast<size_t>(getJsonInteger(bufferView, "byteStride", static_cast<int64_t>(elementSize)));
+
+    if (viewOffset < 0 || viewLength < 0 || accessorOffset < 0 || resolved.stride < elementSize
+        || static_cast<uint64_t>(viewOffset) + static_cast<uint64_t>(viewLength) > binSize) {
+        throw std::runtime_error("importMesh() glTF buffer view out of range!");
+    }
+    const uint64_t accessorEnd = static_cast<uint64_t>(accessorOffset)
+        + (resolved.count > 0 ? (resolved.count - 1) * static_cast<uint64_t>(resolved.stride) + elementSize : 0);
+    if (accessorEnd > static_cast<uint64_t>(viewLength)) {
+        throw std::runtime_error("importMesh() glTF accessor out of range!");
+    }
+
+    resolved.data = bin + viewOffset + accessorOffset;
+    return resolved;
+}
+
+// Reads up to `count` components of an element as floats, dequantizing normalized integers
+void readGltfFloats(const GltfAccessor& accessor, uint32_t element, float* values, uint32_t count)
+{
+    const uint8_t* source = accessor.data + element * accessor.stride;
+    count = std::min(count, accessor.componentCount);
+    for (uint32_t c = 0; c < count; c++) {
+        switch (accessor.componentType) {
+        case GLTF_FLOAT:
+            std::memcpy(&values[c], source + c * 4, sizeof(float));
+            break;
+        case GLTF_UNSIGNED_BYTE:
+            values[c] = static_cast<float>(source[c]) / (accessor.normalized ? 255.0f : 1.0f);
+            break;
+        case GLTF_BYTE:
+            values[c] = static_cast<float>(static_cast<int8_t>(source[c]));
+            values[c] = accessor.normalized ? std::max(values[c] / 127.0f, -1.0f) : values[c];
+            break;
+        case GLTF_UNSIGNED_SHORT: {
+            uint16_t component;
+            std::memcpy(&component, source + c * 2, sizeof(component));
+            values[c] = static_cast<float>(component) / (accessor.normalized ? 65535.0f : 1.0f);
+            break;
+        }
+        case GLTF_SHORT: {
+            int16_t component;
+            std::memcpy(&component, source + c * 2, sizeof(component));
+            values[c] = accessor.normalized ? std::max(component / 32767.0f, -1.0f) : static_cast<float>(component);
+            break;
+        }
+        default:
+            throw std::runtime_error("importMesh() Unsupported glTF vertex component type!");
+        }
+    }
+}
+
+uint32_t readGltfIndex(const GltfAccessor& accessor, uint32_t element)
+{
+    const uint8_t* source = accessor.data + element * accessor.stride;
+    switch (accessor.componentType) {
+    case GLTF_UNSIGNED_BYTE:
+        return source[0];
+    case GLTF_UNSIGNED_SHORT: {
+        uint16_t index;
+        std::memcpy(&index, source, sizeof(index));
+        return index;
+    }
+    case GLTF_UNSIGNED_INT: {
+        uint32_t index;
+        std::memcpy(&index, source, sizeof(index));
+        return index;
+    }
+    default:
+        throw std::runtime_error("importMesh() Unsupported glTF index component type!");
+    }
+}
+
+glm::mat4 getGltfNodeTransform(const JsonValue& node)
+{
+    auto readNumbers = [](const JsonValue* array, float* values, size_t count) {
+        if (array->type != JsonValue::JSON_ARRAY || array->values.size() != count) {
+            throwJsonError();
+        }
+        for (size_t i = 0; i < count; i++) {
+            values[i] = static_cast<float>(array->values[i].number);
+        }
+    };
+
+    if (const JsonValue* matrix = node.find("matrix")) {
+        float values[16];
+        readNumbers(matrix, values, 16);
+        glm::mat4 transform;
+        for (int column = 0; column < 4; column++) {
+            const float* v = &values[column * 4];
+            transform[column] = glm::vec4(v[0], v[1], v[2], v[3]);
+        }
+        return transform;
+    }
+
+    glm::vec3 translation(0.0f);
+    glm::quat rotation(1.0f, 0.0f, 0.0f, 0.0f);
+    glm::vec3 scale(1.0f);
+    if (const JsonValue* member = node.find("translation")) {
+        readNumbers(member, &translation.x, 3);
+    }
+    if (const JsonValue* member = node.find("rotation")) {
+        float values[4];
+        readNumbers(member, values, 4);
+        rotation = glm::quat(values[3], values[0], values[1], values[2]); // glTF stores xyzw
+    }
+    if (const JsonValue* member = node.find("scale")) {
+        readNumbers(member, &scale.x, 3);
+    }
+
+    glm::mat4 transform = glm::mat4_cast(rotation);
+    transform[0] *= scale.x;
+    transform[1] *= scale.y;
+    transform[2] *= scale.z;
+    transform[3] = glm::vec4(translation, 1.0f);
+    return transform;
+}
+
+// One primitive of one mesh instance, with its slice of the output
+struct GltfPrimitiveInstance
+{
+    glm::mat4 transform;
+    bool mirrored;
+    GltfAccessor positions;
+    GltfAccessor normals;
+    GltfAccessor tangents;
+    GltfAccessor uvs;
+    GltfAccessor indices;
+    uint32_t firstVertex;
+    uint32_t firstIndex;
+    uint32_t indexCount;
+};
+
+void collectGltfInstances(
+    const JsonValue& root,
+    const uint8_t* bin,
+    size_t binSize,
+    std::vector<GltfPrimitiveInstance>& instances,
+    size_t& vertexCount,
+    size_t& indexCount)
+{
+    const JsonValue* nodes = root.find("nodes");
+    if (nodes == nullptr) {
+        return;
+    }
+
+    // Roots of the default scene, or every node nobody lists as a child
+    std::vector<int64_t> roots;
+    const JsonValue* scenes = root.find("scenes");
+    if (scenes != nullptr && !scenes->values.empty()) {
+        const JsonValue& scene = getJsonElement(*scenes, getJsonInteger(root, "scene", 0));
+        if (const JsonValue* sceneNodes = scene.find("nodes")) {
+            for (const JsonValue& node : sceneNodes->values) {
+                roots.push_back(static_cast<int64_t>(node.number));
+            }
+        }
+    }
+    else {
+        std::vector<bool> isChild(nodes->values.size(), false);
+        for (const JsonValue& node : nodes->values) {
+            if (const JsonValue* children = node.find("children")) {
+                for (const JsonValue& child : children->values) {
+                    int64_t childIndex = static_cast<int64_t>(child.number);
+                    getJsonElement(*nodes, childIndex); // Range check
+                    isChild[static_cast<size_t>(childIndex)] = true;
+                }
+            }
+        }
+        for (size_t i = 0; i < isChild.size(); i++) {
+            if (!isChild[i]) {
+                roots.push_back(static_cast<int64_t>(i));
+            }
+        }
+    }
+
+    struct PendingNode
+    {
+        int64_t node;
+        glm::mat4 parentTransform;
+        size_t depth;
+    };
+    std::vector<PendingNode> pending;
+    for (int64_t node : roots) {
+        pending.push_back({node, glm::mat4(1.0f), 0});
+    }
+
+    while (!pending.empty()) {
+        PendingNode current = pending.back();
+        pending.pop_back();
+        // A valid hierarchy is a forest, so deeper than the node count means a cycle
+        if (current.depth > nodes->values.size()) {
+            throw std::runtime_error("importMesh() glTF node hierarchy has a cycle!");
+        }
+
+        const JsonValue& node = getJsonElement(*nodes, current.node);
+        glm::mat4 transform = current.parentTransform * getGltfNodeTransform(node);
+        if (const JsonValue* children = node.find("children")) {
+            for (const JsonValue& child : children->values) {
+                pending.push_back({static_cast<int64_t>(child.number), transform, current.depth + 1});
+            }
+        }
+
+        const int64_t meshIndex = getJsonInteger(node, "mesh", -1);
+        if (meshIndex < 0) {
+            continue;
+        }
+        const JsonValue& mesh = getJsonElement(getJsonMember(root, "meshes"), meshIndex);
+        for (const JsonValue& primitive : getJsonMember(mesh, "primitives").values) {
+            if (getJsonInteger(primitive, "mode", GLTF_MODE_TRIANGLES) != GLTF_MODE_TRIANGLES) {
+                continue; // Points and lines
+            }
+
+            const JsonValue& attributes = getJsonMember(primitive, "attributes");
+            GltfPrimitiveInstance instance;
+            instance.transform = transform;
+            instance.mirrored = glm::determinant(glm::mat3(transform)) < 0.0f;
+            instance.positions = resolveGltfAccessor(root, bin, binSize, getJsonInteger(attributes, "POSITION", -1));
+            if (instance.positions.componentType != GLTF_FLOAT || instance.positions.componentCount != 3) {
+                throw std::runtime_error("importMesh() glTF positions must be float VEC3!");
+            }
+            if (attributes.find("NORMAL") != nullptr) {
+                instance.normals = resolveGltfAccessor(root, bin, binSize, getJsonInteger(attributes, "NORMAL", -1));
+            }
+            if (attributes.find("TANGENT") != nullptr) {
+                instance.tangents = resolveGltfAccessor(root, bin, binSize, getJsonInteger(attributes, "TANGENT", -1));
+            }
+            if (attributes.find("TEXCOORD_0") != nullptr) {
+                instance.uvs = resolveGltfAccessor(root, bin, binSize, getJsonInteger(attributes, "TEXCOORD_0", -1));
+            }
+            if (primitive.find("indices") != nullptr) {
+                instance.indices = resolveGltfAccessor(root, bin, binSize, getJsonInteger(primitive, "indices", -1));
+            }
+
+            const uint32_t primitiveVertices = instance.positions.count;
+            for (const GltfAccessor* attribute : {&instance.normals, &instance.tangents, &instance.uvs}) {
+                if (attribute->data != nullptr && attribute->count != primitiveVertices) {
+                    throw std::runtime_error("importMesh() glTF attribute counts differ within a primitive!");
+                }
+            }
+            instance.indexCount = instance.indices.data != nullptr ? instance.indices.count : primitiveVertices;
+            if (instance.indexCount % 3 != 0) {
+                throw std::runtime_error("importMesh() glTF triangle primitive index count is not a multiple of 3!");
+            }
+
+            instance.firstVertex = static_cast<uint32_t>(std::min<size_t>(vertexCount, UINT32_MAX));
+            instance.firstIndex = static_cast<uint32_t>(std::min<size_t>(indexCount, UINT32_MAX));
+            vertexCount += primitiveVertices;
+            indexCount += instance.indexCount;
+            instances.push_back(instance);
+        }
+    }
+}
+
+void writeGltfVertices(const GltfPrimitiveInstance& instance, uint32_t first, uint32_t last, Vertex* vertices)
+{
+    const glm::mat3 linear(instance.transform);
+    const glm::mat3 normalMatrix = glm::transpose(glm::inverse(linear));
+
+    for (uint32_t i = first; i < last; i++) {
+        Vertex& vertex = vertices[instance.firstVertex + i];
+
+        glm::vec3 position;
+        readGltfFloats(instance.positions, i, &position.x, 3);
+        vertex.position = glm::vec3(instance.transform * glm::vec4(position, 1.0f));
+
+        vertex.normal = glm::vec3(0.0f);
+        if (instance.normals.data != nullptr) {
+            glm::vec3 normal(0.0f);
+            readGltfFloats(instance.normals, i, &normal.x, 3);
+            normal = normalMatrix * normal;
+            float length = glm::length(normal);
+            vertex.normal = length > 0.0f ? normal / length : glm::vec3(0.0f);
+        }
+
+        vertex.tangent = DEFAULT_TANGENT;
+        if (instance.tangents.data != nullptr) {
+            glm::vec4 tangent(0.0f, 0.0f, 0.0f, 1.0f);
+            readGltfFloats(instance.tangents, i, &tangent.x, 4);
+            glm::vec3 direction = linear * glm::vec3(tangent);
+            float length = glm::length(direction);
+            // Mirroring flips the handedness of the tangent frame
+            float sign = (tangent.w < 0.0f) != instance.mirrored ? -1.0f : 1.0f;
+            vertex.tangent = length > 0.0f ? glm::vec4(direction / length, sign) : DEFAULT_TANGENT;
+        }
+
+        vertex.uv = glm::vec2(0.0f);
+        if (instance.uvs.data != nullptr) {
+            readGltfFloats(instance.uvs, i, &vertex.uv.x, 2);
+        }
+    }
+}
+
+// first and last count triangles
+void writeGltfIndices(const GltfPrimitiveInstance& instance, uint32_t first, uint32_t last, uint32_t* indices)
+{
+    const uint32_t vertexCount = instance.positions.count;
+    // glTF is counter-clockwise; a mirroring transform already reversed it once
+    const bool reverse = !instance.mirrored;
+
+    for (uint32_t t = first; t < last; t++) {
+        uint32_t triangle[3];
+        for (uint32_t k = 0; k < 3; k++) {
+            uint32_t element = t * 3 + k;
+            triangle[k] = instance.indices.data != nullptr ? readGltfIndex(instance.indices, element) : element;
+            if (triangle[k] >= vertexCount) {
+                throw std::runtime_error("importMesh() glTF index out of range of its primitive!");
+            }
+        }
+
+        uint32_t* output = indices + instance.firstIndex + t * 3;
+        output[0] = instance.firstVertex + triangle[0];
+        output[1] = instance.firstVertex + triangle[reverse ? 2 : 1];
+        output[2] = instance.firstVertex + triangle[reverse ? 1 : 2];
+    }
+}
+
+void importGltfBinary(MeshAsset& asset, const MappedFile& file, uint32_t workerCount)
+{
+    auto readWord = [&file](size_t offset) {
+        uint32_t word;
+        std::memcpy(&word, file.data + offset, sizeof(word));
+        return word;
+    };
+
+    // 12-byte header, then chunks of (length, type, data padded to 4 bytes)
+    if (file.size < 20 || readWord(0) != GLB_MAGIC || readWord(4) != 2) {
+        throw std::runtime_error("importMesh() Not a glTF 2.0 binary file!");
+    }
+    const size_t jsonLength = readWord(12);
+    if (readWord(16) != GLB_CHUNK_JSON || 20 + jsonLength > file.size) {
+        throw std::runtime_error("importMesh() GLB JSON chunk is missing or truncated!");
+    }
+
+    const uint8_t* bin = nullptr;
+    size_t binSize = 0;
+    size_t binChunk = 20 + ((jsonLength + 3) & ~size_t(3));
+    if (binChunk + 8 <= file.size && readWord(binChunk + 4) == GLB_CHUNK_BIN) {
+        binSize = readWord(binChunk);
+        bin = file.data + binChunk + 8;
+        if (binChunk + 8 + binSize > file.size) {
+            throw std::runtime_error("importMesh() GLB binary chunk is truncated!");
+        }
+    }
+
+    JsonValue root;
+    JsonParser parser;
+    parser.cursor = reinterpret_cast<const char*>(file.data + 20);
+    parser.end = parser.cursor + jsonLength;
+    parseJsonValue(parser, root, 0);
+    if (root.type != JsonValue::JSON_OBJECT) {
+        throwJsonError();
+    }
+
+    std::vector<GltfPrimitiveInstance> instances;
+    size_t vertexCount = 0;
+    size_t indexCount = 0;
+    collectGltfInstances(root, bin, binSize, instances, vertexCount, indexCount);
+    resizeMeshAsset(asset, vertexCount, indexCount);
+
+    Vertex* vertices = getAssetVertices(asset, "importMesh() Unexpected vertex layout!");
+    uint32_t* indices = asset.indices.data();
+    std::vector<TaskGraphNode> jobs;
+    for (size_t p = 0; p < instances.size(); p++) {
+        const GltfPrimitiveInstance& instance = instances[p];
+        for (uint32_t first = 0; first < instance.positions.count; first += MESH_IMPORT_CHUNK_ELEMENTS) {
+            uint32_t last = std::min(instance.positions.count, first + MESH_IMPORT_CHUNK_ELEMENTS);
+            std::string name = "importGltfVertices" + std::to_string(p) + "_" + std::to_string(first);
+            jobs.push_back({name, {}, [&, first, last]() { writeGltfVertices(instance, first, last, vertices); }});
+        }
+        const uint32_t triangleCount = instance.indexCount / 3;
+        for (uint32_t first = 0; first < triangleCount; first += MESH_IMPORT_CHUNK_ELEMENTS / 3) {
+            uint32_t last = std::min(triangleCount, first + MESH_IMPORT_CHUNK_ELEMENTS / 3);
+            std::string name = "importGltfIndices" + std::to_string(p) + "_" + std::to_string(first);
+            jobs.push_back({name, {}, [&, first, last]() { writeGltfIndices(instance, first, last, indices); }});
+        }
+    }
+    runImportJobs(jobs, workerCount);
+}
+
+//---------------------------------
+// OBJ
+//---------------------------------
+struct ObjChunk
+{
+    const char* begin;
+    const char* end;
+    // Statement counts, then the index of the chunk's first element in the whole file
+    uint32_t positionCount{0};
+    uint32_t uvCount{0};
+    uint32_t normalCount{0};
+    uint32_t triangleCount{0};
+    uint32_t firstPosition{0};
+    uint32_t firstUv{0};
+    uint32_t firstNormal{0};
+    uint32_t firstTriangle{0};
+};
+
+enum ObjStatement
+{
+    OBJ_OTHER,
+    OBJ_POSITION,
+    OBJ_UV,
+    OBJ_NORMAL,
+    OBJ_FACE,
+};
+
+bool isObjSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+const char* skipObjSpaces(const char* cursor, const char* end)
+{
+    while (cursor < end && isObjSpace(*cursor)) {
+        cursor++;
+    }
+    return cursor;
+}
+
+// Classifies the line and leaves `cursor` after the keyword
+ObjStatement parseObjKeyword(const char*& cursor, const char* end)
+{
+    cursor = skipObjSpaces(cursor, end);
+    auto keyword = [&](std::string_view name) {
+        if (static_cast<size_t>(end - cursor) > name.size() && std::memcmp(cursor, name.data(), name.size()) == 0
+            && isObjSpace(cursor[name.size()])) {
+            cursor += name.size();
+            return true;
+        }
+        return false;
+    };
+    if (keyword("v")) {
+        return OBJ_POSITION;
+    }
+    if (keyword("vt")) {
+        return OBJ_UV;
+    }
+    if (keyword("vn")) {
+        return OBJ_NORMAL;
+    }
+    if (keyword("f")) {
+        return OBJ_FACE;
+    }
+    return OBJ_OTHER;
+}
+
+// Calls statement(type, cursor after the keyword, line end) for every line of the chunk
+template <typename Function> void forEachObjStatement(const ObjChunk& chunk, Function statement)
+{
+    const char* line = chunk.begin;
+    while (line < chunk.end) {
+        const char* lineEnd = static_cast<const char*>(std::memchr(line, '\n', static_cast<size_t>(chunk.end - line)));
+        lineEnd = lineEnd != nullptr ? lineEnd : chunk.end;
+        const char* cursor = line;
+        ObjStatement type = parseObjKeyword(cursor, lineEnd);
+        if (type != OBJ_OTHER) {
+            statement(type, cursor, lineEnd);
+        }
+        line = lineEnd + 1;
+    }
+}
+
+uint32_t countObjFaceCorners(const char* cursor, const char* end)
+{
+    uint32_t corners = 0;
+    while ((cursor = skipObjSpaces(cursor, end)) < end) {
+        corners++;
+        while (cursor < end && !isObjSpace(*cursor)) {
+            cursor++;
+        }
+    }
+    return corners;
+}
+
+void parseObjFloats(const char* cursor, const char* end, float* values, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        cursor = skipObjSpaces(cursor, end);
+        std::from_chars_result result = std::from_chars(cursor, end, values[i]);
+        if (result.ec != std::errc()) {
+            throw std::runtime_error("importMesh() Malformed OBJ vertex data!");
+        }
+        cursor = result.ptr;
+    }
+}
+
+struct ObjCorner
+{
+    uint32_t position;
+    uint32_t uv;     // UINT32_MAX when absent
+    uint32_t normal; // UINT32_MAX when absent
+};
+
+// Resolves a 1-based or negative (relative to the elements defined so far) OBJ index
+uint32_t parseObjIndex(const char*& cursor, const char* end, uint32_t definedCount)
+{
+    int64_t index = 0;
+    std::from_chars_result result = std::from_chars(cursor, end, index);
+    if (result.ec != std::errc()) {
+        throw std::runtime_error("importMesh() Malformed OBJ face!");
+    }
+    cursor = result.ptr;
+
+    int64_t resolved = index > 0 ? index - 1 : static_cast<int64_t>(definedCount) + index;
+    if (index == 0 || resolved < 0 || resolved >= static_cast<int64_t>(definedCount)) {
+        throw std::runtime_error("importMesh() OBJ face references an undefined vertex!");
+    }
+    return static_cast<uint32_t>(resolved);
+}
+
+ObjCorner parseObjCorner(const char*& cursor, const char* end, const ObjChunk& defined)
+{
+    // p, p/t, p//n or p/t/n; `defined` holds the element counts seen before this line
+    ObjCorner corner;
+    corner.position = parseObjIndex(cursor, end, defined.firstPosition);
+    corner.uv = UINT32_MAX;
+    corner.normal = UINT32_MAX;
+    if (cursor < end && *cursor == '/') {
+        cursor++;
+        if (cursor < end && *cursor != '/') {
+            corner.uv = parseObjIndex(cursor, end, defined.firstUv);
+        }
+        if (cursor < end && *cursor == '/') {
+            cursor++;
+            corner.normal = parseObjIndex(cursor, end, defined.firstNormal);
+        }
+    }
+    return corner;
+}
+
+struct ObjPools
+{
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec2> uvs;
+    std::vector<glm::vec3> normals;
+};
+
+void countObjStatements(ObjChunk& chunk)
+{
+    forEachObjStatement(chunk, [&chunk](ObjStatement type, const char* cursor, const char* end) {
+        if (type == OBJ_POSITION) {
+            chunk.positionCount++;
+        }
+        else if (type == OBJ_UV) {
+            chunk.uvCount++;
+        }
+        else if (type == OBJ_NORMAL) {
+            chunk.normalCount++;
+        }
+        else if (type == OBJ_FACE) {
+            chunk.triangleCount += std::max(countObjFaceCorners(cursor, end), 2u) - 2;
+        }
+    });
+}
+
+void parseObjAttributes(const ObjChunk& chunk, ObjPools& pools)
+{
+    uint32_t position = chunk.firstPosition;
+    uint32_t uv = chunk.firstUv;
+    uint32_t normal = chunk.firstNormal;
+    forEachObjStatement(chunk, [&](ObjStatement type, const char* cursor, const char* end) {
+        if (type == OBJ_POSITION) {
+            parseObjFloats(cursor, end, &pools.positions[position++].x, 3);
+        }
+        else if (type == OBJ_UV) {
+            glm::vec2& value = pools.uvs[uv++];
+            parseObjFloats(cursor, end, &value.x, 2);
+            value.y = 1.0f - value.y; // OBJ's origin is bottom-left, Vulkan's top-left
+        }
+        else if (type == OBJ_NORMAL) {
+            parseObjFloats(cursor, end, &pools.normals[normal++].x, 3);
+        }
+    });
+}
+
+void parseObjFaces(const ObjChunk& chunk, const ObjPools& pools, Vertex* vertices, uint32_t* indices)
+{
+    ObjChunk defined = chunk; // first* fields track the elements defined so far
+    uint32_t corner = chunk.firstTriangle * 3;
+
+    auto writeCorner = [&](const ObjCorner& source) {
+        Vertex& vertex = vertices[corner];
+        vertex.position = pools.positions[source.position];
+        vertex.normal = source.normal != UINT32_MAX ? pools.normals[source.normal] : glm::vec3(0.0f);
+        vertex.tangent = DEFAULT_TANGENT;
+        vertex.uv = source.uv != UINT32_MAX ? pools.uvs[source.uv] : glm::vec2(0.0f);
+        // Unindexed for now; welding in optimizeMeshAsset() merges the shared corners
+        indices[corner] = corner;
+        corner++;
+    };
+
+    forEachObjStatement(chunk, [&](ObjStatement type, const char* cursor, const char* end) {
+        if (type == OBJ_POSITION) {
+            defined.firstPosition++;
+        }
+        else if (type == OBJ_UV) {
+            defined.firstUv++;
+        }
+        else if (type == OBJ_NORMAL) {
+            defined.firstNormal++;
+        }
+        else if (type == OBJ_FACE) {
+            // Fan around the first corner, reversed to clockwise
+            ObjCorner first{};
+            ObjCorner previous{};
+            uint32_t count = 0;
+            while ((cursor = skipObjSpaces(cursor, end)) < end) {
+                ObjCorner current = parseObjCorner(cursor, end, defined);
+                if (count >= 2) {
+                    writeCorner(first);
+                    writeCorner(current);
+                    writeCorner(previous);
+                }
+                first = count == 0 ? current : first;
+                previous = current;
+                count++;
+            }
+        }
+    });
+}
+
+void importObj(MeshAsset& asset, const MappedFile& file, uint32_t workerCount)
+{
+    // Split at line boundaries, then count every chunk's statements in parallel so each one
+    // knows where its elements land before anything is parsed
+    const char* text = reinterpret_cast<const char*>(file.data);
+    const char* textEnd = text + file.size;
+    std::vector<ObjChunk> chunks;
+    for (const char* begin = text; begin < textEnd;) {
+        const char* end = begin + std::min(MESH_IMPORT_CHUNK_BYTES, static_cast<size_t>(textEnd - begin));
+        const char* newline
+            = static_cast<const char*>(std::memchr(end - 1, '\n', static_cast<size_t>(textEnd - end + 1)));
+        end = newline != nullptr ? newline + 1 : textEnd;
+        ObjChunk chunk;
+        chunk.begin = begin;
+        chunk.end = end;
+        chunks.push_back(chunk);
+        begin = end;
+    }
+
+    std::vector<TaskGraphNode> jobs;
+    for (size_t c = 0; c < chunks.size(); c++) {
+        jobs.push_back({"countObjChunk" + std::to_string(c), {}, [&chunks, c]() { countObjStatements(chunks[c]); }});
+    }
+    runImportJobs(jobs, workerCount);
+
+    uint64_t positionCount = 0;
+    uint64_t uvCount = 0;
+    uint64_t normalCount = 0;
+    uint64_t triangleCount = 0;
+    for (ObjChunk& chunk : chunks) {
+        chunk.firstPosition = static_cast<uint32_t>(positionCount);
+        chunk.firstUv = static_cast<uint32_t>(uvCount);
+        chunk.firstNormal = static_cast<uint32_t>(normalCount);
+        chunk.firstTriangle = static_cast<uint32_t>(triangleCount);
+        positionCount += chunk.positionCount;
+        uvCount += chunk.uvCount;
+        normalCount += chunk.normalCount;
+        triangleCount += chunk.triangleCount;
+    }
+    if (std::max({positionCount, uvCount, normalCount, triangleCount * 3}) >= UINT32_MAX) {
+        throw std::runtime_error("importMesh() OBJ exceeds 32-bit vertex or index counts!");
+    }
+
+    // OBJ indexes positions, UVs and normals separately, so those pools are the one copy
+    // that can't be avoided; every triangle corner is then written straight into the asset
+    ObjPools pools;
+    pools.positions.resize(positionCount);
+    pools.uvs.resize(uvCount);
+    pools.normals.resize(normalCount);
+    resizeMeshAsset(asset, triangleCount * 3, triangleCount * 3);
+
+    jobs.clear();
+    for (size_t c = 0; c < chunks.size(); c++) {
+        jobs.push_back({"parseObjAttributes" + std::to_string(c), {}, [&chunks, &pools, c]() {
+                            parseObjAttributes(chunks[c], pools);
+                        }});
+    }
+    runImportJobs(jobs, workerCount);
+
+    Vertex* vertices = getAssetVertices(asset, "importMesh() Unexpected vertex layout!");
+    uint32_t* indices = asset.indices.data();
+    jobs.clear();
+    for (size_t c = 0; c < chunks.size(); c++) {
+        jobs.push_back({"parseObjFaces" + std::to_string(c), {}, [&chunks, &pools, vertices, indices, c]() {
+                            parseObjFaces(chunks[c], pools, vertices, indices);
+                        }});
+    }
+    runImportJobs(jobs, workerCount);
+}
+
+std::string getLowercaseExtension(const std::string& filename)
+{
+    std::string extension = std::filesystem::path(filename).extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) {
+        return static_cast<char>(std::tolower(c));
+    });
+    return extension;
+}
+} // namespace
+
+//---------------------------------
+// importMesh()
+//---------------------------------
+void importMesh(MeshAsset& asset, const std::string& filename, uint32_t workerCount)
+{
+    const std::string extension = getLowercaseExtension(filename);
+    if (extension != ".glb" && extension != ".obj") {
+        throw std::runtime_error("importMesh() Unsupported mesh file type " + extension);
+    }
+
+    MappedFile file;
+    mapFile(file, filename);
+    try {
+        if (extension == ".glb") {
+            importGltfBinary(asset, file, workerCount);
+        }
+        else {
+            importObj(asset, file, workerCount);
+        }
+    }
+    catch (...) {
+        unmapFile(file);
+        throw;
+    }
+    unmapFile(file);
+}
+
+//---------------------------------
+// fillMissingNormals()
+//---------------------------------
+void fillMissingNormals(MeshAsset& asset)
+{
+    Vertex* vertices = getAssetVertices(asset, "fillMissingNormals() Mesh asset vertices are not Vertex!");
+
+    std::vector<bool> missing(asset.vertexCount);
+    bool anyMissing = false;
+    for (uint32_t v = 0; v < asset.vertexCount; v++) {
+        missing[v] = vertices[v].normal == glm::vec3(0.0f);
+        anyMissing = anyMissing || missing[v];
+    }
+    if (!anyMissing) {
+        return;
+    }
+
+    for (size_t i = 0; i + 2 < asset.indices.size(); i += 3) {
+        const uint32_t a = asset.indices[i];
+        const uint32_t b = asset.indices[i + 1];
+        const uint32_t c = asset.indices[i + 2];
+        // Unnormalized, so larger triangles weigh more; clockwise front faces
+        const glm::vec3& origin = vertices[a].position;
+        glm::vec3 normal = glm::cross(vertices[c].position - origin, vertices[b].position - origin);
+        for (uint32_t v : {a, b, c}) {
+            if (missing[v]) {
+                vertices[v].normal += normal;
+            }
+        }
+    }
+
+    for (uint32_t v = 0; v < asset.vertexCount; v++) {
+        float length = glm::length(vertices[v].normal);
+        if (missing[v] && length > 0.0f) {
+            vertices[v].normal /= length;
+        }
+    }
+}
+
+//---------------------------------
+// loadMesh()
+//---------------------------------
+void loadMesh(MeshAsset& asset, const std::string& filename, const std::string& cacheFilename, uint32_t workerCount)
+{
+    // Size and modification time stand in for the contents; hashing the whole file would cost
+    // about as much as a cache miss saves on the largest scenes
+    std::error_code error;
+    const auto fileSize = std::filesystem::file_size(filename, error);
+    const auto writeTime = std::filesystem::last_write_time(filename, error).time_since_epoch().count();
+    const std::string source = filename + "|" + std::to_string(fileSize) + "|" + std::to_string(writeTime) + "|"
+        + std::to_string(sizeof(Vertex));
+    const uint64_t sourceHash = hashMeshSource(source.data(), source.size());
+
+    if (!cacheFilename.empty() && readMeshAssetCache(cacheFilename, sourceHash, sizeof(Vertex), asset)
+        && (asset.flags & MESH_ASSET_OPTIMIZED_BIT) != 0) {
+        return;
+    }
+
+    importMesh(asset, filename, workerCount);
+    optimizeMeshAsset(asset);
+    fillMissingNormals(asset);
+
+    if (!cacheFilename.empty()) {
+        writeMeshAssetCache(cacheFilename, sourceHash, asset);
+    }
+}
+
+//---------------------------------
+// computeVertexQuantization()
+//---------------------------------
+VertexQuantization computeVertexQuantization(const MeshAsset& asset)
+{
+    const Vertex* vertices = getAssetVertices(asset, "computeVertexQuantization() Mesh asset vertices are not Vertex!");
+    return computeVertexQuantization(vertices, asset.vertexCount);
+}
+
+//---------------------------------
+// writePackedVertices()
+//---------------------------------
+void writePackedVertices(void* destination, const MeshAsset& asset, const VertexQuantization& quantization)
+{
+    const Vertex* vertices = getAssetVertices(asset, "writePackedVertices() Mesh asset vertices are not Vertex!");
+    PackedVertex* packed = static_cast<PackedVertex*>(destination);
+    for (uint32_t v = 0; v < asset.vertexCount; v++) {
+        packed[v] = packVertex(vertices[v], quantization);
+    }
+}
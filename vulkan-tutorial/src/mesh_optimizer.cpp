@@ -0,0 +1,415 @@
+#include "mesh_optimizer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <stdexcept>
+
+namespace {
+const uint32_t EMPTY_SLOT = UINT32_MAX;
+
+void validateTriangleList(const std::vector<uint32_t>& indices, size_t vertexCount, const char* error)
+{
+    if (indices.size() % 3 != 0) {
+        throw std::runtime_error(error);
+    }
+    for (uint32_t index : indices) {
+        if (index >= vertexCount) {
+            throw std::runtime_error(error);
+        }
+    }
+}
+
+// FNV-1a over the vertex bytes
+uint32_t hashVertex(const uint8_t* vertex, size_t vertexStride)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < vertexStride; i++) {
+        hash = (hash ^ vertex[i]) * 16777619u;
+    }
+    return hash;
+}
+
+// FIFO cache over timestamps: a vertex is resident while fewer than cacheSize misses have
+// happened since it was loaded. Starting the clock at cacheSize + 1 leaves the cache empty.
+struct CacheSimulation
+{
+    std::vector<uint32_t> loadTimes;
+    uint32_t time;
+    uint32_t cacheSize;
+
+    CacheSimulation(size_t vertexCount, uint32_t size) : loadTimes(vertexCount, 0), time(size + 1), cacheSize(size) {}
+
+    bool isCached(uint32_t vertex) const { return time - loadTimes[vertex] <= cacheSize; }
+
+    // Returns the number of misses
+    uint32_t touch(const uint32_t* triangle)
+    {
+        uint32_t misses = 0;
+        for (int i = 0; i < 3; i++) {
+            if (!isCached(triangle[i])) {
+                loadTimes[triangle[i]] = time++;
+                misses++;
+            }
+        }
+        return misses;
+    }
+
+    void flush() { time += cacheSize + 1; }
+};
+
+// Triangles adjacent to each vertex, stored as one array with per-vertex offsets
+struct VertexAdjacency
+{
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> triangles;
+};
+
+void buildVertexAdjacency(VertexAdjacency& adjacency, const std::vector<uint32_t>& indices, size_t vertexCount)
+{
+    adjacency.offsets.assign(vertexCount + 1, 0);
+    for (uint32_t index : indices) {
+        adjacency.offsets[index + 1]++;
+    }
+    std::partial_sum(adjacency.offsets.begin(), adjacency.offsets.end(), adjacency.offsets.begin());
+
+    std::vector<uint32_t> cursors(adjacency.offsets.begin(), adjacency.offsets.end() - 1);
+    adjacency.triangles.resize(indices.size());
+    for (size_t i = 0; i < indices.size(); i++) {
+        adjacency.triangles[cursors[indices[i]]++] = static_cast<uint32_t>(i / 3);
+    }
+}
+} // namespace
+
+//---------------------------------
+// analyzeVertexCache()
+//---------------------------------
+VertexCacheStats analyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize)
+{
+    validateTriangleList(indices, vertexCount, "analyzeVertexCache() Indices are not a valid triangle list!");
+
+    CacheSimulation cache(vertexCount, cacheSize);
+    std::vector<bool> referenced(vertexCount, false);
+    uint32_t uniqueVertices = 0;
+    uint32_t misses = 0;
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        misses += cache.touch(&indices[i]);
+        for (size_t j = i; j < i + 3; j++) {
+            uniqueVertices += referenced[indices[j]] ? 0 : 1;
+            referenced[indices[j]] = true;
+        }
+    }
+
+    VertexCacheStats stats;
+    stats.vertexShaderInvocations = misses;
+    stats.acmr = indices.empty() ? 0.0f : static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+    stats.atvr = uniqueVertices == 0 ? 0.0f : static_cast<float>(misses) / static_cast<float>(uniqueVertices);
+    return stats;
+}
+
+//---------------------------------
+// weldVertices()
+//---------------------------------
+uint32_t weldVertices(std::vector<uint32_t>& remap, const void* vertices, size_t vertexCount, size_t vertexStride)
+{
+    if (vertexStride == 0 || vertexCount >= EMPTY_SLOT) {
+        throw std::runtime_error("weldVertices() Invalid vertex layout!");
+    }
+
+    const uint8_t* bytes = static_cast<const uint8_t*>(vertices);
+
+    // Open addressing with quadratic probing; at most half full so probes stay short
+    size_t capacity = 1;
+    while (capacity < vertexCount * 2) {
+        capacity *= 2;
+    }
+    std::vector<uint32_t> table(capacity, EMPTY_SLOT);
+
+    remap.resize(vertexCount);
+    uint32_t uniqueCount = 0;
+    for (size_t i = 0; i < vertexCount; i++) {
+        const uint8_t* vertex = bytes + i * vertexStride;
+        size_t slot = hashVertex(vertex, vertexStride) & (capacity - 1);
+        for (size_t probe = 1;; probe++) {
+            uint32_t existing = table[slot];
+            if (existing == EMPTY_SLOT) {
+                table[slot] = static_cast<uint32_t>(i);
+                remap[i] = uniqueCount++;
+                break;
+            }
+            if (std::memcmp(bytes + existing * vertexStride, vertex, vertexStride) == 0) {
+                remap[i] = remap[existing];
+                break;
+            }
+            slot = (slot + probe) & (capacity - 1);
+        }
+    }
+    return uniqueCount;
+}
+
+//---------------------------------
+// remapIndices()
+//---------------------------------
+void remapIndices(std::vector<uint32_t>& indices, const std::vector<uint32_t>& remap)
+{
+    for (uint32_t& index : indices) {
+        if (index >= remap.size() || remap[index] == VERTEX_REMAP_UNUSED) {
+            throw std::runtime_error("remapIndices() Index has no remap entry!");
+        }
+        index = remap[index];
+    }
+}
+
+//---------------------------------
+// remapVertices()
+//---------------------------------
+void remapVertices(
+    void* destination,
+    const void* vertices,
+    size_t vertexCount,
+    size_t vertexStride,
+    const std::vector<uint32_t>& remap)
+{
+    if (remap.size() < vertexCount) {
+        throw std::runtime_error("remapVertices() Remap table is smaller than the vertex count!");
+    }
+
+    uint8_t* destinationBytes = static_cast<uint8_t*>(destination);
+    const uint8_t* sourceBytes = static_cast<const uint8_t*>(vertices);
+    for (size_t i = 0; i < vertexCount; i++) {
+        if (remap[i] != VERTEX_REMAP_UNUSED) {
+            std::memcpy(destinationBytes + remap[i] * vertexStride, sourceBytes + i * vertexStride, vertexStride);
+        }
+    }
+}
+
+//---------------------------------
+// optimizeVertexCache()
+//---------------------------------
+void optimizeVertexCache(
+    std::vector<uint32_t>& indices,
+    size_t vertexCount,
+    uint32_t cacheSize,
+    std::vector<uint32_t>* clusters)
+{
+    validateTriangleList(indices, vertexCount, "optimizeVertexCache() Indices are not a valid triangle list!");
+    if (cacheSize < 3) {
+        throw std::runtime_error("optimizeVertexCache() Cache must hold at least one triangle!");
+    }
+
+    if (clusters != nullptr) {
+        clusters->clear();
+    }
+    const size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0) {
+        return;
+    }
+
+    VertexAdjacency adjacency;
+    buildVertexAdjacency(adjacency, indices, vertexCount);
+
+    // Triangles not yet emitted around each vertex
+    std::vector<uint32_t> liveTriangles(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++) {
+        liveTriangles[v] = adjacency.offsets[v + 1] - adjacency.offsets[v];
+    }
+
+    CacheSimulation cache(vertexCount, cacheSize);
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<uint32_t> deadEnds; // Recently used vertices, to resume near them
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> output;
+    output.reserve(indices.size());
+
+    uint32_t scanCursor = 0; // Next vertex to try when the dead-end stack is exhausted
+    uint32_t fanVertex = indices[0];
+    if (clusters != nullptr) {
+        clusters->push_back(0);
+    }
+
+    while (true) {
+        // Emit every remaining triangle around the fanning vertex
+        candidates.clear();
+        for (uint32_t a = adjacency.offsets[fanVertex]; a < adjacency.offsets[fanVertex + 1]; a++) {
+            uint32_t triangle = adjacency.triangles[a];
+            if (emitted[triangle]) {
+                continue;
+            }
+            emitted[triangle] = true;
+
+            const uint32_t* vertices = &indices[triangle * 3];
+            cache.touch(vertices);
+            for (int i = 0; i < 3; i++) {
+                output.push_back(vertices[i]);
+                deadEnds.push_back(vertices[i]);
+                candidates.push_back(vertices[i]);
+                liveTriangles[vertices[i]]--;
+            }
+        }
+
+        // Next fan: the candidate that will still be cached after emitting its triangles and
+        // has been cached longest, so the fan uses it before it's evicted
+        uint32_t nextVertex = EMPTY_SLOT;
+        uint32_t bestPriority = 0;
+        for (uint32_t candidate : candidates) {
+            if (liveTriangles[candidate] == 0) {
+                continue;
+            }
+            uint32_t priority = 1;
+            uint32_t age = cache.time - cache.loadTimes[candidate];
+            if (age + 2 * liveTriangles[candidate] <= cacheSize) {
+                priority = age + 1;
+            }
+            if (priority > bestPriority) {
+                bestPriority = priority;
+                nextVertex = candidate;
+            }
+        }
+
+        if (nextVertex == EMPTY_SLOT) {
+            // Dead end: resume from the most recent vertex with work left, else scan forward.
+            // Either way the cache contents are unrelated to what follows.
+            while (!deadEnds.empty() && nextVertex == EMPTY_SLOT) {
+                uint32_t vertex = deadEnds.back();
+                deadEnds.pop_back();
+                if (liveTriangles[vertex] > 0) {
+                    nextVertex = vertex;
+                }
+            }
+            while (nextVertex == EMPTY_SLOT && scanCursor < vertexCount) {
+                if (liveTriangles[scanCursor] > 0) {
+                    nextVertex = scanCursor;
+                }
+                scanCursor++;
+            }
+            if (nextVertex == EMPTY_SLOT) {
+                break;
+            }
+            if (clusters != nullptr) {
+                clusters->push_back(static_cast<uint32_t>(output.size() / 3));
+            }
+        }
+        fanVertex = nextVertex;
+    }
+
+    indices.swap(output);
+}
+
+//---------------------------------
+// optimizeOverdraw()
+//---------------------------------
+void optimizeOverdraw(
+    std::vector<uint32_t>& indices,
+    const std::vector<glm::vec3>& positions,
+    const std::vector<uint32_t>& clusters,
+    uint32_t cacheSize,
+    float threshold)
+{
+    validateTriangleList(indices, positions.size(), "optimizeOverdraw() Indices are not a valid triangle list!");
+
+    const uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+    if (triangleCount == 0) {
+        return;
+    }
+
+    std::vector<uint32_t> hardBoundaries = clusters;
+    if (hardBoundaries.empty() || hardBoundaries[0] != 0) {
+        hardBoundaries.insert(hardBoundaries.begin(), 0);
+    }
+    hardBoundaries.push_back(triangleCount);
+
+    // Split each run wherever its ACMR so far is within threshold of the whole run's, so the
+    // split costs little more than the cache-optimal order
+    std::vector<uint32_t> boundaries;
+    CacheSimulation cache(positions.size(), cacheSize);
+    for (size_t c = 0; c + 1 < hardBoundaries.size(); c++) {
+        const uint32_t start = hardBoundaries[c];
+        const uint32_t end = hardBoundaries[c + 1];
+        if (start >= end || end > triangleCount) {
+            throw std::runtime_error("optimizeOverdraw() Cluster boundaries are not increasing!");
+        }
+
+        cache.flush();
+        uint32_t runMisses = 0;
+        for (uint32_t t = start; t < end; t++) {
+            runMisses += cache.touch(&indices[t * 3]);
+        }
+        const float clusterThreshold = threshold * static_cast<float>(runMisses) / static_cast<float>(end - start);
+
+        boundaries.push_back(start);
+        cache.flush();
+        uint32_t clusterMisses = 0;
+        uint32_t clusterSize = 0;
+        for (uint32_t t = start; t + 1 < end; t++) {
+            clusterMisses += cache.touch(&indices[t * 3]);
+            clusterSize++;
+            if (static_cast<float>(clusterMisses) <= clusterThreshold * static_cast<float>(clusterSize)) {
+                boundaries.push_back(t + 1);
+                clusterMisses = 0;
+                clusterSize = 0;
+                cache.flush();
+            }
+        }
+    }
+    boundaries.push_back(triangleCount);
+
+    // Area-weighted centroid and normal of every cluster
+    const size_t clusterCount = boundaries.size() - 1;
+    std::vector<glm::vec3> centroids(clusterCount, glm::vec3(0.0f));
+    std::vector<glm::vec3> normals(clusterCount, glm::vec3(0.0f));
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+    for (size_t c = 0; c < clusterCount; c++) {
+        float clusterArea = 0.0f;
+        for (uint32_t t = boundaries[c]; t < boundaries[c + 1]; t++) {
+            const glm::vec3& a = positions[indices[t * 3 + 0]];
+            const glm::vec3& b = positions[indices[t * 3 + 1]];
+            const glm::vec3& p = positions[indices[t * 3 + 2]];
+            glm::vec3 normal = glm::cross(p - a, b - a);
+            float area = glm::length(normal);
+            centroids[c] += (a + b + p) * (area / 3.0f);
+            normals[c] += normal;
+            clusterArea += area;
+        }
+        meshCentroid += centroids[c];
+        meshArea += clusterArea;
+        centroids[c] = clusterArea > 0.0f ? centroids[c] / clusterArea : positions[indices[boundaries[c] * 3]];
+    }
+    meshCentroid = meshArea > 0.0f ? meshCentroid / meshArea : centroids[0];
+
+    std::vector<float> sortKeys(clusterCount);
+    for (size_t c = 0; c < clusterCount; c++) {
+        float length = glm::length(normals[c]);
+        glm::vec3 normal = length > 0.0f ? normals[c] / length : glm::vec3(0.0f);
+        sortKeys[c] = glm::dot(centroids[c] - meshCentroid, normal);
+    }
+
+    std::vector<uint32_t> order(clusterCount);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return sortKeys[a] > sortKeys[b]; });
+
+    std::vector<uint32_t> output;
+    output.reserve(indices.size());
+    for (uint32_t c : order) {
+        output.insert(output.end(), indices.begin() + boundaries[c] * 3, indices.begin() + boundaries[c + 1] * 3);
+    }
+    indices.swap(output);
+}
+
+//---------------------------------
+// optimizeVertexFetch()
+//---------------------------------
+uint32_t optimizeVertexFetch(std::vector<uint32_t>& remap, std::vector<uint32_t>& indices, size_t vertexCount)
+{
+    validateTriangleList(indices, vertexCount, "optimizeVertexFetch() Indices are not a valid triangle list!");
+
+    remap.assign(vertexCount, VERTEX_REMAP_UNUSED);
+    uint32_t nextVertex = 0;
+    for (uint32_t& index : indices) {
+        if (remap[index] == VERTEX_REMAP_UNUSED) {
+            remap[index] = nextVertex++;
+        }
+        index = remap[index];
+    }
+    return nextVertex;
+}
@@ -0,0 +1,527 @@
+#include "meshlet_scene.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+const uint32_t MESHLET_TASK_WORKGROUP_SIZE = 32; // local_size_x in meshlet.task
+const uint32_t MESHLET_CULL_WORKGROUP_SIZE = 64; // local_size_x in meshlet_cull.comp
+const uint32_t MESHLET_BINDING_COUNT = 7;
+
+VkPipeline createMeshletCullPipeline(
+    const VkDevice& device,
+    const VkPipelineLayout& pipelineLayout,
+    const VkShaderModule& shaderModule,
+    bool compactDraws)
+{
+    // constant_id = 0 is COMPACT_DRAWS, as in cull.comp
+    VkBool32 compactDrawsValue = compactDraws ? VK_TRUE : VK_FALSE;
+
+    VkSpecializationMapEntry specializationEntry;
+    specializationEntry.constantID = 0;
+    specializationEntry.offset = 0;
+    specializationEntry.size = sizeof(VkBool32);
+
+    VkSpecializationInfo specializationInfo;
+    specializationInfo.mapEntryCount = 1;
+    specializationInfo.pMapEntries = &specializationEntry;
+    specializationInfo.dataSize = sizeof(VkBool32);
+    specializationInfo.pData = &compactDrawsValue;
+
+    VkComputePipelineCreateInfo pipelineInfo;
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.pNext = nullptr;
+    pipelineInfo.flags = 0;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.pNext = nullptr;
+    pipelineInfo.stage.flags = 0;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = shaderModule;
+    pipelineInfo.stage.pName = "main";
+    pipelineInfo.stage.pSpecializationInfo = &specializationInfo;
+    pipelineInfo.layout = pipelineLayout;
+    pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+    pipelineInfo.basePipelineIndex = -1;
+
+    VkPipeline pipeline;
+    if (vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
+        throw std::runtime_error("createMeshletScene() Failed to create meshlet cull pipeline!");
+    }
+    return pipeline;
+}
+
+VkDescriptorBufferInfo wholeBuffer(VkBuffer buffer)
+{
+    VkDescriptorBufferInfo bufferInfo;
+    bufferInfo.buffer = buffer;
+    bufferInfo.offset = 0;
+    bufferInfo.range = VK_WHOLE_SIZE;
+    return bufferInfo;
+}
+} // namespace
+
+//---------------------------------
+// hasMeshShaderSupport()
+//---------------------------------
+bool hasMeshShaderSupport(const DeviceFeatureChain& enabledFeatures)
+{
+    return enabledFeatures.meshShader.taskShader == VK_TRUE && enabledFeatures.meshShader.meshShader == VK_TRUE;
+}
+
+//---------------------------------
+// createMeshletScene()
+//---------------------------------
+void createMeshletScene(
+    MeshletScene& meshletScene,
+    const VkDevice& device,
+    const VkPhysicalDevice& physicalDevice,
+    const DeviceFeatureChain& enabledFeatures,
+    const QueueFamilyIndices& queueFamilies,
+    const VkCommandPool& transferCommandPool,
+    const VkQueue& transferQueue,
+    const VkDescriptorSetLayout& sceneSetLayout,
+    const VkRenderPass& renderPass,
+    const MaterialDesc& material,
+    const MeshletMesh& mesh,
+    const std::vector<GpuMeshletVertex>& vertices,
+    const std::vector<MeshletInstance>& instances)
+{
+    if (mesh.meshlets.empty() || instances.empty() || vertices.empty()) {
+        throw std::runtime_error("createMeshletScene() Scene has no meshlets!");
+    }
+
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+
+    meshletScene.instanceCount = static_cast<uint32_t>(instances.size());
+    meshletScene.maxDrawCount = std::min(meshletScene.instanceCount, deviceProperties.limits.maxDrawIndirectCount);
+    meshletScene.meshShaders = hasMeshShaderSupport(enabledFeatures);
+    meshletScene.compactDraws = enabledFeatures.vulkan12.drawIndirectCount == VK_TRUE;
+    meshletScene.multiDrawIndirect = enabledFeatures.features2.features.multiDrawIndirect == VK_TRUE;
+
+    if (meshletScene.meshShaders) {
+        VkPhysicalDeviceMeshShaderPropertiesEXT meshShaderProperties = {};
+        meshShaderProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_PROPERTIES_EXT;
+        VkPhysicalDeviceProperties2 properties2 = {};
+        properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        properties2.pNext = &meshShaderProperties;
+        vkGetPhysicalDeviceProperties2(physicalDevice, &properties2);
+        meshletScene.maxTaskWorkGroupCountX = meshShaderProperties.maxTaskWorkGroupCount[0];
+
+        meshletScene.drawMeshTasks
+            = reinterpret_cast<PFN_vkCmdDrawMeshTasksEXT>(vkGetDeviceProcAddr(device, "vkCmdDrawMeshTasksEXT"));
+        if (meshletScene.drawMeshTasks == nullptr) {
+            throw std::runtime_error("createMeshletScene() Failed to load vkCmdDrawMeshTasksEXT!");
+        }
+    }
+
+    std::vector<GpuMeshlet> meshlets(mesh.meshlets.size());
+    for (size_t i = 0; i < mesh.meshlets.size(); i++) {
+        const Meshlet& meshlet = mesh.meshlets[i];
+        const MeshletBounds& bounds = mesh.bounds[i];
+        meshlets[i].boundingSphere = glm::vec4(bounds.center, bounds.radius);
+        meshlets[i].coneApex = glm::vec4(bounds.coneApex, 0.0f);
+        meshlets[i].coneAxis = glm::vec4(bounds.coneAxis, bounds.coneCutoff);
+        meshlets[i].vertexOffset = meshlet.vertexOffset;
+        meshlets[i].triangleOffset = meshlet.triangleOffset;
+        meshlets[i].vertexCount = meshlet.vertexCount;
+        meshlets[i].triangleCount = meshlet.triangleCount;
+    }
+
+    // The mesh stage reads local indices packed per triangle; the fallback draws the same
+    // triangles through a regular index buffer of source vertex indices
+    std::vector<uint32_t> packedTriangles(mesh.triangles.size() / 3);
+    std::vector<uint32_t> indices(mesh.triangles.size());
+    for (const Meshlet& meshlet : mesh.meshlets) {
+        for (uint32_t t = 0; t < meshlet.triangleCount; t++) {
+            const uint32_t triangle = meshlet.triangleOffset + t;
+            const uint8_t* local = &mesh.triangles[triangle * 3];
+            packedTriangles[triangle] = local[0] | (local[1] << 8) | (local[2] << 16);
+            for (uint32_t corner = 0; corner < 3; corner++) {
+                indices[triangle * 3 + corner] = mesh.vertices[meshlet.vertexOffset + local[corner]];
+            }
+        }
+    }
+
+    std::vector<uint32_t> uploadFamilies = {queueFamilies.graphicsFamily.value(), queueFamilies.transferFamily.value()};
+    auto upload = [&](const void* data,
+                      VkDeviceSize size,
+                      VkBufferUsageFlags usage,
+                      VkBuffer& buffer,
+                      VkDeviceMemory& memory) {
+        createDeviceLocalBuffer(
+            device,
+            physicalDevice,
+            transferCommandPool,
+            transferQueue,
+            data,
+            size,
+            usage,
+            uploadFamilies,
+            buffer,
+            memory);
+    };
+
+    upload(
+        meshlets.data(),
+        sizeof(GpuMeshlet) * meshlets.size(),
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        meshletScene.meshletBuffer,
+        meshletScene.meshletBufferMemory);
+    upload(
+        instances.data(),
+        sizeof(MeshletInstance) * instances.size(),
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        meshletScene.instanceBuffer,
+        meshletScene.instanceBufferMemory);
+    upload(
+        mesh.vertices.data(),
+        sizeof(uint32_t) * mesh.vertices.size(),
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        meshletScene.vertexIndexBuffer,
+        meshletScene.vertexIndexBufferMemory);
+    upload(
+        packedTriangles.data(),
+        sizeof(uint32_t) * packedTriangles.size(),
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        meshletScene.triangleBuffer,
+        meshletScene.triangleBufferMemory);
+    upload(
+        vertices.data(),
+        sizeof(GpuMeshletVertex) * vertices.size(),
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        meshletScene.vertexDataBuffer,
+        meshletScene.vertexDataBufferMemory);
+    upload(
+        indices.data(),
+        sizeof(uint32_t) * indices.size(),
+        VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+        meshletScene.indexBuffer,
+        meshletScene.indexBufferMemory);
+
+    createBuffer(
+        device,
+        physicalDevice,
+        sizeof(VkDrawIndexedIndirectCommand) * instances.size(),
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        {},
+        meshletScene.drawCommandBuffer,
+        meshletScene.drawCommandBufferMemory);
+
+    createBuffer(
+        device,
+        physicalDevice,
+        sizeof(uint32_t),
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        {},
+        meshletScene.drawCountBuffer,
+        meshletScene.drawCountBufferMemory);
+
+    const VkShaderStageFlags cullStages
+        = meshletScene.meshShaders ? VK_SHADER_STAGE_TASK_BIT_EXT : VK_SHADER_STAGE_COMPUTE_BIT;
+    const VkShaderStageFlags meshStages = meshletScene.meshShaders ? VK_SHADER_STAGE_MESH_BIT_EXT : 0;
+
+    VkDescriptorSetLayoutBinding bindings[MESHLET_BINDING_COUNT];
+    for (uint32_t i = 0; i < MESHLET_BINDING_COUNT; i++) {
+        bindings[i].binding = i;
+        bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[i].descriptorCount = 1;
+        bindings[i].pImmutableSamplers = nullptr;
+    }
+    bindings[MESHLET_BINDING_MESHLETS].stageFlags = cullStages | meshStages;
+    bindings[MESHLET_BINDING_INSTANCES].stageFlags = cullStages | meshStages;
+    bindings[MESHLET_BINDING_VERTICES].stageFlags = meshStages;
+    bindings[MESHLET_BINDING_TRIANGLES].stageFlags = meshStages;
+    bindings[MESHLET_BINDING_VERTEX_DATA].stageFlags = meshStages;
+    bindings[MESHLET_BINDING_DRAW_COMMANDS].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    bindings[MESHLET_BINDING_DRAW_COUNT].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo;
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.pNext = nullptr;
+    layoutInfo.flags = 0;
+    layoutInfo.bindingCount = MESHLET_BINDING_COUNT;
+    layoutInfo.pBindings = bindings;
+
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &meshletScene.setLayout) != VK_SUCCESS) {
+        throw std::runtime_error("createMeshletScene() Failed to create descriptor set layout!");
+    }
+
+    VkDescriptorPoolSize poolSize;
+    poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSize.descriptorCount = MESHLET_BINDING_COUNT;
+
+    VkDescriptorPoolCreateInfo poolInfo;
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.pNext = nullptr;
+    poolInfo.flags = 0;
+    poolInfo.maxSets = 1;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+
+    if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &meshletScene.descriptorPool) != VK_SUCCESS) {
+        throw std::runtime_error("createMeshletScene() Failed to create descriptor pool!");
+    }
+
+    VkDescriptorSetAllocateInfo allocateInfo;
+    allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocateInfo.pNext = nullptr;
+    allocateInfo.descriptorPool = meshletScene.descriptorPool;
+    allocateInfo.descriptorSetCount = 1;
+    allocateInfo.pSetLayouts = &meshletScene.setLayout;
+
+    if (vkAllocateDescriptorSets(device, &allocateInfo, &meshletScene.descriptorSet) != VK_SUCCESS) {
+        throw std::runtime_error("createMeshletScene() Failed to allocate descriptor set!");
+    }
+
+    VkDescriptorBufferInfo bufferInfos[MESHLET_BINDING_COUNT] = {
+        wholeBuffer(meshletScene.meshletBuffer),
+        wholeBuffer(meshletScene.instanceBuffer),
+        wholeBuffer(meshletScene.vertexIndexBuffer),
+        wholeBuffer(meshletScene.triangleBuffer),
+        wholeBuffer(meshletScene.vertexDataBuffer),
+        wholeBuffer(meshletScene.drawCommandBuffer),
+        wholeBuffer(meshletScene.drawCountBuffer)};
+
+    VkWriteDescriptorSet writes[MESHLET_BINDING_COUNT];
+    for (uint32_t i = 0; i < MESHLET_BINDING_COUNT; i++) {
+        writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[i].pNext = nullptr;
+        writes[i].dstSet = meshletScene.descriptorSet;
+        writes[i].dstBinding = i;
+        writes[i].dstArrayElement = 0;
+        writes[i].descriptorCount = 1;
+        writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writes[i].pImageInfo = nullptr;
+        writes[i].pBufferInfo = &bufferInfos[i];
+        writes[i].pTexelBufferView = nullptr;
+    }
+    vkUpdateDescriptorSets(device, MESHLET_BINDING_COUNT, writes, 0, nullptr);
+
+    VkDescriptorSetLayout setLayouts[2] = {sceneSetLayout, meshletScene.setLayout};
+
+    VkPushConstantRange pushConstantRange;
+    pushConstantRange.stageFlags = cullStages;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(MeshletPushConstants);
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo;
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.pNext = nullptr;
+    pipelineLayoutInfo.flags = 0;
+    pipelineLayoutInfo.setLayoutCount = 2;
+    pipelineLayoutInfo.pSetLayouts = setLayouts;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &meshletScene.pipelineLayout) != VK_SUCCESS) {
+        throw std::runtime_error("createMeshletScene() Failed to create pipeline layout!");
+    }
+
+    if (meshletScene.meshShaders) {
+        meshletScene.meshProgram.taskModule = loadShaderModule(device, "meshlet.task");
+        meshletScene.meshProgram.meshModule = loadShaderModule(device, "meshlet.mesh");
+        meshletScene.meshProgram.fragmentModule = loadShaderModule(device, "default.frag");
+        meshletScene.meshPipeline = createPipelinePermutation(
+            device,
+            VK_NULL_HANDLE,
+            renderPass,
+            meshletScene.pipelineLayout,
+            meshletScene.meshProgram,
+            material.featureBits,
+            material.state);
+    }
+    else {
+        meshletScene.cullShaderModule = loadShaderModule(device, "meshlet_cull.comp");
+        meshletScene.cullPipeline = createMeshletCullPipeline(
+            device, meshletScene.pipelineLayout, meshletScene.cullShaderModule, meshletScene.compactDraws);
+    }
+}
+
+//---------------------------------
+// recordMeshletCulling()
+//---------------------------------
+void recordMeshletCulling(VkCommandBuffer commandBuffer, const MeshletScene& meshletScene, const GpuScene& scene)
+{
+    if (meshletScene.meshShaders) {
+        return;
+    }
+
+    vkCmdFillBuffer(commandBuffer, meshletScene.drawCountBuffer, 0, sizeof(uint32_t), 0);
+
+    VkMemoryBarrier clearBarrier;
+    clearBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    clearBarrier.pNext = nullptr;
+    clearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    clearBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0,
+        1,
+        &clearBarrier,
+        0,
+        nullptr,
+        0,
+        nullptr);
+
+    VkDescriptorSet descriptorSets[2] = {scene.descriptorSet, meshletScene.descriptorSet};
+
+    MeshletPushConstants pushConstants;
+    pushConstants.instanceCount = meshletScene.instanceCount;
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, meshletScene.cullPipeline);
+    vkCmdBindDescriptorSets(
+        commandBuffer,
+        VK_PIPELINE_BIND_POINT_COMPUTE,
+        meshletScene.pipelineLayout,
+        0,
+        2,
+        descriptorSets,
+        1,
+        &scene.cullUniformsOffset);
+    vkCmdPushConstants(
+        commandBuffer,
+        meshletScene.pipelineLayout,
+        VK_SHADER_STAGE_COMPUTE_BIT,
+        0,
+        sizeof(MeshletPushConstants),
+        &pushConstants);
+    uint32_t groupCount = (meshletScene.instanceCount + MESHLET_CULL_WORKGROUP_SIZE - 1) / MESHLET_CULL_WORKGROUP_SIZE;
+    vkCmdDispatch(commandBuffer, groupCount, 1, 1);
+
+    VkMemoryBarrier cullBarrier;
+    cullBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    cullBarrier.pNext = nullptr;
+    cullBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    cullBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+        0,
+        1,
+        &cullBarrier,
+        0,
+        nullptr,
+        0,
+        nullptr);
+}
+
+//---------------------------------
+// recordMeshletDraws()
+//---------------------------------
+void recordMeshletDraws(
+    VkCommandBuffer commandBuffer,
+    const MeshletScene& meshletScene,
+    const GpuScene& scene,
+    const VkPipelineLayout& pipelineLayout)
+{
+    if (meshletScene.meshShaders) {
+        VkDescriptorSet descriptorSets[2] = {scene.descriptorSet, meshletScene.descriptorSet};
+
+        MeshletPushConstants pushConstants;
+        pushConstants.instanceCount = meshletScene.instanceCount;
+
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, meshletScene.meshPipeline);
+        vkCmdBindDescriptorSets(
+            commandBuffer,
+            VK_PIPELINE_BIND_POINT_GRAPHICS,
+            meshletScene.pipelineLayout,
+            0,
+            2,
+            descriptorSets,
+            1,
+            &scene.cullUniformsOffset);
+        vkCmdPushConstants(
+            commandBuffer,
+            meshletScene.pipelineLayout,
+            VK_SHADER_STAGE_TASK_BIT_EXT,
+            0,
+            sizeof(MeshletPushConstants),
+            &pushConstants);
+
+        // One task workgroup per MESHLET_TASK_WORKGROUP_SIZE instances, folded into a second
+        // dimension past the X limit; meshlet.task linearizes the workgroup ID again
+        uint32_t groupCount
+            = (meshletScene.instanceCount + MESHLET_TASK_WORKGROUP_SIZE - 1) / MESHLET_TASK_WORKGROUP_SIZE;
+        uint32_t groupCountX = std::min(groupCount, meshletScene.maxTaskWorkGroupCountX);
+        uint32_t groupCountY = (groupCount + groupCountX - 1) / groupCountX;
+        meshletScene.drawMeshTasks(commandBuffer, groupCountX, groupCountY, 1);
+        return;
+    }
+
+    const uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+
+    vkCmdBindDescriptorSets(
+        commandBuffer,
+        VK_PIPELINE_BIND_POINT_GRAPHICS,
+        pipelineLayout,
+        0,
+        1,
+        &scene.descriptorSet,
+        1,
+        &scene.cullUniformsOffset);
+    vkCmdBindIndexBuffer(commandBuffer, meshletScene.indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+    // firstInstance of each command is the object index, resolved through the identity stream
+    VkDeviceSize instanceOffset = 0;
+    vkCmdBindVertexBuffers(commandBuffer, 0, 1, &scene.identityInstanceBuffer, &instanceOffset);
+
+    if (meshletScene.compactDraws) {
+        vkCmdDrawIndexedIndirectCount(
+            commandBuffer,
+            meshletScene.drawCommandBuffer,
+            0,
+            meshletScene.drawCountBuffer,
+            0,
+            meshletScene.maxDrawCount,
+            stride);
+        return;
+    }
+
+    uint32_t batchSize = meshletScene.multiDrawIndirect ? meshletScene.maxDrawCount : 1;
+    for (uint32_t first = 0; first < meshletScene.instanceCount; first += batchSize) {
+        uint32_t drawCount = std::min(batchSize, meshletScene.instanceCount - first);
+        VkDeviceSize offset = static_cast<VkDeviceSize>(first) * stride;
+        vkCmdDrawIndexedIndirect(commandBuffer, meshletScene.drawCommandBuffer, offset, drawCount, stride);
+    }
+}
+
+//---------------------------------
+// destroyMeshletScene()
+//---------------------------------
+void destroyMeshletScene(MeshletScene& meshletScene, const VkDevice& device)
+{
+    vkDestroyPipeline(device, meshletScene.meshPipeline, nullptr);
+    vkDestroyShaderModule(device, meshletScene.meshProgram.taskModule, nullptr);
+    vkDestroyShaderModule(device, meshletScene.meshProgram.meshModule, nullptr);
+    vkDestroyShaderModule(device, meshletScene.meshProgram.fragmentModule, nullptr);
+    vkDestroyPipeline(device, meshletScene.cullPipeline, nullptr);
+    vkDestroyShaderModule(device, meshletScene.cullShaderModule, nullptr);
+    vkDestroyPipelineLayout(device, meshletScene.pipelineLayout, nullptr);
+
+    vkDestroyDescriptorPool(device, meshletScene.descriptorPool, nullptr);
+    vkDestroyDescriptorSetLayout(device, meshletScene.setLayout, nullptr);
+
+    vkDestroyBuffer(device, meshletScene.drawCountBuffer, nullptr);
+    vkFreeMemory(device, meshletScene.drawCountBufferMemory, nullptr);
+    vkDestroyBuffer(device, meshletScene.drawCommandBuffer, nullptr);
+    vkFreeMemory(device, meshletScene.drawCommandBufferMemory, nullptr);
+    vkDestroyBuffer(device, meshletScene.indexBuffer, nullptr);
+    vkFreeMemory(device, meshletScene.indexBufferMemory, nullptr);
+    vkDestroyBuffer(device, meshletScene.vertexDataBuffer, nullptr);
+    vkFreeMemory(device, meshletScene.vertexDataBufferMemory, nullptr);
+    vkDestroyBuffer(device, meshletScene.triangleBuffer, nullptr);
+    vkFreeMemory(device, meshletScene.triangleBufferMemory, nullptr);
+    vkDestroyBuffer(device, meshletScene.vertexIndexBuffer, nullptr);
+    vkFreeMemory(device, meshletScene.vertexIndexBufferMemory, nullptr);
+    vkDestroyBuffer(device, meshletScene.instanceBuffer, nullptr);
+    vkFreeMemory(device, meshletScene.instanceBufferMemory, nullptr);
+    vkDestroyBuffer(device, meshletScene.meshletBuffer, nullptr);
+    vkFreeMemory(device, meshletScene.meshletBufferMemory, nullptr);
+
+    meshletScene = MeshletScene{};
+}
@@ -0,0 +1,166 @@
+#include "meshlets.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+const uint8_t UNASSIGNED_VERTEX = 0xFF;
+
+void finishMeshlet(MeshletMesh& mesh, Meshlet& meshlet, const std::vector<glm::vec3>& positions)
+{
+    mesh.meshlets.push_back(meshlet);
+    mesh.bounds.push_back(computeMeshletBounds(mesh, meshlet, positions));
+
+    meshlet.vertexOffset = static_cast<uint32_t>(mesh.vertices.size());
+    meshlet.triangleOffset = static_cast<uint32_t>(mesh.triangles.size() / 3);
+    meshlet.vertexCount = 0;
+    meshlet.triangleCount = 0;
+}
+} // namespace
+
+//---------------------------------
+// buildMeshlets()
+//---------------------------------
+uint32_t buildMeshlets(
+    MeshletMesh& mesh,
+    const std::vector<uint32_t>& indices,
+    uint32_t firstIndex,
+    uint32_t indexCount,
+    const std::vector<glm::vec3>& positions,
+    uint32_t maxVertices,
+    uint32_t maxTriangles)
+{
+    if (indexCount % 3 != 0 || static_cast<size_t>(firstIndex) + indexCount > indices.size()) {
+        throw std::runtime_error("buildMeshlets() Index range is not a whole triangle list!");
+    }
+    if (maxVertices < 3 || maxVertices >= UNASSIGNED_VERTEX || maxTriangles == 0) {
+        throw std::runtime_error("buildMeshlets() Meshlet limits out of range!");
+    }
+
+    const uint32_t firstMeshlet = static_cast<uint32_t>(mesh.meshlets.size());
+
+    // Local index of each source vertex in the meshlet being built
+    std::vector<uint8_t> localIndices(positions.size(), UNASSIGNED_VERTEX);
+
+    Meshlet meshlet;
+    meshlet.vertexOffset = static_cast<uint32_t>(mesh.vertices.size());
+    meshlet.triangleOffset = static_cast<uint32_t>(mesh.triangles.size() / 3);
+    meshlet.vertexCount = 0;
+    meshlet.triangleCount = 0;
+
+    for (uint32_t i = firstIndex; i < firstIndex + indexCount; i += 3) {
+        const uint32_t triangle[3] = {indices[i], indices[i + 1], indices[i + 2]};
+
+        uint32_t newVertices = 0;
+        for (uint32_t vertex : triangle) {
+            if (vertex >= positions.size()) {
+                throw std::runtime_error("buildMeshlets() Index out of range of the vertex positions!");
+            }
+            newVertices += localIndices[vertex] == UNASSIGNED_VERTEX ? 1 : 0;
+        }
+
+        if (meshlet.vertexCount + newVertices > maxVertices || meshlet.triangleCount + 1 > maxTriangles) {
+            for (uint32_t v = 0; v < meshlet.vertexCount; v++) {
+                localIndices[mesh.vertices[meshlet.vertexOffset + v]] = UNASSIGNED_VERTEX;
+            }
+            finishMeshlet(mesh, meshlet, positions);
+        }
+
+        for (uint32_t vertex : triangle) {
+            if (localIndices[vertex] == UNASSIGNED_VERTEX) {
+                localIndices[vertex] = static_cast<uint8_t>(meshlet.vertexCount++);
+                mesh.vertices.push_back(vertex);
+            }
+            mesh.triangles.push_back(localIndices[vertex]);
+        }
+        meshlet.triangleCount++;
+    }
+
+    if (meshlet.triangleCount > 0) {
+        finishMeshlet(mesh, meshlet, positions);
+    }
+
+    return firstMeshlet;
+}
+
+//---------------------------------
+// computeMeshletBounds()
+//---------------------------------
+MeshletBounds computeMeshletBounds(
+    const MeshletMesh& mesh,
+    const Meshlet& meshlet,
+    const std::vector<glm::vec3>& positions)
+{
+    MeshletBounds bounds;
+
+    // Sphere around the vertex bounding box; not minimal, but cheap and conservative
+    glm::vec3 boxMin(INFINITY);
+    glm::vec3 boxMax(-INFINITY);
+    for (uint32_t v = 0; v < meshlet.vertexCount; v++) {
+        const glm::vec3& position = positions[mesh.vertices[meshlet.vertexOffset + v]];
+        boxMin = glm::min(boxMin, position);
+        boxMax = glm::max(boxMax, position);
+    }
+    bounds.center = 0.5f * (boxMin + boxMax);
+    bounds.radius = 0.0f;
+    for (uint32_t v = 0; v < meshlet.vertexCount; v++) {
+        const glm::vec3& position = positions[mesh.vertices[meshlet.vertexOffset + v]];
+        bounds.radius = std::max(bounds.radius, glm::length(position - bounds.center));
+    }
+
+    // Front faces are clockwise, so (c - a) x (b - a) points out of the front face
+    std::vector<glm::vec3> normals;
+    std::vector<glm::vec3> corners;
+    normals.reserve(meshlet.triangleCount);
+    corners.reserve(meshlet.triangleCount);
+    for (uint32_t t = 0; t < meshlet.triangleCount; t++) {
+        const uint8_t* triangle = &mesh.triangles[(meshlet.triangleOffset + t) * 3];
+        const glm::vec3& a = positions[mesh.vertices[meshlet.vertexOffset + triangle[0]]];
+        const glm::vec3& b = positions[mesh.vertices[meshlet.vertexOffset + triangle[1]]];
+        const glm::vec3& c = positions[mesh.vertices[meshlet.vertexOffset + triangle[2]]];
+
+        glm::vec3 normal = glm::cross(c - a, b - a);
+        float length = glm::length(normal);
+        if (length > 0.0f) {
+            normals.push_back(normal / length);
+            corners.push_back(a);
+        }
+    }
+
+    bounds.coneApex = bounds.center;
+    bounds.coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+    bounds.coneCutoff = 1.0f;
+
+    glm::vec3 normalSum(0.0f);
+    for (const glm::vec3& normal : normals) {
+        normalSum += normal;
+    }
+    float sumLength = glm::length(normalSum);
+    if (normals.empty() || sumLength == 0.0f) {
+        return bounds;
+    }
+    const glm::vec3 axis = normalSum / sumLength;
+
+    float minDot = 1.0f;
+    for (const glm::vec3& normal : normals) {
+        minDot = std::min(minDot, glm::dot(normal, axis));
+    }
+    // Normals spread over a hemisphere or more: some triangle always faces the camera
+    if (minDot <= 0.0f) {
+        return bounds;
+    }
+
+    // Move the apex back along the axis until every triangle plane faces away from it, so the
+    // test is exact for cameras anywhere, not just far away
+    float apexDistance = 0.0f;
+    for (size_t t = 0; t < normals.size(); t++) {
+        float distance = glm::dot(bounds.center - corners[t], normals[t]) / glm::dot(axis, normals[t]);
+        apexDistance = std::max(apexDistance, distance);
+    }
+
+    bounds.coneApex = bounds.center - axis * apexDistance;
+    bounds.coneAxis = axis;
+    bounds.coneCutoff = std::sqrt(std::max(0.0f, 1.0f - minDot * minDot));
+    return bounds;
+}
@@ -0,0 +1,340 @@
+#include "pipeline_permutations.h"
+
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+
+//---------------------------------
+// PipelineStateDesc::operator<()
+//---------------------------------
+bool PipelineStateDesc::operator<(const PipelineStateDesc& other) const
+{
+    return std::tie(topology, polygonMode, cullMode, frontFace, blendEnable, depthTestEnable, depthWriteEnable, depthCompareOp)
+        < std::tie(
+            other.topology,
+            other.polygonMode,
+            other.cullMode,
+            other.frontFace,
+            other.blendEnable,
+            other.depthTestEnable,
+            other.depthWriteEnable,
+            other.depthCompareOp);
+}
+
+//---------------------------------
+// PipelineKey::operator<()
+//---------------------------------
+bool PipelineKey::operator<(const PipelineKey& other) const
+{
+    return std::tie(shaderProgram, featureBits, state) < std::tie(other.shaderProgram, other.featureBits, other.state);
+}
+
+//---------------------------------
+// makePipelineKey()
+//---------------------------------
+PipelineKey makePipelineKey(const MaterialDesc& material)
+{
+    PipelineKey key;
+    key.shaderProgram = material.shaderProgram;
+    key.featureBits = material.featureBits;
+    key.state = material.state;
+    return key;
+}
+
+//---------------------------------
+// initPipelinePermutationCache()
+//---------------------------------
+void initPipelinePermutationCache(
+    PipelinePermutationCache& cache,
+    const VkDevice& device,
+    const VkRenderPass& renderPass,
+    const VkPipelineLayout& pipelineLayout)
+{
+    cache.device = device;
+    cache.renderPass = renderPass;
+    cache.pipelineLayout = pipelineLayout;
+
+    VkPipelineCacheCreateInfo createInfo;
+    createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    createInfo.pNext = nullptr;
+    createInfo.flags = 0;
+    createInfo.initialDataSize = 0;
+    createInfo.pInitialData = nullptr;
+
+    if (vkCreatePipelineCache(device, &createInfo, nullptr, &cache.pipelineCache) != VK_SUCCESS) {
+        throw std::runtime_error("initPipelinePermutationCache() Failed to create pipeline cache!");
+    }
+}
+
+//---------------------------------
+// registerShaderProgram()
+//---------------------------------
+uint32_t registerShaderProgram(
+    PipelinePermutationCache& cache,
+    VkShaderModule vertexModule,
+    VkShaderModule fragmentModule,
+    const std::string& vertexSourceName,
+    const std::string& fragmentSourceName,
+    VertexFormat vertexFormat)
+{
+    ShaderProgram program;
+    program.vertexModule = vertexModule;
+    program.fragmentModule = fragmentModule;
+    program.vertexSourceName = vertexSourceName;
+    program.fragmentSourceName = fragmentSourceName;
+    program.vertexFormat = vertexFormat;
+
+    cache.programs.push_back(program);
+    return static_cast<uint32_t>(cache.programs.size() - 1);
+}
+
+//---------------------------------
+// getPipelinePermutation()
+//---------------------------------
+VkPipeline getPipelinePermutation(PipelinePermutationCache& cache, const PipelineKey& key)
+{
+    auto it = cache.pipelines.find(key);
+    if (it != cache.pipelines.end()) {
+        return it->second;
+    }
+
+    if (key.shaderProgram >= cache.programs.size()) {
+        throw std::runtime_error("getPipelinePermutation() Unknown shader program!");
+    }
+
+    VkPipeline pipeline = createPipelinePermutation(
+        cache.device,
+        cache.pipelineCache,
+        cache.renderPass,
+        cache.pipelineLayout,
+        cache.programs[key.shaderProgram],
+        key.featureBits,
+        key.state);
+    cache.pipelines.emplace(key, pipeline);
+
+    return pipeline;
+}
+
+//---------------------------------
+// destroyPipelinePermutationCache()
+//---------------------------------
+void destroyPipelinePermutationCache(PipelinePermutationCache& cache)
+{
+    for (const auto& [key, pipeline] : cache.pipelines) {
+        vkDestroyPipeline(cache.device, pipeline, nullptr);
+    }
+    cache.pipelines.clear();
+
+    for (const ShaderProgram& program : cache.programs) {
+        vkDestroyShaderModule(cache.device, program.taskModule, nullptr);
+        vkDestroyShaderModule(cache.device, program.meshModule, nullptr);
+        vkDestroyShaderModule(cache.device, program.vertexModule, nullptr);
+        vkDestroyShaderModule(cache.device, program.fragmentModule, nullptr);
+    }
+    cache.programs.clear();
+
+    vkDestroyPipelineCache(cache.device, cache.pipelineCache, nullptr);
+    cache.pipelineCache = nullptr;
+}
+
+//---------------------------------
+// createPipelinePermutation()
+//---------------------------------
+VkPipeline createPipelinePermutation(
+    const VkDevice& device,
+    const VkPipelineCache& pipelineCache,
+    const VkRenderPass& renderPass,
+    const VkPipelineLayout& pipelineLayout,
+    const ShaderProgram& program,
+    uint32_t featureBits,
+    const PipelineStateDesc& state)
+{
+    // One VkBool32 per feature bit, constant_id == bit index. Entries for ids a
+    // stage doesn't declare are ignored, so all stages share the same info.
+    VkBool32 specializationData[MATERIAL_FEATURE_COUNT];
+    VkSpecializationMapEntry specializationEntries[MATERIAL_FEATURE_COUNT];
+    for (uint32_t i = 0; i < MATERIAL_FEATURE_COUNT; i++) {
+        specializationData[i] = (featureBits & (1u << i)) ? VK_TRUE : VK_FALSE;
+
+        specializationEntries[i].constantID = i;
+        specializationEntries[i].offset = i * sizeof(VkBool32);
+        specializationEntries[i].size = sizeof(VkBool32);
+    }
+
+    VkSpecializationInfo specializationInfo;
+    specializationInfo.mapEntryCount = MATERIAL_FEATURE_COUNT;
+    specializationInfo.pMapEntries = specializationEntries;
+    specializationInfo.dataSize = sizeof(specializationData);
+    specializationInfo.pData = specializationData;
+
+    // Mesh shader programs replace the vertex stage (and fixed-function vertex input) with an
+    // optional task stage and a mesh stage
+    std::vector<std::pair<VkShaderStageFlagBits, VkShaderModule>> stageModules;
+    if (program.meshModule != nullptr) {
+        if (program.taskModule != nullptr) {
+            stageModules.emplace_back(VK_SHADER_STAGE_TASK_BIT_EXT, program.taskModule);
+        }
+        stageModules.emplace_back(VK_SHADER_STAGE_MESH_BIT_EXT, program.meshModule);
+    }
+    else {
+        stageModules.emplace_back(VK_SHADER_STAGE_VERTEX_BIT, program.vertexModule);
+    }
+    stageModules.emplace_back(VK_SHADER_STAGE_FRAGMENT_BIT, program.fragmentModule);
+
+    std::vector<VkPipelineShaderStageCreateInfo> shaderStages;
+    for (const auto& [stage, module] : stageModules) {
+        VkPipelineShaderStageCreateInfo shaderStageInfo;
+        shaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        shaderStageInfo.pNext = nullptr;
+        shaderStageInfo.flags = 0;
+        shaderStageInfo.stage = stage;
+        shaderStageInfo.module = module;
+        shaderStageInfo.pName = "main";
+        shaderStageInfo.pSpecializationInfo = &specializationInfo;
+        shaderStages.push_back(shaderStageInfo);
+    }
+
+    std::vector<VkDynamicState> dynamicStates = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+    VkPipelineDynamicStateCreateInfo dynamicState;
+    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.pNext = nullptr;
+    dynamicState.flags = 0;
+    dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+    dynamicState.pDynamicStates = dynamicStates.data();
+
+    // Every program reads the per-instance object index that GpuScene binds at binding 0;
+    // programs with a vertex format also read a vertex buffer
+    VkVertexInputBindingDescription instanceBinding;
+    instanceBinding.binding = 0;
+    instanceBinding.stride = sizeof(uint32_t);
+    instanceBinding.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+
+    VkVertexInputAttributeDescription instanceAttribute;
+    instanceAttribute.location = 0;
+    instanceAttribute.binding = 0;
+    instanceAttribute.format = VK_FORMAT_R32_UINT;
+    instanceAttribute.offset = 0;
+
+    std::vector<VkVertexInputBindingDescription> vertexBindings = {instanceBinding};
+    std::vector<VkVertexInputAttributeDescription> vertexAttributes = {instanceAttribute};
+    appendVertexInputDescriptions(program.vertexFormat, vertexBindings, vertexAttributes);
+
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo;
+    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    vertexInputInfo.pNext = nullptr;
+    vertexInputInfo.flags = 0;
+    vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(vertexBindings.size());
+    vertexInputInfo.pVertexBindingDescriptions = vertexBindings.data();
+    vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(vertexAttributes.size());
+    vertexInputInfo.pVertexAttributeDescriptions = vertexAttributes.data();
+
+    VkPipelineInputAssemblyStateCreateInfo inputAssemblyInfo;
+    inputAssemblyInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    inputAssemblyInfo.pNext = nullptr;
+    inputAssemblyInfo.flags = 0;
+    inputAssemblyInfo.topology = state.topology;
+    inputAssemblyInfo.primitiveRestartEnable = VK_FALSE;
+
+    // Viewport and scissor are dynamic, so permutations don't depend on the swapchain extent
+    VkPipelineViewportStateCreateInfo viewportStateInfo;
+    viewportStateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportStateInfo.pNext = nullptr;
+    viewportStateInfo.flags = 0;
+    viewportStateInfo.viewportCount = 1;
+    viewportStateInfo.pViewports = nullptr;
+    viewportStateInfo.scissorCount = 1;
+    viewportStateInfo.pScissors = nullptr;
+
+    VkPipelineRasterizationStateCreateInfo rasterizerInfo;
+    rasterizerInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterizerInfo.pNext = nullptr;
+    rasterizerInfo.flags = 0;
+    rasterizerInfo.depthClampEnable = VK_FALSE;
+    rasterizerInfo.rasterizerDiscardEnable = VK_FALSE;
+    rasterizerInfo.polygonMode = state.polygonMode;
+    rasterizerInfo.cullMode = state.cullMode;
+    rasterizerInfo.frontFace = state.frontFace;
+    rasterizerInfo.depthBiasEnable = VK_FALSE;
+    rasterizerInfo.depthBiasConstantFactor = 0.0f;
+    rasterizerInfo.depthBiasClamp = 0.0f;
+    rasterizerInfo.depthBiasSlopeFactor = 0.0f;
+    rasterizerInfo.lineWidth = 1.0f;
+
+    VkPipelineMultisampleStateCreateInfo multisamplingInfo;
+    multisamplingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisamplingInfo.pNext = nullptr;
+    multisamplingInfo.flags = 0;
+    multisamplingInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+    multisamplingInfo.sampleShadingEnable = VK_FALSE;
+    multisamplingInfo.minSampleShading = 1.0f;
+    multisamplingInfo.pSampleMask = nullptr;
+    multisamplingInfo.alphaToCoverageEnable = VK_FALSE;
+    multisamplingInfo.alphaToOneEnable = VK_FALSE;
+
+    VkPipelineDepthStencilStateCreateInfo depthStencilInfo;
+    depthStencilInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depthStencilInfo.pNext = nullptr;
+    depthStencilInfo.flags = 0;
+    depthStencilInfo.depthTestEnable = state.depthTestEnable;
+    depthStencilInfo.depthWriteEnable = state.depthWriteEnable;
+    depthStencilInfo.depthCompareOp = state.depthCompareOp;
+    depthStencilInfo.depthBoundsTestEnable = VK_FALSE;
+    depthStencilInfo.stencilTestEnable = VK_FALSE;
+    depthStencilInfo.front = {};
+    depthStencilInfo.back = {};
+    depthStencilInfo.minDepthBounds = 0.0f;
+    depthStencilInfo.maxDepthBounds = 1.0f;
+
+    VkPipelineColorBlendAttachmentState colorBlendAttachementState;
+    colorBlendAttachementState.blendEnable = state.blendEnable;
+    colorBlendAttachementState.srcColorBlendFactor = state.blendEnable ? VK_BLEND_FACTOR_SRC_ALPHA : VK_BLEND_FACTOR_ONE;
+    colorBlendAttachementState.dstColorBlendFactor
+        = state.blendEnable ? VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA : VK_BLEND_FACTOR_ZERO;
+    colorBlendAttachementState.colorBlendOp = VK_BLEND_OP_ADD;
+    colorBlendAttachementState.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    colorBlendAttachementState.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+    colorBlendAttachementState.alphaBlendOp = VK_BLEND_OP_ADD;
+    colorBlendAttachementState.colorWriteMask
+        = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+
+    VkPipelineColorBlendStateCreateInfo colorBlending;
+    colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlending.pNext = nullptr;
+    colorBlending.flags = 0;
+    colorBlending.logicOpEnable = VK_FALSE;
+    colorBlending.logicOp = VK_LOGIC_OP_COPY;
+    colorBlending.attachmentCount = 1;
+    colorBlending.pAttachments = &colorBlendAttachementState;
+    colorBlending.blendConstants[0] = 0.0f;
+    colorBlending.blendConstants[1] = 0.0f;
+    colorBlending.blendConstants[2] = 0.0f;
+    colorBlending.blendConstants[3] = 0.0f;
+
+    VkGraphicsPipelineCreateInfo pipelineInfo;
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.pNext = nullptr;
+    pipelineInfo.flags = 0;
+    pipelineInfo.stageCount = static_cast<uint32_t>(shaderStages.size());
+    pipelineInfo.pStages = shaderStages.data();
+    pipelineInfo.pVertexInputState = program.meshModule != nullptr ? nullptr : &vertexInputInfo;
+    pipelineInfo.pInputAssemblyState = program.meshModule != nullptr ? nullptr : &inputAssemblyInfo;
+    pipelineInfo.pTessellationState = nullptr;
+    pipelineInfo.pViewportState = &viewportStateInfo;
+    pipelineInfo.pRasterizationState = &rasterizerInfo;
+    pipelineInfo.pMultisampleState = &multisamplingInfo;
+    pipelineInfo.pDepthStencilState = &depthStencilInfo;
+    pipelineInfo.pColorBlendState = &colorBlending;
+    pipelineInfo.pDynamicState = &dynamicState;
+    pipelineInfo.layout = pipelineLayout;
+    pipelineInfo.renderPass = renderPass;
+    pipelineInfo.subpass = 0;
+    pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+    pipelineInfo.basePipelineIndex = -1;
+
+    VkPipeline pipeline;
+    if (vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
+        throw std::runtime_error("createPipelinePermutation() Failed to create graphics pipeline!");
+    }
+
+    return pipeline;
+}
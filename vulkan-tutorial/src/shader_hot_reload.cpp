@@ -0,0 +1,410 @@
+#include "shader_hot_reload.h"
+
+#include "vulkan_utils.h"
+#include "utils.h"
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <set>
+#include <stdexcept>
+
+#if SHADER_HOT_RELOAD_ENABLE
+    #include <shaderc/shaderc.h>
+
+    #include <poll.h>
+    #include <sys/inotify.h>
+    #include <unistd.h>
+#endif
+
+#if SHADER_HOT_RELOAD_ENABLE
+namespace {
+bool isGlslSource(const std::string& name)
+{
+    return name.ends_with(".vert") || name.ends_with(".frag") || name.ends_with(".comp");
+}
+
+void watchShaderDirectory(ShaderHotReloader* reloader)
+{
+    alignas(inotify_event) char buffer[4096];
+
+    while (reloader->running) {
+        pollfd pollDescriptor;
+        pollDescriptor.fd = reloader->inotifyFd;
+        pollDescriptor.events = POLLIN;
+        pollDescriptor.revents = 0;
+
+        // Time out regularly so stopShaderHotReload() doesn't have to wake us up
+        if (poll(&pollDescriptor, 1, 100) <= 0) {
+            continue;
+        }
+
+        ssize_t length = read(reloader->inotifyFd, buffer, sizeof(buffer));
+        if (length <= 0) {
+            continue;
+        }
+
+        // Editors emit several events per save; collapse them into one compile per file
+        std::set<std::string> changedSources;
+        for (char* ptr = buffer; ptr < buffer + length;) {
+            const inotify_event* event = reinterpret_cast<const inotify_event*>(ptr);
+            if (event->len > 0 && isGlslSource(event->name)) {
+                changedSources.insert(event->name);
+            }
+            ptr += sizeof(inotify_event) + event->len;
+        }
+
+        for (const std::string& sourceName : changedSources) {
+            try {
+                CompiledShader compiled;
+                compiled.sourceName = sourceName;
+                compiled.spirv = compileGlslToSpirv(reloader->shaderDirectory + "/" + sourceName);
+
+                std::lock_guard<std::mutex> lock(reloader->compiledMutex);
+                reloader->compiledShaders.push_back(std::move(compiled));
+            }
+            catch (std::exception& e) {
+                std::cerr << e.what() << std::endl;
+            }
+        }
+    }
+}
+
+// Releases everything a rebuild created. Modules it shares with the cache are left alone.
+void destroyProgramRebuilds(
+    const VkDevice& device,
+    const std::vector<ShaderProgram>& cachePrograms,
+    const std::vector<ProgramRebuild>& rebuilds)
+{
+    for (const ProgramRebuild& rebuild : rebuilds) {
+        for (const auto& [key, pipeline] : rebuild.pipelines) {
+            vkDestroyPipeline(device, pipeline, nullptr);
+        }
+
+        const ShaderProgram& original = cachePrograms[rebuild.shaderProgram];
+        if (rebuild.program.vertexModule != original.vertexModule) {
+            vkDestroyShaderModule(device, rebuild.program.vertexModule, nullptr);
+        }
+        if (rebuild.program.fragmentModule != original.fragmentModule) {
+            vkDestroyShaderModule(device, rebuild.program.fragmentModule, nullptr);
+        }
+    }
+}
+
+// Owns the strings a shaderc_include_result points at until shaderc releases it
+struct IncludeResult
+{
+    shaderc_include_result result;
+    std::string sourceName;
+    std::string content;
+};
+
+// Resolves #include "name" relative to the including file, like glslc does for the offline build
+shaderc_include_result* resolveInclude(
+    void* /*userData*/, const char* requestedSource, int /*type*/, const char* requestingSource, size_t /*depth*/)
+{
+    IncludeResult* include = new IncludeResult;
+
+    std::string requesting = requestingSource;
+    size_t separator = requesting.find_last_of('/');
+    std::string path = separator == std::string::npos ? "" : requesting.substr(0, separator + 1);
+    path += requestedSource;
+
+    try {
+        std::vector<char> content = readFile(path);
+        include->sourceName = path;
+        include->content.assign(content.begin(), content.end());
+    }
+    catch (std::exception&) {
+        // An empty source name tells shaderc the include failed; content becomes the error message
+        include->content = "Cannot open included file " + path;
+    }
+
+    include->result.source_name = include->sourceName.c_str();
+    include->result.source_name_length = include->sourceName.size();
+    include->result.content = include->content.c_str();
+    include->result.content_length = include->content.size();
+    include->result.user_data = include;
+    return &include->result;
+}
+
+void releaseInclude(void* /*userData*/, shaderc_include_result* result)
+{
+    delete static_cast<IncludeResult*>(result->user_data);
+}
+
+// Matches TARGET_ENV in shaders/Makefile for the stages compiled here
+shaderc_env_version getTargetEnvVersion(const std::string& path)
+{
+    std::string name = path.substr(path.find_last_of('/') + 1);
+    if (name.ends_with(".vert")
+        || ((name.starts_with("primitive_") || name.starts_with("downsample_subgroup_")) && name.ends_with(".comp"))) {
+        return shaderc_env_version_vulkan_1_2;
+    }
+    return shaderc_env_version_vulkan_1_0;
+}
+} // namespace
+#endif
+
+//---------------------------------
+// startShaderHotReload()
+//---------------------------------
+void startShaderHotReload(ShaderHotReloader& reloader, const std::string& shaderDirectory)
+{
+#if SHADER_HOT_RELOAD_ENABLE
+    reloader.shaderDirectory = shaderDirectory;
+
+    reloader.inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (reloader.inotifyFd < 0) {
+        throw std::runtime_error("startShaderHotReload() inotify_init1() failed");
+    }
+
+    // IN_CLOSE_WRITE covers in-place saves, IN_MOVED_TO covers editors that write a temp file and rename
+    reloader.watchDescriptor = inotify_add_watch(reloader.inotifyFd, shaderDirectory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (reloader.watchDescriptor < 0) {
+        close(reloader.inotifyFd);
+        reloader.inotifyFd = -1;
+        throw std::runtime_error("startShaderHotReload() inotify_add_watch() failed");
+    }
+
+    reloader.running = true;
+    reloader.watcherThread = std::thread(watchShaderDirectory, &reloader);
+#else
+    (void)reloader;
+    (void)shaderDirectory;
+#endif
+}
+
+//---------------------------------
+// stopShaderHotReload()
+//---------------------------------
+void stopShaderHotReload(ShaderHotReloader& reloader, PipelinePermutationCache& cache)
+{
+#if SHADER_HOT_RELOAD_ENABLE
+    if (!reloader.running) {
+        return;
+    }
+
+    reloader.running = false;
+    reloader.watcherThread.join();
+
+    inotify_rm_watch(reloader.inotifyFd, reloader.watchDescriptor);
+    close(reloader.inotifyFd);
+    reloader.inotifyFd = -1;
+    reloader.watchDescriptor = -1;
+
+    // A rebuild that never got swapped in still owns its modules and pipelines
+    if (reloader.pendingRebuild.valid()) {
+        try {
+            destroyProgramRebuilds(cache.device, cache.programs, reloader.pendingRebuild.get());
+        }
+        catch (std::exception&) {
+            // Failed rebuilds clean up after themselves
+        }
+    }
+#else
+    (void)reloader;
+    (void)cache;
+#endif
+}
+
+//---------------------------------
+// applyShaderHotReload()
+//---------------------------------
+bool applyShaderHotReload(ShaderHotReloader& reloader, PipelinePermutationCache& cache)
+{
+#if SHADER_HOT_RELOAD_ENABLE
+    if (!reloader.running) {
+        return false;
+    }
+
+    // Swap in a finished rebuild
+    if (reloader.pendingRebuild.valid()) {
+        if (reloader.pendingRebuild.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            return false;
+        }
+
+        std::vector<ProgramRebuild> rebuilds;
+        try {
+            rebuilds = reloader.pendingRebuild.get();
+        }
+        catch (std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return false;
+        }
+
+        // Old modules and pipelines may still be referenced by in-flight command buffers
+        vkDeviceWaitIdle(cache.device);
+
+        for (const ProgramRebuild& rebuild : rebuilds) {
+            ShaderProgram& program = cache.programs[rebuild.shaderProgram];
+            if (program.vertexModule != rebuild.program.vertexModule) {
+                vkDestroyShaderModule(cache.device, program.vertexModule, nullptr);
+            }
+            if (program.fragmentModule != rebuild.program.fragmentModule) {
+                vkDestroyShaderModule(cache.device, program.fragmentModule, nullptr);
+            }
+            program = rebuild.program;
+
+            // Drops permutations requested while the rebuild was running too; they get rebuilt lazily
+            std::erase_if(cache.pipelines, [&cache, &rebuild](const auto& entry) {
+                if (entry.first.shaderProgram != rebuild.shaderProgram) {
+                    return false;
+                }
+                vkDestroyPipeline(cache.device, entry.second, nullptr);
+                return true;
+            });
+            cache.pipelines.insert(rebuild.pipelines.begin(), rebuild.pipelines.end());
+        }
+
+        std::cout << "Shader hot reload: swapped " << rebuilds.size() << " program(s)" << std::endl;
+        return true;
+    }
+
+    std::vector<CompiledShader> compiledShaders;
+    {
+        std::lock_guard<std::mutex> lock(reloader.compiledMutex);
+        compiledShaders.swap(reloader.compiledShaders);
+    }
+    if (compiledShaders.empty()) {
+        return false;
+    }
+
+    // A file saved again while a rebuild was pending is queued more than once; keep its newest compile
+    std::set<std::string> seenSources;
+    std::vector<CompiledShader> latestShaders;
+    for (auto it = compiledShaders.rbegin(); it != compiledShaders.rend(); ++it) {
+        if (seenSources.insert(it->sourceName).second) {
+            latestShaders.push_back(std::move(*it));
+        }
+    }
+
+    // Each affected program gets its own copy of the new modules so ownership stays one-to-one
+    std::vector<ProgramRebuild> rebuilds;
+    try {
+        for (uint32_t i = 0; i < cache.programs.size(); i++) {
+            // Added up front so a failing createShaderModule() leaves every new module in rebuilds
+            ProgramRebuild& rebuild = rebuilds.emplace_back();
+            rebuild.shaderProgram = i;
+            rebuild.program = cache.programs[i];
+
+            bool affected = false;
+            for (const CompiledShader& compiled : latestShaders) {
+                if (compiled.sourceName == rebuild.program.vertexSourceName) {
+                    rebuild.program.vertexModule = createShaderModule(cache.device, compiled.spirv);
+                    affected = true;
+                }
+                if (compiled.sourceName == rebuild.program.fragmentSourceName) {
+                    rebuild.program.fragmentModule = createShaderModule(cache.device, compiled.spirv);
+                    affected = true;
+                }
+            }
+            if (!affected) {
+                rebuilds.pop_back();
+                continue;
+            }
+
+            for (const auto& [key, pipeline] : cache.pipelines) {
+                if (key.shaderProgram == i) {
+                    rebuild.pipelines.emplace_back(key, VK_NULL_HANDLE);
+                }
+            }
+        }
+    }
+    catch (std::exception& e) {
+        destroyProgramRebuilds(cache.device, cache.programs, rebuilds);
+        std::cerr << e.what() << std::endl;
+        return false;
+    }
+    if (rebuilds.empty()) {
+        return false;
+    }
+
+    // The pipeline cache is internally synchronized, so permutations can be compiled off the render thread
+    reloader.pendingRebuild = std::async(
+        std::launch::async,
+        [device = cache.device,
+         pipelineCache = cache.pipelineCache,
+         renderPass = cache.renderPass,
+         pipelineLayout = cache.pipelineLayout,
+         originals = cache.programs,
+         rebuilds]() mutable {
+            try {
+                for (ProgramRebuild& rebuild : rebuilds) {
+                    for (auto& [key, pipeline] : rebuild.pipelines) {
+                        pipeline = createPipelinePermutation(
+                            device, pipelineCache, renderPass, pipelineLayout, rebuild.program, key.featureBits, key.state);
+                    }
+                }
+            }
+            catch (...) {
+                destroyProgramRebuilds(device, originals, rebuilds);
+                throw;
+            }
+            return rebuilds;
+        });
+
+    return false;
+#else
+    (void)reloader;
+    (void)cache;
+    return false;
+#endif
+}
+
+//---------------------------------
+// compileGlslToSpirv()
+//---------------------------------
+std::vector<uint32_t> compileGlslToSpirv(const std::string& path)
+{
+#if SHADER_HOT_RELOAD_ENABLE
+    shaderc_shader_kind kind;
+    if (path.ends_with(".vert")) {
+        kind = shaderc_glsl_vertex_shader;
+    }
+    else if (path.ends_with(".frag")) {
+        kind = shaderc_glsl_fragment_shader;
+    }
+    else if (path.ends_with(".comp")) {
+        kind = shaderc_glsl_compute_shader;
+    }
+    else {
+        throw std::runtime_error("compileGlslToSpirv() Unknown shader stage for " + path);
+    }
+
+    std::vector<char> source = readFile(path);
+
+    shaderc_compiler_t compiler = shaderc_compiler_initialize();
+    shaderc_compile_options_t options = shaderc_compile_options_initialize();
+    shaderc_compile_options_set_optimization_level(options, shaderc_optimization_level_performance);
+    shaderc_compile_options_set_target_env(options, shaderc_target_env_vulkan, getTargetEnvVersion(path));
+    shaderc_compile_options_set_include_callbacks(options, resolveInclude, releaseInclude, nullptr);
+
+    shaderc_compilation_result_t result
+        = shaderc_compile_into_spv(compiler, source.data(), source.size(), kind, path.c_str(), "main", options);
+
+    std::vector<uint32_t> spirv;
+    bool success = shaderc_result_get_compilation_status(result) == shaderc_compilation_status_success;
+    std::string errorMessage;
+    if (success) {
+        // shaderc hands back a char buffer with no alignment guarantee, so copy instead of casting
+        spirv.resize(shaderc_result_get_length(result) / sizeof(uint32_t));
+        memcpy(spirv.data(), shaderc_result_get_bytes(result), spirv.size() * sizeof(uint32_t));
+    }
+    else {
+        errorMessage = shaderc_result_get_error_message(result);
+    }
+
+    shaderc_result_release(result);
+    shaderc_compile_options_release(options);
+    shaderc_compiler_release(compiler);
+
+    if (!success) {
+        throw std::runtime_error("compileGlslToSpirv() Failed to compile " + path + ":\n" + errorMessage);
+    }
+
+    return spirv;
+#else
+    throw std::runtime_error("compileGlslToSpirv() Shader hot reload is not enabled in this build for " + path);
+#endif
+}
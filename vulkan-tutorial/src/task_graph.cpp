@@ -0,0 +1,278 @@
+#include "task_graph.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+//---------------------------------
+// runTaskGraph()
+//---------------------------------
+std::vector<TaskTiming> runTaskGraph(const std::vector<TaskGraphNode>& nodes, uint32_t workerCount)
+{
+    using Clock = std::chrono::steady_clock;
+    const Clock::time_point graphStart = Clock::now();
+
+    std::map<std::string, size_t> nodeIndices;
+    for (size_t i = 0; i < nodes.size(); i++) {
+        if (!nodeIndices.emplace(nodes[i].name, i).second) {
+            throw std::runtime_error("runTaskGraph() Duplicate task name " + nodes[i].name);
+        }
+    }
+
+    std::vector<uint32_t> pendingDependencies(nodes.size(), 0);
+    std::vector<std::vector<size_t>> dependents(nodes.size());
+    for (size_t i = 0; i < nodes.size(); i++) {
+        for (const std::string& dependency : nodes[i].dependencies) {
+            auto it = nodeIndices.find(dependency);
+            if (it == nodeIndices.end()) {
+                throw std::runtime_error("runTaskGraph() " + nodes[i].name + " depends on unknown task " + dependency);
+            }
+            dependents[it->second].push_back(i);
+            pendingDependencies[i]++;
+        }
+    }
+
+    std::mutex mutex;
+    std::condition_variable readyCondition;
+    std::deque<size_t> readyWorkerNodes;
+    std::deque<size_t> readyMainNodes;
+    size_t runningCount = 0;
+    size_t finishedCount = 0;
+    std::exception_ptr firstError;
+    std::vector<TaskTiming> timings;
+
+    auto enqueueLocked = [&](size_t index) {
+        if (nodes[index].mainThreadOnly || workerCount == 0) {
+            readyMainNodes.push_back(index);
+        }
+        else {
+            readyWorkerNodes.push_back(index);
+        }
+    };
+    for (size_t i = 0; i < nodes.size(); i++) {
+        if (pendingDependencies[i] == 0) {
+            enqueueLocked(i);
+        }
+    }
+    if (!nodes.empty() && readyMainNodes.empty() && readyWorkerNodes.empty()) {
+        throw std::runtime_error("runTaskGraph() Task graph has no root node");
+    }
+
+    // Done once nothing is running and nothing more can start: everything ran, a node failed,
+    // or the remaining nodes are stuck in a cycle
+    auto isDoneLocked = [&]() {
+        return finishedCount == nodes.size()
+            || (runningCount == 0 && (firstError || (readyMainNodes.empty() && readyWorkerNodes.empty())));
+    };
+
+    auto runNode = [&](size_t index, bool onMainThread, std::unique_lock<std::mutex>& lock) {
+        runningCount++;
+        lock.unlock();
+
+        TaskTiming timing;
+        timing.name = nodes[index].name;
+        timing.ranOnMainThread = onMainThread;
+        const Clock::time_point start = Clock::now();
+        std::exception_ptr error;
+        try {
+            nodes[index].work();
+        }
+        catch (...) {
+            error = std::current_exception();
+        }
+        const Clock::time_point end = Clock::now();
+        timing.startMs = std::chrono::duration<double, std::milli>(start - graphStart).count();
+        timing.durationMs = std::chrono::duration<double, std::milli>(end - start).count();
+
+        lock.lock();
+        runningCount--;
+        timings.push_back(timing);
+        if (error) {
+            if (!firstError) {
+                firstError = error;
+            }
+        }
+        else {
+            finishedCount++;
+            if (!firstError) {
+                for (size_t dependent : dependents[index]) {
+                    if (--pendingDependencies[dependent] == 0) {
+                        enqueueLocked(dependent);
+                    }
+                }
+            }
+        }
+        readyCondition.notify_all();
+    };
+
+    std::vector<std::thread> workers;
+    for (uint32_t i = 0; i < workerCount; i++) {
+        workers.emplace_back([&]() {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (true) {
+                readyCondition.wait(lock, [&]() { return isDoneLocked() || (!firstError && !readyWorkerNodes.empty()); });
+                if (isDoneLocked()) {
+                    return;
+                }
+                size_t index = readyWorkerNodes.front();
+                readyWorkerNodes.pop_front();
+                runNode(index, false, lock);
+            }
+        });
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            readyCondition.wait(lock, [&]() { return isDoneLocked() || (!firstError && !readyMainNodes.empty()); });
+            if (isDoneLocked()) {
+                break;
+            }
+            size_t index = readyMainNodes.front();
+            readyMainNodes.pop_front();
+            runNode(index, true, lock);
+        }
+    }
+
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+
+    if (firstError) {
+        std::rethrow_exception(firstError);
+    }
+    if (finishedCount != nodes.size()) {
+        throw std::runtime_error("runTaskGraph() Task graph contains a dependency cycle");
+    }
+
+    return timings;
+}
+
+//---------------------------------
+// printTaskTimings()
+//---------------------------------
+void printTaskTimings(const std::string& label, const std::vector<TaskTiming>& timings)
+{
+    double totalMs = 0.0;
+    double busyMs = 0.0;
+    for (const TaskTiming& timing : timings) {
+        totalMs = std::max(totalMs, timing.startMs + timing.durationMs);
+        busyMs += timing.durationMs;
+    }
+
+    std::ios_base::fmtflags flags = std::cout.flags();
+    std::streamsize precision = std::cout.precision();
+
+    std::cout << label << " finished in " << std::fixed << std::setprecision(2) << totalMs << " ms (" << busyMs
+              << " ms of work)" << std::endl;
+    for (const TaskTiming& timing : timings) {
+        std::cout << "  " << std::left << std::setw(24) << timing.name << std::right << " start " << std::setw(8)
+                  << timing.startMs << " ms  took " << std::setw(8) << timing.durationMs << " ms"
+                  << (timing.ranOnMainThread ? "  [main]" : "") << std::endl;
+    }
+    std::cout.flags(flags);
+    std::cout.precision(precision);
+}
+
+namespace {
+// Takes items of the current job until none are left; called and returns with the lock held
+void runWorkerPoolItems(WorkerPool& pool, std::unique_lock<std::mutex>& lock)
+{
+    while (pool.nextItem < pool.itemCount) {
+        const uint32_t item = pool.nextItem++;
+        lock.unlock();
+
+        std::exception_ptr error;
+        try {
+            (*pool.work)(item);
+        }
+        catch (...) {
+            error = std::current_exception();
+        }
+
+        lock.lock();
+        if (error && !pool.firstError) {
+            pool.firstError = error;
+        }
+        if (--pool.unfinishedCount == 0) {
+            pool.doneCondition.notify_all();
+        }
+    }
+}
+} // namespace
+
+//---------------------------------
+// startWorkerPool()
+//---------------------------------
+void startWorkerPool(WorkerPool& pool, uint32_t threadCount)
+{
+    pool.stopping = false;
+    for (uint32_t i = 0; i < threadCount; i++) {
+        pool.threads.emplace_back([&pool]() {
+            std::unique_lock<std::mutex> lock(pool.mutex);
+            while (true) {
+                pool.workCondition.wait(lock, [&]() { return pool.stopping || pool.nextItem < pool.itemCount; });
+                if (pool.stopping) {
+                    return;
+                }
+                runWorkerPoolItems(pool, lock);
+            }
+        });
+    }
+}
+
+//---------------------------------
+// stopWorkerPool()
+//---------------------------------
+void stopWorkerPool(WorkerPool& pool)
+{
+    {
+        std::lock_guard<std::mutex> lock(pool.mutex);
+        pool.stopping = true;
+    }
+    pool.workCondition.notify_all();
+    for (std::thread& thread : pool.threads) {
+        thread.join();
+    }
+    pool.threads.clear();
+}
+
+//---------------------------------
+// runParallelFor()
+//---------------------------------
+void runParallelFor(WorkerPool& pool, uint32_t count, const std::function<void(uint32_t)>& work)
+{
+    if (count == 0) {
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(pool.mutex);
+    pool.work = &work;
+    pool.itemCount = count;
+    pool.nextItem = 0;
+    pool.unfinishedCount = count;
+    pool.firstError = nullptr;
+    pool.workCondition.notify_all();
+
+    runWorkerPoolItems(pool, lock);
+    pool.doneCondition.wait(lock, [&]() { return pool.unfinishedCount == 0; });
+
+    std::exception_ptr error = pool.firstError;
+    pool.work = nullptr;
+    pool.itemCount = 0;
+    pool.nextItem = 0;
+    pool.firstError = nullptr;
+    lock.unlock();
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
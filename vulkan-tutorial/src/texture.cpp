@@ -0,0 +1,436 @@
+#include "texture.h"
+#include "vulkan_utils.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+// Satisfies vkCmdCopyBufferToImage()'s offset alignment for every supported format
+const VkDeviceSize TEXTURE_STAGING_ALIGNMENT = 16;
+
+//---------------------------------
+// transitionTextureLevels()
+//---------------------------------
+void transitionTextureLevels(
+    VkCommandBuffer commandBuffer,
+    const Texture& texture,
+    uint32_t baseLevel,
+    uint32_t levelCount,
+    VkImageLayout oldLayout,
+    VkImageLayout newLayout,
+    VkPipelineStageFlags srcStage,
+    VkAccessFlags srcAccess,
+    VkPipelineStageFlags dstStage,
+    VkAccessFlags dstAccess)
+{
+    VkImageMemoryBarrier barrier;
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.pNext = nullptr;
+    barrier.srcAccessMask = srcAccess;
+    barrier.dstAccessMask = dstAccess;
+    barrier.oldLayout = oldLayout;
+    barrier.newLayout = newLayout;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = texture.image;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel = baseLevel;
+    barrier.subresourceRange.levelCount = levelCount;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+
+    vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+//---------------------------------
+// uploadTextureLevels()
+//---------------------------------
+// Copies levels [baseLevel, baseLevel + levelCount) from the mapped file into the image in one
+// submission and leaves them ready for sampling
+void uploadTextureLevels(
+    const Texture& texture,
+    const VkDevice& device,
+    const VkPhysicalDevice& physicalDevice,
+    const VkCommandPool& commandPool,
+    const VkQueue& queue,
+    uint32_t baseLevel,
+    uint32_t levelCount)
+{
+    std::vector<VkBufferImageCopy> regions(levelCount);
+    VkDeviceSize stagingSize = 0;
+    for (uint32_t i = 0; i < levelCount; i++) {
+        const uint32_t level = baseLevel + i;
+        VkBufferImageCopy& region = regions[i];
+        region.bufferOffset = stagingSize;
+        region.bufferRowLength = 0;
+        region.bufferImageHeight = 0;
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.mipLevel = level;
+        region.imageSubresource.baseArrayLayer = 0;
+        region.imageSubresource.layerCount = 1;
+        region.imageOffset = {0, 0, 0};
+        region.imageExtent = {std::max(texture.width >> level, 1u), std::max(texture.height >> level, 1u), 1};
+
+        stagingSize += texture.source.levels[level].byteLength;
+        stagingSize = (stagingSize + TEXTURE_STAGING_ALIGNMENT - 1) & ~(TEXTURE_STAGING_ALIGNMENT - 1);
+    }
+
+    VkBuffer stagingBuffer;
+    VkDeviceMemory stagingBufferMemory;
+    createBuffer(
+        device,
+        physicalDevice,
+        stagingSize,
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        {},
+        stagingBuffer,
+        stagingBufferMemory);
+
+    // Straight from the mapping: the file's block layout is what the image expects
+    uint8_t* mapped = nullptr;
+    vkMapMemory(device, stagingBufferMemory, 0, stagingSize, 0, reinterpret_cast<void**>(&mapped));
+    for (uint32_t i = 0; i < levelCount; i++) {
+        const Ktx2Level& level = texture.source.levels[baseLevel + i];
+        memcpy(mapped + regions[i].bufferOffset, texture.source.file.data + level.byteOffset, level.byteLength);
+    }
+    vkUnmapMemory(device, stagingBufferMemory);
+
+    VkCommandBuffer commandBuffer = beginSingleTimeCommands(device, commandPool);
+    transitionTextureLevels(
+        commandBuffer,
+        texture,
+        baseLevel,
+        levelCount,
+        VK_IMAGE_LAYOUT_UNDEFINED,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+        0,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_ACCESS_TRANSFER_WRITE_BIT);
+    vkCmdCopyBufferToImage(
+        commandBuffer,
+        stagingBuffer,
+        texture.image,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        static_cast<uint32_t>(regions.size()),
+        regions.data());
+    transitionTextureLevels(
+        commandBuffer,
+        texture,
+        baseLevel,
+        levelCount,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_ACCESS_TRANSFER_WRITE_BIT,
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_ACCESS_SHADER_READ_BIT);
+    endSingleTimeCommands(device, commandPool, queue, commandBuffer);
+
+    vkDestroyBuffer(device, stagingBuffer, nullptr);
+    vkFreeMemory(device, stagingBufferMemory, nullptr);
+}
+
+//---------------------------------
+// canGenerateTextureMips()
+//---------------------------------
+bool canGenerateTextureMips(const VkPhysicalDevice& physicalDevice, const Downsampler& mipGenerator, VkFormat format)
+{
+    if (mipGenerator.format != format) {
+        return false;
+    }
+
+    VkFormatProperties properties;
+    vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &properties);
+    return (properties.optimalTilingFeatures & VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT) != 0;
+}
+
+//---------------------------------
+// generateTextureMips()
+//---------------------------------
+// Fills levels 1 and up from level 0, which must already be uploaded. One downsample dispatch
+// covers DOWNSAMPLE_MAX_MIPS levels, so only textures larger than 4096 need a second one.
+void generateTextureMips(
+    const Texture& texture,
+    const VkDevice& device,
+    const VkPhysicalDevice& physicalDevice,
+    const VkCommandPool& commandPool,
+    const VkQueue& queue,
+    const Downsampler& mipGenerator)
+{
+    std::vector<VkImageView> sourceViews;
+    std::vector<DownsampleChain> chains;
+    for (uint32_t sourceLevel = 0; sourceLevel + 1 < texture.levelCount; sourceLevel += DOWNSAMPLE_MAX_MIPS) {
+        const uint32_t baseLevel = sourceLevel + 1;
+        sourceViews.push_back(
+            createImageView(device, texture.image, texture.format, VK_IMAGE_ASPECT_COLOR_BIT, sourceLevel, 1));
+
+        chains.emplace_back();
+        createDownsampleChain(
+            chains.back(),
+            device,
+            physicalDevice,
+            commandPool,
+            queue,
+            mipGenerator,
+            texture.image,
+            baseLevel,
+            std::max(texture.width >> baseLevel, 1u),
+            std::max(texture.height >> baseLevel, 1u),
+            std::min(DOWNSAMPLE_MAX_MIPS, texture.levelCount - baseLevel),
+            sourceViews.back(),
+            sourceLevel == 0 ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_GENERAL);
+    }
+
+    VkCommandBuffer commandBuffer = beginSingleTimeCommands(device, commandPool);
+    transitionTextureLevels(
+        commandBuffer,
+        texture,
+        1,
+        texture.levelCount - 1,
+        VK_IMAGE_LAYOUT_UNDEFINED,
+        VK_IMAGE_LAYOUT_GENERAL,
+        VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+        0,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+    for (size_t i = 0; i < chains.size(); i++) {
+        const uint32_t sourceLevel = static_cast<uint32_t>(i) * DOWNSAMPLE_MAX_MIPS;
+        if (i > 0) {
+            // The next chain samples the last level of the previous one
+            VkMemoryBarrier chainBarrier;
+            chainBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+            chainBarrier.pNext = nullptr;
+            chainBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+            chainBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+            vkCmdPipelineBarrier(
+                commandBuffer,
+                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                0,
+                1,
+                &chainBarrier,
+                0,
+                nullptr,
+                0,
+                nullptr);
+        }
+
+        VkExtent2D sourceExtent;
+        sourceExtent.width = std::max(texture.width >> sourceLevel, 1u);
+        sourceExtent.height = std::max(texture.height >> sourceLevel, 1u);
+        recordDownsample(commandBuffer, mipGenerator, chains[i], sourceExtent);
+    }
+
+    transitionTextureLevels(
+        commandBuffer,
+        texture,
+        1,
+        texture.levelCount - 1,
+        VK_IMAGE_LAYOUT_GENERAL,
+        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_ACCESS_SHADER_WRITE_BIT,
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_ACCESS_SHADER_READ_BIT);
+    endSingleTimeCommands(device, commandPool, queue, commandBuffer);
+
+    for (DownsampleChain& chain : chains) {
+        destroyDownsampleChain(chain, device);
+    }
+    for (VkImageView sourceView : sourceViews) {
+        vkDestroyImageView(device, sourceView, nullptr);
+    }
+}
+} // namespace
+
+//---------------------------------
+// isTextureFormatSupported()
+//---------------------------------
+bool isTextureFormatSupported(
+    const VkPhysicalDevice& physicalDevice,
+    const DeviceFeatureChain& enabledFeatures,
+    VkFormat format)
+{
+    uint32_t blockSize = 0;
+    if (getTextureFormatBlockBytes(format, blockSize) == 0) {
+        return false;
+    }
+    if (isBlockCompressedFormat(format) && enabledFeatures.features2.features.textureCompressionBC != VK_TRUE) {
+        return false;
+    }
+
+    VkFormatProperties properties;
+    vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &properties);
+    const VkFormatFeatureFlags required = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT
+        | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT | VK_FORMAT_FEATURE_TRANSFER_DST_BIT;
+    return (properties.optimalTilingFeatures & required) == required;
+}
+
+//---------------------------------
+// createTexture()
+//---------------------------------
+void createTexture(
+    Texture& texture,
+    const VkDevice& device,
+    const VkPhysicalDevice& physicalDevice,
+    const DeviceFeatureChain& enabledFeatures,
+    const VkCommandPool& commandPool,
+    const VkQueue& queue,
+    const std::string& filename,
+    const Downsampler* mipGenerator)
+{
+    openKtx2File(texture.source, filename);
+    if (!isTextureFormatSupported(physicalDevice, enabledFeatures, texture.source.format)) {
+        closeKtx2File(texture.source);
+        throw std::runtime_error("createTexture() Texture format not supported by the device: " + filename);
+    }
+
+    texture.format = texture.source.format;
+    texture.width = texture.source.width;
+    texture.height = texture.source.height;
+    const uint32_t sourceLevelCount = static_cast<uint32_t>(texture.source.levels.size());
+    texture.levelCount = sourceLevelCount;
+
+    const bool generateMips = sourceLevelCount == 1 && mipGenerator != nullptr
+        && canGenerateTextureMips(physicalDevice, *mipGenerator, texture.format);
+    if (generateMips) {
+        while ((std::max(texture.width, texture.height) >> texture.levelCount) > 0) {
+            texture.levelCount++;
+        }
+    }
+
+    // The tail always includes the last level, even for a texture with no small mips
+    uint32_t tailLevel = sourceLevelCount - 1;
+    while (tailLevel > 0
+           && std::max(texture.width >> (tailLevel - 1), texture.height >> (tailLevel - 1))
+               <= TEXTURE_RESIDENT_TAIL_SIZE) {
+        tailLevel--;
+    }
+
+    createImage(
+        device,
+        physicalDevice,
+        texture.width,
+        texture.height,
+        texture.levelCount,
+        texture.format,
+        VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT
+            | (generateMips ? VK_IMAGE_USAGE_STORAGE_BIT : 0),
+        texture.image,
+        texture.imageMemory);
+
+    uploadTextureLevels(texture, device, physicalDevice, commandPool, queue, tailLevel, sourceLevelCount - tailLevel);
+    if (generateMips && texture.levelCount > 1) {
+        generateTextureMips(texture, device, physicalDevice, commandPool, queue, *mipGenerator);
+    }
+    texture.residentLevel = tailLevel;
+    texture.view = createImageView(
+        device,
+        texture.image,
+        texture.format,
+        VK_IMAGE_ASPECT_COLOR_BIT,
+        texture.residentLevel,
+        texture.levelCount - texture.residentLevel);
+
+    if (isTextureFullyResident(texture)) {
+        closeKtx2File(texture.source);
+    }
+}
+
+//---------------------------------
+// streamTextureLevel()
+//---------------------------------
+bool streamTextureLevel(
+    Texture& texture,
+    const VkDevice& device,
+    const VkPhysicalDevice& physicalDevice,
+    const VkCommandPool& commandPool,
+    const VkQueue& queue)
+{
+    if (isTextureFullyResident(texture)) {
+        return false;
+    }
+
+    const uint32_t level = texture.residentLevel - 1;
+    uploadTextureLevels(texture, device, physicalDevice, commandPool, queue, level, 1);
+
+    vkDestroyImageView(device, texture.view, nullptr);
+    texture.residentLevel = level;
+    texture.view = createImageView(
+        device,
+        texture.image,
+        texture.format,
+        VK_IMAGE_ASPECT_COLOR_BIT,
+        texture.residentLevel,
+        texture.levelCount - texture.residentLevel);
+
+    if (isTextureFullyResident(texture)) {
+        closeKtx2File(texture.source);
+    }
+    return true;
+}
+
+//---------------------------------
+// isTextureFullyResident()
+//---------------------------------
+bool isTextureFullyResident(const Texture& texture)
+{
+    return texture.residentLevel == 0;
+}
+
+//---------------------------------
+// destroyTexture()
+//---------------------------------
+void destroyTexture(Texture& texture, const VkDevice& device)
+{
+    vkDestroyImageView(device, texture.view, nullptr);
+    vkDestroyImage(device, texture.image, nullptr);
+    vkFreeMemory(device, texture.imageMemory, nullptr);
+    closeKtx2File(texture.source);
+    texture = Texture();
+}
+
+//---------------------------------
+// createTextureSampler()
+//---------------------------------
+VkSampler createTextureSampler(
+    const VkDevice& device,
+    const VkPhysicalDevice& physicalDevice,
+    const DeviceFeatureChain& enabledFeatures)
+{
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    const bool anisotropy = enabledFeatures.features2.features.samplerAnisotropy == VK_TRUE;
+
+    VkSamplerCreateInfo samplerInfo;
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.pNext = nullptr;
+    samplerInfo.flags = 0;
+    samplerInfo.magFilter = VK_FILTER_LINEAR;
+    samplerInfo.minFilter = VK_FILTER_LINEAR;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    samplerInfo.mipLodBias = 0.0f;
+    samplerInfo.anisotropyEnable = anisotropy ? VK_TRUE : VK_FALSE;
+    samplerInfo.maxAnisotropy =
+        anisotropy ? std::min(TEXTURE_MAX_ANISOTROPY, properties.limits.maxSamplerAnisotropy) : 1.0f;
+    samplerInfo.compareEnable = VK_FALSE;
+    samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
+    samplerInfo.minLod = 0.0f;
+    samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+    samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_TRANSPARENT_BLACK;
+    samplerInfo.unnormalizedCoordinates = VK_FALSE;
+
+    VkSampler sampler;
+    if (vkCreateSampler(device, &samplerInfo, nullptr, &sampler) != VK_SUCCESS) {
+        throw std::runtime_error("createTextureSampler() Failed to create sampler!");
+    }
+    return sampler;
+}
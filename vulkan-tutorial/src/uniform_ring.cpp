@@ -0,0 +1,108 @@
+#include "uniform_ring.h"
+#include "vulkan_utils.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+//---------------------------------
+// createUniformRing()
+//---------------------------------
+void createUniformRing(
+    UniformRing& ring,
+    const VkDevice& device,
+    const VkPhysicalDevice& physicalDevice,
+    VkDeviceSize frameSize,
+    uint32_t frameCount)
+{
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+    // A power of two; rounding the region size up to it keeps every region start aligned
+    ring.alignment = std::max<VkDeviceSize>(properties.limits.minUniformBufferOffsetAlignment, 1);
+    ring.frameSize = (frameSize + ring.alignment - 1) & ~(ring.alignment - 1);
+    ring.frameCount = frameCount;
+    // The first beginUniformRingFrame() moves to region 0
+    ring.frame = frameCount - 1;
+    ring.head = 0;
+
+    const VkDeviceSize size = ring.frameSize * frameCount;
+    if (size > UINT32_MAX) {
+        throw std::runtime_error("createUniformRing() Ring too large for 32-bit dynamic offsets!");
+    }
+
+    createBuffer(
+        device,
+        physicalDevice,
+        size,
+        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        {},
+        ring.buffer,
+        ring.bufferMemory);
+
+    void* mapped = nullptr;
+    if (vkMapMemory(device, ring.bufferMemory, 0, size, 0, &mapped) != VK_SUCCESS) {
+        throw std::runtime_error("createUniformRing() Failed to map uniform ring memory!");
+    }
+    ring.mapped = static_cast<uint8_t*>(mapped);
+}
+
+//---------------------------------
+// beginUniformRingFrame()
+//---------------------------------
+void beginUniformRingFrame(UniformRing& ring)
+{
+    ring.frame = (ring.frame + 1) % ring.frameCount;
+    ring.head = 0;
+}
+
+//---------------------------------
+// allocateUniforms()
+//---------------------------------
+UniformAllocation allocateUniforms(UniformRing& ring, VkDeviceSize size)
+{
+    if (ring.head + size > ring.frameSize) {
+        throw std::runtime_error("allocateUniforms() Uniform ring frame region exhausted!");
+    }
+
+    const VkDeviceSize offset = ring.frame * ring.frameSize + ring.head;
+    ring.head = (ring.head + size + ring.alignment - 1) & ~(ring.alignment - 1);
+
+    UniformAllocation allocation;
+    allocation.offset = static_cast<uint32_t>(offset);
+    allocation.data = ring.mapped + offset;
+    return allocation;
+}
+
+//---------------------------------
+// pushUniforms()
+//---------------------------------
+uint32_t pushUniforms(UniformRing& ring, const void* data, VkDeviceSize size)
+{
+    UniformAllocation allocation = allocateUniforms(ring, size);
+    memcpy(allocation.data, data, size);
+    return allocation.offset;
+}
+
+//---------------------------------
+// getUniformRingDescriptor()
+//---------------------------------
+VkDescriptorBufferInfo getUniformRingDescriptor(const UniformRing& ring, VkDeviceSize range)
+{
+    VkDescriptorBufferInfo info;
+    info.buffer = ring.buffer;
+    info.offset = 0;
+    info.range = range;
+    return info;
+}
+
+//---------------------------------
+// destroyUniformRing()
+//---------------------------------
+void destroyUniformRing(UniformRing& ring, const VkDevice& device)
+{
+    vkDestroyBuffer(device, ring.buffer, nullptr);
+    vkFreeMemory(device, ring.bufferMemory, nullptr);
+    ring = UniformRing{};
+}
@@ -22,5 +22,32 @@ std::vector<char> readFile(const std::string& filename)
 
     file.close();
 
+    return buffer;
+}
+
+//---------------------------------
+// readSpirvFile()
+//---------------------------------
+std::vector<uint32_t> readSpirvFile(const std::string& filename)
+{
+    std::ifstream file(filename, std::ios::ate | std::ios::binary);
+
+    if (!file.is_open()) {
+        throw std::runtime_error("readSpirvFile() Failed to open file!");
+    }
+
+    size_t fileSize = (size_t)file.tellg();
+    if (fileSize % sizeof(uint32_t) != 0) {
+        throw std::runtime_error("readSpirvFile() File size is not a multiple of 4 bytes!");
+    }
+
+    // Reading straight into uint32_t storage keeps the words aligned for VkShaderModuleCreateInfo::pCode
+    std::vector<uint32_t> buffer(fileSize / sizeof(uint32_t));
+
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(buffer.data()), fileSize);
+
+    file.close();
+
     return buffer;
 }
\ No newline at end of file
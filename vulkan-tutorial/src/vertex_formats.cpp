@@ -0,0 +1,170 @@
+#include "vertex_formats.h"
+
+#include <glm/gtc/packing.hpp>
+
+#include <cstddef>
+#include <stdexcept>
+
+//---------------------------------
+// computeVertexQuantization()
+//---------------------------------
+VertexQuantization computeVertexQuantization(const Vertex* vertices, size_t vertexCount)
+{
+    VertexQuantization quantization;
+    quantization.center = glm::vec3(0.0f);
+    quantization.extent = 1.0f;
+    if (vertexCount == 0) {
+        return quantization;
+    }
+
+    glm::vec3 minimum = vertices[0].position;
+    glm::vec3 maximum = vertices[0].position;
+    for (size_t i = 1; i < vertexCount; i++) {
+        minimum = glm::min(minimum, vertices[i].position);
+        maximum = glm::max(maximum, vertices[i].position);
+    }
+
+    glm::vec3 halfSize = (maximum - minimum) * 0.5f;
+    quantization.center = (minimum + maximum) * 0.5f;
+    quantization.extent = glm::max(glm::max(halfSize.x, halfSize.y), halfSize.z);
+    if (quantization.extent <= 0.0f) {
+        quantization.extent = 1.0f; // A single point; any scale reproduces it
+    }
+    return quantization;
+}
+
+//---------------------------------
+// encodeOctahedral()
+//---------------------------------
+glm::vec2 encodeOctahedral(const glm::vec3& direction)
+{
+    // Project onto the octahedron |x| + |y| + |z| = 1, then fold the lower half over the
+    // diagonals so the whole sphere maps to the [-1, 1] square
+    float l1Norm = glm::abs(direction.x) + glm::abs(direction.y) + glm::abs(direction.z);
+    if (l1Norm == 0.0f) {
+        return glm::vec2(0.0f); // Degenerate input; decodes to +z
+    }
+    glm::vec3 n = direction / l1Norm;
+    if (n.z >= 0.0f) {
+        return glm::vec2(n.x, n.y);
+    }
+    glm::vec2 signs(n.x >= 0.0f ? 1.0f : -1.0f, n.y >= 0.0f ? 1.0f : -1.0f);
+    return (1.0f - glm::abs(glm::vec2(n.y, n.x))) * signs;
+}
+
+//---------------------------------
+// decodeOctahedral()
+//---------------------------------
+glm::vec3 decodeOctahedral(const glm::vec2& encoded)
+{
+    // Same as octahedralDecode() in packed.vert
+    glm::vec3 n(encoded.x, encoded.y, 1.0f - glm::abs(encoded.x) - glm::abs(encoded.y));
+    float fold = glm::max(-n.z, 0.0f);
+    n.x += n.x >= 0.0f ? -fold : fold;
+    n.y += n.y >= 0.0f ? -fold : fold;
+    return glm::normalize(n);
+}
+
+//---------------------------------
+// packVertex()
+//---------------------------------
+PackedVertex packVertex(const Vertex& vertex, const VertexQuantization& quantization)
+{
+    glm::vec3 position = (vertex.position - quantization.center) / quantization.extent;
+
+    PackedVertex packed;
+    packed.position[0] = glm::packSnorm1x16(position.x);
+    packed.position[1] = glm::packSnorm1x16(position.y);
+    packed.position[2] = glm::packSnorm1x16(position.z);
+    packed.position[3] = glm::packSnorm1x16(vertex.tangent.w < 0.0f ? -1.0f : 1.0f);
+    packed.normal = glm::packSnorm2x16(encodeOctahedral(vertex.normal));
+    packed.tangent = glm::packSnorm2x16(encodeOctahedral(glm::vec3(vertex.tangent)));
+    packed.uv = glm::packHalf2x16(vertex.uv);
+    return packed;
+}
+
+//---------------------------------
+// unpackVertex()
+//---------------------------------
+Vertex unpackVertex(const PackedVertex& vertex, const VertexQuantization& quantization)
+{
+    glm::vec3 position(
+        glm::unpackSnorm1x16(vertex.position[0]),
+        glm::unpackSnorm1x16(vertex.position[1]),
+        glm::unpackSnorm1x16(vertex.position[2]));
+
+    Vertex unpacked;
+    unpacked.position = quantization.center + position * quantization.extent;
+    unpacked.normal = decodeOctahedral(glm::unpackSnorm2x16(vertex.normal));
+    unpacked.tangent = glm::vec4(
+        decodeOctahedral(glm::unpackSnorm2x16(vertex.tangent)), glm::unpackSnorm1x16(vertex.position[3]));
+    unpacked.uv = glm::unpackHalf2x16(vertex.uv);
+    return unpacked;
+}
+
+//---------------------------------
+// packVertices()
+//---------------------------------
+std::vector<PackedVertex> packVertices(const std::vector<Vertex>& vertices, const VertexQuantization& quantization)
+{
+    std::vector<PackedVertex> packed(vertices.size());
+    for (size_t i = 0; i < vertices.size(); i++) {
+        packed[i] = packVertex(vertices[i], quantization);
+    }
+    return packed;
+}
+
+//---------------------------------
+// foldVertexQuantization()
+//---------------------------------
+glm::vec4 foldVertexQuantization(const glm::vec4& transform, const VertexQuantization& quantization)
+{
+    // transform maps p to p.xy * z + xy; substituting p = center + q * extent gives a
+    // transform of the same form in q
+    glm::vec2 offset = glm::vec2(quantization.center) * transform.z + glm::vec2(transform);
+    return glm::vec4(offset, quantization.extent * transform.z, transform.w);
+}
+
+//---------------------------------
+// appendVertexInputDescriptions()
+//---------------------------------
+void appendVertexInputDescriptions(
+    VertexFormat format,
+    std::vector<VkVertexInputBindingDescription>& bindings,
+    std::vector<VkVertexInputAttributeDescription>& attributes)
+{
+    if (format == VERTEX_FORMAT_PROCEDURAL) {
+        return;
+    }
+    if (format != VERTEX_FORMAT_PACKED) {
+        throw std::runtime_error("appendVertexInputDescriptions() Unknown vertex format!");
+    }
+
+    VkVertexInputBindingDescription binding;
+    binding.binding = VERTEX_BINDING_VERTICES;
+    binding.stride = sizeof(PackedVertex);
+    binding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+    bindings.push_back(binding);
+
+    // Locations follow the per-instance object index at location 0
+    const struct
+    {
+        VkFormat format;
+        uint32_t offset;
+    } packedAttributes[] = {
+        {VK_FORMAT_R16G16B16A16_SNORM, offsetof(PackedVertex, position)},
+        {VK_FORMAT_R16G16_SNORM, offsetof(PackedVertex, normal)},
+        {VK_FORMAT_R16G16_SNORM, offsetof(PackedVertex, tangent)},
+        {VK_FORMAT_R16G16_SFLOAT, offsetof(PackedVertex, uv)},
+    };
+
+    uint32_t location = 1;
+    for (const auto& packedAttribute : packedAttributes) {
+        VkVertexInputAttributeDescription attribute;
+        attribute.location = location++;
+        attribute.binding = VERTEX_BINDING_VERTICES;
+        attribute.format = packedAttribute.format;
+        attribute.offset = packedAttribute.offset;
+        attributes.push_back(attribute);
+    }
+}
@@ -0,0 +1,203 @@
+#include "virtual_page_cache.h"
+
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+
+namespace {
+const uint64_t VIRTUAL_PAGE_PINNED = UINT64_MAX;
+} // namespace
+
+//---------------------------------
+// initVirtualPageCache()
+//---------------------------------
+void initVirtualPageCache(VirtualPageCache& cache, uint32_t pagesPerSide, uint32_t atlasPagesPerSide)
+{
+    if (pagesPerSide == 0 || (pagesPerSide & (pagesPerSide - 1)) != 0) {
+        throw std::runtime_error("initVirtualPageCache() Pages per side must be a power of two!");
+    }
+    if (atlasPagesPerSide == 0 || atlasPagesPerSide > 256) {
+        throw std::runtime_error("initVirtualPageCache() Atlas slots don't fit the page table entries!");
+    }
+
+    cache = VirtualPageCache{};
+    cache.pagesPerSide = pagesPerSide;
+    cache.atlasPagesPerSide = atlasPagesPerSide;
+    for (uint32_t side = pagesPerSide; side > 0; side /= 2) {
+        cache.levelOffsets.push_back(cache.pageCount);
+        cache.pageCount += side * side;
+        cache.levelCount++;
+    }
+
+    cache.pageSlots.assign(cache.pageCount, VIRTUAL_PAGE_NONE);
+    cache.slotPages.assign(atlasPagesPerSide * atlasPagesPerSide, VIRTUAL_PAGE_NONE);
+    cache.slotLastUsed.assign(atlasPagesPerSide * atlasPagesPerSide, 0);
+    cache.pageTable.assign(cache.pageCount, 0);
+}
+
+//---------------------------------
+// getVirtualPagesPerSide()
+//---------------------------------
+uint32_t getVirtualPagesPerSide(const VirtualPageCache& cache, uint32_t level)
+{
+    return cache.pagesPerSide >> level;
+}
+
+//---------------------------------
+// getVirtualPageIndex()
+//---------------------------------
+uint32_t getVirtualPageIndex(const VirtualPageCache& cache, uint32_t level, uint32_t x, uint32_t y)
+{
+    return cache.levelOffsets[level] + y * getVirtualPagesPerSide(cache, level) + x;
+}
+
+//---------------------------------
+// getVirtualPageCoords()
+//---------------------------------
+void getVirtualPageCoords(const VirtualPageCache& cache, uint32_t page, uint32_t& level, uint32_t& x, uint32_t& y)
+{
+    level = cache.levelCount - 1;
+    while (page < cache.levelOffsets[level]) {
+        level--;
+    }
+
+    uint32_t side = getVirtualPagesPerSide(cache, level);
+    uint32_t index = page - cache.levelOffsets[level];
+    x = index % side;
+    y = index / side;
+}
+
+//---------------------------------
+// getVirtualPageParent()
+//---------------------------------
+uint32_t getVirtualPageParent(const VirtualPageCache& cache, uint32_t page)
+{
+    uint32_t level, x, y;
+    getVirtualPageCoords(cache, page, level, x, y);
+    if (level + 1 == cache.levelCount) {
+        return VIRTUAL_PAGE_NONE;
+    }
+    return getVirtualPageIndex(cache, level + 1, x / 2, y / 2);
+}
+
+//---------------------------------
+// packVirtualPageEntry()
+//---------------------------------
+uint32_t packVirtualPageEntry(const VirtualPageCache& cache, uint32_t slot, uint32_t level)
+{
+    uint32_t slotX = slot % cache.atlasPagesPerSide;
+    uint32_t slotY = slot / cache.atlasPagesPerSide;
+    return slotX | (slotY << 8) | (level << 16) | (1u << 24);
+}
+
+//---------------------------------
+// processVirtualPageRequests()
+//---------------------------------
+std::vector<uint32_t> processVirtualPageRequests(
+    VirtualPageCache& cache,
+    const uint32_t* requestBits,
+    const std::vector<uint8_t>& loading,
+    size_t maxRequests)
+{
+    cache.frame++;
+
+    std::vector<uint32_t> missing;
+    std::vector<uint8_t> queued(cache.pageCount, 0);
+    for (uint32_t word = 0; word < (cache.pageCount + 31) / 32; word++) {
+        for (uint32_t bits = requestBits[word]; bits != 0; bits &= bits - 1) {
+            uint32_t page = word * 32 + std::countr_zero(bits);
+            if (page >= cache.pageCount) {
+                break;
+            }
+
+            // Walk up to the resident page the shader actually sampled, keeping it alive too
+            for (; page != VIRTUAL_PAGE_NONE; page = getVirtualPageParent(cache, page)) {
+                uint32_t slot = cache.pageSlots[page];
+                if (slot != VIRTUAL_PAGE_NONE) {
+                    cache.slotLastUsed[slot] = std::max(cache.slotLastUsed[slot], cache.frame);
+                    break;
+                }
+                if (queued[page] == 0 && loading[page] == 0) {
+                    queued[page] = 1;
+                    missing.push_back(page);
+                }
+            }
+        }
+    }
+
+    // Higher page indices are coarser levels
+    std::sort(missing.begin(), missing.end(), [](uint32_t a, uint32_t b) { return a > b; });
+    if (missing.size() > maxRequests) {
+        missing.resize(maxRequests);
+    }
+    return missing;
+}
+
+//---------------------------------
+// allocateVirtualPageSlot()
+//---------------------------------
+uint32_t allocateVirtualPageSlot(VirtualPageCache& cache, uint32_t page)
+{
+    uint32_t victim = VIRTUAL_PAGE_NONE;
+    for (uint32_t slot = 0; slot < cache.slotPages.size(); slot++) {
+        if (cache.slotLastUsed[slot] >= cache.frame) {
+            continue; // Sampled this frame, or pinned
+        }
+        if (victim == VIRTUAL_PAGE_NONE || cache.slotLastUsed[slot] < cache.slotLastUsed[victim]) {
+            victim = slot;
+        }
+        if (cache.slotPages[slot] == VIRTUAL_PAGE_NONE) {
+            break;
+        }
+    }
+    if (victim == VIRTUAL_PAGE_NONE) {
+        return VIRTUAL_PAGE_NONE;
+    }
+
+    if (cache.slotPages[victim] != VIRTUAL_PAGE_NONE) {
+        cache.pageSlots[cache.slotPages[victim]] = VIRTUAL_PAGE_NONE;
+    }
+    cache.slotPages[victim] = page;
+    cache.pageSlots[page] = victim;
+    cache.slotLastUsed[victim] = cache.frame;
+    cache.pageTableDirty = true;
+    return victim;
+}
+
+//---------------------------------
+// pinVirtualPage()
+//---------------------------------
+void pinVirtualPage(VirtualPageCache& cache, uint32_t page, uint32_t slot)
+{
+    cache.slotPages[slot] = page;
+    cache.pageSlots[page] = slot;
+    cache.slotLastUsed[slot] = VIRTUAL_PAGE_PINNED;
+    cache.pageTableDirty = true;
+}
+
+//---------------------------------
+// buildVirtualPageTable()
+//---------------------------------
+void buildVirtualPageTable(VirtualPageCache& cache)
+{
+    // Coarsest level first, so every page can inherit its parent's entry
+    for (uint32_t level = cache.levelCount; level-- > 0;) {
+        uint32_t side = getVirtualPagesPerSide(cache, level);
+        for (uint32_t y = 0; y < side; y++) {
+            for (uint32_t x = 0; x < side; x++) {
+                uint32_t page = getVirtualPageIndex(cache, level, x, y);
+                uint32_t slot = cache.pageSlots[page];
+                if (slot != VIRTUAL_PAGE_NONE) {
+                    cache.pageTable[page] = packVirtualPageEntry(cache, slot, level);
+                }
+                else if (level + 1 < cache.levelCount) {
+                    cache.pageTable[page] = cache.pageTable[getVirtualPageIndex(cache, level + 1, x / 2, y / 2)];
+                }
+                else {
+                    cache.pageTable[page] = 0; // Only before the root page is pinned
+                }
+            }
+        }
+    }
+    cache.pageTableDirty = false;
+}
@@ -0,0 +1,640 @@
+#include "virtual_texture.h"
+#include "texture.h"
+#include "vulkan_utils.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+struct VirtualPageUpload
+{
+    uint32_t slot;
+    const VirtualTexturePageData* data;
+};
+
+VkDeviceSize getPaddedPageBytes(const VirtualTexture& virtualTexture)
+{
+    const VkDeviceSize blocks = VIRTUAL_TEXTURE_PADDED_PAGE_SIZE / virtualTexture.blockSize;
+    return blocks * blocks * virtualTexture.blockBytes;
+}
+
+uint32_t wrapBlock(int64_t block, uint32_t blockCount)
+{
+    return static_cast<uint32_t>(((block % blockCount) + blockCount) % blockCount);
+}
+
+//---------------------------------
+// readVirtualPage()
+//---------------------------------
+// Copies the page plus its border out of the mapped level data, block by block. The border
+// wraps around the texture edges, matching repeat addressing.
+void readVirtualPage(const VirtualTexture& virtualTexture, uint32_t page, std::vector<uint8_t>& texels)
+{
+    uint32_t level, pageX, pageY;
+    getVirtualPageCoords(virtualTexture.cache, page, level, pageX, pageY);
+
+    const Ktx2Level& levelData = virtualTexture.source.levels[level];
+    const uint8_t* levelTexels = virtualTexture.source.file.data + levelData.byteOffset;
+    const uint32_t blockSize = virtualTexture.blockSize;
+    const uint32_t blockBytes = virtualTexture.blockBytes;
+    const uint32_t levelBlocks = (virtualTexture.source.width >> level) / blockSize;
+    const uint32_t pageBlocks = VIRTUAL_TEXTURE_PADDED_PAGE_SIZE / blockSize;
+    const int64_t borderBlocks = VIRTUAL_TEXTURE_PAGE_BORDER / blockSize;
+    const int64_t firstRow = int64_t(pageY) * (VIRTUAL_TEXTURE_PAGE_SIZE / blockSize) - borderBlocks;
+    const int64_t firstColumn = int64_t(pageX) * (VIRTUAL_TEXTURE_PAGE_SIZE / blockSize) - borderBlocks;
+
+    texels.resize(getPaddedPageBytes(virtualTexture));
+    for (uint32_t row = 0; row < pageBlocks; row++) {
+        const uint32_t sourceRow = wrapBlock(firstRow + row, levelBlocks);
+        const uint8_t* sourceRowTexels = levelTexels + size_t(sourceRow) * levelBlocks * blockBytes;
+        for (uint32_t column = 0; column < pageBlocks; column++) {
+            const uint32_t sourceColumn = wrapBlock(firstColumn + column, levelBlocks);
+            std::memcpy(
+                texels.data() + (size_t(row) * pageBlocks + column) * blockBytes,
+                sourceRowTexels + size_t(sourceColumn) * blockBytes,
+                blockBytes);
+        }
+    }
+}
+
+//---------------------------------
+// runVirtualTextureLoader()
+//---------------------------------
+void runVirtualTextureLoader(VirtualTexture* virtualTexture)
+{
+    std::unique_lock<std::mutex> lock(virtualTexture->loaderMutex);
+    while (true) {
+        virtualTexture->loaderWake.wait(lock, [virtualTexture]() {
+            return !virtualTexture->loaderRunning || !virtualTexture->loadQueue.empty();
+        });
+        if (!virtualTexture->loaderRunning) {
+            return;
+        }
+
+        VirtualTexturePageData data;
+        data.page = virtualTexture->loadQueue.front();
+        virtualTexture->loadQueue.pop_front();
+
+        lock.unlock();
+        readVirtualPage(*virtualTexture, data.page, data.texels);
+        lock.lock();
+
+        virtualTexture->loadedPages.push_back(std::move(data));
+    }
+}
+
+//---------------------------------
+// recordBufferBarrier()
+//---------------------------------
+void recordBufferBarrier(
+    VkCommandBuffer commandBuffer,
+    VkBuffer buffer,
+    VkPipelineStageFlags srcStage,
+    VkAccessFlags srcAccess,
+    VkPipelineStageFlags dstStage,
+    VkAccessFlags dstAccess)
+{
+    VkBufferMemoryBarrier barrier;
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.pNext = nullptr;
+    barrier.srcAccessMask = srcAccess;
+    barrier.dstAccessMask = dstAccess;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.buffer = buffer;
+    barrier.offset = 0;
+    barrier.size = VK_WHOLE_SIZE;
+
+    vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+}
+
+//---------------------------------
+// recordImageTransition()
+//---------------------------------
+void recordImageTransition(
+    VkCommandBuffer commandBuffer,
+    VkImage image,
+    uint32_t levelCount,
+    VkImageLayout oldLayout,
+    VkImageLayout newLayout,
+    VkPipelineStageFlags srcStage,
+    VkAccessFlags srcAccess,
+    VkPipelineStageFlags dstStage,
+    VkAccessFlags dstAccess)
+{
+    VkImageMemoryBarrier barrier;
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.pNext = nullptr;
+    barrier.srcAccessMask = srcAccess;
+    barrier.dstAccessMask = dstAccess;
+    barrier.oldLayout = oldLayout;
+    barrier.newLayout = newLayout;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel = 0;
+    barrier.subresourceRange.levelCount = levelCount;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+
+    vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+//---------------------------------
+// recordVirtualTextureUploads()
+//---------------------------------
+// Copies the pages into their atlas slots and, when it changed, the page table. Both images
+// are left in SHADER_READ_ONLY_OPTIMAL; on the first call they start out UNDEFINED.
+void recordVirtualTextureUploads(
+    VkCommandBuffer commandBuffer,
+    VirtualTexture& virtualTexture,
+    const std::vector<VirtualPageUpload>& uploads,
+    bool firstUpload)
+{
+    const VkImageLayout oldLayout
+        = firstUpload ? VK_IMAGE_LAYOUT_UNDEFINED : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    const VkDeviceSize pageBytes = getPaddedPageBytes(virtualTexture);
+    VirtualPageCache& cache = virtualTexture.cache;
+
+    if (!uploads.empty()) {
+        std::vector<VkBufferImageCopy> regions(uploads.size());
+        for (size_t i = 0; i < uploads.size(); i++) {
+            std::memcpy(virtualTexture.stagingMapped + i * pageBytes, uploads[i].data->texels.data(), pageBytes);
+
+            VkBufferImageCopy& region = regions[i];
+            region.bufferOffset = i * pageBytes;
+            region.bufferRowLength = 0;
+            region.bufferImageHeight = 0;
+            region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            region.imageSubresource.mipLevel = 0;
+            region.imageSubresource.baseArrayLayer = 0;
+            region.imageSubresource.layerCount = 1;
+            const uint32_t slotX = uploads[i].slot % cache.atlasPagesPerSide;
+            const uint32_t slotY = uploads[i].slot / cache.atlasPagesPerSide;
+            region.imageOffset.x = int32_t(slotX * VIRTUAL_TEXTURE_PADDED_PAGE_SIZE);
+            region.imageOffset.y = int32_t(slotY * VIRTUAL_TEXTURE_PADDED_PAGE_SIZE);
+            region.imageOffset.z = 0;
+            region.imageExtent = {VIRTUAL_TEXTURE_PADDED_PAGE_SIZE, VIRTUAL_TEXTURE_PADDED_PAGE_SIZE, 1};
+        }
+
+        recordImageTransition(
+            commandBuffer,
+            virtualTexture.atlasImage,
+            1,
+            oldLayout,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+            0,
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_ACCESS_TRANSFER_WRITE_BIT);
+        vkCmdCopyBufferToImage(
+            commandBuffer,
+            virtualTexture.stagingBuffer,
+            virtualTexture.atlasImage,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            static_cast<uint32_t>(regions.size()),
+            regions.data());
+        recordImageTransition(
+            commandBuffer,
+            virtualTexture.atlasImage,
+            1,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_ACCESS_TRANSFER_WRITE_BIT,
+            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+            VK_ACCESS_SHADER_READ_BIT);
+    }
+
+    if (!cache.pageTableDirty) {
+        return;
+    }
+    buildVirtualPageTable(cache);
+
+    const VkDeviceSize pageTableOffset = VIRTUAL_TEXTURE_MAX_UPLOADS_PER_FRAME * pageBytes;
+    std::memcpy(
+        virtualTexture.stagingMapped + pageTableOffset,
+        cache.pageTable.data(),
+        cache.pageTable.size() * sizeof(uint32_t));
+
+    // The page table is stored in page index order, which is level by level, row-major
+    std::vector<VkBufferImageCopy> regions(cache.levelCount);
+    for (uint32_t level = 0; level < cache.levelCount; level++) {
+        const uint32_t side = getVirtualPagesPerSide(cache, level);
+        VkBufferImageCopy& region = regions[level];
+        region.bufferOffset = pageTableOffset + VkDeviceSize(cache.levelOffsets[level]) * sizeof(uint32_t);
+        region.bufferRowLength = 0;
+        region.bufferImageHeight = 0;
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.mipLevel = level;
+        region.imageSubresource.baseArrayLayer = 0;
+        region.imageSubresource.layerCount = 1;
+        region.imageOffset = {0, 0, 0};
+        region.imageExtent = {side, side, 1};
+    }
+
+    recordImageTransition(
+        commandBuffer,
+        virtualTexture.pageTableImage,
+        cache.levelCount,
+        oldLayout,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        0,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_ACCESS_TRANSFER_WRITE_BIT);
+    vkCmdCopyBufferToImage(
+        commandBuffer,
+        virtualTexture.stagingBuffer,
+        virtualTexture.pageTableImage,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        static_cast<uint32_t>(regions.size()),
+        regions.data());
+    recordImageTransition(
+        commandBuffer,
+        virtualTexture.pageTableImage,
+        cache.levelCount,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_ACCESS_TRANSFER_WRITE_BIT,
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        VK_ACCESS_SHADER_READ_BIT);
+}
+
+//---------------------------------
+// createVirtualTextureDescriptors()
+//---------------------------------
+void createVirtualTextureDescriptors(VirtualTexture& virtualTexture, const VkDevice& device)
+{
+    VkDescriptorSetLayoutBinding bindings[3];
+    bindings[0].binding = VIRTUAL_TEXTURE_BINDING_ATLAS;
+    bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    bindings[1].binding = VIRTUAL_TEXTURE_BINDING_PAGE_TABLE;
+    bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    bindings[2].binding = VIRTUAL_TEXTURE_BINDING_FEEDBACK;
+    bindings[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    for (VkDescriptorSetLayoutBinding& binding : bindings) {
+        binding.descriptorCount = 1;
+        binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+        binding.pImmutableSamplers = nullptr;
+    }
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo;
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.pNext = nullptr;
+    layoutInfo.flags = 0;
+    layoutInfo.bindingCount = 3;
+    layoutInfo.pBindings = bindings;
+
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &virtualTexture.setLayout) != VK_SUCCESS) {
+        throw std::runtime_error("createVirtualTexture() Failed to create descriptor set layout!");
+    }
+
+    VkDescriptorPoolSize poolSizes[2];
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    poolSizes[0].descriptorCount = 2;
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSizes[1].descriptorCount = 1;
+
+    VkDescriptorPoolCreateInfo poolInfo;
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.pNext = nullptr;
+    poolInfo.flags = 0;
+    poolInfo.maxSets = 1;
+    poolInfo.poolSizeCount = 2;
+    poolInfo.pPoolSizes = poolSizes;
+
+    if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &virtualTexture.descriptorPool) != VK_SUCCESS) {
+        throw std::runtime_error("createVirtualTexture() Failed to create descriptor pool!");
+    }
+
+    VkDescriptorSetAllocateInfo allocateInfo;
+    allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocateInfo.pNext = nullptr;
+    allocateInfo.descriptorPool = virtualTexture.descriptorPool;
+    allocateInfo.descriptorSetCount = 1;
+    allocateInfo.pSetLayouts = &virtualTexture.setLayout;
+
+    if (vkAllocateDescriptorSets(device, &allocateInfo, &virtualTexture.descriptorSet) != VK_SUCCESS) {
+        throw std::runtime_error("createVirtualTexture() Failed to allocate descriptor set!");
+    }
+
+    VkDescriptorImageInfo atlasInfo;
+    atlasInfo.sampler = virtualTexture.atlasSampler;
+    atlasInfo.imageView = virtualTexture.atlasView;
+    atlasInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+    VkDescriptorImageInfo pageTableInfo;
+    pageTableInfo.sampler = virtualTexture.pageTableSampler;
+    pageTableInfo.imageView = virtualTexture.pageTableView;
+    pageTableInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+    VkDescriptorBufferInfo feedbackInfo;
+    feedbackInfo.buffer = virtualTexture.feedbackBuffer;
+    feedbackInfo.offset = 0;
+    feedbackInfo.range = VK_WHOLE_SIZE;
+
+    VkWriteDescriptorSet writes[3];
+    for (uint32_t i = 0; i < 3; i++) {
+        writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[i].pNext = nullptr;
+        writes[i].dstSet = virtualTexture.descriptorSet;
+        writes[i].dstBinding = bindings[i].binding;
+        writes[i].dstArrayElement = 0;
+        writes[i].descriptorCount = 1;
+        writes[i].descriptorType = bindings[i].descriptorType;
+        writes[i].pImageInfo = nullptr;
+        writes[i].pBufferInfo = nullptr;
+        writes[i].pTexelBufferView = nullptr;
+    }
+    writes[0].pImageInfo = &atlasInfo;
+    writes[1].pImageInfo = &pageTableInfo;
+    writes[2].pBufferInfo = &feedbackInfo;
+    vkUpdateDescriptorSets(device, 3, writes, 0, nullptr);
+}
+} // namespace
+
+//---------------------------------
+// hasVirtualTextureSupport()
+//---------------------------------
+bool hasVirtualTextureSupport(const DeviceFeatureChain& enabledFeatures)
+{
+    return enabledFeatures.features2.features.fragmentStoresAndAtomics == VK_TRUE;
+}
+
+//---------------------------------
+// createVirtualTexture()
+//---------------------------------
+void createVirtualTexture(
+    VirtualTexture& virtualTexture,
+    const VkDevice& device,
+    const VkPhysicalDevice& physicalDevice,
+    const DeviceFeatureChain& enabledFeatures,
+    const VkCommandPool& commandPool,
+    const VkQueue& queue,
+    const std::string& filename)
+{
+    if (!hasVirtualTextureSupport(enabledFeatures)) {
+        throw std::runtime_error("createVirtualTexture() fragmentStoresAndAtomics is not enabled!");
+    }
+
+    openKtx2File(virtualTexture.source, filename);
+    const Ktx2File& source = virtualTexture.source;
+    if (source.width != source.height || (source.width & (source.width - 1)) != 0
+        || source.width < VIRTUAL_TEXTURE_PAGE_SIZE) {
+        closeKtx2File(virtualTexture.source);
+        throw std::runtime_error("createVirtualTexture() Virtual textures must be square powers of two: " + filename);
+    }
+    if (!isTextureFormatSupported(physicalDevice, enabledFeatures, source.format)) {
+        closeKtx2File(virtualTexture.source);
+        throw std::runtime_error("createVirtualTexture() Texture format not supported by the device: " + filename);
+    }
+
+    virtualTexture.blockBytes = getTextureFormatBlockBytes(source.format, virtualTexture.blockSize);
+    initVirtualPageCache(virtualTexture.cache, source.width / VIRTUAL_TEXTURE_PAGE_SIZE, VIRTUAL_TEXTURE_ATLAS_PAGES);
+    VirtualPageCache& cache = virtualTexture.cache;
+    if (source.levels.size() < cache.levelCount) {
+        closeKtx2File(virtualTexture.source);
+        throw std::runtime_error("createVirtualTexture() Mip chain must reach the single-page level: " + filename);
+    }
+    virtualTexture.pageLoading.assign(cache.pageCount, 0);
+
+    const uint32_t atlasSize = VIRTUAL_TEXTURE_ATLAS_PAGES * VIRTUAL_TEXTURE_PADDED_PAGE_SIZE;
+    createImage(
+        device,
+        physicalDevice,
+        atlasSize,
+        atlasSize,
+        1,
+        source.format,
+        VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+        virtualTexture.atlasImage,
+        virtualTexture.atlasImageMemory);
+    virtualTexture.atlasView
+        = createImageView(device, virtualTexture.atlasImage, source.format, VK_IMAGE_ASPECT_COLOR_BIT, 0, 1);
+    virtualTexture.atlasSampler = createTextureSampler(device, physicalDevice, enabledFeatures);
+
+    createImage(
+        device,
+        physicalDevice,
+        cache.pagesPerSide,
+        cache.pagesPerSide,
+        cache.levelCount,
+        VK_FORMAT_R8G8B8A8_UINT,
+        VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+        virtualTexture.pageTableImage,
+        virtualTexture.pageTableImageMemory);
+    virtualTexture.pageTableView = createImageView(
+        device,
+        virtualTexture.pageTableImage,
+        VK_FORMAT_R8G8B8A8_UINT,
+        VK_IMAGE_ASPECT_COLOR_BIT,
+        0,
+        cache.levelCount);
+
+    // Read with texelFetch only
+    VkSamplerCreateInfo samplerInfo;
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.pNext = nullptr;
+    samplerInfo.flags = 0;
+    samplerInfo.magFilter = VK_FILTER_NEAREST;
+    samplerInfo.minFilter = VK_FILTER_NEAREST;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.mipLodBias = 0.0f;
+    samplerInfo.anisotropyEnable = VK_FALSE;
+    samplerInfo.maxAnisotropy = 1.0f;
+    samplerInfo.compareEnable = VK_FALSE;
+    samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
+    samplerInfo.minLod = 0.0f;
+    samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+    samplerInfo.borderColor = VK_BORDER_COLOR_INT_TRANSPARENT_BLACK;
+    samplerInfo.unnormalizedCoordinates = VK_FALSE;
+
+    if (vkCreateSampler(device, &samplerInfo, nullptr, &virtualTexture.pageTableSampler) != VK_SUCCESS) {
+        throw std::runtime_error("createVirtualTexture() Failed to create page table sampler!");
+    }
+
+    const VkDeviceSize feedbackSize = ((cache.pageCount + 31) / 32) * sizeof(uint32_t);
+    createBuffer(
+        device,
+        physicalDevice,
+        feedbackSize,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        {},
+        virtualTexture.feedbackBuffer,
+        virtualTexture.feedbackBufferMemory);
+    createBuffer(
+        device,
+        physicalDevice,
+        feedbackSize,
+        VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        {},
+        virtualTexture.readbackBuffer,
+        virtualTexture.readbackBufferMemory);
+    void* readbackMapped = nullptr;
+    vkMapMemory(device, virtualTexture.readbackBufferMemory, 0, feedbackSize, 0, &readbackMapped);
+    virtualTexture.readbackMapped = static_cast<const uint32_t*>(readbackMapped);
+
+    const VkDeviceSize stagingSize = VIRTUAL_TEXTURE_MAX_UPLOADS_PER_FRAME * getPaddedPageBytes(virtualTexture)
+        + cache.pageCount * sizeof(uint32_t);
+    createBuffer(
+        device,
+        physicalDevice,
+        stagingSize,
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        {},
+        virtualTexture.stagingBuffer,
+        virtualTexture.stagingBufferMemory);
+    void* stagingMapped = nullptr;
+    vkMapMemory(device, virtualTexture.stagingBufferMemory, 0, stagingSize, 0, &stagingMapped);
+    virtualTexture.stagingMapped = static_cast<uint8_t*>(stagingMapped);
+
+    createVirtualTextureDescriptors(virtualTexture, device);
+
+    // The root page covers the whole texture, so every page table entry has a fallback
+    VirtualTexturePageData root;
+    root.page = getVirtualPageIndex(cache, cache.levelCount - 1, 0, 0);
+    readVirtualPage(virtualTexture, root.page, root.texels);
+    pinVirtualPage(cache, root.page, 0);
+
+    VkCommandBuffer commandBuffer = beginSingleTimeCommands(device, commandPool);
+    vkCmdFillBuffer(commandBuffer, virtualTexture.feedbackBuffer, 0, VK_WHOLE_SIZE, 0);
+    vkCmdFillBuffer(commandBuffer, virtualTexture.readbackBuffer, 0, VK_WHOLE_SIZE, 0);
+    recordVirtualTextureUploads(commandBuffer, virtualTexture, {{0, &root}}, true);
+    endSingleTimeCommands(device, commandPool, queue, commandBuffer);
+
+    virtualTexture.loaderRunning = true;
+    virtualTexture.loaderThread = std::thread(runVirtualTextureLoader, &virtualTexture);
+}
+
+//---------------------------------
+// updateVirtualTexture()
+//---------------------------------
+void updateVirtualTexture(VkCommandBuffer commandBuffer, VirtualTexture& virtualTexture)
+{
+    VirtualPageCache& cache = virtualTexture.cache;
+
+    // Requests from two frames ago, copied out by the previous frame's command buffer
+    std::vector<uint32_t> requests = processVirtualPageRequests(
+        cache, virtualTexture.readbackMapped, virtualTexture.pageLoading, VIRTUAL_TEXTURE_MAX_UPLOADS_PER_FRAME);
+
+    std::vector<VirtualTexturePageData> loadedPages;
+    {
+        std::lock_guard<std::mutex> lock(virtualTexture.loaderMutex);
+        for (uint32_t page : requests) {
+            virtualTexture.loadQueue.push_back(page);
+            virtualTexture.pageLoading[page] = 1;
+        }
+
+        size_t count = std::min<size_t>(virtualTexture.loadedPages.size(), VIRTUAL_TEXTURE_MAX_UPLOADS_PER_FRAME);
+        auto loadedEnd = virtualTexture.loadedPages.begin() + count;
+        std::move(virtualTexture.loadedPages.begin(), loadedEnd, std::back_inserter(loadedPages));
+        virtualTexture.loadedPages.erase(virtualTexture.loadedPages.begin(), loadedEnd);
+    }
+    if (!requests.empty()) {
+        virtualTexture.loaderWake.notify_one();
+    }
+
+    // A page that finds no free slot is dropped; if it is still wanted it will be requested again
+    std::vector<VirtualPageUpload> uploads;
+    for (const VirtualTexturePageData& data : loadedPages) {
+        virtualTexture.pageLoading[data.page] = 0;
+        uint32_t slot = allocateVirtualPageSlot(cache, data.page);
+        if (slot != VIRTUAL_PAGE_NONE) {
+            uploads.push_back({slot, &data});
+        }
+    }
+    recordVirtualTextureUploads(commandBuffer, virtualTexture, uploads, false);
+
+    // Hand this frame's requests to the host, then start collecting the next ones
+    recordBufferBarrier(
+        commandBuffer,
+        virtualTexture.feedbackBuffer,
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        VK_ACCESS_SHADER_WRITE_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_ACCESS_TRANSFER_READ_BIT);
+
+    VkBufferCopy copyRegion;
+    copyRegion.srcOffset = 0;
+    copyRegion.dstOffset = 0;
+    copyRegion.size = ((cache.pageCount + 31) / 32) * sizeof(uint32_t);
+    vkCmdCopyBuffer(commandBuffer, virtualTexture.feedbackBuffer, virtualTexture.readbackBuffer, 1, &copyRegion);
+
+    recordBufferBarrier(
+        commandBuffer,
+        virtualTexture.readbackBuffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_ACCESS_TRANSFER_WRITE_BIT,
+        VK_PIPELINE_STAGE_HOST_BIT,
+        VK_ACCESS_HOST_READ_BIT);
+    recordBufferBarrier(
+        commandBuffer,
+        virtualTexture.feedbackBuffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_ACCESS_TRANSFER_WRITE_BIT);
+    vkCmdFillBuffer(commandBuffer, virtualTexture.feedbackBuffer, 0, VK_WHOLE_SIZE, 0);
+    recordBufferBarrier(
+        commandBuffer,
+        virtualTexture.feedbackBuffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_ACCESS_TRANSFER_WRITE_BIT,
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+}
+
+//---------------------------------
+// destroyVirtualTexture()
+//---------------------------------
+void destroyVirtualTexture(VirtualTexture& virtualTexture, const VkDevice& device)
+{
+    if (virtualTexture.loaderThread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(virtualTexture.loaderMutex);
+            virtualTexture.loaderRunning = false;
+        }
+        virtualTexture.loaderWake.notify_one();
+        virtualTexture.loaderThread.join();
+    }
+    virtualTexture.loadQueue.clear();
+    virtualTexture.loadedPages.clear();
+    virtualTexture.pageLoading.clear();
+
+    vkDestroyDescriptorPool(device, virtualTexture.descriptorPool, nullptr);
+    vkDestroyDescriptorSetLayout(device, virtualTexture.setLayout, nullptr);
+
+    vkDestroyBuffer(device, virtualTexture.stagingBuffer, nullptr);
+    vkFreeMemory(device, virtualTexture.stagingBufferMemory, nullptr);
+    vkDestroyBuffer(device, virtualTexture.readbackBuffer, nullptr);
+    vkFreeMemory(device, virtualTexture.readbackBufferMemory, nullptr);
+    vkDestroyBuffer(device, virtualTexture.feedbackBuffer, nullptr);
+    vkFreeMemory(device, virtualTexture.feedbackBufferMemory, nullptr);
+    virtualTexture.stagingMapped = nullptr;
+    virtualTexture.readbackMapped = nullptr;
+
+    vkDestroySampler(device, virtualTexture.pageTableSampler, nullptr);
+    vkDestroyImageView(device, virtualTexture.pageTableView, nullptr);
+    vkDestroyImage(device, virtualTexture.pageTableImage, nullptr);
+    vkFreeMemory(device, virtualTexture.pageTableImageMemory, nullptr);
+
+    vkDestroySampler(device, virtualTexture.atlasSampler, nullptr);
+    vkDestroyImageView(device, virtualTexture.atlasView, nullptr);
+    vkDestroyImage(device, virtualTexture.atlasImage, nullptr);
+    vkFreeMemory(device, virtualTexture.atlasImageMemory, nullptr);
+
+    closeKtx2File(virtualTexture.source);
+    virtualTexture.cache = VirtualPageCache{};
+}
@@ -1,10 +1,17 @@
 #include "vulkan_utils.h"
 
 #include "constants.h"
+#include "utils.h"
+
+#ifdef EMBEDDED_SHADERS
+    #include "generated/embedded_shaders.h"
+#endif
 
 #include <iostream>
 #include <set>
 #include <algorithm>
+#include <cctype>
+#include <cstring>
 
 //---------------------------------
 // getVkInstanceExtensionProperties()
@@ -66,18 +73,40 @@ QueueFamilyIndices findQueueFamilies(const VkPhysicalDevice& physicalDevice, con
     std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
     vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
 
-    for (int i = 0; i < queueFamilies.size(); i++) {
-        if (queueFamilies[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) {
-            indices.graphicsFamily = i;
-        }
+    // Every family has to be inspected to find the dedicated ones, so no early out here
+    std::optional<uint32_t> anyComputeFamily;
+    for (uint32_t i = 0; i < queueFamilies.size(); i++) {
+        VkQueueFlags flags = queueFamilies[i].queueFlags;
 
         VkBool32 presentSupport = VK_FALSE;
         vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, i, surface, &presentSupport);
-        if (presentSupport) {
+
+        if ((flags & VK_QUEUE_GRAPHICS_BIT) && !indices.graphicsFamily.has_value()) {
+            indices.graphicsFamily = i;
+        }
+        // Prefer presenting from the graphics family so no ownership transfer is needed before present
+        if (presentSupport && (!indices.presentFamily.has_value() || indices.graphicsFamily == i)) {
             indices.presentFamily = i;
         }
 
-        if (indices.isComplete()) break;
+        if ((flags & VK_QUEUE_COMPUTE_BIT) && !anyComputeFamily.has_value()) {
+            anyComputeFamily = i;
+        }
+        if ((flags & VK_QUEUE_COMPUTE_BIT) && !(flags & VK_QUEUE_GRAPHICS_BIT) && !indices.computeFamily.has_value()) {
+            indices.computeFamily = i;
+        }
+        if ((flags & VK_QUEUE_TRANSFER_BIT) && !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))
+            && !indices.transferFamily.has_value()) {
+            indices.transferFamily = i;
+        }
+    }
+
+    // Graphics and compute families implicitly support transfer
+    if (!indices.computeFamily.has_value()) {
+        indices.computeFamily = anyComputeFamily;
+    }
+    if (!indices.transferFamily.has_value()) {
+        indices.transferFamily = indices.computeFamily.has_value() ? indices.computeFamily : indices.graphicsFamily;
     }
 
     return indices;
@@ -250,17 +279,199 @@ bool checkDeviceExtensionSupport(const VkPhysicalDevice& physicalDevice)
     return requiredExtensions.empty();
 }
 
+//---------------------------------
+// isDeviceExtensionAvailable()
+//---------------------------------
+bool isDeviceExtensionAvailable(const std::vector<VkExtensionProperties>& availableExtensions, const char* extensionName)
+{
+    return std::any_of(availableExtensions.begin(), availableExtensions.end(), [extensionName](const VkExtensionProperties& extensionProperty) {
+        return strcmp(extensionName, extensionProperty.extensionName) == 0;
+    });
+}
+
+//---------------------------------
+// scorePhysicalDevice()
+//---------------------------------
+int64_t scorePhysicalDevice(const VkPhysicalDevice& physicalDevice, const VkSurfaceKHR& surface)
+{
+    if (!isPhysicalDeviceSuitable(physicalDevice, surface)) {
+        return -1;
+    }
+
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+
+    VkPhysicalDeviceFeatures deviceFeatures;
+    vkGetPhysicalDeviceFeatures(physicalDevice, &deviceFeatures);
+
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+    int64_t score = 0;
+
+    // Device type dominates: a discrete GPU should win over any integrated one regardless of the rest
+    switch (deviceProperties.deviceType) {
+        case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+            score += 100000;
+            break;
+        case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+            score += 20000;
+            break;
+        case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+            score += 10000;
+            break;
+        case VK_PHYSICAL_DEVICE_TYPE_CPU:
+            // Software rasterizers (llvmpipe, SwiftShader) are a last resort
+            score += 1;
+            break;
+        default:
+            break;
+    }
+
+    // Largest device-local heap, 1 point per 16 MiB
+    VkDeviceSize deviceLocalBytes = 0;
+    for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++) {
+        if (memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) {
+            deviceLocalBytes = std::max(deviceLocalBytes, memoryProperties.memoryHeaps[i].size);
+        }
+    }
+    score += static_cast<int64_t>(deviceLocalBytes / (16ull * 1024 * 1024));
+
+    // Features the rendering fast paths rely on
+    VkBool32 preferredFeatures[] = {
+        deviceFeatures.multiDrawIndirect,
+        deviceFeatures.drawIndirectFirstInstance,
+        deviceFeatures.samplerAnisotropy,
+        deviceFeatures.textureCompressionBC,
+        deviceFeatures.shaderInt64,
+        deviceFeatures.sparseResidencyImage2D,
+    };
+    for (VkBool32 feature : preferredFeatures) {
+        if (feature) {
+            score += 500;
+        }
+    }
+
+    uint32_t extensionCount = 0;
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+    std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, availableExtensions.data());
+    for (const char* extensionName : PREFERRED_DEVICE_EXTENSIONS) {
+        if (isDeviceExtensionAvailable(availableExtensions, extensionName)) {
+            score += 500;
+        }
+    }
+
+    // Queue topology: dedicated compute/transfer families allow overlapping work with graphics
+    QueueFamilyIndices indices = findQueueFamilies(physicalDevice, surface);
+    if (indices.hasDedicatedCompute()) {
+        score += 1000;
+    }
+    if (indices.hasDedicatedTransfer()) {
+        score += 1000;
+    }
+    if (indices.graphicsFamily == indices.presentFamily) {
+        score += 250;
+    }
+
+    return score;
+}
+
+//---------------------------------
+// parsePhysicalDeviceOverride()
+//---------------------------------
+std::optional<PhysicalDeviceOverride> parsePhysicalDeviceOverride(const std::string& text)
+{
+    auto isHex = [](char c) { return std::isxdigit(static_cast<unsigned char>(c)) != 0; };
+
+    PhysicalDeviceOverride deviceOverride;
+
+    // "vendorID:deviceID", e.g. "10de:2684"
+    size_t separator = text.find(':');
+    if (separator != std::string::npos) {
+        std::string vendor = text.substr(0, separator);
+        std::string device = text.substr(separator + 1);
+        if (vendor.empty() || device.empty() || vendor.size() > 8 || device.size() > 8
+            || !std::all_of(vendor.begin(), vendor.end(), isHex) || !std::all_of(device.begin(), device.end(), isHex)) {
+            return std::nullopt;
+        }
+        deviceOverride.vendorID = static_cast<uint32_t>(std::stoul(vendor, nullptr, 16));
+        deviceOverride.deviceID = static_cast<uint32_t>(std::stoul(device, nullptr, 16));
+        return deviceOverride;
+    }
+
+    // Device UUID, dashes optional
+    std::string hexDigits;
+    for (char c : text) {
+        if (c == '-') {
+            continue;
+        }
+        if (!isHex(c)) {
+            return std::nullopt;
+        }
+        hexDigits.push_back(c);
+    }
+    if (hexDigits.size() != VK_UUID_SIZE * 2) {
+        return std::nullopt;
+    }
+
+    std::array<uint8_t, VK_UUID_SIZE> uuid;
+    for (size_t i = 0; i < VK_UUID_SIZE; i++) {
+        uuid[i] = static_cast<uint8_t>(std::stoul(hexDigits.substr(i * 2, 2), nullptr, 16));
+    }
+    deviceOverride.deviceUUID = uuid;
+    return deviceOverride;
+}
+
+//---------------------------------
+// matchesPhysicalDeviceOverride()
+//---------------------------------
+bool matchesPhysicalDeviceOverride(const VkPhysicalDevice& physicalDevice, const PhysicalDeviceOverride& deviceOverride)
+{
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+
+    if (deviceOverride.vendorID.has_value() && deviceOverride.vendorID.value() != deviceProperties.vendorID) {
+        return false;
+    }
+    if (deviceOverride.deviceID.has_value() && deviceOverride.deviceID.value() != deviceProperties.deviceID) {
+        return false;
+    }
+
+    if (deviceOverride.deviceUUID.has_value()) {
+        // deviceUUID is only reported through the Vulkan 1.1 properties chain
+        if (deviceProperties.apiVersion < VK_API_VERSION_1_1) {
+            return false;
+        }
+
+        VkPhysicalDeviceIDProperties idProperties;
+        idProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES;
+        idProperties.pNext = nullptr;
+
+        VkPhysicalDeviceProperties2 properties2;
+        properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        properties2.pNext = &idProperties;
+        vkGetPhysicalDeviceProperties2(physicalDevice, &properties2);
+
+        if (memcmp(idProperties.deviceUUID, deviceOverride.deviceUUID.value().data(), VK_UUID_SIZE) != 0) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
 //---------------------------------
 // createShaderModule()
 //---------------------------------
-VkShaderModule createShaderModule(const VkDevice& device, const std::vector<char>& code)
+VkShaderModule createShaderModule(const VkDevice& device, const uint32_t* code, size_t codeSize)
 {
     VkShaderModuleCreateInfo createInfo;
     createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
     createInfo.pNext = nullptr;
     createInfo.flags = 0;
-    createInfo.codeSize = code.size();
-    createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+    createInfo.codeSize = codeSize;
+    createInfo.pCode = code;
 
     VkShaderModule shaderModule;
     if (vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
@@ -270,6 +481,500 @@ VkShaderModule createShaderModule(const VkDevice& device, const std::vector<char
     return shaderModule;
 }
 
+VkShaderModule createShaderModule(const VkDevice& device, const std::vector<uint32_t>& code)
+{
+    return createShaderModule(device, code.data(), code.size() * sizeof(uint32_t));
+}
+
+//---------------------------------
+// loadShaderModule()
+//---------------------------------
+VkShaderModule loadShaderModule(const VkDevice& device, const std::string& sourceName)
+{
+#ifdef EMBEDDED_SHADERS
+    // SPIR-V baked in by `make embed`; no file I/O and the arrays are already uint32_t aligned
+    for (const EmbeddedShaders::EmbeddedShader& shader : EmbeddedShaders::EMBEDDED_SHADERS) {
+        if (sourceName == shader.sourceName) {
+            return createShaderModule(device, shader.code, shader.codeSize);
+        }
+    }
+    throw std::runtime_error("loadShaderModule() No embedded SPIR-V for " + sourceName);
+#else
+    return createShaderModule(device, readSpirvFile(SHADER_DIRECTORY + "/" + sourceName + ".spv"));
+#endif
+}
+
+//---------------------------------
+// findMemoryType()
+//---------------------------------
+uint32_t findMemoryType(const VkPhysicalDevice& physicalDevice, uint32_t typeFilter, VkMemoryPropertyFlags properties)
+{
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+    for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+        if ((typeFilter & (1u << i)) && (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+            return i;
+        }
+    }
+
+    throw std::runtime_error("findMemoryType() Failed to find a suitable memory type!");
+}
+
+//---------------------------------
+// createBuffer()
+//---------------------------------
+void createBuffer(
+    const VkDevice& device,
+    const VkPhysicalDevice& physicalDevice,
+    VkDeviceSize size,
+    VkBufferUsageFlags usage,
+    VkMemoryPropertyFlags properties,
+    const std::vector<uint32_t>& queueFamilies,
+    VkBuffer& buffer,
+    VkDeviceMemory& bufferMemory)
+{
+    std::set<uint32_t> uniqueFamilySet(queueFamilies.begin(), queueFamilies.end());
+    std::vector<uint32_t> uniqueFamilies(uniqueFamilySet.begin(), uniqueFamilySet.end());
+
+    VkBufferCreateInfo bufferInfo;
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.pNext = nullptr;
+    bufferInfo.flags = 0;
+    bufferInfo.size = size;
+    bufferInfo.usage = usage;
+    if (uniqueFamilies.size() > 1) {
+        bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+        bufferInfo.queueFamilyIndexCount = static_cast<uint32_t>(uniqueFamilies.size());
+        bufferInfo.pQueueFamilyIndices = uniqueFamilies.data();
+    }
+    else {
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        bufferInfo.queueFamilyIndexCount = 0;
+        bufferInfo.pQueueFamilyIndices = nullptr;
+    }
+
+    if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
+        throw std::runtime_error("createBuffer() Failed to create buffer!");
+    }
+
+    VkMemoryRequirements memoryRequirements;
+    vkGetBufferMemoryRequirements(device, buffer, &memoryRequirements);
+
+    VkMemoryAllocateFlagsInfo allocateFlagsInfo;
+    allocateFlagsInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO;
+    allocateFlagsInfo.pNext = nullptr;
+    allocateFlagsInfo.flags = VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT;
+    allocateFlagsInfo.deviceMask = 0;
+
+    VkMemoryAllocateInfo allocateInfo;
+    allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocateInfo.pNext = (usage & VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT) != 0 ? &allocateFlagsInfo : nullptr;
+    allocateInfo.allocationSize = memoryRequirements.size;
+    allocateInfo.memoryTypeIndex = findMemoryType(physicalDevice, memoryRequirements.memoryTypeBits, properties);
+
+    if (vkAllocateMemory(device, &allocateInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
+        vkDestroyBuffer(device, buffer, nullptr);
+        throw std::runtime_error("createBuffer() Failed to allocate buffer memory!");
+    }
+
+    vkBindBufferMemory(device, buffer, bufferMemory, 0);
+}
+
+//---------------------------------
+// getBufferDeviceAddress()
+//---------------------------------
+VkDeviceAddress getBufferDeviceAddress(const VkDevice& device, const VkBuffer& buffer)
+{
+    VkBufferDeviceAddressInfo addressInfo;
+    addressInfo.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO;
+    addressInfo.pNext = nullptr;
+    addressInfo.buffer = buffer;
+
+    VkDeviceAddress address = vkGetBufferDeviceAddress(device, &addressInfo);
+    if (address == 0) {
+        throw std::runtime_error("getBufferDeviceAddress() Buffer has no device address!");
+    }
+    return address;
+}
+
+//---------------------------------
+// beginSingleTimeCommands()
+//---------------------------------
+VkCommandBuffer beginSingleTimeCommands(const VkDevice& device, const VkCommandPool& commandPool)
+{
+    VkCommandBufferAllocateInfo allocateInfo;
+    allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocateInfo.pNext = nullptr;
+    allocateInfo.commandPool = commandPool;
+    allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocateInfo.commandBufferCount = 1;
+
+    VkCommandBuffer commandBuffer;
+    if (vkAllocateCommandBuffers(device, &allocateInfo, &commandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("beginSingleTimeCommands() Failed to allocate command buffer!");
+    }
+
+    VkCommandBufferBeginInfo beginInfo;
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.pNext = nullptr;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    beginInfo.pInheritanceInfo = nullptr;
+
+    vkBeginCommandBuffer(commandBuffer, &beginInfo);
+    return commandBuffer;
+}
+
+//---------------------------------
+// endSingleTimeCommands()
+//---------------------------------
+void endSingleTimeCommands(const VkDevice& device, const VkCommandPool& commandPool, const VkQueue& queue, VkCommandBuffer commandBuffer)
+{
+    vkEndCommandBuffer(commandBuffer);
+
+    VkSubmitInfo submitInfo;
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.pNext = nullptr;
+    submitInfo.waitSemaphoreCount = 0;
+    submitInfo.pWaitSemaphores = nullptr;
+    submitInfo.pWaitDstStageMask = nullptr;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+    submitInfo.signalSemaphoreCount = 0;
+    submitInfo.pSignalSemaphores = nullptr;
+
+    if (vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+        throw std::runtime_error("endSingleTimeCommands() Failed to submit command buffer!");
+    }
+    vkQueueWaitIdle(queue);
+
+    vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
+}
+
+//---------------------------------
+// createDeviceLocalBuffer()
+//---------------------------------
+void createDeviceLocalBuffer(
+    const VkDevice& device,
+    const VkPhysicalDevice& physicalDevice,
+    const VkCommandPool& commandPool,
+    const VkQueue& queue,
+    const void* data,
+    VkDeviceSize size,
+    VkBufferUsageFlags usage,
+    const std::vector<uint32_t>& queueFamilies,
+    VkBuffer& buffer,
+    VkDeviceMemory& bufferMemory)
+{
+    createDeviceLocalBuffer(
+        device,
+        physicalDevice,
+        commandPool,
+        queue,
+        [data, size](void* mapped) { memcpy(mapped, data, static_cast<size_t>(size)); },
+        size,
+        usage,
+        queueFamilies,
+        buffer,
+        bufferMemory);
+}
+
+//---------------------------------
+// createDeviceLocalBuffer()
+//---------------------------------
+void createDeviceLocalBuffer(
+    const VkDevice& device,
+    const VkPhysicalDevice& physicalDevice,
+    const VkCommandPool& commandPool,
+    const VkQueue& queue,
+    const std::function<void(void*)>& writeContents,
+    VkDeviceSize size,
+    VkBufferUsageFlags usage,
+    const std::vector<uint32_t>& queueFamilies,
+    VkBuffer& buffer,
+    VkDeviceMemory& bufferMemory)
+{
+    VkBuffer stagingBuffer;
+    VkDeviceMemory stagingBufferMemory;
+    createBuffer(
+        device,
+        physicalDevice,
+        size,
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        {},
+        stagingBuffer,
+        stagingBufferMemory);
+
+    void* mapped = nullptr;
+    vkMapMemory(device, stagingBufferMemory, 0, size, 0, &mapped);
+    writeContents(mapped);
+    vkUnmapMemory(device, stagingBufferMemory);
+
+    createBuffer(
+        device,
+        physicalDevice,
+        size,
+        usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        queueFamilies,
+        buffer,
+        bufferMemory);
+
+    VkCommandBuffer commandBuffer = beginSingleTimeCommands(device, commandPool);
+    VkBufferCopy copyRegion;
+    copyRegion.srcOffset = 0;
+    copyRegion.dstOffset = 0;
+    copyRegion.size = size;
+    vkCmdCopyBuffer(commandBuffer, stagingBuffer, buffer, 1, &copyRegion);
+    endSingleTimeCommands(device, commandPool, queue, commandBuffer);
+
+    vkDestroyBuffer(device, stagingBuffer, nullptr);
+    vkFreeMemory(device, stagingBufferMemory, nullptr);
+}
+
+//---------------------------------
+// createImage()
+//---------------------------------
+void createImage(
+    const VkDevice& device,
+    const VkPhysicalDevice& physicalDevice,
+    uint32_t width,
+    uint32_t height,
+    uint32_t mipLevels,
+    VkFormat format,
+    VkImageUsageFlags usage,
+    VkImage& image,
+    VkDeviceMemory& imageMemory)
+{
+    VkImageCreateInfo imageInfo;
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.pNext = nullptr;
+    imageInfo.flags = 0;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.format = format;
+    imageInfo.extent.width = width;
+    imageInfo.extent.height = height;
+    imageInfo.extent.depth = 1;
+    imageInfo.mipLevels = mipLevels;
+    imageInfo.arrayLayers = 1;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.usage = usage;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.queueFamilyIndexCount = 0;
+    imageInfo.pQueueFamilyIndices = nullptr;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    if (vkCreateImage(device, &imageInfo, nullptr, &image) != VK_SUCCESS) {
+        throw std::runtime_error("createImage() Failed to create image!");
+    }
+
+    VkMemoryRequirements memoryRequirements;
+    vkGetImageMemoryRequirements(device, image, &memoryRequirements);
+
+    VkMemoryAllocateInfo allocateInfo;
+    allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocateInfo.pNext = nullptr;
+    allocateInfo.allocationSize = memoryRequirements.size;
+    allocateInfo.memoryTypeIndex
+        = findMemoryType(physicalDevice, memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    if (vkAllocateMemory(device, &allocateInfo, nullptr, &imageMemory) != VK_SUCCESS) {
+        vkDestroyImage(device, image, nullptr);
+        throw std::runtime_error("createImage() Failed to allocate image memory!");
+    }
+
+    vkBindImageMemory(device, image, imageMemory, 0);
+}
+
+//---------------------------------
+// createImageView()
+//---------------------------------
+VkImageView createImageView(
+    const VkDevice& device,
+    const VkImage& image,
+    VkFormat format,
+    VkImageAspectFlags aspectMask,
+    uint32_t baseMipLevel,
+    uint32_t levelCount)
+{
+    VkImageViewCreateInfo createInfo;
+    createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    createInfo.pNext = nullptr;
+    createInfo.flags = 0;
+    createInfo.image = image;
+    createInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    createInfo.format = format;
+    createInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
+    createInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
+    createInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
+    createInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+    createInfo.subresourceRange.aspectMask = aspectMask;
+    createInfo.subresourceRange.baseMipLevel = baseMipLevel;
+    createInfo.subresourceRange.levelCount = levelCount;
+    createInfo.subresourceRange.baseArrayLayer = 0;
+    createInfo.subresourceRange.layerCount = 1;
+
+    VkImageView imageView;
+    if (vkCreateImageView(device, &createInfo, nullptr, &imageView) != VK_SUCCESS) {
+        throw std::runtime_error("createImageView() Failed to create image view!");
+    }
+    return imageView;
+}
+
+//---------------------------------
+// findSupportedFormat()
+//---------------------------------
+VkFormat findSupportedFormat(
+    const VkPhysicalDevice& physicalDevice,
+    const std::vector<VkFormat>& candidates,
+    VkFormatFeatureFlags features)
+{
+    for (VkFormat format : candidates) {
+        VkFormatProperties properties;
+        vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &properties);
+        if ((properties.optimalTilingFeatures & features) == features) {
+            return format;
+        }
+    }
+
+    throw std::runtime_error("findSupportedFormat() Failed to find a supported format!");
+}
+
+//---------------------------------
+// findDepthFormat()
+//---------------------------------
+VkFormat findDepthFormat(const VkPhysicalDevice& physicalDevice)
+{
+    return findSupportedFormat(
+        physicalDevice,
+        {VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT},
+        VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT);
+}
+
+//---------------------------------
+// releaseBufferOwnership()
+//---------------------------------
+void releaseBufferOwnership(
+    VkCommandBuffer commandBuffer,
+    VkBuffer buffer,
+    uint32_t srcFamily,
+    uint32_t dstFamily,
+    VkPipelineStageFlags srcStage,
+    VkAccessFlags srcAccess)
+{
+    if (srcFamily == dstFamily) {
+        return;
+    }
+
+    VkBufferMemoryBarrier barrier;
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.pNext = nullptr;
+    barrier.srcAccessMask = srcAccess;
+    barrier.dstAccessMask = 0; // Ignored for the release half
+    barrier.srcQueueFamilyIndex = srcFamily;
+    barrier.dstQueueFamilyIndex = dstFamily;
+    barrier.buffer = buffer;
+    barrier.offset = 0;
+    barrier.size = VK_WHOLE_SIZE;
+
+    vkCmdPipelineBarrier(commandBuffer, srcStage, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+}
+
+//---------------------------------
+// acquireBufferOwnership()
+//---------------------------------
+void acquireBufferOwnership(
+    VkCommandBuffer commandBuffer,
+    VkBuffer buffer,
+    uint32_t srcFamily,
+    uint32_t dstFamily,
+    VkPipelineStageFlags dstStage,
+    VkAccessFlags dstAccess)
+{
+    bool sameFamily = srcFamily == dstFamily;
+
+    VkBufferMemoryBarrier barrier;
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.pNext = nullptr;
+    barrier.srcAccessMask = sameFamily ? VK_ACCESS_MEMORY_WRITE_BIT : 0; // Ignored for the acquire half
+    barrier.dstAccessMask = dstAccess;
+    barrier.srcQueueFamilyIndex = sameFamily ? VK_QUEUE_FAMILY_IGNORED : srcFamily;
+    barrier.dstQueueFamilyIndex = sameFamily ? VK_QUEUE_FAMILY_IGNORED : dstFamily;
+    barrier.buffer = buffer;
+    barrier.offset = 0;
+    barrier.size = VK_WHOLE_SIZE;
+
+    VkPipelineStageFlags srcStage = sameFamily ? VK_PIPELINE_STAGE_ALL_COMMANDS_BIT : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+    vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+}
+
+//---------------------------------
+// releaseImageOwnership()
+//---------------------------------
+void releaseImageOwnership(
+    VkCommandBuffer commandBuffer,
+    VkImage image,
+    const VkImageSubresourceRange& subresourceRange,
+    VkImageLayout oldLayout,
+    VkImageLayout newLayout,
+    uint32_t srcFamily,
+    uint32_t dstFamily,
+    VkPipelineStageFlags srcStage,
+    VkAccessFlags srcAccess)
+{
+    if (srcFamily == dstFamily) {
+        return;
+    }
+
+    VkImageMemoryBarrier barrier;
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.pNext = nullptr;
+    barrier.srcAccessMask = srcAccess;
+    barrier.dstAccessMask = 0; // Ignored for the release half
+    barrier.oldLayout = oldLayout;
+    barrier.newLayout = newLayout;
+    barrier.srcQueueFamilyIndex = srcFamily;
+    barrier.dstQueueFamilyIndex = dstFamily;
+    barrier.image = image;
+    barrier.subresourceRange = subresourceRange;
+
+    vkCmdPipelineBarrier(commandBuffer, srcStage, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+//---------------------------------
+// acquireImageOwnership()
+//---------------------------------
+void acquireImageOwnership(
+    VkCommandBuffer commandBuffer,
+    VkImage image,
+    const VkImageSubresourceRange& subresourceRange,
+    VkImageLayout oldLayout,
+    VkImageLayout newLayout,
+    uint32_t srcFamily,
+    uint32_t dstFamily,
+    VkPipelineStageFlags dstStage,
+    VkAccessFlags dstAccess)
+{
+    bool sameFamily = srcFamily == dstFamily;
+
+    VkImageMemoryBarrier barrier;
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.pNext = nullptr;
+    barrier.srcAccessMask = sameFamily ? VK_ACCESS_MEMORY_WRITE_BIT : 0; // Ignored for the acquire half
+    barrier.dstAccessMask = dstAccess;
+    barrier.oldLayout = oldLayout;
+    barrier.newLayout = newLayout;
+    barrier.srcQueueFamilyIndex = sameFamily ? VK_QUEUE_FAMILY_IGNORED : srcFamily;
+    barrier.dstQueueFamilyIndex = sameFamily ? VK_QUEUE_FAMILY_IGNORED : dstFamily;
+    barrier.image = image;
+    barrier.subresourceRange = subresourceRange;
+
+    VkPipelineStageFlags srcStage = sameFamily ? VK_PIPELINE_STAGE_ALL_COMMANDS_BIT : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+    vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
 //---------------------------------
 // populateDebugMessengerCreateInfo()
 //---------------------------------